@@ -8,5 +8,6 @@ void generate_code(Program *program, const char *output_file);
 const char *get_python_type_name(VariableType type);
 void indent(FILE *fp, int indent);
 void generate_structs(FILE *fp, Struct *structs, int struct_count);
+char format_conversion(const char *format, int index);
 
 #endif
\ No newline at end of file
@@ -12,13 +12,19 @@ typedef enum {
     TOKEN_PLUS, TOKEN_MINUS, TOKEN_MULTIPLY, TOKEN_DIVIDE, TOKEN_MOD,
     TOKEN_EQUALS, TOKEN_EQ, TOKEN_NEQ, TOKEN_LT, TOKEN_GT, TOKEN_LTE, TOKEN_GTE,
     TOKEN_AND, TOKEN_OR, TOKEN_NOT, TOKEN_INCR, TOKEN_DECR,
+
+    // Compound assignment operators (+=, -=, ...)
+    TOKEN_PLUS_ASSIGN, TOKEN_MINUS_ASSIGN, TOKEN_MULTIPLY_ASSIGN, TOKEN_DIVIDE_ASSIGN, TOKEN_MOD_ASSIGN,
+    TOKEN_BIT_AND_ASSIGN, TOKEN_BIT_OR_ASSIGN, TOKEN_BIT_XOR_ASSIGN,
+    TOKEN_SHIFT_LEFT_ASSIGN, TOKEN_SHIFT_RIGHT_ASSIGN,
     
     // Punctuation
     TOKEN_SEMICOLON, TOKEN_LPAREN, TOKEN_RPAREN, TOKEN_LBRACE, TOKEN_RBRACE,
-    TOKEN_LBRACKET, TOKEN_RBRACKET, TOKEN_COMMA, TOKEN_DOT,
+    TOKEN_LBRACKET, TOKEN_RBRACKET, TOKEN_COMMA, TOKEN_DOT, TOKEN_COLON,
     
     // Flow control
     TOKEN_IF, TOKEN_ELSE, TOKEN_WHILE, TOKEN_FOR, TOKEN_DO, TOKEN_RETURN, TOKEN_BREAK, TOKEN_CONTINUE,
+    TOKEN_SWITCH, TOKEN_CASE, TOKEN_DEFAULT,
     
     // Functions
     TOKEN_PRINTF, TOKEN_SCANF,
@@ -30,6 +36,9 @@ typedef enum {
     TOKEN_BIT_AND, TOKEN_BIT_OR, TOKEN_BIT_XOR, 
     TOKEN_BIT_NOT, TOKEN_SHIFT_LEFT, TOKEN_SHIFT_RIGHT,
 
+    // Storage classes
+    TOKEN_EXTERN, TOKEN_STATIC,
+
     // Inline assembly
     TOKEN_ASM,  // Added for inline assembly support
     
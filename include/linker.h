@@ -0,0 +1,10 @@
+#ifndef LINKER_H
+#define LINKER_H
+
+#include "parser.h"
+
+// Merge the programs parsed from several translation units into one program;
+// returns NULL after reporting a link error
+Program *link_programs(Program **units, const char **files, int count);
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <stdio.h>
+#include "parser.h"
+
+// Optimizer settings, filled in from the command line by main.c
+typedef struct
+{
+    int enabled;          // 0 when -O0 is given; skips every optimization pass
+    int memo_cache_size;  // lru_cache maxsize for memoized functions (-1 = unbounded, 0 = no memoization)
+    int tabulate_max_size; // Largest table (in entries) built for bottom-up tabulation (0 = off)
+    int eval_step_budget; // Interpreter steps per compile-time evaluation (0 = off)
+    int max_clones;       // Specialized clones per function (0 = no specialization)
+    const char *exports;  // Comma-separated names kept besides main (NULL = main only)
+    const char *profile_generate; // File the instrumented program writes its counts to (NULL = off)
+    const char *profile_use;      // Counts from an instrumented run that guide the passes (NULL = off)
+    int unswitch_growth;  // Statements unswitching may add per loop (0 = no unswitching)
+    int cost_report;      // Print estimated interpreter operations per function and loop nest
+} OptimizerOptions;
+
+extern OptimizerOptions optimizer_options;
+
+// Closed integer interval [lo, hi]; lo > hi means the value is unreachable
+typedef struct
+{
+    long long lo;
+    long long hi;
+} Interval;
+
+// Known ranges for named variables
+typedef struct
+{
+    char **names;
+    Interval *ranges;
+    int count;
+} RangeEnv;
+
+// Callbacks used by the AST walkers (pre-order)
+typedef void (*ExpressionVisitor)(Expression *expr, void *ctx);
+typedef void (*StatementVisitor)(Statement *stmt, void *ctx);
+typedef Statement *(*StatementTransform)(Statement *stmt, void *ctx);
+
+// Run all enabled passes over the program, then lower C integer semantics
+int optimize_program(Program *prog);
+
+// AST helpers shared by the passes
+Function *find_function(Program *prog, const char *name);
+int is_pure_builtin(const char *name);
+int call_is_pure(Program *prog, const char *name);
+Expression *make_int_literal(int value);
+Expression *make_variable(const char *name);
+Expression *make_binary(BinaryOpType op, Expression *left, Expression *right);
+Expression *make_call(const char *name, Expression **args, int arg_count);
+Expression *make_list(Expression **elements, int count);
+Expression *make_slice(const char *array, Expression *start, Expression *stop);
+Expression *offset_expression(Expression *expr, int offset);
+Statement *make_expression_statement(Expression *expr);
+Statement *make_block();
+void block_append(Statement *block, Statement *stmt);
+int statement_always_returns(Statement *stmt);
+int is_global_name(Program *prog, const char *name);
+int is_local_name(Function *func, const char *name);
+void visit_expression(Expression *expr, ExpressionVisitor visit, void *ctx);
+void visit_statement_expressions(Statement *stmt, ExpressionVisitor visit, void *ctx);
+void visit_statements(Statement *stmt, StatementVisitor visit, void *ctx);
+Statement *transform_statements(Statement *stmt, StatementTransform transform, void *ctx);
+int expression_mentions(Expression *expr, const char *name);
+int expressions_equal(Expression *a, Expression *b);
+Expression *written_target(Expression *expr);
+const char *base_variable_name(Expression *target);
+int statement_writes_variable(Statement *stmt, const char *name);
+int count_variable_reads(Statement *stmt, const char *name);
+int statement_has_impure_calls(Program *prog, Statement *stmt);
+int statement_has_print(Statement *stmt);
+int expression_has_side_effects(Program *prog, Expression *expr);
+int expression_is_invariant(Program *prog, Expression *expr, Statement *body);
+Variable *lookup_local(Function *func, const char *name);
+Variable *lookup_variable(Program *prog, Function *func, const char *name);
+Variable *lookup_field(Program *prog, const char *struct_name, const char *field);
+Variable *lookup_member(Program *prog, Function *func, Expression *expr);
+int expression_is_integer(Program *prog, Function *func, Expression *expr);
+VariableType expression_type(Program *prog, Function *func, Expression *expr);
+int function_may_trap(Program *prog, Function *func);
+int expression_may_trap(Program *prog, Expression *expr);
+
+// Value ranges
+Interval interval_full();
+Interval interval_const(long long value);
+int interval_is_empty(Interval range);
+int interval_is_bounded(Interval range);
+Interval interval_hull(Interval a, Interval b);
+RangeEnv *range_env_create();
+RangeEnv *range_env_copy(RangeEnv *env);
+void range_env_free(RangeEnv *env);
+void range_env_set(RangeEnv *env, const char *name, Interval range);
+Interval range_env_get(RangeEnv *env, const char *name);
+void range_env_join(RangeEnv *env, RangeEnv *other);
+Interval interval_of_expression(Expression *expr, RangeEnv *env);
+void refine_by_condition(Expression *cond, int truth, RangeEnv *env);
+BinaryOpType mirror_comparison(BinaryOpType op);
+BinaryOpType negate_comparison(BinaryOpType op);
+
+// Analyses
+void analyze_purity(Program *prog);
+int function_reaches(Program *prog, Function *from, Function *target);
+int constant_local_value(Function *func, Expression *expr, long long *value);
+void report_costs(Program *prog, FILE *out);
+
+// Transformations
+void scalarize_struct_locals(Program *prog);
+void cache_member_accesses(Program *prog);
+void evaluate_constant_calls(Program *prog);
+int evaluate_constant(Program *prog, Expression *expr, long long *value);
+int constant_argument(Function *caller, Expression *arg, long long *value);
+int simplify_statement(Program *prog, Statement **stmt);
+void specialize_functions(Program *prog);
+void tabulate_functions(Program *prog);
+int statement_declares(Statement *stmt, const char *name);
+void fuse_loops(Program *prog);
+void unswitch_loops(Program *prog);
+int match_increment(Expression *expr, const char *var, int *step);
+void lower_range_loops(Program *prog);
+int read_after_loop(Statement *scope, Statement *loop, const char *var);
+int array_size_of(Program *prog, Function *func, const char *name);
+Expression *slice_stop(Expression *stop);
+Statement *single_statement(Statement *stmt);
+int match_accumulate(Expression *expr, const char **acc, BinaryOpType *op, Expression **value);
+int expression_uses_array(Expression *expr, const char *name);
+int statement_uses_array(Statement *stmt, const char *name);
+void collapse_array_fills(Program *prog);
+void lower_copy_loops(Program *prog);
+void reduce_induction_variables(Program *prog);
+int is_bit_builtin(const char *name);
+void recognize_bit_idioms(Program *prog);
+int is_int_reduction(const char *name);
+void recognize_loop_idioms(Program *prog);
+Statement **loop_body_slot(Statement *loop);
+void hoist_loop_invariants(Program *prog);
+void eliminate_common_subexpressions(Program *prog);
+int is_exported_name(const char *name);
+void shake_unused_definitions(Program *prog);
+int int_literal(Expression *expr, long long *value);
+Expression *add_offset(Expression *base, Expression *offset);
+int lower_memory_calls(Program *prog);
+void lower_switch_statements(Program *prog);
+void freeze_constant_tables(Program *prog);
+void add_global_table(Program *prog, const char *name, VariableType type, int size);
+int is_intrinsic(const char *name);
+VariableType intrinsic_result_type(const char *name, VariableType arg_type);
+void lower_intrinsic_calls(Program *prog);
+void lower_inline_asm(Program *prog);
+void instrument_program(Program *prog);
+void apply_profile(Program *prog, const char *path);
+int function_is_cold(Function *func);
+int loop_is_cold(Statement *loop);
+void lower_integer_semantics(Program *prog);
+int function_rebinds_global(Program *prog, Function *func, const char *name);
+void bind_global_names(Program *prog);
+
+#endif
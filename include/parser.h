@@ -35,6 +35,8 @@ typedef struct
     int is_array;
     int array_size;
     char *struct_name; // Added to track struct type for variables
+    Expression *elements; // Brace initializer of a global array (an EXPR_LIST of literals), or NULL
+    int is_constant;      // Never written; set by freeze_constant_tables and emitted as a tuple or bytes
 } Variable;
 
 // Struct structure
@@ -55,7 +57,10 @@ typedef enum
     EXPR_CALL,
     EXPR_ARRAY_ACCESS,
     EXPR_MEMBER_ACCESS, // Added for struct member access (e.g., p.x)
-    EXPR_ASM           // Added for inline assembly
+    EXPR_ASM,          // Added for inline assembly
+    EXPR_SLICE,        // Python slice (e.g., a[lo:hi]); produced by the optimizer
+    EXPR_GENERATOR,    // Python generator expression (e.g., x * x for x in a); produced by the optimizer
+    EXPR_LIST          // Python list display (e.g., [0]); produced by the optimizer
 } ExpressionType;
 
 // Binary operation types
@@ -80,6 +85,11 @@ typedef enum
     OP_BIT_XOR,
     OP_SHIFT_LEFT,
     OP_SHIFT_RIGHT,
+    OP_FLOOR_DIV,  // Python // on ints; produced by the optimizer
+    OP_IN,         // Python membership test; produced by the optimizer
+    OP_TRUNC_DIV,  // C int division (rounds toward zero); produced by the optimizer
+    OP_TRUNC_MOD,  // C int remainder (sign of the dividend); produced by the optimizer
+    OP_POW,        // Python ** (from pow()); produced by the optimizer
 } BinaryOpType;
 
 // Unary operation types
@@ -92,6 +102,7 @@ typedef enum
     OP_POST_INC,
     OP_POST_DEC,
     OP_BIT_NOT,
+    OP_WRAP_INT,   // Reduce to a 32-bit signed int; produced by the optimizer
 } UnaryOpType;
 
 // Inline assembly operand
@@ -174,6 +185,31 @@ struct Expression
 
         // Inline assembly
         AsmBlock asm_block;
+
+        // Slice of an array (start/stop may be NULL for an open end)
+        struct
+        {
+            char *array_name;
+            Expression *start;
+            Expression *stop;
+        } slice;
+
+        // Generator expression: (element for var in iterable if condition)
+        struct
+        {
+            Expression *element;
+            Variable var;          // Typed like the loop variable it replaces
+            Expression *iterable;
+            Expression *condition; // NULL when every item is produced
+            int is_list;           // Emitted as a list comprehension [...]
+        } generator;
+
+        // List display: [elements...]
+        struct
+        {
+            Expression **elements;
+            int count;
+        } list;
     };
 };
 
@@ -189,13 +225,26 @@ typedef enum
     STMT_RETURN,
     STMT_BREAK,
     STMT_CONTINUE,
-    STMT_PRINT
+    STMT_PRINT,
+    STMT_FOR_IN, // Python for-in loop (e.g., for i in range(n)); produced by the optimizer
+    STMT_SWITCH  // C switch; lowered by lower_switch_statements before any other pass
 } StatementType;
 
+// One group of consecutive case labels in a switch and the statements after them
+typedef struct
+{
+    Expression **labels;
+    int label_count;
+    int is_default;   // The default label is one of the group's labels
+    Statement *body;  // Block; runs on into the next group unless it breaks
+} SwitchCase;
+
 // Statement structure
 struct Statement
 {
     StatementType type;
+    int line;                // C source line it was parsed from (0 = made by the optimizer)
+    long long profile_count; // Loops: body executions read by --profile-use (-1 = no profile)
     union
     {
         // Expression statement
@@ -249,6 +298,23 @@ struct Statement
             Expression **args;
             int arg_count;
         } print;
+
+        // For-in loop; else_branch runs when the loop ends without break
+        struct
+        {
+            Variable var;          // Loop variable (never an array)
+            Expression *iterable;
+            Statement *body;
+            Statement *else_branch;
+        } for_in;
+
+        // Switch statement; cases in source order
+        struct
+        {
+            Expression *value;
+            SwitchCase *cases;
+            int case_count;
+        } switch_stmt;
     };
 };
 
@@ -260,6 +326,15 @@ struct Function
     Variable *params;
     int param_count;
     Statement *body;
+    int is_pure;      // Set by analyze_purity: no global writes, printf, asm or array/struct mutation
+    int is_recursive; // Set by analyze_purity: reaches itself through the call graph
+    int memoize;      // Emit with an lru_cache decorator
+    char **default_names;  // Extra parameters bound once when the def runs (name=value)
+    char **default_values;
+    int default_count;
+    long long profile_calls; // Calls read by --profile-use (-1 = no profile)
+    int line;                // C source line of the definition (0 = made by the optimizer)
+    const char *source_file; // Input file of the definition, set by link_programs
 };
 
 // Program structure
@@ -271,12 +346,26 @@ typedef struct
     int global_var_count;
     Struct *structs;
     int struct_count;
+    Statement *init_block; // Module-level statements run after all definitions (may be NULL)
+    char **static_names;   // Functions and globals declared static (private to their unit)
+    int static_count;
+    Variable *extern_vars; // Globals declared extern, resolved by link_programs
+    int extern_count;
+    char **profile_sites;  // Counter names for --profile-generate, in counter order
+    int profile_site_count;
 } Program;
 
 // Global variables for the current program
 extern Program *program;
 
 // Parser functions
+Expression *create_expression();
+char char_literal_value(const char *text);
+Statement *create_statement();
+Function *create_function();
+Expression *clone_expression(Expression *expr);
+Statement *clone_statement(Statement *stmt);
+int literal_elements(Expression *list);
 Program *parse(Token *tokens, int token_count);
 void free_program(Program *program);
 
@@ -32,20 +32,9 @@ if (-not (Test-Path "test")) {
     exit 1
 }
 
-# Find all .c files in the test folder
-$c_files = Get-ChildItem -Path "test" -Recurse -Include "*.c"
-
-# Check if there are any .c files
-if ($c_files.Count -eq 0) {
-    Write-Host "Error: No .c files found in test folder."
-    exit 1
-}
-
-# Process each .c file
-foreach ($c_file in $c_files) {
-    # Extract the base name (e.g., test_struct from test\test_struct.c)
-    $base_name = [System.IO.Path]::GetFileNameWithoutExtension($c_file.Name)
-    Write-Host "Processing $($c_file.FullName)..."
+# Compile a program from one or more C files, run it and save its output
+function Process-Program($base_name, $inputs) {
+    Write-Host "Processing $($inputs -join ' ')..."
 
     # Define output Python file path
     $py_file = "test_result\$base_name.py"
@@ -53,16 +42,16 @@ foreach ($c_file in $c_files) {
     $output_file = "test_result\$base_name.txt"
 
     # Run csnakecompiler to generate Python file
-    ./csnakecompiler "$($c_file.FullName)" -o "$py_file"
+    ./csnakecompiler @inputs -o "$py_file"
     if ($LASTEXITCODE -ne 0) {
-        Write-Host "Error: Failed to compile $($c_file.FullName)"
-        continue
+        Write-Host "Error: Failed to compile $($inputs -join ' ')"
+        return
     }
 
     # Check if Python file was generated
     if (-not (Test-Path "$py_file")) {
         Write-Host "Error: Python file $py_file not generated."
-        continue
+        return
     }
 
     # Run the generated Python file and capture output
@@ -81,4 +70,26 @@ foreach ($c_file in $c_files) {
     }
 }
 
-Write-Host "All tests processed. Results are in test_result folder."
\ No newline at end of file
+# Find all .c files in the test folder
+$c_files = Get-ChildItem -Path "test" -Filter "*.c" -File
+
+# Check if there are any .c files
+if ($c_files.Count -eq 0) {
+    Write-Host "Error: No .c files found in test folder."
+    exit 1
+}
+
+# Process each .c file
+foreach ($c_file in $c_files) {
+    # Extract the base name (e.g., test_struct from test\test_struct.c)
+    $base_name = [System.IO.Path]::GetFileNameWithoutExtension($c_file.Name)
+    Process-Program $base_name @($c_file.FullName)
+}
+
+# Each subfolder of test is one program made of several translation units
+foreach ($dir in Get-ChildItem -Path "test" -Directory) {
+    $inputs = @(Get-ChildItem -Path $dir.FullName -Filter "*.c" -File | ForEach-Object { $_.FullName })
+    Process-Program $dir.Name $inputs
+}
+
+Write-Host "All tests processed. Results are in test_result folder."
@@ -39,20 +39,11 @@ if [ ! -d "test" ]; then
     exit 1
 fi
 
-# Find all .c files in the test folder
-c_files=$(find test -type f -name "*.c")
-
-# Check if there are any .c files
-if [ -z "$c_files" ]; then
-    echo "Error: No .c files found in test folder."
-    exit 1
-fi
-
-# Process each .c file
-for c_file in $c_files; do
-    # Extract the base name (e.g., test_struct from test/test_struct.c)
-    base_name=$(basename "$c_file" .c)
-    echo "Processing $c_file..."
+# Compile a program from one or more C files, run it and save its output
+process_program() {
+    base_name=$1
+    shift
+    echo "Processing $*..."
 
     # Define output Python file path
     py_file="test_result/$base_name.py"
@@ -60,16 +51,16 @@ for c_file in $c_files; do
     output_file="test_result/$base_name.txt"
 
     # Run csnakecompiler to generate Python file
-    ./csnakecompiler "$c_file" -o "$py_file"
+    ./csnakecompiler "$@" -o "$py_file"
     if [ $? -ne 0 ]; then
-        echo "Error: Failed to compile $c_file"
-        continue
+        echo "Error: Failed to compile $*"
+        return
     fi
 
     # Check if Python file was generated
     if [ ! -f "$py_file" ]; then
         echo "Error: Python file $py_file not generated."
-        continue
+        return
     fi
 
     # Run the generated Python file and capture output
@@ -80,6 +71,26 @@ for c_file in $c_files; do
     else
         echo "Output saved to $output_file"
     fi
+}
+
+# Find all .c files in the test folder
+c_files=$(find test -maxdepth 1 -type f -name "*.c")
+
+# Check if there are any .c files
+if [ -z "$c_files" ]; then
+    echo "Error: No .c files found in test folder."
+    exit 1
+fi
+
+# Process each .c file
+for c_file in $c_files; do
+    # Extract the base name (e.g., test_struct from test/test_struct.c)
+    process_program "$(basename "$c_file" .c)" "$c_file"
+done
+
+# Each subfolder of test is one program made of several translation units
+for dir in $(find test -mindepth 1 -maxdepth 1 -type d); do
+    process_program "$(basename "$dir")" "$dir"/*.c
 done
 
 echo "All tests processed. Results are in test_result folder."
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Array fills. Runs on the for-in loops produced by lower_range_loops. A loop
+// that stores a function of the index into every element of a local array
+//     int a[8]; ... for (i = 0; i < 8; i++) a[i] = i * i;
+// is collapsed into the array's declaration as a list comprehension:
+//     a: List[int] = [(i * i) for i in range(0, 8)]
+// an affine fill such as a[i] = 3 * i + 1 becomes list(range(1, 25, 3)) and
+// a fill with a value that does not depend on i becomes [v] * 8.
+// A fill of an array declared elsewhere, or of part of it, assigns a slice
+// instead. The stored value may not read the array (so no iteration depends
+// on an earlier one) or have side effects, and the bounds must be constants
+// that lie within the array.
+
+typedef struct {
+    Program *prog;
+    Function *func;
+} FillContext;
+
+typedef struct {
+    const char *name;
+    int found;
+} ArrayScan;
+
+void find_array_use(Expression *expr, void *ctx) {
+    ArrayScan *scan = ctx;
+    const char *name = NULL;
+    switch (expr->type) {
+        case EXPR_VARIABLE: name = expr->var_name; break;
+        case EXPR_ARRAY_ACCESS: name = expr->array_access.array_name; break;
+        case EXPR_SLICE: name = expr->slice.array_name; break;
+        default: return;
+    }
+    if (strcmp(name, scan->name) == 0) scan->found = 1;
+}
+
+int expression_uses_array(Expression *expr, const char *name) {
+    ArrayScan scan = { name, 0 };
+    visit_expression(expr, find_array_use, &scan);
+    return scan.found;
+}
+
+int statement_uses_array(Statement *stmt, const char *name) {
+    ArrayScan scan = { name, 0 };
+    visit_statement_expressions(stmt, find_array_use, &scan);
+    return scan.found;
+}
+
+// Match scale * var + offset with integer constants
+int match_affine(Expression *expr, const char *var, long long *scale, long long *offset) {
+    long long s1, o1, s2, o2;
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            if (expr->literal.lit_type != TYPE_INT) return 0;
+            *scale = 0;
+            *offset = expr->literal.int_val;
+            return 1;
+        case EXPR_VARIABLE:
+            if (strcmp(expr->var_name, var) != 0) return 0;
+            *scale = 1;
+            *offset = 0;
+            return 1;
+        case EXPR_UNARY:
+            if (expr->unary.op != OP_NEGATE || !match_affine(expr->unary.expr, var, &s1, &o1)) return 0;
+            *scale = -s1;
+            *offset = -o1;
+            return 1;
+        case EXPR_BINARY:
+            if (!match_affine(expr->binary.left, var, &s1, &o1) || !match_affine(expr->binary.right, var, &s2, &o2)) {
+                return 0;
+            }
+            switch (expr->binary.op) {
+                case OP_ADD: *scale = s1 + s2; *offset = o1 + o2; return 1;
+                case OP_SUB: *scale = s1 - s2; *offset = o1 - o2; return 1;
+                case OP_MUL:
+                    if (s1 != 0 && s2 != 0) return 0;
+                    *scale = s1 * o2 + s2 * o1;
+                    *offset = o1 * o2;
+                    return 1;
+                default:
+                    return 0;
+            }
+        default:
+            return 0;
+    }
+}
+
+int fits_int(long long value) {
+    return value >= -2147483648LL && value <= 2147483647LL;
+}
+
+// The values a fill stores into a[start:stop], as one list expression
+Expression *fill_values(Program *prog, Expression *element, const char *var, long long start, long long stop) {
+    Expression *range_args[3] = { make_int_literal((int)start), make_int_literal((int)stop), NULL };
+    if (!expression_mentions(element, var) && !expression_may_trap(prog, element)) {
+        return make_binary(OP_MUL, make_list(&element, 1), make_int_literal((int)(stop - start)));
+    }
+    long long scale, offset;
+    if (match_affine(element, var, &scale, &offset) && scale != 0 &&
+        fits_int(scale * start + offset) && fits_int(scale * stop + offset)) {
+        // Every element fits in an int, so the C expression never wraps
+        range_args[0] = make_int_literal((int)(scale * start + offset));
+        range_args[1] = make_int_literal((int)(scale * stop + offset));
+        range_args[2] = make_int_literal((int)scale);
+        Expression *range = make_call("range", range_args, scale == 1 ? 2 : 3);
+        return make_call("list", &range, 1);
+    }
+
+    Expression *comprehension = create_expression();
+    comprehension->type = EXPR_GENERATOR;
+    comprehension->generator.element = element;
+    comprehension->generator.var.name = strdup(var);
+    comprehension->generator.var.type = TYPE_INT;
+    comprehension->generator.iterable = make_call("range", range_args, 2);
+    comprehension->generator.is_list = 1;
+    return comprehension;
+}
+
+typedef struct {
+    Statement *stmt;
+    const char *var;  // The comprehension's own variable
+    int changed;
+} OperandScan;
+
+void find_call(Expression *expr, void *ctx) {
+    if (expr->type == EXPR_CALL && !is_pure_builtin(expr->call.func_name)) *(int *)ctx = 1;
+}
+
+// Check if a statement calls a program function (which may read or write anything)
+int statement_has_calls(Statement *stmt) {
+    int found = 0;
+    visit_statement_expressions(stmt, find_call, &found);
+    return found;
+}
+
+void find_changed_operand(Expression *expr, void *ctx) {
+    OperandScan *scan = ctx;
+    const char *name = NULL;
+    switch (expr->type) {
+        case EXPR_VARIABLE: name = expr->var_name; break;
+        case EXPR_ARRAY_ACCESS: name = expr->array_access.array_name; break;
+        case EXPR_CALL: break;
+        default: return;
+    }
+    if (name && strcmp(name, scan->var) != 0 && (statement_writes_variable(scan->stmt, name) || statement_declares(scan->stmt, name))) {
+        scan->changed = 1;
+    }
+    // A call may read anything an earlier call changed
+    if (expr->type == EXPR_CALL && !is_pure_builtin(expr->call.func_name) && statement_has_calls(scan->stmt)) {
+        scan->changed = 1;
+    }
+}
+
+// The declaration of a local array earlier in the block, if the fill can move
+// up to it: nothing in between touches the array or changes what the values read
+Statement *fresh_declaration(Statement *block, int index, const char *name, Expression *values, const char *var) {
+    for (int i = index - 1; i >= 0; i--) {
+        Statement *stmt = block->block.statements[i];
+        if (stmt->type == STMT_VAR_DECL && strcmp(stmt->var_decl.var.name, name) == 0) {
+            return stmt->var_decl.var.is_array && !stmt->var_decl.initializer ? stmt : NULL;
+        }
+        OperandScan scan = { stmt, var, 0 };
+        visit_expression(values, find_changed_operand, &scan);
+        if (scan.changed || statement_uses_array(stmt, name)) return NULL;
+    }
+    return NULL;
+}
+
+// Replace the fill loop at block position index; returns 1 if it was removed from the block
+int collapse_fill(FillContext *ctx, Statement *block, int index) {
+    Statement *loop = block->block.statements[index];
+    if (loop->type != STMT_FOR_IN || loop->for_in.else_branch) return 0;
+    Expression *range = loop->for_in.iterable;
+    if (range->type != EXPR_CALL || strcmp(range->call.func_name, "range") != 0 || range->call.arg_count != 2) {
+        return 0;
+    }
+
+    Statement *store = single_statement(loop->for_in.body);
+    if (!store || store->type != STMT_EXPR || store->expr->type != EXPR_BINARY || store->expr->binary.op != OP_ASSIGN) {
+        return 0;
+    }
+    Expression *target = store->expr->binary.left;
+    Expression *element = store->expr->binary.right;
+    const char *var = loop->for_in.var.name;
+    if (target->type != EXPR_ARRAY_ACCESS || target->array_access.index->type != EXPR_VARIABLE ||
+        strcmp(target->array_access.index->var_name, var) != 0) {
+        return 0;
+    }
+    const char *name = target->array_access.array_name;
+    Variable *array = lookup_variable(ctx->prog, ctx->func, name);
+    if (!array || !array->is_array || array->struct_name) return 0;
+    if (expression_uses_array(element, name) || expression_has_side_effects(ctx->prog, element)) return 0;
+
+    long long start, stop;
+    if (!constant_local_value(ctx->func, range->call.args[0], &start) ||
+        !constant_local_value(ctx->func, range->call.args[1], &stop)) {
+        return 0;
+    }
+    if (start < 0 || stop <= start || stop > array->array_size) return 0;
+
+    Expression *values = fill_values(ctx->prog, element, var, start, stop);
+    Statement *decl = start == 0 && stop == array->array_size ? fresh_declaration(block, index, name, values, var) : NULL;
+    if (decl) {
+        decl->var_decl.initializer = values;
+        memmove(&block->block.statements[index], &block->block.statements[index + 1],
+                (block->block.stmt_count - index - 1) * sizeof(Statement*));
+        block->block.stmt_count--;
+        return 1;
+    }
+
+    Expression *slice = make_slice(name, make_int_literal((int)start), make_int_literal((int)stop));
+    block->block.statements[index] = make_expression_statement(make_binary(OP_ASSIGN, slice, values));
+    return 0;
+}
+
+Statement *collapse_fill_statement(Statement *stmt, void *ctx) {
+    if (stmt->type != STMT_BLOCK) return stmt;
+    for (int i = 0; i < stmt->block.stmt_count; i++) {
+        if (collapse_fill(ctx, stmt, i)) i--;
+    }
+    return stmt;
+}
+
+// Turn array-filling loops into comprehensions and bulk constructors
+void collapse_array_fills(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        FillContext ctx = { prog, prog->functions[i] };
+        prog->functions[i]->body = transform_statements(prog->functions[i]->body, collapse_fill_statement, &ctx);
+    }
+}
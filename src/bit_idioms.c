@@ -0,0 +1,320 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Bit-manipulation idioms. Loops that walk an int one bit at a time become
+// int methods that run in C:
+//     while (x) { n += x & 1; x >>= 1; }         ->  n = n + int.bit_count(x)
+//     while (x) { x &= x - 1; n++; }             ->  n = n + (int.bit_count(x & 0x7FFFFFFF) + (x < 0))
+//     while (x) { n++; x >>= 1; }                ->  n = n + int.bit_length(x)
+//     while (x > 1) { x >>= 1; n++; }            ->  if x > 1: n = n + (int.bit_length(x) - 1)
+//     while ((x & 1) == 0) { x >>= 1; n++; }     ->  n = n + (int.bit_length(x & -x) - 1)
+//     for (i = 0; i < 8; i++) { r = (r << 1) | (x & 1); x >>= 1; }
+//                                                ->  r = reverse_bits(x, 8)
+// reverse_bits is emitted by codegen only when a program uses it; it reverses
+// a byte at a time through a 256-entry table.
+// x is given its exit value (0, 1 or shifted right) when it is read after the
+// loop. A loop on x > 0 does not run for negative x, so its replacement is
+// guarded; clearing the lowest bit of a negative x counts the bits of its
+// 32-bit two's complement, like C.
+
+typedef struct {
+    Program *prog;
+    Function *func;
+} BitContext;
+
+typedef enum {
+    LOOP_NONZERO,   // while (x) / while (x != 0)
+    LOOP_POSITIVE,  // while (x > 0)
+    LOOP_ABOVE_ONE, // while (x > 1)
+    LOOP_EVEN,      // while ((x & 1) == 0) / while (!(x & 1))
+} BitLoopKind;
+
+// Check if a name is a scalar int parameter or local, so the rewrite stays in scope
+int is_int_local(BitContext *ctx, const char *name) {
+    Variable *var = lookup_local(ctx->func, name);
+    return var && var->type == TYPE_INT && !var->is_array && !var->struct_name;
+}
+
+int is_variable_named(Expression *expr, const char *name) {
+    return expr->type == EXPR_VARIABLE && strcmp(expr->var_name, name) == 0;
+}
+
+int is_int_constant(Expression *expr, int value) {
+    return expr->type == EXPR_LITERAL && expr->literal.lit_type == TYPE_INT && expr->literal.int_val == value;
+}
+
+// x & 1 or 1 & x
+int is_low_bit(Expression *expr, const char *x) {
+    if (expr->type != EXPR_BINARY || expr->binary.op != OP_BIT_AND) return 0;
+    return (is_variable_named(expr->binary.left, x) && is_int_constant(expr->binary.right, 1)) ||
+           (is_int_constant(expr->binary.left, 1) && is_variable_named(expr->binary.right, x));
+}
+
+// x & 1, (x & 1) == 1 or (x & 1) != 0 as a condition
+int tests_low_bit(Expression *cond, const char *x) {
+    if (is_low_bit(cond, x)) return 1;
+    if (cond->type != EXPR_BINARY || !is_low_bit(cond->binary.left, x)) return 0;
+    return (cond->binary.op == OP_EQ && is_int_constant(cond->binary.right, 1)) ||
+           (cond->binary.op == OP_NEQ && is_int_constant(cond->binary.right, 0));
+}
+
+// The variable and kind of a bit loop condition, or NULL
+const char *match_bit_condition(Expression *cond, BitLoopKind *kind) {
+    if (cond->type == EXPR_VARIABLE) {
+        *kind = LOOP_NONZERO;
+        return cond->var_name;
+    }
+    if (cond->type == EXPR_UNARY && cond->unary.op == OP_NOT && cond->unary.expr->type == EXPR_BINARY &&
+        cond->unary.expr->binary.left->type == EXPR_VARIABLE && is_low_bit(cond->unary.expr, cond->unary.expr->binary.left->var_name)) {
+        *kind = LOOP_EVEN;
+        return cond->unary.expr->binary.left->var_name;
+    }
+    if (cond->type != EXPR_BINARY) return NULL;
+
+    Expression *left = cond->binary.left;
+    Expression *right = cond->binary.right;
+    if (cond->binary.op == OP_EQ && is_int_constant(right, 0) && left->type == EXPR_BINARY &&
+        left->binary.left->type == EXPR_VARIABLE && is_low_bit(left, left->binary.left->var_name)) {
+        *kind = LOOP_EVEN;
+        return left->binary.left->var_name;
+    }
+    if (left->type != EXPR_VARIABLE) return NULL;
+    if (cond->binary.op == OP_NEQ && is_int_constant(right, 0)) {
+        *kind = LOOP_NONZERO;
+    } else if (cond->binary.op == OP_GT && is_int_constant(right, 0)) {
+        *kind = LOOP_POSITIVE;
+    } else if (cond->binary.op == OP_GT && is_int_constant(right, 1)) {
+        *kind = LOOP_ABOVE_ONE;
+    } else {
+        return NULL;
+    }
+    return left->var_name;
+}
+
+// The expression of an assignment to name (name = e), or NULL
+Expression *assigned_value(Statement *stmt, const char *name) {
+    if (!stmt || stmt->type != STMT_EXPR || stmt->expr->type != EXPR_BINARY || stmt->expr->binary.op != OP_ASSIGN ||
+        !is_variable_named(stmt->expr->binary.left, name)) {
+        return NULL;
+    }
+    return stmt->expr->binary.right;
+}
+
+// x >>= 1
+int halves(Statement *stmt, const char *x) {
+    Expression *value = assigned_value(stmt, x);
+    return value && value->type == EXPR_BINARY && value->binary.op == OP_SHIFT_RIGHT &&
+           is_variable_named(value->binary.left, x) && is_int_constant(value->binary.right, 1);
+}
+
+// x &= x - 1
+int clears_lowest_bit(Statement *stmt, const char *x) {
+    Expression *value = assigned_value(stmt, x);
+    if (!value || value->type != EXPR_BINARY || value->binary.op != OP_BIT_AND) return 0;
+    Expression *minus = is_variable_named(value->binary.left, x) ? value->binary.right : value->binary.left;
+    Expression *other = minus == value->binary.right ? value->binary.left : value->binary.right;
+    return is_variable_named(other, x) && minus->type == EXPR_BINARY && minus->binary.op == OP_SUB &&
+           is_variable_named(minus->binary.left, x) && is_int_constant(minus->binary.right, 1);
+}
+
+// n++, ++n or n += 1; returns n
+const char *counts(Statement *stmt) {
+    const char *acc;
+    BinaryOpType op;
+    Expression *value;
+    if (!stmt || stmt->type != STMT_EXPR || !match_accumulate(stmt->expr, &acc, &op, &value)) return NULL;
+    return op == OP_ADD && is_int_constant(value, 1) ? acc : NULL;
+}
+
+// n += x & 1 or if (x & 1) n++; returns n
+const char *adds_low_bit(Statement *stmt, const char *x) {
+    const char *acc;
+    BinaryOpType op;
+    Expression *value;
+    if (stmt && stmt->type == STMT_IF && !stmt->if_stmt.else_branch && tests_low_bit(stmt->if_stmt.condition, x)) {
+        return counts(single_statement(stmt->if_stmt.then_branch));
+    }
+    if (!stmt || stmt->type != STMT_EXPR || !match_accumulate(stmt->expr, &acc, &op, &value)) return NULL;
+    return op == OP_ADD && is_low_bit(value, x) ? acc : NULL;
+}
+
+// The two statements of a loop body, or 0 if it has another shape
+int statement_pair(Statement *body, Statement **first, Statement **second) {
+    if (!body || body->type != STMT_BLOCK || body->block.stmt_count != 2) return 0;
+    *first = body->block.statements[0];
+    *second = body->block.statements[1];
+    return 1;
+}
+
+// A counter incremented once per shift, in either order
+const char *counts_shifts(Statement *first, Statement *second, const char *x) {
+    if (halves(first, x)) return counts(second);
+    if (halves(second, x)) return counts(first);
+    return NULL;
+}
+
+Expression *negate(Expression *expr) {
+    Expression *negated = create_expression();
+    negated->type = EXPR_UNARY;
+    negated->unary.op = OP_NEGATE;
+    negated->unary.expr = expr;
+    return negated;
+}
+
+Expression *int_method(const char *method, Expression *arg) {
+    char name[64];
+    snprintf(name, sizeof(name), "int.%s", method);
+    return make_call(name, &arg, 1);
+}
+
+Statement *assign_variable(const char *name, Expression *value) {
+    return make_expression_statement(make_binary(OP_ASSIGN, make_variable(name), value));
+}
+
+// n = n + count; x = exit (when read later), guarded by the loop condition if needed
+Statement *replace_bit_loop(BitContext *ctx, Statement *loop, const char *n, Expression *count,
+                            const char *x, Expression *exit, int guarded) {
+    Statement *block = make_block();
+    block_append(block, assign_variable(n, make_binary(OP_ADD, make_variable(n), count)));
+    if (read_after_loop(ctx->func->body, loop, x)) block_append(block, assign_variable(x, exit));
+    if (!guarded) return block;
+
+    Statement *guard = create_statement();
+    guard->type = STMT_IF;
+    guard->if_stmt.condition = clone_expression(loop->while_stmt.condition);
+    guard->if_stmt.then_branch = block;
+    guard->if_stmt.else_branch = NULL;
+    return guard;
+}
+
+// Popcount, bit length, floor(log2) and trailing-zero loops
+Statement *bit_loop_idiom(BitContext *ctx, Statement *loop) {
+    BitLoopKind kind;
+    Statement *first, *second;
+    const char *x = match_bit_condition(loop->while_stmt.condition, &kind);
+    if (!x || !is_int_local(ctx, x) || !statement_pair(loop->while_stmt.body, &first, &second)) return NULL;
+
+    const char *n;
+    Expression *count;
+    Expression *exit = make_int_literal(kind == LOOP_ABOVE_ONE ? 1 : 0);
+    if (kind == LOOP_EVEN) {
+        // The number of trailing zeros; x == 0 loops forever in C and raises here
+        n = counts_shifts(first, second, x);
+        Expression *lowest = make_binary(OP_BIT_AND, make_variable(x), negate(make_variable(x)));
+        count = make_binary(OP_SUB, int_method("bit_length", lowest), make_int_literal(1));
+        exit = make_binary(OP_SHIFT_RIGHT, make_variable(x), clone_expression(count));
+    } else if (kind == LOOP_ABOVE_ONE) {
+        n = counts_shifts(first, second, x);
+        count = make_binary(OP_SUB, int_method("bit_length", make_variable(x)), make_int_literal(1));
+    } else if ((n = adds_low_bit(first, x)) && halves(second, x)) {
+        count = int_method("bit_count", make_variable(x));
+    } else if ((clears_lowest_bit(first, x) && (n = counts(second))) ||
+               (clears_lowest_bit(second, x) && (n = counts(first)))) {
+        if (kind == LOOP_NONZERO) {
+            // A negative x has the bits of its 32-bit pattern cleared: the sign bit and the rest
+            Expression *low = make_binary(OP_BIT_AND, make_variable(x), make_int_literal(0x7FFFFFFF));
+            count = make_binary(OP_ADD, int_method("bit_count", low),
+                                make_binary(OP_LT, make_variable(x), make_int_literal(0)));
+        } else {
+            count = int_method("bit_count", make_variable(x));
+        }
+    } else {
+        n = counts_shifts(first, second, x);
+        count = int_method("bit_length", make_variable(x));
+    }
+    if (!n || strcmp(n, x) == 0 || !is_int_local(ctx, n)) return NULL;
+    return replace_bit_loop(ctx, loop, n, count, x, exit, kind == LOOP_POSITIVE || kind == LOOP_ABOVE_ONE);
+}
+
+// Check if the statement before position index sets name to 0
+int starts_at_zero(Statement *block, int index, const char *name) {
+    if (index == 0) return 0;
+    Statement *prev = block->block.statements[index - 1];
+    if (prev->type == STMT_VAR_DECL) {
+        return strcmp(prev->var_decl.var.name, name) == 0 && prev->var_decl.initializer &&
+               is_int_constant(prev->var_decl.initializer, 0);
+    }
+    Expression *value = assigned_value(prev, name);
+    return value && is_int_constant(value, 0);
+}
+
+// for (i = 0; i < W; i++) { r = (r << 1) | (x & 1); x >>= 1; }  ->  r = (r << W) | reverse_bits(x, W)
+Statement *bit_reverse_idiom(BitContext *ctx, Statement *block, int index) {
+    Statement *loop = block->block.statements[index];
+    Expression *range = loop->for_in.iterable;
+    Statement *first, *second;
+    if (loop->for_in.else_branch || range->type != EXPR_CALL || strcmp(range->call.func_name, "range") != 0 ||
+        range->call.arg_count != 2 || !is_int_constant(range->call.args[0], 0) ||
+        range->call.args[1]->type != EXPR_LITERAL || range->call.args[1]->literal.lit_type != TYPE_INT) {
+        return NULL;
+    }
+    int width = range->call.args[1]->literal.int_val;
+    if (width < 1 || width > 32 || !statement_pair(loop->for_in.body, &first, &second)) return NULL;
+    if (count_variable_reads(loop->for_in.body, loop->for_in.var.name) > 0) return NULL;
+
+    // r = (r << 1) | (x & 1), then x >>= 1
+    if (first->type != STMT_EXPR || first->expr->type != EXPR_BINARY || first->expr->binary.op != OP_ASSIGN ||
+        first->expr->binary.left->type != EXPR_VARIABLE) {
+        return NULL;
+    }
+    const char *r = first->expr->binary.left->var_name;
+    Expression *value = first->expr->binary.right;
+    if (value->type != EXPR_BINARY || value->binary.op != OP_BIT_OR) return NULL;
+    Expression *shifted = value->binary.left;
+    Expression *bit = value->binary.right;
+    if (shifted->type != EXPR_BINARY || shifted->binary.op != OP_SHIFT_LEFT) {
+        shifted = value->binary.right;
+        bit = value->binary.left;
+    }
+    if (shifted->type != EXPR_BINARY || shifted->binary.op != OP_SHIFT_LEFT ||
+        !is_variable_named(shifted->binary.left, r) || !is_int_constant(shifted->binary.right, 1) ||
+        bit->type != EXPR_BINARY || bit->binary.left->type != EXPR_VARIABLE) {
+        return NULL;
+    }
+    const char *x = bit->binary.left->var_name;
+    if (!is_low_bit(bit, x) || !halves(second, x) || strcmp(r, x) == 0 || !is_int_local(ctx, r) ||
+        !is_int_local(ctx, x)) {
+        return NULL;
+    }
+
+    Expression *args[2] = { make_variable(x), make_int_literal(width) };
+    Expression *reversed = make_call("reverse_bits", args, 2);
+    // A 32-bit result may need wrapping, which the shift-or form gets from the integer lowering
+    if (width == 32 || !starts_at_zero(block, index, r)) {
+        reversed = make_binary(OP_BIT_OR, make_binary(OP_SHIFT_LEFT, make_variable(r), make_int_literal(width)), reversed);
+    }
+    Statement *replacement = make_block();
+    block_append(replacement, assign_variable(r, reversed));
+    if (read_after_loop(ctx->func->body, loop, x)) {
+        block_append(replacement, assign_variable(x, make_binary(OP_SHIFT_RIGHT, make_variable(x), make_int_literal(width))));
+    }
+    return replacement;
+}
+
+Statement *recognize_bit_statement(Statement *stmt, void *ctx) {
+    if (stmt->type != STMT_BLOCK) return stmt;
+    for (int i = 0; i < stmt->block.stmt_count; i++) {
+        Statement *loop = stmt->block.statements[i];
+        Statement *replacement = NULL;
+        if (loop->type == STMT_WHILE) replacement = bit_loop_idiom(ctx, loop);
+        if (loop->type == STMT_FOR_IN) replacement = bit_reverse_idiom(ctx, stmt, i);
+        if (replacement) stmt->block.statements[i] = replacement;
+    }
+    return stmt;
+}
+
+// Check if a call is one of the bit operations this pass emits (they return ints and have no side effects)
+int is_bit_builtin(const char *name) {
+    return strcmp(name, "int.bit_count") == 0 || strcmp(name, "int.bit_length") == 0 ||
+           strcmp(name, "reverse_bits") == 0;
+}
+
+// Replace bit-at-a-time loops in every function
+void recognize_bit_idioms(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        BitContext ctx = { prog, prog->functions[i] };
+        prog->functions[i]->body = transform_statements(prog->functions[i]->body, recognize_bit_statement, &ctx);
+    }
+}
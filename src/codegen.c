@@ -3,6 +3,7 @@
 #include <string.h>
 #include "../include/parser.h"
 #include "../include/codegen.h"
+#include "../include/optimizer.h"
 
 void indent(FILE *fp, int level) {
     for (int i = 0; i < level; i++) {
@@ -13,6 +14,9 @@ void indent(FILE *fp, int level) {
 void generate_expression(FILE *fp, Expression *expr, int indent_level);
 void generate_statement(FILE *fp, Statement *stmt, int indent_level);
 
+// Increment of the innermost C for-loop lowered to while, emitted before each continue
+Expression *loop_increment = NULL;
+
 const char *get_python_type_name(VariableType type) {
     switch (type) {
         case TYPE_INT: return "int";
@@ -53,6 +57,10 @@ void generate_binary_op(FILE *fp, BinaryOpType op) {
         case OP_BIT_XOR: fprintf(fp, " ^ "); break;
         case OP_SHIFT_LEFT: fprintf(fp, " << "); break;
         case OP_SHIFT_RIGHT: fprintf(fp, " >> "); break;
+        case OP_FLOOR_DIV: fprintf(fp, " // "); break;
+        case OP_IN: fprintf(fp, " in "); break;
+        case OP_POW: fprintf(fp, " ** "); break;
+        case OP_TRUNC_DIV: case OP_TRUNC_MOD: break; // Emitted as helper calls by generate_expression
     }
 }
 
@@ -65,6 +73,31 @@ void generate_unary_op(FILE *fp, UnaryOpType op) {
         case OP_POST_INC: fprintf(fp, "++"); break;
         case OP_POST_DEC: fprintf(fp, "--"); break;
         case OP_BIT_NOT: fprintf(fp, "~"); break;
+        case OP_WRAP_INT: break; // Emitted by generate_expression
+    }
+}
+
+// Emit a C character as a one-character Python string; the terminator '\0' is ''
+void generate_char_literal(FILE *fp, char c) {
+    if (c == '\0') {
+        fprintf(fp, "''");
+    } else if (c == '\'' || c == '\\') {
+        fprintf(fp, "'\\%c'", c);
+    } else if (c >= 32 && c < 127) {
+        fprintf(fp, "'%c'", c);
+    } else {
+        fprintf(fp, "'\\x%02x'", (unsigned char)c);
+    }
+}
+
+// Emit "element for var in iterable if condition" without surrounding parentheses
+void generate_generator_clauses(FILE *fp, Expression *expr, int indent_level) {
+    generate_expression(fp, expr->generator.element, indent_level);
+    fprintf(fp, " for %s in ", expr->generator.var.name);
+    generate_expression(fp, expr->generator.iterable, indent_level);
+    if (expr->generator.condition) {
+        fprintf(fp, " if ");
+        generate_expression(fp, expr->generator.condition, indent_level);
     }
 }
 
@@ -85,7 +118,7 @@ void generate_expression(FILE *fp, Expression *expr, int indent_level) {
                     fprintf(fp, "%f", expr->literal.float_val);
                     break;
                 case TYPE_CHAR:
-                    fprintf(fp, "'%c'", expr->literal.char_val);
+                    generate_char_literal(fp, expr->literal.char_val);
                     break;
                 case TYPE_STRING:
                     fprintf(fp, "\"%s\"", expr->literal.string_val);
@@ -101,6 +134,12 @@ void generate_expression(FILE *fp, Expression *expr, int indent_level) {
                 generate_expression(fp, expr->binary.left, indent_level);
                 generate_binary_op(fp, expr->binary.op);
                 generate_expression(fp, expr->binary.right, indent_level);
+            } else if (expr->binary.op == OP_TRUNC_DIV || expr->binary.op == OP_TRUNC_MOD) {
+                fprintf(fp, expr->binary.op == OP_TRUNC_DIV ? "_c_div(" : "_c_mod(");
+                generate_expression(fp, expr->binary.left, indent_level);
+                fprintf(fp, ", ");
+                generate_expression(fp, expr->binary.right, indent_level);
+                fprintf(fp, ")");
             } else {
                 fprintf(fp, "(");
                 generate_expression(fp, expr->binary.left, indent_level);
@@ -111,7 +150,23 @@ void generate_expression(FILE *fp, Expression *expr, int indent_level) {
             break;
 
         case EXPR_UNARY:
-            if (expr->unary.op == OP_POST_INC || expr->unary.op == OP_POST_DEC) {
+            if (expr->unary.op == OP_WRAP_INT) {
+                // Two's-complement wraparound of a 32-bit int
+                fprintf(fp, "(((");
+                generate_expression(fp, expr->unary.expr, indent_level);
+                fprintf(fp, " + 0x80000000) & 0xFFFFFFFF) - 0x80000000)");
+            } else if (expr->unary.expr->type == EXPR_VARIABLE &&
+                (expr->unary.op == OP_PRE_INC || expr->unary.op == OP_PRE_DEC)) {
+                // ++x evaluates to the new value
+                fprintf(fp, "(%s := %s %c 1)", expr->unary.expr->var_name, expr->unary.expr->var_name,
+                        expr->unary.op == OP_PRE_INC ? '+' : '-');
+            } else if (expr->unary.expr->type == EXPR_VARIABLE &&
+                       (expr->unary.op == OP_POST_INC || expr->unary.op == OP_POST_DEC)) {
+                // x++ evaluates to the old value
+                fprintf(fp, "((%s := %s %c 1) %c 1)", expr->unary.expr->var_name, expr->unary.expr->var_name,
+                        expr->unary.op == OP_POST_INC ? '+' : '-',
+                        expr->unary.op == OP_POST_INC ? '-' : '+');
+            } else if (expr->unary.op == OP_POST_INC || expr->unary.op == OP_POST_DEC) {
                 generate_expression(fp, expr->unary.expr, indent_level);
                 generate_unary_op(fp, expr->unary.op);
             } else {
@@ -122,6 +177,13 @@ void generate_expression(FILE *fp, Expression *expr, int indent_level) {
 
         case EXPR_CALL:
             fprintf(fp, "%s(", expr->call.func_name);
+            if (expr->call.arg_count == 1 && expr->call.args[0]->type == EXPR_GENERATOR &&
+                !expr->call.args[0]->generator.is_list) {
+                // A sole generator argument needs no parentheses of its own
+                generate_generator_clauses(fp, expr->call.args[0], indent_level);
+                fprintf(fp, ")");
+                break;
+            }
             for (int i = 0; i < expr->call.arg_count; i++) {
                 generate_expression(fp, expr->call.args[i], indent_level);
                 if (i < expr->call.arg_count - 1) {
@@ -142,32 +204,62 @@ void generate_expression(FILE *fp, Expression *expr, int indent_level) {
             fprintf(fp, ".%s", expr->member_access.member_name);
             break;
 
+        case EXPR_SLICE:
+            fprintf(fp, "%s[", expr->slice.array_name);
+            generate_expression(fp, expr->slice.start, indent_level);
+            fprintf(fp, ":");
+            generate_expression(fp, expr->slice.stop, indent_level);
+            fprintf(fp, "]");
+            break;
+
+        case EXPR_GENERATOR:
+            fprintf(fp, expr->generator.is_list ? "[" : "(");
+            generate_generator_clauses(fp, expr, indent_level);
+            fprintf(fp, expr->generator.is_list ? "]" : ")");
+            break;
+
+        case EXPR_LIST:
+            fprintf(fp, "[");
+            for (int i = 0; i < expr->list.count; i++) {
+                generate_expression(fp, expr->list.elements[i], indent_level);
+                if (i < expr->list.count - 1) {
+                    fprintf(fp, ", ");
+                }
+            }
+            fprintf(fp, "]");
+            break;
+
         case EXPR_ASM:
+            // Blocks lower_inline_asm could not translate; the statement is already indented
+            fprintf(fp, "pass  # Inline assembly block (not translated)\n");
             indent(fp, indent_level);
-            fprintf(fp, "# Inline assembly block\n");
-            indent(fp, indent_level);
-            fprintf(fp, "# Instructions: %s\n", expr->asm_block.instructions ? expr->asm_block.instructions : "");
+            fprintf(fp, "# Instructions: %s", expr->asm_block.instructions ? expr->asm_block.instructions : "");
             if (expr->asm_block.output_count > 0) {
+                fprintf(fp, "\n");
                 indent(fp, indent_level);
-                fprintf(fp, "# Outputs:\n");
+                fprintf(fp, "# Outputs:");
                 for (int i = 0; i < expr->asm_block.output_count; i++) {
+                    fprintf(fp, "\n");
                     indent(fp, indent_level);
-                    fprintf(fp, "#   %s (%s)\n", 
+                    fprintf(fp, "#   \"%s\" (%s)",
                             expr->asm_block.outputs[i].constraint ? expr->asm_block.outputs[i].constraint : "",
                             expr->asm_block.outputs[i].variable ? expr->asm_block.outputs[i].variable : "");
                 }
             }
             if (expr->asm_block.input_count > 0) {
+                fprintf(fp, "\n");
                 indent(fp, indent_level);
-                fprintf(fp, "# Inputs:\n");
+                fprintf(fp, "# Inputs:");
                 for (int i = 0; i < expr->asm_block.input_count; i++) {
+                    fprintf(fp, "\n");
                     indent(fp, indent_level);
-                    fprintf(fp, "#   %s (%s)\n", 
+                    fprintf(fp, "#   \"%s\" (%s)",
                             expr->asm_block.inputs[i].constraint ? expr->asm_block.inputs[i].constraint : "",
                             expr->asm_block.inputs[i].variable ? expr->asm_block.inputs[i].variable : "");
                 }
             }
             if (expr->asm_block.clobber_count > 0) {
+                fprintf(fp, "\n");
                 indent(fp, indent_level);
                 fprintf(fp, "# Clobbers:");
                 for (int i = 0; i < expr->asm_block.clobber_count; i++) {
@@ -176,7 +268,6 @@ void generate_expression(FILE *fp, Expression *expr, int indent_level) {
                         fprintf(fp, ",");
                     }
                 }
-                fprintf(fp, "\n");
             }
             break;
     }
@@ -193,12 +284,13 @@ void generate_variable_init(FILE *fp, Variable *var, int indent_level) {
                 var->array_size);
     } else {
         generate_type(fp, var->type, var->struct_name);
-        if (!var->is_initialized) {
+        if (!var->is_initialized && var->struct_name) {
+            fprintf(fp, " = %s()", var->struct_name);
+        } else if (!var->is_initialized) {
             fprintf(fp, " = %s", 
                     var->type == TYPE_INT ? "0" : 
                     var->type == TYPE_FLOAT ? "0.0" : 
-                    var->type == TYPE_CHAR ? "''" : 
-                    var->struct_name ? var->struct_name : "None");
+                    var->type == TYPE_CHAR ? "''" : "None");
         }
     }
     if (var->is_initialized && var->is_array) {
@@ -207,17 +299,171 @@ void generate_variable_init(FILE *fp, Variable *var, int indent_level) {
     fprintf(fp, "\n");
 }
 
+// Int elements that all fit in a byte
+int byte_elements(Expression *list) {
+    for (int i = 0; i < list->list.count; i++) {
+        Expression *element = list->list.elements[i];
+        if (element->literal.lit_type != TYPE_INT || element->literal.int_val < 0 || element->literal.int_val > 255) {
+            return 0;
+        }
+    }
+    return list->list.count > 0;
+}
+
+// Global arrays with a brace initializer: a list, or for arrays nothing
+// writes, a bytes or tuple constant that CPython keeps in the code object
+void generate_array_constant(FILE *fp, Variable *var) {
+    Expression *list = var->elements;
+    if (var->is_constant && var->type == TYPE_INT && byte_elements(list)) {
+        fprintf(fp, "%s: bytes = b'", var->name);
+        for (int i = 0; i < list->list.count; i++) {
+            fprintf(fp, "\\x%02x", list->list.elements[i]->literal.int_val);
+        }
+        fprintf(fp, "'\n");
+        return;
+    }
+    if (var->is_constant) {
+        fprintf(fp, "%s: tuple = (", var->name);
+    } else {
+        fprintf(fp, "%s: List[", var->name);
+        generate_type(fp, var->type, NULL);
+        fprintf(fp, "] = [");
+    }
+    for (int i = 0; i < list->list.count; i++) {
+        if (i > 0) fprintf(fp, ", ");
+        generate_expression(fp, list->list.elements[i], 0);
+    }
+    fprintf(fp, var->is_constant ? (list->list.count == 1 ? ",)\n" : ")\n") : "]\n");
+}
+
+// Globals carry their literal initializer in var->value
+void generate_global_init(FILE *fp, Variable *var) {
+    if (var->is_array && var->elements) {
+        generate_array_constant(fp, var);
+        return;
+    }
+    if (!var->is_initialized || var->is_array || var->struct_name) {
+        generate_variable_init(fp, var, 0);
+        return;
+    }
+    fprintf(fp, "%s: ", var->name);
+    generate_type(fp, var->type, NULL);
+    switch (var->type) {
+        case TYPE_FLOAT: fprintf(fp, " = %f\n", var->value.float_val); break;
+        case TYPE_CHAR:
+            fprintf(fp, " = ");
+            generate_char_literal(fp, var->value.char_val);
+            fprintf(fp, "\n");
+            break;
+        default: fprintf(fp, " = %d\n", var->value.int_val); break;
+    }
+}
+
+// Check if a statement generates no Python code
+int statement_is_empty(Statement *stmt) {
+    if (!stmt) return 1;
+    if (stmt->type != STMT_BLOCK) return 0;
+    for (int i = 0; i < stmt->block.stmt_count; i++) {
+        if (!statement_is_empty(stmt->block.statements[i])) return 0;
+    }
+    return 1;
+}
+
+// Generate the body of a compound statement; Python needs at least one statement
+void generate_body(FILE *fp, Statement *body, int indent_level) {
+    if (statement_is_empty(body)) {
+        indent(fp, indent_level);
+        fprintf(fp, "pass\n");
+        return;
+    }
+    generate_statement(fp, body, indent_level);
+}
+
+// Generate an expression used as a statement; x++ and --x become augmented assignments
+void generate_expression_statement(FILE *fp, Expression *expr, int indent_level) {
+    indent(fp, indent_level);
+    if (expr->type == EXPR_UNARY &&
+        (expr->unary.op == OP_PRE_INC || expr->unary.op == OP_POST_INC ||
+         expr->unary.op == OP_PRE_DEC || expr->unary.op == OP_POST_DEC)) {
+        generate_expression(fp, expr->unary.expr, indent_level);
+        fprintf(fp, (expr->unary.op == OP_PRE_INC || expr->unary.op == OP_POST_INC) ? " += 1" : " -= 1");
+    } else {
+        generate_expression(fp, expr, indent_level);
+    }
+    fprintf(fp, "\n");
+}
+
+// Emit a printf format for Python's % operator, which rejects C length
+// modifiers such as %ld; without arguments %% is written out as %
+void generate_format_string(FILE *fp, const char *format, int has_args) {
+    for (const char *c = format; *c; c++) {
+        if (*c == '\\' && c[1]) {
+            fprintf(fp, "%c%c", c[0], c[1]);
+            c++;
+        } else if (*c == '%' && c[1] == '%') {
+            fprintf(fp, has_args ? "%%%%" : "%%");
+            c++;
+        } else if (*c == '%') {
+            fputc('%', fp);
+            while (c[1] && strchr("-+ #0123456789.*", c[1])) fputc(*++c, fp);
+            while (c[1] && strchr("hlLqjzt", c[1])) c++;
+        } else {
+            fputc(*c, fp);
+        }
+    }
+}
+
+// The conversion character that formats the index-th printf argument, or 0
+char format_conversion(const char *format, int index) {
+    int arg = 0;
+    for (const char *c = format; *c; c++) {
+        if (*c == '\\' && c[1]) {
+            c++;
+            continue;
+        }
+        if (*c != '%') continue;
+        if (c[1] == '%') {
+            c++;
+            continue;
+        }
+        while (c[1] && strchr("-+ #0123456789.*", c[1])) {
+            if (*++c == '*') arg++;  // A * width or precision takes an argument of its own
+        }
+        while (c[1] && strchr("hlLqjzt", c[1])) c++;
+        if (!c[1]) return 0;
+        if (arg++ == index) return c[1];
+        c++;
+    }
+    return 0;
+}
+
+// The if an else branch consists of, which can be emitted as elif
+Statement *else_if_statement(Statement *branch) {
+    while (branch && branch->type == STMT_BLOCK && branch->block.stmt_count == 1) {
+        branch = branch->block.statements[0];
+    }
+    return branch && branch->type == STMT_IF ? branch : NULL;
+}
+
 void generate_statement(FILE *fp, Statement *stmt, int indent_level) {
     if (!stmt) return;
 
     switch (stmt->type) {
         case STMT_EXPR:
-            indent(fp, indent_level);
-            generate_expression(fp, stmt->expr, indent_level);
-            fprintf(fp, "\n");
+            generate_expression_statement(fp, stmt->expr, indent_level);
             break;
 
         case STMT_VAR_DECL:
+            if (stmt->var_decl.var.is_array && stmt->var_decl.initializer) {
+                // Arrays built in one go (list comprehensions) skip the zero fill
+                indent(fp, indent_level);
+                fprintf(fp, "%s: List[", stmt->var_decl.var.name);
+                generate_type(fp, stmt->var_decl.var.type, stmt->var_decl.var.struct_name);
+                fprintf(fp, "] = ");
+                generate_expression(fp, stmt->var_decl.initializer, indent_level);
+                fprintf(fp, "\n");
+                break;
+            }
             generate_variable_init(fp, &stmt->var_decl.var, indent_level);
             if (stmt->var_decl.initializer) {
                 indent(fp, indent_level);
@@ -233,28 +479,45 @@ void generate_statement(FILE *fp, Statement *stmt, int indent_level) {
             }
             break;
 
-        case STMT_IF:
+        case STMT_IF: {
             indent(fp, indent_level);
             fprintf(fp, "if ");
             generate_expression(fp, stmt->if_stmt.condition, indent_level);
             fprintf(fp, ":\n");
-            generate_statement(fp, stmt->if_stmt.then_branch, indent_level + 1);
-            if (stmt->if_stmt.else_branch) {
+            generate_body(fp, stmt->if_stmt.then_branch, indent_level + 1);
+            // else if chains (and lowered switches) stay at one indentation level
+            Statement *rest = stmt->if_stmt.else_branch;
+            while (else_if_statement(rest)) {
+                rest = else_if_statement(rest);
+                indent(fp, indent_level);
+                fprintf(fp, "elif ");
+                generate_expression(fp, rest->if_stmt.condition, indent_level);
+                fprintf(fp, ":\n");
+                generate_body(fp, rest->if_stmt.then_branch, indent_level + 1);
+                rest = rest->if_stmt.else_branch;
+            }
+            if (rest) {
                 indent(fp, indent_level);
                 fprintf(fp, "else:\n");
-                generate_statement(fp, stmt->if_stmt.else_branch, indent_level + 1);
+                generate_body(fp, rest, indent_level + 1);
             }
             break;
+        }
 
-        case STMT_WHILE:
+        case STMT_WHILE: {
+            Expression *outer_increment = loop_increment;
+            loop_increment = NULL;
             indent(fp, indent_level);
             fprintf(fp, "while ");
             generate_expression(fp, stmt->while_stmt.condition, indent_level);
             fprintf(fp, ":\n");
-            generate_statement(fp, stmt->while_stmt.body, indent_level + 1);
+            generate_body(fp, stmt->while_stmt.body, indent_level + 1);
+            loop_increment = outer_increment;
             break;
+        }
 
-        case STMT_FOR:
+        case STMT_FOR: {
+            Expression *outer_increment = loop_increment;
             if (stmt->for_stmt.initializer) {
                 generate_statement(fp, stmt->for_stmt.initializer, indent_level);
             }
@@ -262,13 +525,31 @@ void generate_statement(FILE *fp, Statement *stmt, int indent_level) {
             fprintf(fp, "while ");
             generate_expression(fp, stmt->for_stmt.condition, indent_level);
             fprintf(fp, ":\n");
-            generate_statement(fp, stmt->for_stmt.body, indent_level + 1);
+            loop_increment = stmt->for_stmt.increment;
+            generate_body(fp, stmt->for_stmt.body, indent_level + 1);
+            loop_increment = outer_increment;
             if (stmt->for_stmt.increment) {
-                indent(fp, indent_level + 1);
-                generate_expression(fp, stmt->for_stmt.increment, indent_level + 1);
-                fprintf(fp, "\n");
+                generate_expression_statement(fp, stmt->for_stmt.increment, indent_level + 1);
             }
             break;
+        }
+
+        case STMT_FOR_IN: {
+            Expression *outer_increment = loop_increment;
+            loop_increment = NULL;
+            indent(fp, indent_level);
+            fprintf(fp, "for %s in ", stmt->for_in.var.name);
+            generate_expression(fp, stmt->for_in.iterable, indent_level);
+            fprintf(fp, ":\n");
+            generate_body(fp, stmt->for_in.body, indent_level + 1);
+            loop_increment = outer_increment;
+            if (stmt->for_in.else_branch) {
+                indent(fp, indent_level);
+                fprintf(fp, "else:\n");
+                generate_body(fp, stmt->for_in.else_branch, indent_level + 1);
+            }
+            break;
+        }
 
         case STMT_RETURN:
             indent(fp, indent_level);
@@ -286,36 +567,247 @@ void generate_statement(FILE *fp, Statement *stmt, int indent_level) {
             break;
 
         case STMT_CONTINUE:
+            // C runs the for-loop increment before re-testing the condition
+            if (loop_increment) {
+                generate_expression_statement(fp, loop_increment, indent_level);
+            }
             indent(fp, indent_level);
             fprintf(fp, "continue\n");
             break;
 
         case STMT_PRINT:
+            // printf("x=%d\n", x) becomes print("x=%d\n" % (x,), end="")
             indent(fp, indent_level);
-            fprintf(fp, "print(f\"%s\"", stmt->print.format);
-            for (int i = 0; i < stmt->print.arg_count; i++) {
-                fprintf(fp, ", ");
-                generate_expression(fp, stmt->print.args[i], indent_level);
+            fprintf(fp, "print(\"");
+            generate_format_string(fp, stmt->print.format, stmt->print.arg_count > 0);
+            fprintf(fp, "\"");
+            if (stmt->print.arg_count > 0) {
+                fprintf(fp, " %% (");
+                for (int i = 0; i < stmt->print.arg_count; i++) {
+                    // Python formats negative ints with a sign; C prints the unsigned bits
+                    char conversion = format_conversion(stmt->print.format, i);
+                    int is_unsigned = conversion && strchr("uxXo", conversion);
+                    if (is_unsigned) fprintf(fp, "(");
+                    generate_expression(fp, stmt->print.args[i], indent_level);
+                    if (is_unsigned) fprintf(fp, " & 0xFFFFFFFF)");
+                    if (i < stmt->print.arg_count - 1 || stmt->print.arg_count == 1) {
+                        fprintf(fp, ",");
+                    }
+                    if (i < stmt->print.arg_count - 1) {
+                        fprintf(fp, " ");
+                    }
+                }
+                fprintf(fp, ")");
             }
-            fprintf(fp, ")\n");
+            fprintf(fp, ", end=\"\")\n");
+            break;
+
+        case STMT_SWITCH:
+            // Always lowered to if chains, decision trees or tables by lower_switch_statements
             break;
     }
 }
 
-void generate_function(FILE *fp, Function *func, int indent_level) {
+void generate_function(FILE *fp, Program *prog, Function *func, int indent_level) {
+    if (func->memoize) {
+        indent(fp, indent_level);
+        if (optimizer_options.memo_cache_size < 0) {
+            fprintf(fp, "@lru_cache(maxsize=None)\n");
+        } else {
+            fprintf(fp, "@lru_cache(maxsize=%d)\n", optimizer_options.memo_cache_size);
+        }
+    }
     indent(fp, indent_level);
     fprintf(fp, "def %s(", func->name);
     for (int i = 0; i < func->param_count; i++) {
         fprintf(fp, "%s: ", func->params[i].name);
         generate_type(fp, func->params[i].type, func->params[i].struct_name);
-        if (i < func->param_count - 1) {
+        if (i < func->param_count - 1 || func->default_count > 0) {
             fprintf(fp, ", ");
         }
     }
+    for (int i = 0; i < func->default_count; i++) {
+        fprintf(fp, "%s=%s%s", func->default_names[i], func->default_values[i], i < func->default_count - 1 ? ", " : "");
+    }
     fprintf(fp, ") -> ");
     generate_type(fp, func->return_type, NULL);
     fprintf(fp, ":\n");
-    generate_statement(fp, func->body, indent_level + 1);
+
+    // Python needs a global declaration for every global the function assigns
+    int declared = 0;
+    for (int i = 0; i < prog->global_var_count; i++) {
+        if (!function_rebinds_global(prog, func, prog->global_vars[i].name)) continue;
+        if (declared++ == 0) {
+            indent(fp, indent_level + 1);
+            fprintf(fp, "global %s", prog->global_vars[i].name);
+        } else {
+            fprintf(fp, ", %s", prog->global_vars[i].name);
+        }
+    }
+    if (declared) fprintf(fp, "\n");
+    generate_body(fp, func->body, indent_level + 1);
+}
+
+typedef struct {
+    const char *module;
+    int found;
+} ModuleScan;
+
+void find_module_call(Expression *expr, void *ctx) {
+    ModuleScan *scan = ctx;
+    size_t length = strlen(scan->module);
+    if (expr->type == EXPR_CALL && strncmp(expr->call.func_name, scan->module, length) == 0 &&
+        expr->call.func_name[length] == '.') {
+        scan->found = 1;
+    }
+}
+
+// Check if the generated code calls into a Python module (e.g. math.prod),
+// including through a default argument such as _math_sin=math.sin
+int program_uses_module(Program *prog, const char *module) {
+    ModuleScan scan = { module, 0 };
+    size_t length = strlen(module);
+    for (int i = 0; i < prog->function_count; i++) {
+        Function *func = prog->functions[i];
+        visit_statement_expressions(func->body, find_module_call, &scan);
+        for (int j = 0; j < func->default_count; j++) {
+            if (strncmp(func->default_values[j], module, length) == 0 && func->default_values[j][length] == '.') {
+                scan.found = 1;
+            }
+        }
+    }
+    visit_statement_expressions(prog->init_block, find_module_call, &scan);
+    return scan.found;
+}
+
+typedef struct {
+    const char *name;
+    int found;
+} CallScan;
+
+void find_named_call(Expression *expr, void *ctx) {
+    CallScan *scan = ctx;
+    if (expr->type == EXPR_CALL && strcmp(expr->call.func_name, scan->name) == 0) scan->found = 1;
+}
+
+// Check if the generated code calls a helper function
+int program_uses_call(Program *prog, const char *name) {
+    CallScan scan = { name, 0 };
+    for (int i = 0; i < prog->function_count; i++) {
+        visit_statement_expressions(prog->functions[i]->body, find_named_call, &scan);
+    }
+    visit_statement_expressions(prog->init_block, find_named_call, &scan);
+    return scan.found;
+}
+
+typedef struct {
+    BinaryOpType op;
+    int found;
+} OperatorScan;
+
+void find_operator(Expression *expr, void *ctx) {
+    OperatorScan *scan = ctx;
+    if (expr->type == EXPR_BINARY && expr->binary.op == scan->op) scan->found = 1;
+}
+
+// Check if any generated expression uses a binary operator
+int program_uses_operator(Program *prog, BinaryOpType op) {
+    OperatorScan scan = { op, 0 };
+    for (int i = 0; i < prog->function_count; i++) {
+        visit_statement_expressions(prog->functions[i]->body, find_operator, &scan);
+    }
+    visit_statement_expressions(prog->init_block, find_operator, &scan);
+    return scan.found;
+}
+
+// C division and remainder round toward zero, unlike Python's // and %; bit
+// reversal goes through a byte table
+void generate_int_helpers(FILE *fp, Program *prog) {
+    int uses_mod = program_uses_operator(prog, OP_TRUNC_MOD);
+    if (uses_mod || program_uses_operator(prog, OP_TRUNC_DIV)) {
+        fprintf(fp, "def _c_div(a: int, b: int) -> int:\n");
+        fprintf(fp, "    q = abs(a) // abs(b)\n");
+        fprintf(fp, "    return q if (a < 0) == (b < 0) else -q\n\n");
+    }
+    if (uses_mod) {
+        fprintf(fp, "def _c_mod(a: int, b: int) -> int:\n");
+        fprintf(fp, "    return a - b * _c_div(a, b)\n\n");
+    }
+    // Same as reverse_bits in src/helpers/bitwise_helper.py
+    if (program_uses_call(prog, "reverse_bits")) {
+        fprintf(fp, "_REVERSED_BYTES = [int(f\"{b:08b}\"[::-1], 2) for b in range(256)]\n\n");
+        fprintf(fp, "def reverse_bits(value: int, width: int) -> int:\n");
+        fprintf(fp, "    value &= (1 << width) - 1\n");
+        fprintf(fp, "    result = 0\n");
+        fprintf(fp, "    for _ in range((width + 7) // 8):\n");
+        fprintf(fp, "        result = (result << 8) | _REVERSED_BYTES[value & 0xFF]\n");
+        fprintf(fp, "        value >>= 8\n");
+        fprintf(fp, "    return result >> (-width %% 8)\n\n");
+    }
+}
+
+// C math functions return NaN or inf outside their domain where Python's raise
+static const char *math_helpers[][2] = {
+    { "_c_sqrt",  "def _c_sqrt(x: float) -> float:\n"
+                  "    return math.sqrt(x) if x >= 0 else math.nan\n\n" },
+    { "_c_exp",   "def _c_exp(x: float) -> float:\n"
+                  "    try:\n"
+                  "        return math.exp(x)\n"
+                  "    except OverflowError:\n"
+                  "        return math.inf\n\n" },
+    { "_c_log",   "def _c_log(x: float) -> float:\n"
+                  "    if x > 0:\n"
+                  "        return math.log(x)\n"
+                  "    return -math.inf if x == 0 else math.nan\n\n" },
+    { "_c_log2",  "def _c_log2(x: float) -> float:\n"
+                  "    if x > 0:\n"
+                  "        return math.log2(x)\n"
+                  "    return -math.inf if x == 0 else math.nan\n\n" },
+    { "_c_log10", "def _c_log10(x: float) -> float:\n"
+                  "    if x > 0:\n"
+                  "        return math.log10(x)\n"
+                  "    return -math.inf if x == 0 else math.nan\n\n" },
+    { "_c_asin",  "def _c_asin(x: float) -> float:\n"
+                  "    return math.asin(x) if -1 <= x <= 1 else math.nan\n\n" },
+    { "_c_acos",  "def _c_acos(x: float) -> float:\n"
+                  "    return math.acos(x) if -1 <= x <= 1 else math.nan\n\n" },
+};
+
+#define MATH_HELPER_COUNT (sizeof(math_helpers) / sizeof(math_helpers[0]))
+
+// Check if the generated code calls one of the math helpers
+int program_uses_math_helpers(Program *prog) {
+    for (size_t i = 0; i < MATH_HELPER_COUNT; i++) {
+        if (program_uses_call(prog, math_helpers[i][0])) return 1;
+    }
+    return 0;
+}
+
+void generate_math_helpers(FILE *fp, Program *prog) {
+    for (size_t i = 0; i < MATH_HELPER_COUNT; i++) {
+        if (program_uses_call(prog, math_helpers[i][0])) fputs(math_helpers[i][1], fp);
+    }
+}
+
+// Counters added by --profile-generate and the exit hook that writes them out
+void generate_profile_counters(FILE *fp, Program *prog) {
+    if (prog->profile_site_count == 0) return;
+    fprintf(fp, "_profile_sites = [");
+    for (int i = 0; i < prog->profile_site_count; i++) {
+        fprintf(fp, "%s\"%s\"", i > 0 ? ", " : "", prog->profile_sites[i]);
+    }
+    fprintf(fp, "]\n");
+    fprintf(fp, "_profile = [0] * %d\n\n", prog->profile_site_count);
+    fprintf(fp, "def _profile_dump():\n");
+    fprintf(fp, "    with open(\"");
+    for (const char *c = optimizer_options.profile_generate; *c; c++) {
+        if (*c == '\\' || *c == '"') fputc('\\', fp);
+        fputc(*c, fp);
+    }
+    fprintf(fp, "\", \"w\") as out:\n");
+    fprintf(fp, "        for site, count in zip(_profile_sites, _profile):\n");
+    fprintf(fp, "            out.write(f\"{site} {count}\\n\")\n\n");
+    fprintf(fp, "atexit.register(_profile_dump)\n\n");
 }
 
 void generate_code(Program *prog, const char *output_file) {
@@ -325,15 +817,37 @@ void generate_code(Program *prog, const char *output_file) {
         return;
     }
 
-    fprintf(fp, "from dataclasses import dataclass\n");
+    if (prog->profile_site_count > 0) {
+        fprintf(fp, "import atexit\n");
+    }
+    if (program_uses_module(prog, "math") || program_uses_math_helpers(prog)) {
+        fprintf(fp, "import math\n");
+    }
+    // Array fields need field(default_factory=...) so instances don't share a list
+    int needs_field = 0;
+    for (int i = 0; i < prog->struct_count; i++) {
+        for (int j = 0; j < prog->structs[i].field_count; j++) {
+            if (prog->structs[i].fields[j].is_array) needs_field = 1;
+        }
+    }
+    fprintf(fp, needs_field ? "from dataclasses import dataclass, field\n" : "from dataclasses import dataclass\n");
+    for (int i = 0; i < prog->function_count; i++) {
+        if (prog->functions[i]->memoize) {
+            fprintf(fp, "from functools import lru_cache\n");
+            break;
+        }
+    }
     fprintf(fp, "from typing import List\n\n");
+    generate_int_helpers(fp, prog);
+    generate_math_helpers(fp, prog);
+    generate_profile_counters(fp, prog);
 
     // Generate structs
     generate_structs(fp, prog->structs, prog->struct_count);
 
     // Generate global variables
     for (int i = 0; i < prog->global_var_count; i++) {
-        generate_variable_init(fp, &prog->global_vars[i], 0);
+        generate_global_init(fp, &prog->global_vars[i]);
     }
     if (prog->global_var_count > 0) {
         fprintf(fp, "\n");
@@ -341,14 +855,20 @@ void generate_code(Program *prog, const char *output_file) {
 
     // Generate functions
     for (int i = 0; i < prog->function_count; i++) {
-        generate_function(fp, prog->functions[i], 0);
+        generate_function(fp, prog, prog->functions[i], 0);
+        fprintf(fp, "\n");
+    }
+
+    // Generate module-level initialization (precomputed tables)
+    if (prog->init_block) {
+        generate_statement(fp, prog->init_block, 0);
         fprintf(fp, "\n");
     }
 
-    // Generate main execution block
-    fprintf(fp, "if __name__ == \"__main__\":\n");
+    // Generate main execution block (a module without main is a library)
     for (int i = 0; i < prog->function_count; i++) {
         if (strcmp(prog->functions[i]->name, "main") == 0) {
+            fprintf(fp, "if __name__ == \"__main__\":\n");
             fprintf(fp, "    main()\n");
             break;
         }
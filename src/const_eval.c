@@ -0,0 +1,730 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Compile-time evaluation. A small interpreter runs the C program's AST with
+// C semantics (32-bit wrapping ints, truncating division) so that
+//     int num = 5; printf("%d\n", factorial(num));
+// compiles to printf("%d\n", 120). Pure functions called with constant
+// arguments are evaluated and the call replaced by its result. If main takes
+// no input at all, it is run as a whole and its output emitted as one
+// precomputed string.
+// Every evaluation has a step budget (--eval-budget); anything the
+// interpreter cannot model (structs, asm, unknown globals, traps such as
+// division by zero) abandons the attempt and leaves the code as it was.
+
+#define MAX_EVAL_DEPTH 900      // Stay below Python's recursion limit
+#define MAX_EVAL_OUTPUT 65536   // Largest precomputed output of main
+#define FOLD_STEP_BUDGET 10000  // Steps for folding one expression
+
+typedef enum {
+    VALUE_INT,
+    VALUE_FLOAT
+} ValueKind;
+
+typedef struct {
+    ValueKind kind;
+    long long i;
+    double f;
+} Value;
+
+// A variable during evaluation; scalars have one element
+typedef struct {
+    char *name;
+    VariableType type;
+    int is_array;
+    int size;
+    int known;         // 0 for globals with an initializer we do not track
+    Value *values;
+} Slot;
+
+typedef struct {
+    Slot *slots;
+    int count;
+} Frame;
+
+typedef enum {
+    FLOW_NORMAL,
+    FLOW_BREAK,
+    FLOW_CONTINUE,
+    FLOW_RETURN
+} Flow;
+
+typedef struct {
+    Program *prog;
+    long long steps;     // Remaining budget
+    int failed;          // Set when the program does something we cannot evaluate
+    int depth;
+    int run_main;        // Impure functions and printf allowed
+    Frame globals;
+    Frame *frame;
+    Value result;        // Value of the last return
+    char *output;        // printf output as format text ("%%" for a literal %)
+    size_t output_len;
+} Evaluator;
+
+Value int_value(long long i) {
+    Value value = { VALUE_INT, i, 0 };
+    return value;
+}
+
+Value float_value(double f) {
+    Value value = { VALUE_FLOAT, 0, f };
+    return value;
+}
+
+// Reduce to a 32-bit two's-complement int, as C stores it
+long long wrap_int(long long value) {
+    return (long long)(int)(unsigned int)(unsigned long long)value;
+}
+
+double as_double(Value value) {
+    return value.kind == VALUE_FLOAT ? value.f : (double)value.i;
+}
+
+// Convert a value for storage in a variable of the given type
+Value convert_value(Value value, VariableType type) {
+    if (type == TYPE_FLOAT) return float_value(as_double(value));
+    if (value.kind == VALUE_FLOAT) return int_value(wrap_int((long long)value.f));
+    return value;
+}
+
+Value fail(Evaluator *eval) {
+    eval->failed = 1;
+    return int_value(0);
+}
+
+int spend_step(Evaluator *eval) {
+    if (eval->failed) return 0;
+    if (--eval->steps < 0) eval->failed = 1;
+    return !eval->failed;
+}
+
+Slot *find_slot(Frame *frame, const char *name) {
+    for (int i = frame->count - 1; i >= 0; i--) {
+        if (strcmp(frame->slots[i].name, name) == 0) return &frame->slots[i];
+    }
+    return NULL;
+}
+
+Slot *lookup_slot(Evaluator *eval, const char *name) {
+    Slot *slot = find_slot(eval->frame, name);
+    if (!slot) slot = find_slot(&eval->globals, name);
+    if (!slot || !slot->known) {
+        eval->failed = 1;
+        return NULL;
+    }
+    return slot;
+}
+
+// Create (or reset) a variable in a frame, zero-filled like the generated Python
+Slot *declare_slot(Frame *frame, Variable *var) {
+    Slot *slot = find_slot(frame, var->name);
+    if (!slot) {
+        frame->slots = realloc(frame->slots, (frame->count + 1) * sizeof(Slot));
+        slot = &frame->slots[frame->count++];
+        slot->name = var->name;
+    } else {
+        free(slot->values);
+    }
+    slot->type = var->type;
+    slot->is_array = var->is_array;
+    slot->size = var->is_array ? var->array_size : 1;
+    slot->known = 1;
+    slot->values = malloc((slot->size > 0 ? slot->size : 1) * sizeof(Value));
+    for (int i = 0; i < slot->size; i++) {
+        slot->values[i] = var->type == TYPE_FLOAT ? float_value(0) : int_value(0);
+    }
+    return slot;
+}
+
+void free_frame(Frame *frame) {
+    for (int i = 0; i < frame->count; i++) {
+        free(frame->slots[i].values);
+    }
+    free(frame->slots);
+}
+
+Value evaluate(Evaluator *eval, Expression *expr);
+Flow execute(Evaluator *eval, Statement *stmt);
+
+// Element of an array or the value of a scalar that an assignment writes
+Value *target_value(Evaluator *eval, Expression *target, VariableType *type) {
+    if (target->type == EXPR_VARIABLE) {
+        Slot *slot = lookup_slot(eval, target->var_name);
+        if (!slot || slot->is_array) return NULL;
+        *type = slot->type;
+        return &slot->values[0];
+    }
+    if (target->type == EXPR_ARRAY_ACCESS) {
+        Value index = evaluate(eval, target->array_access.index);
+        Slot *slot = lookup_slot(eval, target->array_access.array_name);
+        if (!slot || !slot->is_array || index.kind != VALUE_INT || index.i < 0 || index.i >= slot->size) return NULL;
+        *type = slot->type;
+        return &slot->values[index.i];
+    }
+    return NULL;
+}
+
+Value evaluate_int_binary(Evaluator *eval, BinaryOpType op, long long a, long long b) {
+    switch (op) {
+        case OP_ADD: return int_value(wrap_int(a + b));
+        case OP_SUB: return int_value(wrap_int(a - b));
+        case OP_MUL: return int_value(wrap_int(a * b));
+        case OP_DIV:
+        case OP_MOD:
+            if (b == 0 || (a == -2147483647LL - 1 && b == -1)) return fail(eval);
+            return int_value(op == OP_DIV ? a / b : a % b);
+        case OP_EQ: return int_value(a == b);
+        case OP_NEQ: return int_value(a != b);
+        case OP_LT: return int_value(a < b);
+        case OP_GT: return int_value(a > b);
+        case OP_LTE: return int_value(a <= b);
+        case OP_GTE: return int_value(a >= b);
+        case OP_BIT_AND: return int_value(a & b);
+        case OP_BIT_OR: return int_value(a | b);
+        case OP_BIT_XOR: return int_value(a ^ b);
+        case OP_SHIFT_LEFT:
+            if (b < 0 || b >= 32) return fail(eval);
+            return int_value(wrap_int((long long)((unsigned long long)a << b)));
+        case OP_SHIFT_RIGHT:
+            if (b < 0 || b >= 32) return fail(eval);
+            return int_value(a >> b);
+        default:
+            return fail(eval);
+    }
+}
+
+Value evaluate_float_binary(Evaluator *eval, BinaryOpType op, double a, double b) {
+    switch (op) {
+        case OP_ADD: return float_value(a + b);
+        case OP_SUB: return float_value(a - b);
+        case OP_MUL: return float_value(a * b);
+        case OP_DIV:
+            if (b == 0) return fail(eval);
+            return float_value(a / b);
+        case OP_EQ: return int_value(a == b);
+        case OP_NEQ: return int_value(a != b);
+        case OP_LT: return int_value(a < b);
+        case OP_GT: return int_value(a > b);
+        case OP_LTE: return int_value(a <= b);
+        case OP_GTE: return int_value(a >= b);
+        default:
+            return fail(eval);
+    }
+}
+
+int is_true(Value value) {
+    return value.kind == VALUE_FLOAT ? value.f != 0 : value.i != 0;
+}
+
+Value evaluate_binary(Evaluator *eval, Expression *expr) {
+    BinaryOpType op = expr->binary.op;
+    if (op == OP_AND || op == OP_OR) {
+        int left = is_true(evaluate(eval, expr->binary.left));
+        if (left == (op == OP_OR)) return int_value(left);
+        return int_value(is_true(evaluate(eval, expr->binary.right)));
+    }
+    if (op == OP_ASSIGN) {
+        Value value = evaluate(eval, expr->binary.right);
+        VariableType type;
+        Value *target = target_value(eval, expr->binary.left, &type);
+        if (!target) return fail(eval);
+        *target = convert_value(value, type);
+        return *target;
+    }
+
+    Value a = evaluate(eval, expr->binary.left);
+    Value b = evaluate(eval, expr->binary.right);
+    if (eval->failed) return a;
+    if (a.kind == VALUE_INT && b.kind == VALUE_INT) return evaluate_int_binary(eval, op, a.i, b.i);
+    return evaluate_float_binary(eval, op, as_double(a), as_double(b));
+}
+
+Value evaluate_unary(Evaluator *eval, Expression *expr) {
+    UnaryOpType op = expr->unary.op;
+    if (op == OP_PRE_INC || op == OP_PRE_DEC || op == OP_POST_INC || op == OP_POST_DEC) {
+        VariableType type;
+        Value *target = target_value(eval, expr->unary.expr, &type);
+        if (!target) return fail(eval);
+        Value old = *target;
+        int step = op == OP_PRE_INC || op == OP_POST_INC ? 1 : -1;
+        *target = old.kind == VALUE_FLOAT ? float_value(old.f + step) : int_value(wrap_int(old.i + step));
+        return op == OP_PRE_INC || op == OP_PRE_DEC ? *target : old;
+    }
+
+    Value value = evaluate(eval, expr->unary.expr);
+    switch (op) {
+        case OP_NEGATE:
+            return value.kind == VALUE_FLOAT ? float_value(-value.f) : int_value(wrap_int(-value.i));
+        case OP_NOT:
+            return int_value(!is_true(value));
+        case OP_BIT_NOT:
+            if (value.kind == VALUE_FLOAT) return fail(eval);
+            return int_value(~value.i);
+        default:
+            return fail(eval);
+    }
+}
+
+// Run a program function with the given arguments
+Value call_function(Evaluator *eval, Function *func, Value *args) {
+    if (eval->depth >= MAX_EVAL_DEPTH || (!func->is_pure && !eval->run_main)) return fail(eval);
+
+    Frame frame = { NULL, 0 };
+    for (int i = 0; i < func->param_count; i++) {
+        Variable *param = &func->params[i];
+        if (param->is_array || param->struct_name) {
+            free_frame(&frame);
+            return fail(eval);
+        }
+        Slot *slot = declare_slot(&frame, param);
+        slot->values[0] = convert_value(args[i], param->type);
+    }
+
+    Frame *caller = eval->frame;
+    eval->frame = &frame;
+    eval->depth++;
+    Flow flow = execute(eval, func->body);
+    eval->depth--;
+    eval->frame = caller;
+    free_frame(&frame);
+
+    // Falling off the end of a non-void function leaves the result undefined
+    if (flow != FLOW_RETURN && func->return_type != TYPE_VOID) return fail(eval);
+    return convert_value(eval->result, func->return_type);
+}
+
+Value evaluate_call(Evaluator *eval, Expression *expr) {
+    Function *callee = find_function(eval->prog, expr->call.func_name);
+    if (!callee || callee->param_count != expr->call.arg_count) return fail(eval);
+
+    Value *args = malloc((expr->call.arg_count + 1) * sizeof(Value));
+    for (int i = 0; i < expr->call.arg_count && !eval->failed; i++) {
+        args[i] = evaluate(eval, expr->call.args[i]);
+    }
+    Value result = eval->failed ? int_value(0) : call_function(eval, callee, args);
+    free(args);
+    return result;
+}
+
+Value evaluate(Evaluator *eval, Expression *expr) {
+    if (!expr || !spend_step(eval)) return fail(eval);
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            switch (expr->literal.lit_type) {
+                case TYPE_INT: return int_value(expr->literal.int_val);
+                case TYPE_CHAR: return int_value(expr->literal.char_val);
+                case TYPE_FLOAT: return float_value(expr->literal.float_val);
+                default: return fail(eval);
+            }
+
+        case EXPR_VARIABLE: {
+            Slot *slot = lookup_slot(eval, expr->var_name);
+            if (!slot || slot->is_array) return fail(eval);
+            return slot->values[0];
+        }
+
+        case EXPR_ARRAY_ACCESS: {
+            VariableType type;
+            Value *element = target_value(eval, expr, &type);
+            return element ? *element : fail(eval);
+        }
+
+        case EXPR_BINARY:
+            return evaluate_binary(eval, expr);
+
+        case EXPR_UNARY:
+            return evaluate_unary(eval, expr);
+
+        case EXPR_CALL:
+            return evaluate_call(eval, expr);
+
+        default:
+            return fail(eval);
+    }
+}
+
+void append_output(Evaluator *eval, const char *text, size_t length) {
+    if (eval->output_len + length > MAX_EVAL_OUTPUT) {
+        eval->failed = 1;
+        return;
+    }
+    eval->output = realloc(eval->output, eval->output_len + length + 1);
+    memcpy(eval->output + eval->output_len, text, length);
+    eval->output_len += length;
+    eval->output[eval->output_len] = '\0';
+}
+
+// Append formatted text, keeping it valid as printf format text
+void append_formatted(Evaluator *eval, const char *text) {
+    for (const char *c = text; *c; c++) {
+        append_output(eval, *c == '%' ? "%%" : c, *c == '%' ? 2 : 1);
+    }
+}
+
+// Format one printf call the way C would; the format keeps its escape sequences
+void execute_print(Evaluator *eval, Statement *stmt) {
+    if (!eval->run_main) {
+        eval->failed = 1;
+        return;
+    }
+
+    const char *format = stmt->print.format;
+    int arg = 0;
+    for (const char *c = format; *c && !eval->failed; c++) {
+        if (*c == '\\' && c[1]) {
+            append_output(eval, c, 2);
+            c++;
+            continue;
+        }
+        if (*c != '%') {
+            append_output(eval, c, 1);
+            continue;
+        }
+        if (c[1] == '%') {
+            append_output(eval, "%%", 2);
+            c++;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion
+        char spec[64] = "%";
+        size_t length = 1;
+        c++;
+        while (*c && strchr("-+ #0123456789.", *c) && length < sizeof(spec) - 4) spec[length++] = *c++;
+        while (*c && strchr("hlLqjzt", *c)) c++;
+        spec[length] = '\0';
+        if (!*c || arg >= stmt->print.arg_count) {
+            eval->failed = 1;
+            return;
+        }
+
+        Expression *arg_expr = stmt->print.args[arg++];
+        char text[512];
+        if (*c == 's') {
+            if (length != 1 || arg_expr->type != EXPR_LITERAL || arg_expr->literal.lit_type != TYPE_STRING) {
+                eval->failed = 1;
+                return;
+            }
+            append_formatted(eval, arg_expr->literal.string_val);
+            continue;
+        }
+
+        Value value = evaluate(eval, arg_expr);
+        if (eval->failed) return;
+        if (strchr("di", *c)) {
+            strcat(spec, "lld");
+            snprintf(text, sizeof(text), spec, value.kind == VALUE_INT ? value.i : (long long)value.f);
+        } else if (strchr("uxXo", *c)) {
+            size_t end = strlen(spec);
+            spec[end] = 'l';
+            spec[end + 1] = 'l';
+            spec[end + 2] = *c;
+            spec[end + 3] = '\0';
+            unsigned int bits = (unsigned int)(value.kind == VALUE_INT ? value.i : (long long)value.f);
+            snprintf(text, sizeof(text), spec, (unsigned long long)bits);
+        } else if (strchr("fFeEgG", *c)) {
+            size_t end = strlen(spec);
+            spec[end] = *c;
+            spec[end + 1] = '\0';
+            snprintf(text, sizeof(text), spec, as_double(value));
+        } else if (*c == 'c' && length == 1 && value.kind == VALUE_INT && value.i >= 32 && value.i < 127 &&
+                   value.i != '"' && value.i != '\\') {
+            text[0] = (char)value.i;
+            text[1] = '\0';
+        } else {
+            eval->failed = 1;
+            return;
+        }
+        append_formatted(eval, text);
+    }
+    if (arg != stmt->print.arg_count) eval->failed = 1;
+}
+
+Flow execute_loop(Evaluator *eval, Expression *condition, Statement *body, Expression *increment) {
+    while (!eval->failed && (!condition || is_true(evaluate(eval, condition)))) {
+        Flow flow = execute(eval, body);
+        if (flow == FLOW_RETURN) return flow;
+        if (flow == FLOW_BREAK) break;
+        if (increment) evaluate(eval, increment);
+    }
+    return FLOW_NORMAL;
+}
+
+Flow execute(Evaluator *eval, Statement *stmt) {
+    if (!stmt) return FLOW_NORMAL;
+    if (!spend_step(eval)) return FLOW_RETURN;
+
+    switch (stmt->type) {
+        case STMT_EXPR:
+            evaluate(eval, stmt->expr);
+            return FLOW_NORMAL;
+
+        case STMT_VAR_DECL: {
+            Variable *var = &stmt->var_decl.var;
+            if (var->struct_name || (var->is_array && var->array_size <= 0)) {
+                eval->failed = 1;
+                return FLOW_RETURN;
+            }
+            Expression *init = stmt->var_decl.initializer;
+            if (var->is_array && init && init->type == EXPR_LIST) {
+                // int t[] = {...}; the parser padded the list to the array size
+                Slot *slot = declare_slot(eval->frame, var);
+                for (int i = 0; i < init->list.count && i < slot->size && !eval->failed; i++) {
+                    slot->values[i] = convert_value(evaluate(eval, init->list.elements[i]), var->type);
+                }
+                return FLOW_NORMAL;
+            }
+            Value value = init ? evaluate(eval, init) : int_value(0);
+            Slot *slot = declare_slot(eval->frame, var);
+            if (!var->is_array) slot->values[0] = convert_value(value, var->type);
+            return FLOW_NORMAL;
+        }
+
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                Flow flow = execute(eval, stmt->block.statements[i]);
+                if (flow != FLOW_NORMAL || eval->failed) return flow;
+            }
+            return FLOW_NORMAL;
+
+        case STMT_IF:
+            if (is_true(evaluate(eval, stmt->if_stmt.condition))) return execute(eval, stmt->if_stmt.then_branch);
+            return execute(eval, stmt->if_stmt.else_branch);
+
+        case STMT_WHILE:
+            return execute_loop(eval, stmt->while_stmt.condition, stmt->while_stmt.body, NULL);
+
+        case STMT_FOR:
+            execute(eval, stmt->for_stmt.initializer);
+            return execute_loop(eval, stmt->for_stmt.condition, stmt->for_stmt.body, stmt->for_stmt.increment);
+
+        case STMT_RETURN:
+            eval->result = stmt->return_value ? evaluate(eval, stmt->return_value) : int_value(0);
+            return FLOW_RETURN;
+
+        case STMT_BREAK:
+            return FLOW_BREAK;
+
+        case STMT_CONTINUE:
+            return FLOW_CONTINUE;
+
+        case STMT_PRINT:
+            execute_print(eval, stmt);
+            return FLOW_NORMAL;
+
+        default:
+            eval->failed = 1;
+            return FLOW_RETURN;
+    }
+}
+
+// Module-level statements run before main: table[:] = [constants] fills
+// (switch lookup tables) are replayed, and any other global they write is unknown
+void apply_module_fills(Evaluator *eval, Statement *init) {
+    for (int i = 0; init && i < init->block.stmt_count; i++) {
+        Statement *stmt = init->block.statements[i];
+        Expression *target = stmt->type == STMT_EXPR ? written_target(stmt->expr) : NULL;
+        Expression *value = target ? stmt->expr->binary.right : NULL;
+        Slot *slot = target && base_variable_name(target) ? find_slot(&eval->globals, base_variable_name(target)) : NULL;
+        int filled = slot && target->type == EXPR_SLICE && !target->slice.start && !target->slice.stop &&
+                     value->type == EXPR_LIST && value->list.count == slot->size;
+        for (int j = 0; filled && j < value->list.count; j++) {
+            Expression *element = value->list.elements[j];
+            if (element->type != EXPR_LITERAL || element->literal.lit_type != TYPE_INT) filled = 0;
+        }
+        if (filled) {
+            for (int j = 0; j < value->list.count; j++) {
+                slot->values[j] = int_value(value->list.elements[j]->literal.int_val);
+            }
+        } else if (slot) {
+            slot->known = 0;
+        }
+    }
+}
+
+// Fresh interpreter state; when running main, globals start zeroed as in the generated module
+Evaluator *create_evaluator(Program *prog, int run_main) {
+    Evaluator *eval = calloc(1, sizeof(Evaluator));
+    eval->prog = prog;
+    eval->steps = optimizer_options.eval_step_budget;
+    eval->run_main = run_main;
+    for (int i = 0; i < prog->global_var_count; i++) {
+        Variable *var = &prog->global_vars[i];
+        if (var->struct_name) continue;
+        Slot *slot = declare_slot(&eval->globals, var);
+        // The parser keeps literal initializers of int and float scalars; a lone
+        // call cannot know what the rest of the program stored in any global
+        slot->known = run_main && (!var->is_initialized || (!var->is_array && var->type != TYPE_CHAR));
+        if (var->is_array && var->elements) {
+            // Brace-initialized tables; constant ones are known to every call
+            slot->known = (run_main || var->is_constant) && var->type != TYPE_CHAR;
+            for (int j = 0; slot->known && j < var->elements->list.count && j < slot->size; j++) {
+                Expression *element = var->elements->list.elements[j];
+                Value value = element->literal.lit_type == TYPE_FLOAT ? float_value(element->literal.float_val)
+                                                                      : int_value(element->literal.int_val);
+                slot->values[j] = convert_value(value, var->type);
+            }
+        } else if (slot->known && var->is_initialized) {
+            slot->values[0] = var->type == TYPE_FLOAT ? float_value(var->value.float_val) : int_value(var->value.int_val);
+        }
+    }
+    apply_module_fills(eval, prog->init_block);
+    eval->frame = &eval->globals;
+    return eval;
+}
+
+void free_evaluator(Evaluator *eval) {
+    free_frame(&eval->globals);
+    free(eval->output);
+    free(eval);
+}
+
+// Value of an int expression that reads no variables (pure calls allowed)
+int evaluate_constant(Program *prog, Expression *expr, long long *value) {
+    Evaluator *eval = create_evaluator(prog, 0);
+    eval->steps = FOLD_STEP_BUDGET;
+    Value result = evaluate(eval, expr);
+    int ok = !eval->failed && result.kind == VALUE_INT;
+    if (ok) *value = result.i;
+    free_evaluator(eval);
+    return ok;
+}
+
+// Constant value of a call argument: a literal or a constant local
+int constant_argument(Function *caller, Expression *arg, long long *value) {
+    if (arg->type == EXPR_UNARY && arg->unary.op == OP_NEGATE && arg->unary.expr->type == EXPR_LITERAL &&
+        constant_local_value(caller, arg->unary.expr, value)) {
+        *value = -*value;
+        return 1;
+    }
+    return constant_local_value(caller, arg, value);
+}
+
+// Replace pure int calls with constant arguments by their value, innermost first
+void fold_constant_calls(Program *prog, Function *caller, Expression **slot) {
+    Expression *expr = *slot;
+    if (!expr) return;
+
+    switch (expr->type) {
+        case EXPR_BINARY:
+            fold_constant_calls(prog, caller, &expr->binary.left);
+            fold_constant_calls(prog, caller, &expr->binary.right);
+            return;
+        case EXPR_UNARY:
+            fold_constant_calls(prog, caller, &expr->unary.expr);
+            return;
+        case EXPR_ARRAY_ACCESS:
+            fold_constant_calls(prog, caller, &expr->array_access.index);
+            return;
+        case EXPR_CALL:
+            break;
+        default:
+            return;
+    }
+
+    for (int i = 0; i < expr->call.arg_count; i++) {
+        fold_constant_calls(prog, caller, &expr->call.args[i]);
+    }
+    Function *callee = find_function(prog, expr->call.func_name);
+    if (!callee || !callee->is_pure || callee->return_type != TYPE_INT || callee->param_count != expr->call.arg_count) {
+        return;
+    }
+    Value *args = malloc((expr->call.arg_count + 1) * sizeof(Value));
+    for (int i = 0; i < expr->call.arg_count; i++) {
+        long long value;
+        if (!constant_argument(caller, expr->call.args[i], &value)) {
+            free(args);
+            return;
+        }
+        args[i] = int_value(value);
+    }
+
+    Evaluator *eval = create_evaluator(prog, 0);
+    Value result = call_function(eval, callee, args);
+    if (!eval->failed) *slot = make_int_literal((int)result.i);
+    free_evaluator(eval);
+    free(args);
+}
+
+typedef struct {
+    Program *prog;
+    Function *func;
+} FoldContext;
+
+void fold_statement_calls(Statement *stmt, void *ctx) {
+    FoldContext *fold = ctx;
+    switch (stmt->type) {
+        case STMT_EXPR:
+            fold_constant_calls(fold->prog, fold->func, &stmt->expr);
+            break;
+        case STMT_VAR_DECL:
+            fold_constant_calls(fold->prog, fold->func, &stmt->var_decl.initializer);
+            break;
+        case STMT_IF:
+            fold_constant_calls(fold->prog, fold->func, &stmt->if_stmt.condition);
+            break;
+        case STMT_WHILE:
+            fold_constant_calls(fold->prog, fold->func, &stmt->while_stmt.condition);
+            break;
+        case STMT_FOR:
+            fold_constant_calls(fold->prog, fold->func, &stmt->for_stmt.condition);
+            fold_constant_calls(fold->prog, fold->func, &stmt->for_stmt.increment);
+            break;
+        case STMT_RETURN:
+            fold_constant_calls(fold->prog, fold->func, &stmt->return_value);
+            break;
+        case STMT_PRINT:
+            for (int i = 0; i < stmt->print.arg_count; i++) {
+                fold_constant_calls(fold->prog, fold->func, &stmt->print.args[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Run a main() that reads no input and keep only what it prints and returns
+void precompute_main(Program *prog) {
+    Function *main_func = find_function(prog, "main");
+    if (!main_func || main_func->param_count > 0) return;
+
+    Evaluator *eval = create_evaluator(prog, 1);
+    Value result = call_function(eval, main_func, NULL);
+    if (eval->failed) {
+        free_evaluator(eval);
+        return;
+    }
+
+    Statement *body = make_block();
+    if (eval->output_len > 0) {
+        Statement *print = create_statement();
+        print->type = STMT_PRINT;
+        print->print.format = strdup(eval->output);
+        print->print.args = NULL;
+        print->print.arg_count = 0;
+        block_append(body, print);
+    }
+    if (main_func->return_type != TYPE_VOID) {
+        Statement *ret = create_statement();
+        ret->type = STMT_RETURN;
+        ret->return_value = make_int_literal((int)result.i);
+        block_append(body, ret);
+    }
+    main_func->body = body;
+    free_evaluator(eval);
+}
+
+// Evaluate constant work at compile time
+void evaluate_constant_calls(Program *prog) {
+    if (optimizer_options.eval_step_budget <= 0) return;
+
+    for (int i = 0; i < prog->function_count; i++) {
+        FoldContext ctx = { prog, prog->functions[i] };
+        visit_statements(prog->functions[i]->body, fold_statement_calls, &ctx);
+    }
+    precompute_main(prog);
+}
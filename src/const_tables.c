@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Constant lookup tables. An array with a brace initializer that nothing
+// writes becomes a module-level constant, which CPython keeps in the code
+// object instead of building a list:
+//     int crc[4] = {0, 79764919, 159529838, 222504665};
+//     crc: tuple = (0, 79764919, 159529838, 222504665)
+// Int tables whose elements all fit in a byte become bytes, which index to
+// the same ints. A local table is moved to the module under the name
+// _<function>_<array>, so it is no longer rebuilt on every call:
+//     int lut[] = {10, 20, 30, 40};  ->  _main_lut: bytes = b'\x0a\x14\x1e\x28'
+// An array counts as written when any statement stores into it, or when it
+// is passed to a function that may write the parameter or to a call we
+// cannot see into.
+
+#define MAX_TABLE_CALL_DEPTH 8  // Parameters passed on deeper than this count as written
+
+typedef struct {
+    Program *prog;
+    const char *name;
+    int depth;
+    int written;
+} TableWriteScan;
+
+int array_may_be_written(Program *prog, Statement *body, const char *name, int depth);
+
+// Whether a call may store through its index-th argument
+int argument_may_be_written(Program *prog, const char *callee_name, int index, int depth) {
+    Function *callee = find_function(prog, callee_name);
+    if (!callee) return !is_pure_builtin(callee_name);
+    if (index >= callee->param_count || depth >= MAX_TABLE_CALL_DEPTH) return 1;
+    return array_may_be_written(prog, callee->body, callee->params[index].name, depth + 1);
+}
+
+void find_table_write(Expression *expr, void *ctx) {
+    TableWriteScan *scan = ctx;
+    Expression *target = written_target(expr);
+    const char *base = target ? base_variable_name(target) : NULL;
+    if (base && strcmp(base, scan->name) == 0) {
+        scan->written = 1;
+        return;
+    }
+    if (expr->type != EXPR_CALL) return;
+    for (int i = 0; i < expr->call.arg_count && !scan->written; i++) {
+        Expression *arg = expr->call.args[i];
+        if (arg->type == EXPR_VARIABLE && strcmp(arg->var_name, scan->name) == 0 &&
+            argument_may_be_written(scan->prog, expr->call.func_name, i, scan->depth)) {
+            scan->written = 1;
+        }
+    }
+}
+
+int array_may_be_written(Program *prog, Statement *body, const char *name, int depth) {
+    TableWriteScan scan = { prog, name, depth, 0 };
+    visit_statement_expressions(body, find_table_write, &scan);
+    return scan.written;
+}
+
+int global_may_be_written(Program *prog, const char *name) {
+    if (array_may_be_written(prog, prog->init_block, name, 0)) return 1;
+    for (int i = 0; i < prog->function_count; i++) {
+        if (array_may_be_written(prog, prog->functions[i]->body, name, 0)) return 1;
+    }
+    return 0;
+}
+
+typedef struct {
+    Program *prog;
+    Function *func;
+    Statement **tables;  // Declarations of local tables that can move to the module
+    int table_count;
+} LocalTableScan;
+
+typedef struct {
+    const char *name;
+    int count;
+} DeclarationCount;
+
+void count_declarations(Statement *stmt, void *ctx) {
+    DeclarationCount *decls = ctx;
+    if (stmt->type == STMT_VAR_DECL && strcmp(stmt->var_decl.var.name, decls->name) == 0) decls->count++;
+}
+
+void find_local_table(Statement *stmt, void *ctx) {
+    LocalTableScan *scan = ctx;
+    if (stmt->type != STMT_VAR_DECL) return;
+    Variable *var = &stmt->var_decl.var;
+    Expression *init = stmt->var_decl.initializer;
+    if (!var->is_array || var->struct_name || !init || init->type != EXPR_LIST || !literal_elements(init)) return;
+    // One declaration, and no global it could shadow before it
+    DeclarationCount decls = { var->name, 0 };
+    visit_statements(scan->func->body, count_declarations, &decls);
+    if (decls.count != 1 || is_global_name(scan->prog, var->name)) return;
+    for (int i = 0; i < scan->func->param_count; i++) {
+        if (strcmp(scan->func->params[i].name, var->name) == 0) return;
+    }
+    if (array_may_be_written(scan->prog, scan->func->body, var->name, 0)) return;
+    scan->tables = realloc(scan->tables, (scan->table_count + 1) * sizeof(Statement*));
+    scan->tables[scan->table_count++] = stmt;
+}
+
+typedef struct {
+    const char *from;
+    const char *to;
+} TableRename;
+
+void rename_table_use(Expression *expr, void *ctx) {
+    TableRename *rename = ctx;
+    char **name = NULL;
+    if (expr->type == EXPR_VARIABLE) name = &expr->var_name;
+    if (expr->type == EXPR_ARRAY_ACCESS) name = &expr->array_access.array_name;
+    if (expr->type == EXPR_SLICE) name = &expr->slice.array_name;
+    if (name && strcmp(*name, rename->from) == 0) {
+        free(*name);
+        *name = strdup(rename->to);
+    }
+}
+
+Statement *remove_table_declaration(Statement *stmt, void *ctx) {
+    return stmt == ctx ? make_block() : stmt;
+}
+
+// Move a local table to a module-level constant
+void hoist_local_table(Program *prog, Function *func, Statement *decl) {
+    Variable *var = &decl->var_decl.var;
+    char name[256];
+    snprintf(name, sizeof(name), "_%s_%s", func->name, var->name);
+    for (int i = 2; is_global_name(prog, name); i++) {
+        snprintf(name, sizeof(name), "_%s_%s%d", func->name, var->name, i);
+    }
+    add_global_table(prog, name, var->type, var->array_size);
+    Variable *table = &prog->global_vars[prog->global_var_count - 1];
+    table->is_initialized = 1;
+    table->elements = decl->var_decl.initializer;
+    table->is_constant = 1;
+
+    TableRename rename = { var->name, name };
+    visit_statement_expressions(func->body, rename_table_use, &rename);
+    func->body = transform_statements(func->body, remove_table_declaration, decl);
+}
+
+// Emit never-written brace-initialized arrays as module-level constants
+void freeze_constant_tables(Program *prog) {
+    for (int i = 0; i < prog->global_var_count; i++) {
+        Variable *var = &prog->global_vars[i];
+        if (var->is_array && var->elements && !global_may_be_written(prog, var->name)) {
+            var->is_constant = 1;
+        }
+    }
+    for (int i = 0; i < prog->function_count; i++) {
+        Function *func = prog->functions[i];
+        LocalTableScan scan = { prog, func, NULL, 0 };
+        visit_statements(func->body, find_local_table, &scan);
+        for (int j = 0; j < scan.table_count; j++) {
+            hoist_local_table(prog, func, scan.tables[j]);
+        }
+        free(scan.tables);
+    }
+}
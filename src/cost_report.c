@@ -0,0 +1,684 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Static cost report (--cost-report). Estimates how many interpreter
+// operations the emitted Python runs, from the optimized AST: roughly one per
+// load, store and operator, more for calls, attribute lookups and the integer
+// helpers. Loop bodies are multiplied by their trip count, which stays
+// symbolic when the bound is a variable:
+//     for (i = 0; i < n; i++) for (j = 0; j < m; j++) s += a[i] * b[j];
+//     ~ 9*m*n + 6*n + 2
+// Loops with no recognizable bound get a symbol of their own (N12 for the
+// loop on line 12). Functions (per call) and outermost loop nests are ranked
+// by the estimate, with every unknown trip count taken as DEFAULT_TRIP, and
+// listed with the constructs that lower badly to Python: while loops nested
+// in while loops, recursion without a cache or table, struct fields read
+// in a loop, and program functions called on every iteration.
+
+#define DEFAULT_TRIP 100
+#define MAX_SYMBOL 128
+#define CALL_COST 4        // Building the frame and binding the arguments
+#define HELPER_COST 10     // _c_div, _c_mod and the like
+#define ATTRIBUTE_COST 2   // LOAD_ATTR on a dataclass instance
+
+typedef struct {
+    double coef;
+    char **factors;   // Trip-count symbols multiplied together, sorted
+    int factor_count;
+} CostTerm;
+
+// A sum of terms such as 3*m*n + 2*n + 5
+typedef struct {
+    CostTerm *terms;
+    int count;
+} Cost;
+
+typedef struct {
+    int line;
+    char *message;
+} CostFlag;
+
+typedef struct {
+    Function *func;
+    int line;
+    int is_loop;      // An outermost loop nest rather than a whole function
+    Cost cost;
+    CostFlag *flags;
+    int flag_count;
+} CostItem;
+
+typedef struct {
+    Program *prog;
+    CostItem *items;
+    int item_count;
+    int *state;       // Per function: 0 = not costed, 1 = in progress, 2 = done
+    double *per_call; // Per function: estimated cost of one call
+    int unknown_trips; // Some loop got an N<line> symbol
+} CostReport;
+
+typedef struct {
+    CostReport *report;
+    Function *func;
+    int item;         // Index of the item flags are attached to
+    int line;         // Line of the statement being costed
+    int loop_depth;
+    int while_depth;
+} CostWalk;
+
+Cost cost_const(double value) {
+    Cost cost = { NULL, 0 };
+    if (value == 0) return cost;
+    cost.terms = malloc(sizeof(CostTerm));
+    cost.terms[0].coef = value;
+    cost.terms[0].factors = NULL;
+    cost.terms[0].factor_count = 0;
+    cost.count = 1;
+    return cost;
+}
+
+Cost cost_symbol(const char *symbol, double coef) {
+    Cost cost = cost_const(coef);
+    cost.terms[0].factors = malloc(sizeof(char*));
+    cost.terms[0].factors[0] = strdup(symbol);
+    cost.terms[0].factor_count = 1;
+    return cost;
+}
+
+void cost_free(Cost *cost) {
+    for (int i = 0; i < cost->count; i++) {
+        for (int j = 0; j < cost->terms[i].factor_count; j++) {
+            free(cost->terms[i].factors[j]);
+        }
+        free(cost->terms[i].factors);
+    }
+    free(cost->terms);
+    cost->terms = NULL;
+    cost->count = 0;
+}
+
+int same_factors(CostTerm *a, CostTerm *b) {
+    if (a->factor_count != b->factor_count) return 0;
+    for (int i = 0; i < a->factor_count; i++) {
+        if (strcmp(a->factors[i], b->factors[i]) != 0) return 0;
+    }
+    return 1;
+}
+
+// Add a term to a cost, merging it with a term over the same symbols; takes the factors
+void cost_add_term(Cost *cost, CostTerm term) {
+    for (int i = 0; i < cost->count; i++) {
+        if (same_factors(&cost->terms[i], &term)) {
+            cost->terms[i].coef += term.coef;
+            for (int j = 0; j < term.factor_count; j++) {
+                free(term.factors[j]);
+            }
+            free(term.factors);
+            return;
+        }
+    }
+    cost->terms = realloc(cost->terms, (cost->count + 1) * sizeof(CostTerm));
+    cost->terms[cost->count++] = term;
+}
+
+// cost += other; other is consumed
+void cost_add(Cost *cost, Cost other) {
+    for (int i = 0; i < other.count; i++) {
+        cost_add_term(cost, other.terms[i]);
+    }
+    free(other.terms);
+}
+
+int compare_factors(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// a * b; neither is consumed
+Cost cost_multiply(Cost *a, Cost *b) {
+    Cost product = { NULL, 0 };
+    for (int i = 0; i < a->count; i++) {
+        for (int j = 0; j < b->count; j++) {
+            CostTerm term;
+            term.coef = a->terms[i].coef * b->terms[j].coef;
+            term.factor_count = a->terms[i].factor_count + b->terms[j].factor_count;
+            term.factors = malloc((term.factor_count + 1) * sizeof(char*));
+            for (int k = 0; k < a->terms[i].factor_count; k++) {
+                term.factors[k] = strdup(a->terms[i].factors[k]);
+            }
+            for (int k = 0; k < b->terms[j].factor_count; k++) {
+                term.factors[a->terms[i].factor_count + k] = strdup(b->terms[j].factors[k]);
+            }
+            qsort(term.factors, term.factor_count, sizeof(char*), compare_factors);
+            cost_add_term(&product, term);
+        }
+    }
+    return product;
+}
+
+double cost_estimate(Cost *cost) {
+    double total = 0;
+    for (int i = 0; i < cost->count; i++) {
+        double term = cost->terms[i].coef;
+        for (int j = 0; j < cost->terms[i].factor_count; j++) {
+            term *= DEFAULT_TRIP;
+        }
+        total += term;
+    }
+    return total;
+}
+
+int compare_terms(const void *a, const void *b) {
+    const CostTerm *x = a;
+    const CostTerm *y = b;
+    if (x->factor_count != y->factor_count) return y->factor_count - x->factor_count;
+    for (int i = 0; i < x->factor_count; i++) {
+        int order = strcmp(x->factors[i], y->factors[i]);
+        if (order != 0) return order;
+    }
+    return 0;
+}
+
+// Highest degree first: 3*m*n + 2*n + 5
+void cost_format(Cost *cost, char *buffer, size_t size) {
+    qsort(cost->terms, cost->count, sizeof(CostTerm), compare_terms);
+    buffer[0] = '\0';
+    if (cost->count == 0) {
+        snprintf(buffer, size, "0");
+        return;
+    }
+    for (int i = 0; i < cost->count; i++) {
+        size_t used = strlen(buffer);
+        CostTerm *term = &cost->terms[i];
+        const char *separator = i > 0 ? " + " : "";
+        if (term->factor_count > 0 && term->coef == 1) {
+            snprintf(buffer + used, size - used, "%s", separator);
+        } else {
+            snprintf(buffer + used, size - used, "%s%g%s", separator, term->coef, term->factor_count > 0 ? "*" : "");
+        }
+        for (int j = 0; j < term->factor_count; j++) {
+            used = strlen(buffer);
+            snprintf(buffer + used, size - used, "%s%s", j > 0 ? "*" : "", term->factors[j]);
+        }
+    }
+}
+
+// A short C-like rendering of a loop bound for a trip-count symbol; 0 if it is not simple
+int format_bound(Expression *expr, char *buffer, size_t size) {
+    size_t used = strlen(buffer);
+    switch (expr->type) {
+        case EXPR_VARIABLE:
+            snprintf(buffer + used, size - used, "%s", expr->var_name);
+            return 1;
+        case EXPR_LITERAL:
+            if (expr->literal.lit_type != TYPE_INT) return 0;
+            snprintf(buffer + used, size - used, "%d", expr->literal.int_val);
+            return 1;
+        case EXPR_MEMBER_ACCESS:
+            if (!format_bound(expr->member_access.struct_expr, buffer, size)) return 0;
+            used = strlen(buffer);
+            snprintf(buffer + used, size - used, ".%s", expr->member_access.member_name);
+            return 1;
+        case EXPR_UNARY:
+            if (expr->unary.op != OP_WRAP_INT) return 0;
+            return format_bound(expr->unary.expr, buffer, size);
+        case EXPR_CALL:
+            if (expr->call.arg_count != 1) return 0;
+            snprintf(buffer + used, size - used, "%s(", expr->call.func_name);
+            if (!format_bound(expr->call.args[0], buffer, size)) return 0;
+            strncat(buffer, ")", size - strlen(buffer) - 1);
+            return 1;
+        case EXPR_BINARY: {
+            const char *op;
+            switch (expr->binary.op) {
+                case OP_ADD: op = " + "; break;
+                case OP_SUB: op = " - "; break;
+                case OP_MUL: op = " * "; break;
+                case OP_DIV: case OP_FLOOR_DIV: case OP_TRUNC_DIV: op = " / "; break;
+                default: return 0;
+            }
+            strncat(buffer, "(", size - strlen(buffer) - 1);
+            if (!format_bound(expr->binary.left, buffer, size)) return 0;
+            strncat(buffer, op, size - strlen(buffer) - 1);
+            if (!format_bound(expr->binary.right, buffer, size)) return 0;
+            strncat(buffer, ")", size - strlen(buffer) - 1);
+            return 1;
+        }
+        default:
+            return 0;
+    }
+}
+
+// A trip-count symbol of its own for a loop with an unknown bound
+Cost unknown_trip(CostWalk *walk) {
+    char symbol[MAX_SYMBOL];
+    snprintf(symbol, sizeof(symbol), "N%d", walk->line);
+    walk->report->unknown_trips = 1;
+    return cost_symbol(symbol, 1);
+}
+
+// Trip count of start..stop by step: a number, or (stop - start) / step kept symbolic
+Cost trip_count(CostWalk *walk, Expression *start, Expression *stop, long long step, int inclusive) {
+    long long lo, hi;
+    if (step == 0) return unknown_trip(walk);
+    if (step < 0) {
+        Expression *swap = start;
+        start = stop;
+        stop = swap;
+        step = -step;
+    }
+    if (int_literal(start, &lo) && int_literal(stop, &hi)) {
+        long long span = hi - lo + (inclusive ? 1 : 0);
+        return cost_const(span > 0 ? (double)((span + step - 1) / step) : 0);
+    }
+    char symbol[MAX_SYMBOL] = "";
+    long long zero;
+    int ok;
+    if (int_literal(start, &zero) && zero == 0) {
+        ok = format_bound(stop, symbol, sizeof(symbol));
+    } else {
+        strncat(symbol, "(", sizeof(symbol) - 1);
+        ok = format_bound(stop, symbol, sizeof(symbol));
+        strncat(symbol, " - ", sizeof(symbol) - strlen(symbol) - 1);
+        ok = ok && format_bound(start, symbol, sizeof(symbol));
+        strncat(symbol, ")", sizeof(symbol) - strlen(symbol) - 1);
+    }
+    if (!ok) return unknown_trip(walk);
+    Cost trips = cost_symbol(symbol, 1.0 / step);
+    if (inclusive) cost_add(&trips, cost_const(1));
+    return trips;
+}
+
+// Iterations of a for-in loop or generator over an iterable
+Cost iterable_trips(CostWalk *walk, Expression *iterable) {
+    if (iterable->type == EXPR_CALL && strcmp(iterable->call.func_name, "range") == 0) {
+        Expression **args = iterable->call.args;
+        long long step = 1;
+        switch (iterable->call.arg_count) {
+            case 1: {
+                Expression *zero = make_int_literal(0);
+                Cost trips = trip_count(walk, zero, args[0], 1, 0);
+                free(zero);
+                return trips;
+            }
+            case 2: return trip_count(walk, args[0], args[1], 1, 0);
+            case 3:
+                if (!int_literal(args[2], &step)) {
+                    if (args[2]->type == EXPR_UNARY && args[2]->unary.op == OP_NEGATE && int_literal(args[2]->unary.expr, &step)) {
+                        step = -step;
+                    } else {
+                        return unknown_trip(walk);
+                    }
+                }
+                return trip_count(walk, args[0], args[1], step, 0);
+            default: return unknown_trip(walk);
+        }
+    }
+    if (iterable->type == EXPR_SLICE) {
+        Expression *start = iterable->slice.start ? iterable->slice.start : make_int_literal(0);
+        Expression *stop = iterable->slice.stop;
+        int size = array_size_of(walk->report->prog, walk->func, iterable->slice.array_name);
+        if (!stop && size >= 0) stop = make_int_literal(size);
+        Cost trips = stop ? trip_count(walk, start, stop, 1, 0) : unknown_trip(walk);
+        if (!iterable->slice.start) free(start);
+        if (!iterable->slice.stop && stop) free(stop);
+        return trips;
+    }
+    if (iterable->type == EXPR_VARIABLE) {
+        int size = array_size_of(walk->report->prog, walk->func, iterable->var_name);
+        if (size >= 0) return cost_const(size);
+        char symbol[MAX_SYMBOL];
+        snprintf(symbol, sizeof(symbol), "len(%s)", iterable->var_name);
+        return cost_symbol(symbol, 1);
+    }
+    return unknown_trip(walk);
+}
+
+void add_flag(CostWalk *walk, const char *message) {
+    CostItem *item = &walk->report->items[walk->item];
+    for (int i = 0; i < item->flag_count; i++) {
+        if (item->flags[i].line == walk->line && strcmp(item->flags[i].message, message) == 0) return;
+    }
+    item->flags = realloc(item->flags, (item->flag_count + 1) * sizeof(CostFlag));
+    item->flags[item->flag_count].line = walk->line;
+    item->flags[item->flag_count].message = strdup(message);
+    item->flag_count++;
+}
+
+int add_item(CostReport *report, Function *func, int line, int is_loop) {
+    report->items = realloc(report->items, (report->item_count + 1) * sizeof(CostItem));
+    CostItem *item = &report->items[report->item_count];
+    item->func = func;
+    item->line = line;
+    item->is_loop = is_loop;
+    item->cost.terms = NULL;
+    item->cost.count = 0;
+    item->flags = NULL;
+    item->flag_count = 0;
+    return report->item_count++;
+}
+
+double function_cost(CostReport *report, Function *func);
+Cost expression_cost(CostWalk *walk, Expression *expr);
+
+// The variable a member access chain such as pts[i].pos.x is rooted in, or the array element
+Expression *member_root(Expression *expr) {
+    while (expr->type == EXPR_MEMBER_ACCESS) expr = expr->member_access.struct_expr;
+    return expr;
+}
+
+Cost generator_cost(CostWalk *walk, Expression *expr) {
+    Cost cost = expression_cost(walk, expr->generator.iterable);
+    Cost trips = iterable_trips(walk, expr->generator.iterable);
+    walk->loop_depth++;
+    Cost each = expression_cost(walk, expr->generator.element);
+    if (expr->generator.condition) cost_add(&each, expression_cost(walk, expr->generator.condition));
+    walk->loop_depth--;
+    cost_add(&each, cost_const(2));  // FOR_ITER and the store to the loop variable
+    cost_add(&cost, cost_multiply(&trips, &each));
+    cost_free(&trips);
+    cost_free(&each);
+    return cost;
+}
+
+Cost call_cost(CostWalk *walk, Expression *expr) {
+    Cost cost = cost_const(CALL_COST);
+    for (int i = 0; i < expr->call.arg_count; i++) {
+        cost_add(&cost, expression_cost(walk, expr->call.args[i]));
+    }
+    Function *callee = find_function(walk->report->prog, expr->call.func_name);
+    // Math helpers such as _c_sqrt check the domain in Python before calling math
+    if (!callee && strncmp(expr->call.func_name, "_c_", 3) == 0) cost_add(&cost, cost_const(HELPER_COST));
+    if (!callee) return cost;
+    if (walk->loop_depth > 0) {
+        char message[MAX_SYMBOL * 2];
+        snprintf(message, sizeof(message), "calls %s() on every iteration: a Python frame per call", callee->name);
+        add_flag(walk, message);
+    }
+    // A callee's own trip symbols mean nothing here, so its cost counts as a number
+    cost_add(&cost, cost_const(function_cost(walk->report, callee)));
+    return cost;
+}
+
+Cost expression_cost(CostWalk *walk, Expression *expr) {
+    if (!expr) return cost_const(0);
+    Cost cost = cost_const(0);
+    switch (expr->type) {
+        case EXPR_VARIABLE:
+            // Globals are a dict lookup rather than a frame slot
+            cost_add(&cost, cost_const(is_local_name(walk->func, expr->var_name) ? 1 : 2));
+            break;
+        case EXPR_LITERAL:
+            cost_add(&cost, cost_const(1));
+            break;
+        case EXPR_BINARY:
+            cost_add(&cost, expression_cost(walk, expr->binary.left));
+            cost_add(&cost, expression_cost(walk, expr->binary.right));
+            if (expr->binary.op == OP_TRUNC_DIV || expr->binary.op == OP_TRUNC_MOD) {
+                cost_add(&cost, cost_const(CALL_COST + HELPER_COST));
+            } else {
+                cost_add(&cost, cost_const(1));
+            }
+            break;
+        case EXPR_UNARY:
+            cost_add(&cost, expression_cost(walk, expr->unary.expr));
+            // The wraparound is an add, a mask and a subtract with their constants
+            cost_add(&cost, cost_const(expr->unary.op == OP_WRAP_INT ? 6 : 1));
+            break;
+        case EXPR_CALL:
+            cost_add(&cost, call_cost(walk, expr));
+            break;
+        case EXPR_ARRAY_ACCESS:
+            cost_add(&cost, expression_cost(walk, expr->array_access.index));
+            cost_add(&cost, cost_const(2));
+            break;
+        case EXPR_MEMBER_ACCESS:
+            if (walk->loop_depth > 0) {
+                add_flag(walk, member_root(expr)->type == EXPR_ARRAY_ACCESS
+                    ? "struct field of an array element: an index and an attribute lookup per iteration"
+                    : "struct field in a loop: an attribute lookup per iteration");
+            }
+            cost_add(&cost, expression_cost(walk, expr->member_access.struct_expr));
+            cost_add(&cost, cost_const(ATTRIBUTE_COST));
+            break;
+        case EXPR_SLICE:
+            cost_add(&cost, expression_cost(walk, expr->slice.start));
+            cost_add(&cost, expression_cost(walk, expr->slice.stop));
+            cost_add(&cost, cost_const(3));
+            break;
+        case EXPR_GENERATOR:
+            cost_add(&cost, generator_cost(walk, expr));
+            break;
+        case EXPR_LIST:
+            for (int i = 0; i < expr->list.count; i++) {
+                cost_add(&cost, expression_cost(walk, expr->list.elements[i]));
+            }
+            cost_add(&cost, cost_const(1));
+            break;
+        default:
+            break;
+    }
+    return cost;
+}
+
+Cost statement_cost(CostWalk *walk, Statement *stmt);
+
+// trips * each + once; an outermost loop also records it on its item
+Cost loop_cost(CostWalk *walk, Cost once, Cost trips, Cost each, int item) {
+    Cost cost = cost_multiply(&trips, &each);
+    cost_add(&cost, once);
+    cost_free(&trips);
+    cost_free(&each);
+    if (item >= 0) {
+        Cost one = cost_const(1);
+        walk->report->items[item].cost = cost_multiply(&cost, &one);
+        cost_free(&one);
+    }
+    return cost;
+}
+
+// Cost of the C-style for (i = a; i < b; i += k) bound, or an unknown symbol
+Cost for_trips(CostWalk *walk, Statement *stmt) {
+    Expression *cond = stmt->for_stmt.condition;
+    Expression *inc = stmt->for_stmt.increment;
+    Statement *init = stmt->for_stmt.initializer;
+    if (!cond || cond->type != EXPR_BINARY || cond->binary.left->type != EXPR_VARIABLE || !inc || !init) {
+        return unknown_trip(walk);
+    }
+    const char *var = cond->binary.left->var_name;
+    Expression *start = NULL;
+    if (init->type == STMT_VAR_DECL && strcmp(init->var_decl.var.name, var) == 0) {
+        start = init->var_decl.initializer;
+    } else if (init->type == STMT_EXPR && init->expr->type == EXPR_BINARY && init->expr->binary.op == OP_ASSIGN &&
+               init->expr->binary.left->type == EXPR_VARIABLE && strcmp(init->expr->binary.left->var_name, var) == 0) {
+        start = init->expr->binary.right;
+    }
+    // The integer lowering may have wrapped i + k to 32 bits
+    Expression unwrapped = *inc;
+    if (inc->type == EXPR_BINARY && inc->binary.op == OP_ASSIGN && inc->binary.right->type == EXPR_UNARY &&
+        inc->binary.right->unary.op == OP_WRAP_INT) {
+        unwrapped.binary.right = inc->binary.right->unary.expr;
+    }
+    int step = 0;
+    if (!match_increment(&unwrapped, var, &step)) step = 0;
+    if (!start || step == 0) return unknown_trip(walk);
+    switch (cond->binary.op) {
+        case OP_LT: case OP_LTE:
+            if (step < 0) return unknown_trip(walk);
+            return trip_count(walk, start, cond->binary.right, step, cond->binary.op == OP_LTE);
+        case OP_GT: case OP_GTE:
+            if (step > 0) return unknown_trip(walk);
+            return trip_count(walk, cond->binary.right, start, -step, cond->binary.op == OP_GTE);
+        default:
+            return unknown_trip(walk);
+    }
+}
+
+Cost statement_cost(CostWalk *walk, Statement *stmt) {
+    if (!stmt) return cost_const(0);
+    int outer_line = walk->line;
+    if (stmt->line > 0) walk->line = stmt->line;
+    Cost cost = cost_const(0);
+    int is_loop = stmt->type == STMT_WHILE || stmt->type == STMT_FOR || stmt->type == STMT_FOR_IN;
+    int outer_item = walk->item;
+    int item = -1;
+    if (is_loop && walk->loop_depth == 0) {
+        item = add_item(walk->report, walk->func, walk->line, 1);
+        walk->item = item;
+    }
+
+    switch (stmt->type) {
+        case STMT_EXPR:
+            cost_add(&cost, expression_cost(walk, stmt->expr));
+            break;
+        case STMT_VAR_DECL:
+            cost_add(&cost, expression_cost(walk, stmt->var_decl.initializer));
+            cost_add(&cost, cost_const(stmt->var_decl.var.is_array ? 3 : 1));
+            break;
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                cost_add(&cost, statement_cost(walk, stmt->block.statements[i]));
+            }
+            break;
+        case STMT_IF: {
+            // Charge the dearer branch
+            cost_add(&cost, expression_cost(walk, stmt->if_stmt.condition));
+            Cost then_cost = statement_cost(walk, stmt->if_stmt.then_branch);
+            Cost else_cost = statement_cost(walk, stmt->if_stmt.else_branch);
+            if (cost_estimate(&then_cost) >= cost_estimate(&else_cost)) {
+                cost_add(&cost, then_cost);
+                cost_free(&else_cost);
+            } else {
+                cost_add(&cost, else_cost);
+                cost_free(&then_cost);
+            }
+            cost_add(&cost, cost_const(1));
+            break;
+        }
+        case STMT_WHILE: {
+            if (walk->while_depth > 0) {
+                add_flag(walk, "while loop nested in a while loop: neither runs as range(), so every test and counter update is bytecode");
+            }
+            Cost trips = unknown_trip(walk);
+            walk->loop_depth++;
+            walk->while_depth++;
+            Cost each = expression_cost(walk, stmt->while_stmt.condition);
+            cost_add(&each, statement_cost(walk, stmt->while_stmt.body));
+            walk->while_depth--;
+            walk->loop_depth--;
+            cost = loop_cost(walk, expression_cost(walk, stmt->while_stmt.condition), trips, each, item);
+            break;
+        }
+        case STMT_FOR: {
+            Cost once = statement_cost(walk, stmt->for_stmt.initializer);
+            cost_add(&once, expression_cost(walk, stmt->for_stmt.condition));
+            Cost trips = for_trips(walk, stmt);
+            walk->loop_depth++;
+            Cost each = expression_cost(walk, stmt->for_stmt.condition);
+            cost_add(&each, expression_cost(walk, stmt->for_stmt.increment));
+            cost_add(&each, statement_cost(walk, stmt->for_stmt.body));
+            walk->loop_depth--;
+            cost = loop_cost(walk, once, trips, each, item);
+            break;
+        }
+        case STMT_FOR_IN: {
+            Cost once = expression_cost(walk, stmt->for_in.iterable);
+            cost_add(&once, statement_cost(walk, stmt->for_in.else_branch));
+            Cost trips = iterable_trips(walk, stmt->for_in.iterable);
+            walk->loop_depth++;
+            Cost each = cost_const(2);  // FOR_ITER and the store to the loop variable
+            cost_add(&each, statement_cost(walk, stmt->for_in.body));
+            walk->loop_depth--;
+            cost = loop_cost(walk, once, trips, each, item);
+            break;
+        }
+        case STMT_RETURN:
+            cost_add(&cost, expression_cost(walk, stmt->return_value));
+            cost_add(&cost, cost_const(1));
+            break;
+        case STMT_PRINT:
+            for (int i = 0; i < stmt->print.arg_count; i++) {
+                cost_add(&cost, expression_cost(walk, stmt->print.args[i]));
+            }
+            cost_add(&cost, cost_const(CALL_COST + HELPER_COST));  // Formatting and the print call
+            break;
+        default:
+            cost_add(&cost, cost_const(1));
+            break;
+    }
+
+    walk->item = outer_item;
+    walk->line = outer_line;
+    return cost;
+}
+
+// Estimated cost of one call, costing the function (and its items) on first use
+double function_cost(CostReport *report, Function *func) {
+    int index = 0;
+    while (report->prog->functions[index] != func) index++;
+    if (report->state[index] == 1) return 0;  // Recursion; flagged on the function itself
+    if (report->state[index] == 2) return report->per_call[index];
+    report->state[index] = 1;
+
+    int item = add_item(report, func, func->line, 0);
+    CostWalk walk = { report, func, item, func->line, 0, 0 };
+    if (function_reaches(report->prog, func, func) && !func->memoize) {
+        add_flag(&walk, "recursive without a cache or table: a Python frame per call, and recursion depth is limited");
+    }
+    Cost cost = statement_cost(&walk, func->body);
+    cost_add(&cost, cost_const(CALL_COST));
+    report->items[item].cost = cost;
+    report->per_call[index] = cost_estimate(&cost);
+    report->state[index] = 2;
+    return report->per_call[index];
+}
+
+int compare_items(const void *a, const void *b) {
+    double x = cost_estimate(&((CostItem *)a)->cost);
+    double y = cost_estimate(&((CostItem *)b)->cost);
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+void format_location(Function *func, int line, char *buffer, size_t size) {
+    const char *file = func->source_file ? func->source_file : "line";
+    if (line > 0) {
+        snprintf(buffer, size, "%s:%d", file, line);
+    } else {
+        snprintf(buffer, size, "%s:?", file);
+    }
+}
+
+// Print the estimated cost of every function and outermost loop nest, dearest first
+void report_costs(Program *prog, FILE *out) {
+    CostReport report = { prog, NULL, 0, calloc(prog->function_count + 1, sizeof(int)),
+                          calloc(prog->function_count + 1, sizeof(double)), 0 };
+    for (int i = 0; i < prog->function_count; i++) {
+        if (prog->functions[i]->body) function_cost(&report, prog->functions[i]);
+    }
+    qsort(report.items, report.item_count, sizeof(CostItem), compare_items);
+
+    fprintf(out, "Cost report (estimated Python interpreter operations, unknown trip counts taken as %d):\n", DEFAULT_TRIP);
+    for (int i = 0; i < report.item_count; i++) {
+        CostItem *item = &report.items[i];
+        char location[MAX_SYMBOL * 2];
+        char formula[1024];
+        format_location(item->func, item->line, location, sizeof(location));
+        cost_format(&item->cost, formula, sizeof(formula));
+        char what[MAX_SYMBOL * 2];
+        snprintf(what, sizeof(what), item->is_loop ? "loop nest in %s" : "%s() per call", item->func->name);
+        fprintf(out, "%3d. %-30s %-28s ~ %s  (%.0f)\n", i + 1, location, what, formula, cost_estimate(&item->cost));
+        for (int j = 0; j < item->flag_count; j++) {
+            format_location(item->func, item->flags[j].line, location, sizeof(location));
+            fprintf(out, "       %s  %s\n", location, item->flags[j].message);
+            free(item->flags[j].message);
+        }
+        free(item->flags);
+        cost_free(&item->cost);
+    }
+    if (report.unknown_trips) {
+        fprintf(out, "N<line> is the unknown number of iterations of the loop on that line.\n");
+    }
+    free(report.items);
+    free(report.state);
+    free(report.per_call);
+}
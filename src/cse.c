@@ -0,0 +1,350 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Common subexpression elimination. Statements are numbered in execution
+// order while a table of available pure expressions is kept. When an
+// expression is found again while its first evaluation is still valid, the
+// first evaluation is stored in a _cseN temporary and both places read it:
+//     y = a[i + 1] * 2; z = a[i + 1] - 1
+// becomes
+//     _cse0 = a[i + 1]; y = _cse0 * 2; z = _cse0 - 1
+// Expressions stay available inside nested blocks, if branches and loops the
+// first evaluation dominates, and are dropped once a statement may change
+// one of their operands. Expressions first seen inside a branch or loop body
+// are forgotten when leaving it, and only expressions that are always
+// evaluated by their statement (not behind && or ||) can become temporaries.
+
+#define CSE_TEMP_PREFIX "_cse"
+
+typedef struct {
+    Expression *expr;   // First evaluation (moved into the temporary once materialized)
+    Expression **slot;  // Where the first evaluation sits in the tree
+    Statement *block;   // Block holding the statement that evaluates it
+    Statement *stmt;    // That statement
+    char *temp;         // Temporary name, NULL until a second occurrence is found
+} AvailableExpr;
+
+typedef struct {
+    Program *prog;
+    Function *func;
+    AvailableExpr *entries;
+    int count;
+    int capacity;
+    int temp_count;
+} CseContext;
+
+// Operations worth a temporary; unary operators cost about as much as a load
+int is_cse_candidate(Expression *expr) {
+    switch (expr->type) {
+        case EXPR_BINARY:
+            return expr->binary.op != OP_ASSIGN;
+        case EXPR_CALL:
+        case EXPR_MEMBER_ACCESS:
+        case EXPR_ARRAY_ACCESS:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+AvailableExpr *find_available(CseContext *ctx, Expression *expr) {
+    for (int i = 0; i < ctx->count; i++) {
+        if (expressions_equal(ctx->entries[i].expr, expr)) return &ctx->entries[i];
+    }
+    return NULL;
+}
+
+void add_available(CseContext *ctx, Expression **slot, Statement *block, Statement *stmt) {
+    if (ctx->count >= ctx->capacity) {
+        ctx->capacity = ctx->capacity ? ctx->capacity * 2 : 16;
+        ctx->entries = realloc(ctx->entries, ctx->capacity * sizeof(AvailableExpr));
+    }
+    AvailableExpr entry = { *slot, slot, block, stmt, NULL };
+    ctx->entries[ctx->count++] = entry;
+}
+
+// Insert a statement right before another one in a block
+void insert_before(Statement *block, Statement *anchor, Statement *stmt) {
+    block_append(block, stmt);
+    int index = block->block.stmt_count - 1;
+    while (index > 0 && block->block.statements[index - 1] != anchor) {
+        block->block.statements[index] = block->block.statements[index - 1];
+        index--;
+    }
+    if (index > 0) {
+        block->block.statements[index] = block->block.statements[index - 1];
+        index--;
+    }
+    block->block.statements[index] = stmt;
+}
+
+typedef struct {
+    CseContext *ctx;
+    Statement *decl;
+} NestedEntryScan;
+
+// Entries first seen inside a materialized expression are now evaluated by its declaration
+void retarget_nested_entry(Expression *expr, void *data) {
+    NestedEntryScan *scan = data;
+    for (int i = 0; i < scan->ctx->count; i++) {
+        if (scan->ctx->entries[i].expr == expr && !scan->ctx->entries[i].temp) {
+            scan->ctx->entries[i].stmt = scan->decl;
+        }
+    }
+}
+
+// Move the first evaluation into a temporary declared before its statement
+void materialize(CseContext *ctx, AvailableExpr *entry) {
+    char name[64];
+    snprintf(name, sizeof(name), CSE_TEMP_PREFIX "%d", ctx->temp_count++);
+
+    Statement *decl = create_statement();
+    decl->type = STMT_VAR_DECL;
+    decl->var_decl.var.name = strdup(name);
+    decl->var_decl.var.type = expression_type(ctx->prog, ctx->func, entry->expr);
+    decl->var_decl.var.is_initialized = 1;
+    decl->var_decl.initializer = entry->expr;
+    insert_before(entry->block, entry->stmt, decl);
+
+    *entry->slot = make_variable(name);
+    entry->slot = &decl->var_decl.initializer;
+    entry->temp = decl->var_decl.var.name;
+
+    NestedEntryScan scan = { ctx, decl };
+    visit_expression(entry->expr, retarget_nested_entry, &scan);
+}
+
+// Replace available expressions; record new ones when record is set
+void number_expression(CseContext *ctx, Expression **slot, Statement *block, Statement *stmt, int record) {
+    Expression *expr = *slot;
+    if (!expr || expr->type == EXPR_GENERATOR || expr->type == EXPR_ASM) return;
+
+    if (is_cse_candidate(expr)) {
+        AvailableExpr *entry = find_available(ctx, expr);
+        if (entry) {
+            if (!entry->temp) materialize(ctx, entry);
+            *slot = make_variable(entry->temp);
+            return;
+        }
+    }
+
+    switch (expr->type) {
+        case EXPR_BINARY: {
+            number_expression(ctx, &expr->binary.left, block, stmt, record);
+            // The right operand of && and || may not run at all
+            int short_circuit = expr->binary.op == OP_AND || expr->binary.op == OP_OR;
+            number_expression(ctx, &expr->binary.right, block, stmt, record && !short_circuit);
+            break;
+        }
+        case EXPR_UNARY:
+            number_expression(ctx, &expr->unary.expr, block, stmt, record);
+            break;
+        case EXPR_CALL:
+            for (int i = 0; i < expr->call.arg_count; i++) {
+                number_expression(ctx, &expr->call.args[i], block, stmt, record);
+            }
+            break;
+        case EXPR_ARRAY_ACCESS:
+            number_expression(ctx, &expr->array_access.index, block, stmt, record);
+            break;
+        case EXPR_MEMBER_ACCESS:
+            number_expression(ctx, &expr->member_access.struct_expr, block, stmt, record);
+            break;
+        case EXPR_SLICE:
+            number_expression(ctx, &expr->slice.start, block, stmt, record);
+            number_expression(ctx, &expr->slice.stop, block, stmt, record);
+            break;
+        default:
+            break;
+    }
+
+    // Operands may now read temporaries, matching an earlier evaluation that was rewritten the same way
+    if (is_cse_candidate(expr)) {
+        AvailableExpr *entry = find_available(ctx, expr);
+        if (entry) {
+            if (!entry->temp) materialize(ctx, entry);
+            *slot = make_variable(entry->temp);
+            return;
+        }
+    }
+
+    if (record && is_cse_candidate(*slot) && !expression_has_side_effects(ctx->prog, *slot) &&
+        expression_type(ctx->prog, ctx->func, *slot) != TYPE_VOID) {
+        add_available(ctx, slot, block, stmt);
+    }
+}
+
+typedef struct {
+    Statement *stmt;
+    int writes_elements;
+    int writes_members;
+    int killed;
+} KillScan;
+
+void check_operand_written(Expression *expr, void *data) {
+    KillScan *scan = data;
+    const char *name = NULL;
+    switch (expr->type) {
+        case EXPR_VARIABLE:
+            name = expr->var_name;
+            break;
+        case EXPR_ARRAY_ACCESS:
+        case EXPR_SLICE:
+            // Array parameters may alias, so any element write counts
+            if (scan->writes_elements) scan->killed = 1;
+            name = expr->type == EXPR_SLICE ? expr->slice.array_name : expr->array_access.array_name;
+            break;
+        case EXPR_MEMBER_ACCESS:
+            // Python struct assignment shares the instance, so any member write counts
+            if (scan->writes_members) scan->killed = 1;
+            break;
+        default:
+            break;
+    }
+    if (name && statement_writes_variable(scan->stmt, name)) scan->killed = 1;
+}
+
+void find_target_kinds(Expression *expr, void *data) {
+    KillScan *scan = data;
+    Expression *target = written_target(expr);
+    if (!target) return;
+    if (target->type == EXPR_ARRAY_ACCESS) scan->writes_elements = 1;
+    if (target->type == EXPR_MEMBER_ACCESS) scan->writes_members = 1;
+}
+
+// Forget every available expression that stmt may change
+void kill_written(CseContext *ctx, Statement *stmt) {
+    if (statement_has_impure_calls(ctx->prog, stmt)) {
+        ctx->count = 0;
+        return;
+    }
+
+    KillScan kinds = { stmt, 0, 0, 0 };
+    visit_statement_expressions(stmt, find_target_kinds, &kinds);
+
+    int kept = 0;
+    for (int i = 0; i < ctx->count; i++) {
+        KillScan scan = { stmt, kinds.writes_elements, kinds.writes_members, 0 };
+        visit_expression(ctx->entries[i].expr, check_operand_written, &scan);
+        if (!scan.killed) ctx->entries[kept++] = ctx->entries[i];
+    }
+    ctx->count = kept;
+}
+
+void number_block(CseContext *ctx, Statement *block);
+
+// Number a branch or loop body; what it makes available does not outlive it
+void number_region(CseContext *ctx, Statement **slot) {
+    if (!*slot) return;
+    if ((*slot)->type != STMT_BLOCK) {
+        Statement *block = make_block();
+        block_append(block, *slot);
+        *slot = block;
+    }
+    int mark = ctx->count;
+    number_block(ctx, *slot);
+    ctx->count = mark;
+}
+
+void number_statement(CseContext *ctx, Statement *block, Statement *stmt) {
+    switch (stmt->type) {
+        case STMT_EXPR: {
+            Expression *expr = stmt->expr;
+            Expression **value = &stmt->expr;
+            if (expr->type == EXPR_BINARY && expr->binary.op == OP_ASSIGN) {
+                value = &expr->binary.right;
+                if (expr->binary.left->type == EXPR_ARRAY_ACCESS &&
+                    !expression_has_side_effects(ctx->prog, expr->binary.left->array_access.index)) {
+                    number_expression(ctx, &expr->binary.left->array_access.index, block, stmt, 1);
+                }
+            } else if (written_target(expr)) {
+                value = NULL;
+            }
+            if (value && !expression_has_side_effects(ctx->prog, *value)) {
+                number_expression(ctx, value, block, stmt, 1);
+            }
+            kill_written(ctx, stmt);
+            break;
+        }
+        case STMT_VAR_DECL:
+            if (stmt->var_decl.initializer && !expression_has_side_effects(ctx->prog, stmt->var_decl.initializer)) {
+                number_expression(ctx, &stmt->var_decl.initializer, block, stmt, 1);
+            }
+            kill_written(ctx, stmt);
+            break;
+        case STMT_BLOCK:
+            number_block(ctx, stmt);
+            break;
+        case STMT_IF:
+            if (!expression_has_side_effects(ctx->prog, stmt->if_stmt.condition)) {
+                number_expression(ctx, &stmt->if_stmt.condition, block, stmt, 1);
+            }
+            number_region(ctx, &stmt->if_stmt.then_branch);
+            number_region(ctx, &stmt->if_stmt.else_branch);
+            kill_written(ctx, stmt);
+            break;
+        case STMT_WHILE:
+            // Later iterations see the loop's own writes, so apply them first
+            kill_written(ctx, stmt);
+            if (!expression_has_side_effects(ctx->prog, stmt->while_stmt.condition)) {
+                number_expression(ctx, &stmt->while_stmt.condition, block, stmt, 0);
+            }
+            number_region(ctx, &stmt->while_stmt.body);
+            break;
+        case STMT_FOR:
+            kill_written(ctx, stmt);
+            if (!expression_has_side_effects(ctx->prog, stmt->for_stmt.condition)) {
+                number_expression(ctx, &stmt->for_stmt.condition, block, stmt, 0);
+            }
+            number_region(ctx, &stmt->for_stmt.body);
+            break;
+        case STMT_FOR_IN:
+            // The iterable is evaluated once, before the loop
+            if (!expression_has_side_effects(ctx->prog, stmt->for_in.iterable)) {
+                number_expression(ctx, &stmt->for_in.iterable, block, stmt, 1);
+            }
+            kill_written(ctx, stmt);
+            number_region(ctx, &stmt->for_in.body);
+            number_region(ctx, &stmt->for_in.else_branch);
+            break;
+        case STMT_RETURN:
+            if (!expression_has_side_effects(ctx->prog, stmt->return_value)) {
+                number_expression(ctx, &stmt->return_value, block, stmt, 1);
+            }
+            break;
+        case STMT_PRINT: {
+            int pure = 1;
+            for (int i = 0; i < stmt->print.arg_count; i++) {
+                if (expression_has_side_effects(ctx->prog, stmt->print.args[i])) pure = 0;
+            }
+            for (int i = 0; pure && i < stmt->print.arg_count; i++) {
+                number_expression(ctx, &stmt->print.args[i], block, stmt, 1);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void number_block(CseContext *ctx, Statement *block) {
+    for (int i = 0; i < block->block.stmt_count; i++) {
+        Statement *stmt = block->block.statements[i];
+        number_statement(ctx, block, stmt);
+        // Temporaries may have been inserted before stmt
+        while (block->block.statements[i] != stmt) i++;
+    }
+}
+
+// Eliminate common subexpressions in every function
+void eliminate_common_subexpressions(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        CseContext ctx = { prog, prog->functions[i], NULL, 0, 0, 0 };
+        if (prog->functions[i]->body && prog->functions[i]->body->type == STMT_BLOCK) {
+            number_block(&ctx, prog->functions[i]->body);
+        }
+        free(ctx.entries);
+    }
+}
@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Global and builtin lookups. Python looks up a name that is not local to the
+// function in the module dict (and builtins after that) on every use, while a
+// local is a slot in the frame. For the names a function uses in its loops and
+// comprehensions:
+//  - globals that nothing rebinds (arrays, and scalars no function assigns)
+//    and builtins such as len, range or print become default arguments, which
+//    are evaluated once when the def runs:
+//        def total(n: int, table=table, limit=limit, print=print) -> int:
+//    Dotted builtins get an alias: _math_sin=math.sin.
+//  - a scalar global the function only reads, when nothing it calls writes
+//    it, is copied into a local at entry: _counter = counter
+//  - a scalar global the function writes, when nothing it calls reads or
+//    writes it, lives in that local and is stored back before each return and
+//    at the end of the body.
+// Functions and loops that a --profile-use run never reached are left alone.
+// This runs after the integer lowering, so it sees the final expressions.
+
+typedef struct {
+    char **names;
+    int count;
+} NameSet;
+
+typedef struct {
+    NameSet variables;  // Variables and arrays used in loops and comprehensions
+    NameSet calls;      // Functions called there
+    int prints;         // A loop prints
+} HotNames;
+
+void name_set_add(NameSet *set, const char *name) {
+    for (int i = 0; i < set->count; i++) {
+        if (strcmp(set->names[i], name) == 0) return;
+    }
+    set->names = realloc(set->names, (set->count + 1) * sizeof(char*));
+    set->names[set->count++] = strdup(name);
+}
+
+int name_set_has(NameSet *set, const char *name) {
+    for (int i = 0; i < set->count; i++) {
+        if (strcmp(set->names[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+void name_set_free(NameSet *set) {
+    for (int i = 0; i < set->count; i++) {
+        free(set->names[i]);
+    }
+    free(set->names);
+}
+
+void collect_hot_name(Expression *expr, void *ctx) {
+    HotNames *hot = ctx;
+    switch (expr->type) {
+        case EXPR_VARIABLE: name_set_add(&hot->variables, expr->var_name); break;
+        case EXPR_ARRAY_ACCESS: name_set_add(&hot->variables, expr->array_access.array_name); break;
+        case EXPR_SLICE: name_set_add(&hot->variables, expr->slice.array_name); break;
+        case EXPR_CALL: name_set_add(&hot->calls, expr->call.func_name); break;
+        default: break;
+    }
+}
+
+void collect_loop_names(Statement *stmt, void *ctx) {
+    HotNames *hot = ctx;
+    if (loop_is_cold(stmt)) return;
+    if (stmt->type == STMT_FOR_IN) {
+        // The iterable is evaluated once
+        visit_statement_expressions(stmt->for_in.body, collect_hot_name, hot);
+    } else if (stmt->type == STMT_WHILE || stmt->type == STMT_FOR) {
+        visit_statement_expressions(stmt, collect_hot_name, hot);
+    } else {
+        return;
+    }
+    if (statement_has_print(stmt)) hot->prints = 1;
+}
+
+void collect_comprehension_names(Expression *expr, void *ctx) {
+    if (expr->type == EXPR_GENERATOR) visit_expression(expr, collect_hot_name, ctx);
+}
+
+typedef struct {
+    const char *name;
+    int found;
+} RebindScan;
+
+void find_rebind(Expression *expr, void *ctx) {
+    RebindScan *scan = ctx;
+    Expression *target = written_target(expr);
+    if (target && target->type == EXPR_VARIABLE && strcmp(target->var_name, scan->name) == 0) scan->found = 1;
+}
+
+// Check if a function assigns a global (and so needs a global declaration)
+int function_rebinds_global(Program *prog, Function *func, const char *name) {
+    if (!is_global_name(prog, name) || is_local_name(func, name)) return 0;
+    RebindScan scan = { name, 0 };
+    visit_statement_expressions(func->body, find_rebind, &scan);
+    return scan.found;
+}
+
+// Check if anything assigns a global after its definition; element writes do not count
+int global_is_rebound(Program *prog, const char *name) {
+    for (int i = 0; i < prog->function_count; i++) {
+        if (function_rebinds_global(prog, prog->functions[i], name)) return 1;
+    }
+    RebindScan scan = { name, 0 };
+    visit_statement_expressions(prog->init_block, find_rebind, &scan);
+    return scan.found;
+}
+
+typedef struct {
+    Program *prog;
+    const char *name;
+    int writes_only;
+    int *visited;
+    int found;
+} GlobalUseScan;
+
+void scan_callee_use(Expression *expr, void *ctx);
+
+void scan_function_use(GlobalUseScan *scan, Function *func) {
+    int index = 0;
+    while (scan->prog->functions[index] != func) index++;
+    if (scan->visited[index]) return;
+    scan->visited[index] = 1;
+    if (!is_local_name(func, scan->name)) {
+        if (scan->writes_only ? function_rebinds_global(scan->prog, func, scan->name)
+                              : statement_uses_array(func->body, scan->name)) {
+            scan->found = 1;
+        }
+    }
+    visit_statement_expressions(func->body, scan_callee_use, scan);
+}
+
+void scan_callee_use(Expression *expr, void *ctx) {
+    GlobalUseScan *scan = ctx;
+    if (expr->type != EXPR_CALL || scan->found) return;
+    Function *callee = find_function(scan->prog, expr->call.func_name);
+    if (callee) scan_function_use(scan, callee);
+}
+
+// Check if any function reachable from func's calls writes (or, without writes_only, uses) a global
+int calls_use_global(Program *prog, Function *func, const char *name, int writes_only) {
+    GlobalUseScan scan = { prog, name, writes_only, calloc(prog->function_count + 1, sizeof(int)), 0 };
+    visit_statement_expressions(func->body, scan_callee_use, &scan);
+    free(scan.visited);
+    return scan.found;
+}
+
+// Check if a name is free for a new local or parameter of func
+int name_is_free(Program *prog, Function *func, const char *name) {
+    return !is_local_name(func, name) && !is_global_name(prog, name) && !find_function(prog, name);
+}
+
+// A fresh local for a global or dotted builtin: counter -> _counter, math.sin -> _math_sin
+char *make_alias(Program *prog, Function *func, const char *name) {
+    char alias[256];
+    snprintf(alias, sizeof(alias), "_%s", name);
+    for (char *c = alias; *c; c++) {
+        if (*c == '.') *c = '_';
+    }
+    while (!name_is_free(prog, func, alias)) {
+        strncat(alias, "_", sizeof(alias) - strlen(alias) - 1);
+    }
+    return strdup(alias);
+}
+
+// Builtins and module functions are defined before every def, unlike program functions
+int is_bindable_builtin(Program *prog, const char *name) {
+    if (find_function(prog, name)) return 0;
+    if (!is_pure_builtin(name) && !is_intrinsic(name) && !is_bit_builtin(name)) return 0;
+    // Functions of a module or builtin type, not methods of a variable (a.index)
+    const char *dot = strchr(name, '.');
+    return !dot || strncmp(name, "math.", 5) == 0 || strncmp(name, "int.", 4) == 0 || strncmp(name, "str.", 4) == 0;
+}
+
+void add_default(Function *func, const char *name, const char *value) {
+    func->default_names = realloc(func->default_names, (func->default_count + 1) * sizeof(char*));
+    func->default_values = realloc(func->default_values, (func->default_count + 1) * sizeof(char*));
+    func->default_names[func->default_count] = strdup(name);
+    func->default_values[func->default_count] = strdup(value);
+    func->default_count++;
+}
+
+typedef struct {
+    const char *from;
+    const char *to;
+} Rename;
+
+void rename_name(Expression *expr, void *ctx) {
+    Rename *rename = ctx;
+    if (expr->type == EXPR_VARIABLE && strcmp(expr->var_name, rename->from) == 0) {
+        free(expr->var_name);
+        expr->var_name = strdup(rename->to);
+    }
+    if (expr->type == EXPR_CALL && strcmp(expr->call.func_name, rename->from) == 0) {
+        free(expr->call.func_name);
+        expr->call.func_name = strdup(rename->to);
+    }
+}
+
+typedef struct {
+    Statement *stores;  // global = _global for every promoted global that is written
+} WriteBack;
+
+Statement *store_before_return(Statement *stmt, void *ctx) {
+    WriteBack *write_back = ctx;
+    if (stmt->type != STMT_RETURN) return stmt;
+    Statement *block = make_block();
+    block_append(block, clone_statement(write_back->stores));
+    block_append(block, stmt);
+    return block;
+}
+
+void prepend_statement(Statement *body, Statement *stmt) {
+    block_append(body, stmt);
+    memmove(&body->block.statements[1], &body->block.statements[0], (body->block.stmt_count - 1) * sizeof(Statement*));
+    body->block.statements[0] = stmt;
+}
+
+// Keep a scalar global in a local for the whole function
+void promote_global(Program *prog, Function *func, Variable *global, int writes, WriteBack *write_back, Statement *loads) {
+    char *alias = make_alias(prog, func, global->name);
+    Rename rename = { global->name, alias };
+    visit_statement_expressions(func->body, rename_name, &rename);
+
+    Statement *load = create_statement();
+    load->type = STMT_VAR_DECL;
+    load->var_decl.var = *global;
+    load->var_decl.var.name = alias;
+    load->var_decl.var.is_initialized = 1;
+    load->var_decl.initializer = make_variable(global->name);
+    block_append(loads, load);
+    if (writes) {
+        block_append(write_back->stores, make_expression_statement(make_binary(OP_ASSIGN, make_variable(global->name), make_variable(alias))));
+    }
+}
+
+void bind_function_names(Program *prog, Function *func) {
+    if (!func->body || func->body->type != STMT_BLOCK || function_is_cold(func)) return;
+    HotNames hot = { { NULL, 0 }, { NULL, 0 }, 0 };
+    visit_statements(func->body, collect_loop_names, &hot);
+    visit_statement_expressions(func->body, collect_comprehension_names, &hot);
+
+    WriteBack write_back = { make_block() };
+    Statement *loads = make_block();
+    for (int i = 0; i < prog->global_var_count; i++) {
+        Variable *global = &prog->global_vars[i];
+        if (!name_set_has(&hot.variables, global->name) || is_local_name(func, global->name)) continue;
+        if (!global_is_rebound(prog, global->name)) {
+            add_default(func, global->name, global->name);
+        } else if (!global->is_array && !global->struct_name) {
+            int writes = function_rebinds_global(prog, func, global->name);
+            if (!calls_use_global(prog, func, global->name, !writes)) {
+                promote_global(prog, func, global, writes, &write_back, loads);
+            }
+        }
+    }
+
+    for (int i = 0; i < hot.calls.count; i++) {
+        const char *name = hot.calls.names[i];
+        if (!is_bindable_builtin(prog, name)) continue;
+        if (!strchr(name, '.')) {
+            if (name_is_free(prog, func, name)) add_default(func, name, name);
+            continue;
+        }
+        char *alias = make_alias(prog, func, name);
+        Rename rename = { name, alias };
+        visit_statement_expressions(func->body, rename_name, &rename);
+        add_default(func, alias, name);
+        free(alias);
+    }
+    if (hot.prints && name_is_free(prog, func, "print")) add_default(func, "print", "print");
+
+    if (write_back.stores->block.stmt_count > 0) {
+        func->body = transform_statements(func->body, store_before_return, &write_back);
+        if (!statement_always_returns(func->body)) block_append(func->body, write_back.stores);
+    }
+    for (int i = loads->block.stmt_count - 1; i >= 0; i--) {
+        prepend_statement(func->body, loads->block.statements[i]);
+    }
+    name_set_free(&hot.variables);
+    name_set_free(&hot.calls);
+}
+
+// Turn global and builtin lookups in loops into local ones
+void bind_global_names(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        bind_function_names(prog, prog->functions[i]);
+    }
+}
@@ -17,4 +17,15 @@ def clear_bit(value, position):
 
 def toggle_bit(value, position):
     """Toggle bit at given position"""
-    return value ^ (1 << position)
\ No newline at end of file
+    return value ^ (1 << position)
+
+_REVERSED_BYTES = [int(f"{b:08b}"[::-1], 2) for b in range(256)]
+
+def reverse_bits(value, width):
+    """Reverse the low width bits of value, a byte at a time"""
+    value &= (1 << width) - 1
+    result = 0
+    for _ in range((width + 7) // 8):
+        result = (result << 8) | _REVERSED_BYTES[value & 0xFF]
+        value >>= 8
+    return result >> (-width % 8)
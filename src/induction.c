@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Induction-variable strength reduction for flattened array indexing. When a
+// range loop only uses its variable j in affine indexes e + j, where e is the
+// same loop-invariant expression everywhere (typically i * n from an outer
+// loop), the loop counts the offset itself and e is computed once:
+//     for j in range(0, m): c[i * n + j] = a[i * n + j] + b[i * n + j]
+// becomes
+//     for _iv0 in range(i * n, i * n + m): c[_iv0] = a[_iv0] + b[_iv0]
+// so the multiply and add per access are gone and range() updates the offset.
+// When every such index reads one array that the loop does not write, the
+// loop iterates a slice of it instead:
+//     for j in range(0, m): s += a[i * n + j]
+//     for _a_j in a[i * n:max(i * n + m, 0)]: s += _a_j
+// which the reduction idioms can then turn into sum(). The offset is
+// evaluated even when the loop runs zero times, so it must not raise.
+
+#define IV_PREFIX "_iv"
+
+typedef struct {
+    const char *var;      // The loop variable j
+    Expression *offset;   // e, from the first e + j seen
+    int matches;          // Occurrences of e + j with that e
+    int mismatches;       // e + j with another e, or an e that mentions j
+    const char *array;    // The array every e + j indexes, if there is one
+    int indexes;          // e + j used as an index of that array
+} AffineScan;
+
+// The e of e + j or j + e, or NULL
+Expression *affine_offset(Expression *expr, const char *var) {
+    if (expr->type != EXPR_BINARY || expr->binary.op != OP_ADD) return NULL;
+    Expression *left = expr->binary.left;
+    Expression *right = expr->binary.right;
+    if (right->type == EXPR_VARIABLE && strcmp(right->var_name, var) == 0) return left;
+    if (left->type == EXPR_VARIABLE && strcmp(left->var_name, var) == 0) return right;
+    return NULL;
+}
+
+void find_affine_use(Expression *expr, void *ctx) {
+    AffineScan *scan = ctx;
+    if (expr->type == EXPR_ARRAY_ACCESS && affine_offset(expr->array_access.index, scan->var)) {
+        if (!scan->array) scan->array = expr->array_access.array_name;
+        if (strcmp(scan->array, expr->array_access.array_name) == 0) scan->indexes++;
+        return;
+    }
+    Expression *offset = affine_offset(expr, scan->var);
+    if (!offset) return;
+    if (expression_mentions(offset, scan->var)) {
+        scan->mismatches++;
+    } else if (!scan->offset || expressions_equal(scan->offset, offset)) {
+        scan->offset = offset;
+        scan->matches++;
+    } else {
+        scan->mismatches++;
+    }
+}
+
+typedef struct {
+    const char *var;
+    Expression *offset;
+    const char *array;        // Replace array[e + j] (slice form) or every e + j (offset form)
+    const char *replacement;
+} AffineRewrite;
+
+void replace_affine_use(Expression *expr, void *ctx) {
+    AffineRewrite *rewrite = ctx;
+    if (rewrite->array) {
+        if (expr->type != EXPR_ARRAY_ACCESS || strcmp(expr->array_access.array_name, rewrite->array) != 0) return;
+        if (!affine_offset(expr->array_access.index, rewrite->var)) return;
+        free(expr->array_access.array_name);
+        expr->type = EXPR_VARIABLE;
+        expr->var_name = strdup(rewrite->replacement);
+        return;
+    }
+    if (!affine_offset(expr, rewrite->var)) return;
+    expr->type = EXPR_VARIABLE;
+    expr->var_name = strdup(rewrite->replacement);
+}
+
+void count_element_write(Expression *expr, void *ctx) {
+    Expression *target = written_target(expr);
+    if (target && target->type == EXPR_ARRAY_ACCESS) (*(int *)ctx)++;
+}
+
+typedef struct {
+    Program *prog;
+    Function *func;
+    int temp_count;
+} InductionContext;
+
+Statement *reduce_loop_statement(Statement *stmt, void *ctx) {
+    InductionContext *induction = ctx;
+    if (stmt->type != STMT_FOR_IN || stmt->for_in.else_branch) return stmt;
+    Expression *range = stmt->for_in.iterable;
+    if (range->type != EXPR_CALL || strcmp(range->call.func_name, "range") != 0 || range->call.arg_count < 1) return stmt;
+    const char *var = stmt->for_in.var.name;
+    Statement *body = stmt->for_in.body;
+    if (statement_writes_variable(body, var)) return stmt;
+
+    AffineScan scan = { var, NULL, 0, 0, NULL, 0 };
+    visit_statement_expressions(body, find_affine_use, &scan);
+    if (!scan.offset || scan.mismatches > 0 || scan.matches != count_variable_reads(body, var)) return stmt;
+    Expression *offset = scan.offset;
+    if (expression_has_side_effects(induction->prog, offset) || expression_may_trap(induction->prog, offset) ||
+        !expression_is_invariant(induction->prog, offset, stmt)) {
+        return stmt;
+    }
+
+    Expression *zero = make_int_literal(0);
+    Expression *start = range->call.arg_count == 1 ? zero : range->call.args[0];
+    Expression *stop = range->call.args[range->call.arg_count == 1 ? 0 : 1];
+    long long step = 1;
+    if (range->call.arg_count == 3 && !int_literal(range->call.args[2], &step)) step = 0;
+
+    // Slice form: every e + j reads one array that nothing in the loop can write
+    int element_writes = 0;
+    visit_statement_expressions(body, count_element_write, &element_writes);
+    Expression *end = step == 1 ? slice_stop(add_offset(offset, stop)) : NULL;
+    if (end && scan.indexes == scan.matches && element_writes == 0 &&
+        !statement_writes_variable(body, scan.array) && !statement_has_impure_calls(induction->prog, body)) {
+        char element[512];
+        snprintf(element, sizeof(element), "_%s_%s", scan.array, var);
+        Variable *array = lookup_variable(induction->prog, induction->func, scan.array);
+        // scan.array and offset live in nodes the rewrite frees or replaces
+        char *array_name = strdup(scan.array);
+        Expression *offset_copy = clone_expression(offset);
+        AffineRewrite rewrite = { var, offset_copy, array_name, element };
+        visit_statement_expressions(body, replace_affine_use, &rewrite);
+        free(stmt->for_in.var.name);
+        stmt->for_in.var.name = strdup(element);
+        stmt->for_in.var.type = array ? array->type : TYPE_INT;
+        stmt->for_in.var.struct_name = array && array->struct_name ? strdup(array->struct_name) : NULL;
+        stmt->for_in.iterable = make_slice(array_name, add_offset(offset_copy, start), end);
+        free(array_name);
+        free(zero);
+        return stmt;
+    }
+
+    // Offset form: range() counts e + j directly
+    char name[64];
+    do {
+        snprintf(name, sizeof(name), IV_PREFIX "%d", induction->temp_count++);
+    } while (lookup_variable(induction->prog, induction->func, name));
+    Expression *offset_copy = clone_expression(offset);
+    AffineRewrite rewrite = { var, offset_copy, NULL, name };
+    visit_statement_expressions(body, replace_affine_use, &rewrite);
+    Expression **args = malloc(3 * sizeof(Expression*));
+    int arg_count = 0;
+    args[arg_count++] = add_offset(offset_copy, start);
+    args[arg_count++] = add_offset(offset_copy, stop);
+    if (range->call.arg_count == 3) args[arg_count++] = clone_expression(range->call.args[2]);
+    free(stmt->for_in.var.name);
+    stmt->for_in.var.name = strdup(name);
+    stmt->for_in.iterable = make_call("range", args, arg_count);
+    free(zero);
+    return stmt;
+}
+
+// Strength-reduce affine array indexes in the range loops of every function
+void reduce_induction_variables(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        InductionContext ctx = { prog, prog->functions[i], 0 };
+        prog->functions[i]->body = transform_statements(prog->functions[i]->body, reduce_loop_statement, &ctx);
+    }
+}
@@ -0,0 +1,465 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "../include/optimizer.h"
+
+// Inline assembly. GCC extended asm blocks (AT&T syntax) made of common x86
+// integer instructions are run symbolically and replaced by assignments to
+// their output operands:
+//     asm("popcnt %1, %0" : "=r"(n) : "r"(x));   ->  n = int.bit_count(x & 0x7FFFFFFF) + (x < 0)
+//     asm("roll $8, %0" : "+r"(x));               ->  x = (x << 8) | ((x >> 24) & 255)
+//     asm("movl %1, %%eax\n\t" "imull $3, %%eax\n\t" "addl %%eax, %0"
+//         : "+r"(y) : "r"(x) : "eax");             ->  y = y + x * 3
+// Supported are mov, add, sub, imul, and, or, xor, neg, not, inc, dec,
+// shl/sal, shr, sar, rol, ror, popcnt, bsf, bsr, bswap, xchg and nop, with
+// an optional l suffix. Operands are %N, scratch registers (%%eax) and
+// immediates ($5); the operand expressions must be int variables or
+// constants. The results are ordinary int expressions, so the integer
+// lowering wraps them to 32 bits. Any other block is reported on stderr and
+// kept as a comment. This runs even with -O0: the comment alone loses the
+// block's effect.
+
+#define ASM_MAX_OPERANDS 16
+#define ASM_MAX_REGISTERS 16
+
+typedef struct {
+    Program *prog;
+    Function *func;
+    AsmBlock *block;
+    Expression *slots[ASM_MAX_OPERANDS];  // Value of each operand's register; NULL until written
+    int slot_of[ASM_MAX_OPERANDS];        // Register of operand %N (a tied input shares its output's)
+    int operand_count;
+    char *registers[ASM_MAX_REGISTERS];
+    Expression *register_values[ASM_MAX_REGISTERS];
+    int register_count;
+    char error[256];
+} AsmMachine;
+
+// Record why the block cannot be translated (the first reason wins); returns 0
+int asm_error(AsmMachine *m, const char *format, const char *detail) {
+    if (!m->error[0]) snprintf(m->error, sizeof(m->error), format, detail);
+    return 0;
+}
+
+// The value of an operand expression: an int variable or an integer constant
+Expression *operand_expression(AsmMachine *m, AsmOperand *operand) {
+    const char *text = operand->variable;
+    if (!text || !*text) {
+        asm_error(m, "operand has no expression%s", "");
+        return NULL;
+    }
+    char *end;
+    long long value = strtoll(text, &end, 0);
+    if (*end == '\0' && end != text) {
+        if (value < -2147483648LL || value > 2147483647LL) {
+            asm_error(m, "constant operand %s does not fit in an int", text);
+            return NULL;
+        }
+        return make_int_literal((int)value);
+    }
+    for (const char *c = text; *c; c++) {
+        if (!isalnum((unsigned char)*c) && *c != '_') {
+            asm_error(m, "operand expression '%s' is not a plain variable", text);
+            return NULL;
+        }
+    }
+    Variable *var = lookup_variable(m->prog, m->func, text);
+    if (!var || var->type != TYPE_INT || var->is_array || var->struct_name) {
+        asm_error(m, "operand '%s' is not an int variable", text);
+        return NULL;
+    }
+    return make_variable(text);
+}
+
+// Bind %0.. to outputs then inputs; "+" outputs and inputs start with their variable's value
+int setup_operands(AsmMachine *m) {
+    AsmBlock *block = m->block;
+    m->operand_count = block->output_count + block->input_count;
+    if (m->operand_count > ASM_MAX_OPERANDS) return asm_error(m, "too many operands%s", "");
+
+    for (int i = 0; i < block->output_count; i++) {
+        const char *constraint = block->outputs[i].constraint ? block->outputs[i].constraint : "";
+        Expression *value = operand_expression(m, &block->outputs[i]);
+        if (!value) return 0;
+        if (value->type != EXPR_VARIABLE) return asm_error(m, "output operand %s is not a variable", block->outputs[i].variable);
+        if (!strchr(constraint, '=') && !strchr(constraint, '+')) {
+            return asm_error(m, "output constraint \"%s\" is not \"=\" or \"+\"", constraint);
+        }
+        m->slot_of[i] = i;
+        m->slots[i] = strchr(constraint, '+') ? value : NULL;
+    }
+    for (int j = 0; j < block->input_count; j++) {
+        int operand = block->output_count + j;
+        const char *constraint = block->inputs[j].constraint ? block->inputs[j].constraint : "";
+        Expression *value = operand_expression(m, &block->inputs[j]);
+        if (!value) return 0;
+        if (isdigit((unsigned char)constraint[0])) {
+            // A matching constraint: the input arrives in the output's register
+            int tied = atoi(constraint);
+            if (tied >= block->output_count) return asm_error(m, "input tied to missing output \"%s\"", constraint);
+            m->slot_of[operand] = tied;
+            m->slots[tied] = value;
+        } else {
+            m->slot_of[operand] = operand;
+            m->slots[operand] = value;
+        }
+    }
+    return 1;
+}
+
+// The storage cell an operand names: %N or a register such as %%eax
+Expression **operand_cell(AsmMachine *m, const char *text) {
+    if (text[0] == '%' && text[1] == '%') {
+        const char *name = text + 2;
+        for (int i = 0; i < m->register_count; i++) {
+            if (strcmp(m->registers[i], name) == 0) return &m->register_values[i];
+        }
+        if (m->register_count == ASM_MAX_REGISTERS) {
+            asm_error(m, "too many registers%s", "");
+            return NULL;
+        }
+        m->registers[m->register_count] = strdup(name);
+        m->register_values[m->register_count] = NULL;
+        return &m->register_values[m->register_count++];
+    }
+    if (text[0] == '%' && isdigit((unsigned char)text[1])) {
+        char *end;
+        long index = strtol(text + 1, &end, 10);
+        if (*end == '\0' && index < m->operand_count) return &m->slots[m->slot_of[index]];
+    }
+    asm_error(m, "unsupported operand '%s'", text);
+    return NULL;
+}
+
+// Read an operand's current value (a copy)
+Expression *read_operand(AsmMachine *m, const char *text) {
+    if (text[0] == '$') {
+        char *end;
+        long long value = strtoll(text + 1, &end, 0);
+        if (*end != '\0' || end == text + 1 || value < -2147483648LL || value > 2147483647LL) {
+            asm_error(m, "unsupported immediate '%s'", text);
+            return NULL;
+        }
+        return make_int_literal((int)value);
+    }
+    Expression **cell = operand_cell(m, text);
+    if (!cell) return NULL;
+    if (!*cell) {
+        asm_error(m, "reads %s before anything is written to it", text);
+        return NULL;
+    }
+    return clone_expression(*cell);
+}
+
+int write_operand(AsmMachine *m, const char *text, Expression *value) {
+    if (text[0] == '$') return asm_error(m, "writes to immediate '%s'", text);
+    Expression **cell = operand_cell(m, text);
+    if (!cell) return 0;
+    *cell = value;
+    return 1;
+}
+
+Expression *with_constant(BinaryOpType op, Expression *left, int right) {
+    return make_binary(op, left, make_int_literal(right));
+}
+
+// The shift count of a shift or rotate: an immediate, or %%cl
+int shift_count(AsmMachine *m, const char *text, int *count, Expression **dynamic) {
+    *dynamic = NULL;
+    if (strcmp(text, "%%cl") == 0) {
+        Expression *ecx = read_operand(m, "%%ecx");
+        if (!ecx) return 0;
+        *dynamic = with_constant(OP_BIT_AND, ecx, 31);
+        return 1;
+    }
+    Expression *value = read_operand(m, text);
+    if (!value || value->type != EXPR_LITERAL) return asm_error(m, "unsupported shift count '%s'", text);
+    *count = value->literal.int_val & 31;  // x86 masks 32-bit shift counts to 5 bits
+    return 1;
+}
+
+// 32-bit rotate left by a constant
+Expression *rotate_left(Expression *value, int count) {
+    if (count == 0) return value;
+    Expression *high = with_constant(OP_BIT_AND, with_constant(OP_SHIFT_RIGHT, clone_expression(value), 32 - count), (1 << count) - 1);
+    return make_binary(OP_BIT_OR, with_constant(OP_SHIFT_LEFT, value, count), high);
+}
+
+Expression *byte_swap(Expression *value) {
+    Expression *b0 = with_constant(OP_SHIFT_LEFT, with_constant(OP_BIT_AND, clone_expression(value), 255), 24);
+    Expression *b1 = with_constant(OP_SHIFT_LEFT, with_constant(OP_BIT_AND, with_constant(OP_SHIFT_RIGHT, clone_expression(value), 8), 255), 16);
+    Expression *b2 = with_constant(OP_SHIFT_LEFT, with_constant(OP_BIT_AND, with_constant(OP_SHIFT_RIGHT, clone_expression(value), 16), 255), 8);
+    Expression *b3 = with_constant(OP_BIT_AND, with_constant(OP_SHIFT_RIGHT, value, 24), 255);
+    return make_binary(OP_BIT_OR, make_binary(OP_BIT_OR, make_binary(OP_BIT_OR, b0, b1), b2), b3);
+}
+
+Expression *bit_method(const char *name, Expression *arg) {
+    return make_call(name, &arg, 1);
+}
+
+// popcnt: the set bits of the 32-bit pattern, sign bit included
+Expression *population_count(Expression *value) {
+    Expression *low = bit_method("int.bit_count", with_constant(OP_BIT_AND, clone_expression(value), 0x7FFFFFFF));
+    return make_binary(OP_ADD, low, with_constant(OP_LT, value, 0));
+}
+
+// bsf: index of the lowest set bit
+Expression *lowest_bit_index(Expression *value) {
+    Expression *negated = create_expression();
+    negated->type = EXPR_UNARY;
+    negated->unary.op = OP_NEGATE;
+    negated->unary.expr = clone_expression(value);
+    return with_constant(OP_SUB, bit_method("int.bit_length", make_binary(OP_BIT_AND, value, negated)), 1);
+}
+
+// bsr: index of the highest set bit; 31 for a negative value
+Expression *highest_bit_index(Expression *value) {
+    Expression *args[2] = { with_constant(OP_SUB, bit_method("int.bit_length", clone_expression(value)), 1),
+                            with_constant(OP_MUL, with_constant(OP_LT, value, 0), 31) };
+    return make_call("max", args, 2);
+}
+
+// Run one instruction; returns 0 (with m->error set) if it is not supported
+int execute_instruction(AsmMachine *m, const char *mnemonic, char **args, int argc) {
+    static const char *known[] = { "mov", "add", "sub", "imul", "and", "or", "xor", "neg", "not", "inc", "dec",
+                                   "shl", "sal", "shr", "sar", "rol", "ror", "popcnt", "bsf", "bsr", "bswap",
+                                   "xchg", "nop" };
+    char name[32];
+    snprintf(name, sizeof(name), "%s", mnemonic);
+    int found = 0;
+    for (int pass = 0; pass < 2 && !found; pass++) {
+        for (size_t i = 0; i < sizeof(known) / sizeof(known[0]); i++) {
+            if (strcmp(name, known[i]) == 0) found = 1;
+        }
+        // The l suffix only gives the operand size (addl, shll)
+        size_t length = strlen(name);
+        if (!found && length > 1 && name[length - 1] == 'l') name[length - 1] = '\0';
+    }
+    if (!found) return asm_error(m, "unsupported instruction '%s'", mnemonic);
+
+    if (strcmp(name, "nop") == 0) return argc == 0 || asm_error(m, "bad operands for '%s'", mnemonic);
+
+    if (strcmp(name, "neg") == 0 || strcmp(name, "not") == 0 || strcmp(name, "inc") == 0 ||
+        strcmp(name, "dec") == 0 || strcmp(name, "bswap") == 0) {
+        if (argc != 1) return asm_error(m, "bad operands for '%s'", mnemonic);
+        Expression *value = read_operand(m, args[0]);
+        if (!value) return 0;
+        Expression *result;
+        if (strcmp(name, "inc") == 0 || strcmp(name, "dec") == 0) {
+            result = with_constant(name[0] == 'i' ? OP_ADD : OP_SUB, value, 1);
+        } else if (strcmp(name, "bswap") == 0) {
+            result = byte_swap(value);
+        } else {
+            result = create_expression();
+            result->type = EXPR_UNARY;
+            result->unary.op = name[1] == 'e' ? OP_NEGATE : OP_BIT_NOT;
+            result->unary.expr = value;
+        }
+        return write_operand(m, args[0], result);
+    }
+
+    if (strcmp(name, "shl") == 0 || strcmp(name, "sal") == 0 || strcmp(name, "shr") == 0 ||
+        strcmp(name, "sar") == 0 || strcmp(name, "rol") == 0 || strcmp(name, "ror") == 0) {
+        if (argc != 1 && argc != 2) return asm_error(m, "bad operands for '%s'", mnemonic);
+        int count = 1;
+        Expression *dynamic = NULL;
+        if (argc == 2 && !shift_count(m, args[0], &count, &dynamic)) return 0;
+        Expression *value = read_operand(m, args[argc - 1]);
+        if (!value) return 0;
+        int left = name[2] == 'l';
+        Expression *result;
+        if (dynamic) {
+            if (name[1] != 'a' && strcmp(name, "shl") != 0) {
+                return asm_error(m, "'%s' needs an immediate count", mnemonic);
+            }
+            result = make_binary(left ? OP_SHIFT_LEFT : OP_SHIFT_RIGHT, value, dynamic);
+        } else if (name[0] == 'r') {
+            result = rotate_left(value, left ? count : (32 - count) & 31);
+        } else if (count == 0) {
+            result = value;
+        } else if (strcmp(name, "shr") == 0) {
+            // Logical shift: the bits shifted in are zero
+            result = with_constant(OP_BIT_AND, with_constant(OP_SHIFT_RIGHT, value, count), (int)((1U << (32 - count)) - 1));
+        } else {
+            result = with_constant(left ? OP_SHIFT_LEFT : OP_SHIFT_RIGHT, value, count);
+        }
+        return write_operand(m, args[argc - 1], result);
+    }
+
+    if (strcmp(name, "imul") == 0 && argc == 3) {
+        Expression *factor = read_operand(m, args[0]);
+        Expression *value = read_operand(m, args[1]);
+        if (!factor || !value) return 0;
+        return write_operand(m, args[2], make_binary(OP_MUL, value, factor));
+    }
+    if (argc != 2) return asm_error(m, "bad operands for '%s'", mnemonic);
+
+    Expression *source = read_operand(m, args[0]);
+    if (!source) return 0;
+    if (strcmp(name, "mov") == 0) return write_operand(m, args[1], source);
+    if (strcmp(name, "popcnt") == 0) return write_operand(m, args[1], population_count(source));
+    if (strcmp(name, "bsf") == 0) return write_operand(m, args[1], lowest_bit_index(source));
+    if (strcmp(name, "bsr") == 0) return write_operand(m, args[1], highest_bit_index(source));
+
+    Expression *target = read_operand(m, args[1]);
+    if (!target) return 0;
+    if (strcmp(name, "xchg") == 0) return write_operand(m, args[0], target) && write_operand(m, args[1], source);
+
+    BinaryOpType op;
+    switch (name[0]) {
+        case 'a': op = name[1] == 'd' ? OP_ADD : OP_BIT_AND; break;
+        case 's': op = OP_SUB; break;
+        case 'i': op = OP_MUL; break;
+        case 'o': op = OP_BIT_OR; break;
+        default: op = OP_BIT_XOR; break;
+    }
+    return write_operand(m, args[1], make_binary(op, target, source));
+}
+
+// Split the instruction text into lines (\n, ; and real newlines) and run each one
+int execute_instructions(AsmMachine *m, const char *text) {
+    char *code = malloc(strlen(text) + 1);
+    int length = 0;
+    for (const char *c = text; *c; c++) {
+        if (*c == '\\' && (c[1] == 'n' || c[1] == 't')) {
+            code[length++] = c[1] == 'n' ? '\n' : ' ';
+            c++;
+        } else {
+            code[length++] = *c == ';' ? '\n' : *c;
+        }
+    }
+    code[length] = '\0';
+
+    int ok = 1;
+    for (char *line = strtok(code, "\n"); line && ok; line = strtok(NULL, "\n")) {
+        while (isspace((unsigned char)*line)) line++;
+        if (!*line) continue;
+        if (strchr(line, '(')) {
+            ok = asm_error(m, "memory operands are not supported ('%s')", line);
+            break;
+        }
+
+        char *rest = line;
+        while (*rest && !isspace((unsigned char)*rest)) {
+            *rest = (char)tolower((unsigned char)*rest);
+            rest++;
+        }
+        if (*rest) *rest++ = '\0';
+
+        char *args[4];
+        int argc = 0;
+        char *save;
+        for (char *arg = strtok_r(rest, ",", &save); arg; arg = strtok_r(NULL, ",", &save)) {
+            while (isspace((unsigned char)*arg)) arg++;
+            char *end = arg + strlen(arg);
+            while (end > arg && isspace((unsigned char)end[-1])) *--end = '\0';
+            if (!*arg) continue;
+            if (argc == 4) {
+                ok = asm_error(m, "too many operands for '%s'", line);
+                break;
+            }
+            args[argc++] = arg;
+        }
+        if (ok) ok = execute_instruction(m, line, args, argc);
+    }
+    free(code);
+    return ok;
+}
+
+typedef struct {
+    const char *from;
+    const char *to;
+} AsmRename;
+
+void rename_asm_read(Expression *expr, void *ctx) {
+    AsmRename *rename = ctx;
+    if (expr->type == EXPR_VARIABLE && strcmp(expr->var_name, rename->from) == 0) {
+        free(expr->var_name);
+        expr->var_name = strdup(rename->to);
+    }
+}
+
+// Assignments of the final values to the output variables, or NULL. The
+// outputs are written at once, as in m, n = n, m for xchg: an output that a
+// later value reads is saved in a temporary before the first assignment.
+Statement *output_assignments(AsmMachine *m) {
+    Statement *saves = make_block();
+    Statement *block = make_block();
+    AsmBlock *asm_block = m->block;
+    for (int i = 0; i < asm_block->output_count; i++) {
+        const char *var = asm_block->outputs[i].variable;
+        Expression *value = m->slots[i];
+        if (!value) {
+            asm_error(m, "output %s is never written", var);
+            return NULL;
+        }
+        if (value->type == EXPR_VARIABLE && strcmp(value->var_name, var) == 0) continue;
+        block_append(block, make_expression_statement(make_binary(OP_ASSIGN, make_variable(var), value)));
+
+        int read_later = 0;
+        for (int j = i + 1; j < asm_block->output_count; j++) {
+            if (m->slots[j] && expression_mentions(m->slots[j], var)) read_later = 1;
+        }
+        if (!read_later) continue;
+        char name[256];
+        snprintf(name, sizeof(name), "_asm_%s", var);
+        for (int k = 2; lookup_variable(m->prog, m->func, name); k++) {
+            snprintf(name, sizeof(name), "_asm_%s%d", var, k);
+        }
+        Statement *save = create_statement();
+        save->type = STMT_VAR_DECL;
+        save->var_decl.var.name = strdup(name);
+        save->var_decl.var.type = TYPE_INT;
+        save->var_decl.var.is_initialized = 1;
+        save->var_decl.initializer = make_variable(var);
+        block_append(saves, save);
+        AsmRename rename = { var, name };
+        for (int j = i + 1; j < asm_block->output_count; j++) {
+            if (!m->slots[j]) continue;
+            // Values may share nodes with the assignments already made
+            m->slots[j] = clone_expression(m->slots[j]);
+            visit_expression(m->slots[j], rename_asm_read, &rename);
+        }
+    }
+    for (int i = 0; i < block->block.stmt_count; i++) {
+        block_append(saves, block->block.statements[i]);
+    }
+    return saves;
+}
+
+// The statements an asm block stands for, or NULL with a diagnostic
+Statement *translate_asm(Program *prog, Function *func, AsmBlock *block) {
+    AsmMachine m;
+    memset(&m, 0, sizeof(m));
+    m.prog = prog;
+    m.func = func;
+    m.block = block;
+
+    Statement *result = NULL;
+    if (setup_operands(&m) && execute_instructions(&m, block->instructions ? block->instructions : "")) {
+        result = output_assignments(&m);
+    }
+    if (!result) {
+        fprintf(stderr, "Warning: inline asm in %s() kept as a comment: %s\n", func->name, m.error);
+    }
+    for (int i = 0; i < m.register_count; i++) {
+        free(m.registers[i]);
+    }
+    return result;
+}
+
+Statement *lower_asm_statement(Statement *stmt, void *ctx) {
+    AsmMachine *owner = ctx;
+    if (stmt->type != STMT_EXPR || stmt->expr->type != EXPR_ASM) return stmt;
+    Statement *translated = translate_asm(owner->prog, owner->func, &stmt->expr->asm_block);
+    return translated ? translated : stmt;
+}
+
+// Replace inline asm blocks with equivalent Python integer operations
+void lower_inline_asm(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        AsmMachine owner = { .prog = prog, .func = prog->functions[i] };
+        prog->functions[i]->body = transform_statements(prog->functions[i]->body, lower_asm_statement, &owner);
+    }
+}
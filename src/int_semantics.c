@@ -0,0 +1,435 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+#include "../include/codegen.h"
+
+// C integer semantics on Python ints. C ints are 32 bits and wrap around,
+// and C division and remainder truncate toward zero, while Python ints never
+// overflow and // and % round toward negative infinity. Exact output needs
+//     wrap:      ((x + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+//     division:  _c_div(a, b)    remainder: _c_mod(a, b)
+// but paying for those on every operation would make all arithmetic slow.
+// A value-range analysis keeps the plain operator wherever it gives the same
+// answer:
+//   - +, -, *, <<, unary minus and ~ are wrapped only when the result may
+//     leave the int range. Wrapping commutes with these and with &, | and ^,
+//     so an operand that feeds another of them is wrapped once at the top
+//     of the chain instead of at every step.
+//   - sum() and math.prod() from the loop idioms are int results like any
+//     other, and since wrapping commutes with them their items stay exact.
+//   - a / b and a % b become // and % when both operands have the same sign.
+// At -O0 no ranges are known and every operation gets its fix-up.
+
+#define INT_MIN_VALUE (-2147483647LL - 1)
+#define INT_MAX_VALUE 2147483647LL
+
+typedef struct {
+    Program *prog;
+    Function *func;
+    RangeEnv *env;
+    int use_ranges;    // 0 at -O0: every value is assumed to span the whole int range
+} IntContext;
+
+Interval interval_int() {
+    Interval range = { INT_MIN_VALUE, INT_MAX_VALUE };
+    return range;
+}
+
+int interval_fits_int(Interval range) {
+    return range.lo >= INT_MIN_VALUE && range.hi <= INT_MAX_VALUE;
+}
+
+// Range of a lowered expression; every int value fits the int range
+Interval int_range(IntContext *ctx, Expression *expr) {
+    if (!ctx->use_ranges) return interval_full();
+    return interval_of_expression(expr, ctx->env);
+}
+
+// Operations that wrapping commutes with: wrap(a op b) == wrap(wrap(a) op wrap(b))
+int wraps_operands(Expression *expr) {
+    if (expr->type == EXPR_UNARY) return expr->unary.op == OP_NEGATE || expr->unary.op == OP_BIT_NOT;
+    if (expr->type != EXPR_BINARY) return 0;
+    switch (expr->binary.op) {
+        case OP_ADD: case OP_SUB: case OP_MUL:
+        case OP_BIT_AND: case OP_BIT_OR: case OP_BIT_XOR:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Operations whose result may leave the int range
+int may_overflow(Expression *expr) {
+    if (expr->type == EXPR_CALL) return is_int_reduction(expr->call.func_name);
+    if (expr->type == EXPR_UNARY) return expr->unary.op == OP_NEGATE || expr->unary.op == OP_BIT_NOT;
+    if (expr->type != EXPR_BINARY) return 0;
+    switch (expr->binary.op) {
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_SHIFT_LEFT:
+        case OP_BIT_AND: case OP_BIT_OR: case OP_BIT_XOR:
+        case OP_FLOOR_DIV:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+Expression *make_wrap(Expression *expr) {
+    Expression *wrap = create_expression();
+    wrap->type = EXPR_UNARY;
+    wrap->unary.op = OP_WRAP_INT;
+    wrap->unary.expr = expr;
+    return wrap;
+}
+
+int same_sign(Interval a, Interval b) {
+    return (a.lo >= 0 && b.lo > 0) || (a.hi <= 0 && b.hi < 0);
+}
+
+void lower_expression(IntContext *ctx, Expression **slot, int wrapped_by_parent);
+
+Interval iteration_range(IntContext *ctx, Expression *iter);
+
+// element_wrapped is set when the consumer wraps a sum or product of the items
+void lower_generator(IntContext *ctx, Expression *expr, int element_wrapped) {
+    lower_expression(ctx, &expr->generator.iterable, 0);
+    RangeEnv *outer = ctx->env;
+    ctx->env = range_env_copy(outer);
+    range_env_set(ctx->env, expr->generator.var.name, iteration_range(ctx, expr->generator.iterable));
+    lower_expression(ctx, &expr->generator.element, element_wrapped);
+    lower_expression(ctx, &expr->generator.condition, 0);
+    range_env_free(ctx->env);
+    ctx->env = outer;
+}
+
+// Lower one expression. wrapped_by_parent is set when the parent wraps its
+// result anyway, so this value may stay unbounded.
+void lower_expression(IntContext *ctx, Expression **slot, int wrapped_by_parent) {
+    Expression *expr = *slot;
+    if (!expr) return;
+
+    int is_int = expression_type(ctx->prog, ctx->func, expr) == TYPE_INT;
+    switch (expr->type) {
+        case EXPR_BINARY: {
+            BinaryOpType op = expr->binary.op;
+            if (op == OP_ASSIGN) {
+                if (expr->binary.left->type != EXPR_VARIABLE) lower_expression(ctx, &expr->binary.left, 0);
+                lower_expression(ctx, &expr->binary.right, 0);
+                return;
+            }
+            // The optimizer's own // (closed-form sums) divides exactly, so its operands stay exact too
+            int operands_wrapped = is_int && (wraps_operands(expr) || op == OP_FLOOR_DIV);
+            lower_expression(ctx, &expr->binary.left, operands_wrapped || (is_int && op == OP_SHIFT_LEFT));
+            lower_expression(ctx, &expr->binary.right, operands_wrapped);
+            if (!is_int) break;
+
+            if (op == OP_DIV || op == OP_MOD) {
+                Interval a = int_range(ctx, expr->binary.left);
+                Interval b = int_range(ctx, expr->binary.right);
+                if (same_sign(a, b)) {
+                    expr->binary.op = op == OP_DIV ? OP_FLOOR_DIV : OP_MOD;
+                } else {
+                    expr->binary.op = op == OP_DIV ? OP_TRUNC_DIV : OP_TRUNC_MOD;
+                }
+            }
+            break;
+        }
+
+        case EXPR_UNARY:
+            if (expr->unary.op == OP_WRAP_INT) return;
+            // -1 is a constant in range, even at -O0
+            if (expr->unary.op == OP_NEGATE && expr->unary.expr->type == EXPR_LITERAL &&
+                expr->unary.expr->literal.lit_type == TYPE_INT && expr->unary.expr->literal.int_val != INT_MIN_VALUE) {
+                *slot = make_int_literal(-expr->unary.expr->literal.int_val);
+                return;
+            }
+            if (written_target(expr)) {
+                lower_expression(ctx, &expr->unary.expr, 0);
+                return;
+            }
+            lower_expression(ctx, &expr->unary.expr, is_int && wraps_operands(expr));
+            break;
+
+        case EXPR_CALL: {
+            int reduction = is_int && is_int_reduction(expr->call.func_name);
+            for (int i = 0; i < expr->call.arg_count; i++) {
+                if (reduction && expr->call.args[i]->type == EXPR_GENERATOR) {
+                    lower_generator(ctx, expr->call.args[i], 1);
+                } else {
+                    lower_expression(ctx, &expr->call.args[i], 0);
+                }
+            }
+            if (!reduction) return;
+            break;
+        }
+
+        case EXPR_ARRAY_ACCESS:
+            lower_expression(ctx, &expr->array_access.index, 0);
+            return;
+
+        case EXPR_MEMBER_ACCESS:
+            lower_expression(ctx, &expr->member_access.struct_expr, 0);
+            return;
+
+        case EXPR_SLICE:
+            lower_expression(ctx, &expr->slice.start, 0);
+            lower_expression(ctx, &expr->slice.stop, 0);
+            return;
+
+        case EXPR_GENERATOR:
+            lower_generator(ctx, expr, 0);
+            return;
+
+        case EXPR_LIST:
+            for (int i = 0; i < expr->list.count; i++) {
+                lower_expression(ctx, &expr->list.elements[i], 0);
+            }
+            return;
+
+        default:
+            return;
+    }
+
+    if (is_int && !wrapped_by_parent && may_overflow(expr) && !interval_fits_int(int_range(ctx, expr))) {
+        *slot = make_wrap(expr);
+    }
+}
+
+int is_tracked_name(IntContext *ctx, const char *name) {
+    return ctx->func && is_local_name(ctx->func, name);
+}
+
+// Record the value of an int local after an assignment
+void set_local_range(IntContext *ctx, const char *name, Interval range) {
+    if (!is_tracked_name(ctx, name)) return;
+    if (!interval_fits_int(range)) range = interval_int();
+    range_env_set(ctx->env, name, range);
+}
+
+// Globals may be changed by any call, so no facts about them are kept
+void forget_globals(IntContext *ctx) {
+    for (int i = 0; i < ctx->env->count; i++) {
+        if (!is_tracked_name(ctx, ctx->env->names[i])) ctx->env->ranges[i] = interval_full();
+    }
+}
+
+void refine_locals(IntContext *ctx, Expression *cond, int truth) {
+    refine_by_condition(cond, truth, ctx->env);
+    forget_globals(ctx);
+}
+
+void forget_write(Expression *expr, void *ctx) {
+    IntContext *lower = ctx;
+    Expression *target = written_target(expr);
+    if (target && target->type == EXPR_VARIABLE) set_local_range(lower, target->var_name, interval_full());
+}
+
+void forget_declaration(Statement *stmt, void *ctx) {
+    IntContext *lower = ctx;
+    if (stmt->type == STMT_VAR_DECL) set_local_range(lower, stmt->var_decl.var.name, interval_full());
+    if (stmt->type == STMT_FOR_IN) set_local_range(lower, stmt->for_in.var.name, interval_full());
+}
+
+// Forget everything a statement may write; used at loop heads
+void forget_writes(IntContext *ctx, Statement *stmt) {
+    visit_statement_expressions(stmt, forget_write, ctx);
+    visit_statements(stmt, forget_declaration, ctx);
+}
+
+// x++ and x-- as statements: x = x + 1 unless x is known to stay in range
+void lower_increment(IntContext *ctx, Expression **slot) {
+    Expression *expr = *slot;
+    if (!expr || expr->type != EXPR_UNARY || expr->unary.op == OP_WRAP_INT || !written_target(expr) ||
+        expr->unary.expr->type != EXPR_VARIABLE ||
+        expression_type(ctx->prog, ctx->func, expr->unary.expr) != TYPE_INT) {
+        return;
+    }
+    int up = expr->unary.op == OP_PRE_INC || expr->unary.op == OP_POST_INC;
+    Interval range = int_range(ctx, expr->unary.expr);
+    if (up ? range.hi < INT_MAX_VALUE : range.lo > INT_MIN_VALUE) return;
+
+    Expression *step = make_binary(up ? OP_ADD : OP_SUB, clone_expression(expr->unary.expr), make_int_literal(1));
+    *slot = make_binary(OP_ASSIGN, expr->unary.expr, make_wrap(step));
+}
+
+// Update the ranges after an expression statement runs
+void track_expression_statement(IntContext *ctx, Expression *expr) {
+    if (expr->type == EXPR_BINARY && expr->binary.op == OP_ASSIGN && expr->binary.left->type == EXPR_VARIABLE) {
+        Interval value = int_range(ctx, expr->binary.right);
+        visit_expression(expr->binary.right, forget_write, ctx);
+        set_local_range(ctx, expr->binary.left->var_name, value);
+    } else if (expr->type == EXPR_UNARY && written_target(expr) && expr->unary.expr->type == EXPR_VARIABLE) {
+        Interval range = int_range(ctx, expr->unary.expr);
+        int up = expr->unary.op == OP_PRE_INC || expr->unary.op == OP_POST_INC;
+        Interval next = { range.lo + (up ? 1 : -1), range.hi + (up ? 1 : -1) };
+        set_local_range(ctx, expr->unary.expr->var_name, interval_is_bounded(range) ? next : interval_full());
+    } else {
+        visit_expression(expr, forget_write, ctx);
+    }
+    forget_globals(ctx);
+}
+
+// Replace the current ranges with those of another path
+void take_ranges(IntContext *ctx, RangeEnv *env) {
+    range_env_free(ctx->env);
+    ctx->env = env;
+}
+
+// Range of the variable of for x in range(...)
+Interval iteration_range(IntContext *ctx, Expression *iter) {
+    if (iter->type != EXPR_CALL || strcmp(iter->call.func_name, "range") != 0 || iter->call.arg_count < 1) {
+        return interval_full();
+    }
+    int argc = iter->call.arg_count;
+    Interval start = argc >= 2 ? int_range(ctx, iter->call.args[0]) : interval_const(0);
+    Interval stop = int_range(ctx, iter->call.args[argc >= 2 ? 1 : 0]);
+    Expression *step = argc == 3 ? iter->call.args[2] : NULL;
+    long long step_value = 1;
+    if (step && !(step->type == EXPR_LITERAL && step->literal.lit_type == TYPE_INT)) return interval_full();
+    if (step) step_value = step->literal.int_val;
+
+    Interval range = step_value > 0 ? (Interval){ start.lo, stop.hi - 1 } : (Interval){ stop.lo + 1, start.hi };
+    return interval_is_bounded(range) ? range : interval_full();
+}
+
+void lower_statement(IntContext *ctx, Statement *stmt);
+
+// Lower a loop body with the ranges of every variable it writes forgotten
+void lower_loop(IntContext *ctx, Statement *stmt) {
+    if (stmt->type == STMT_FOR) lower_statement(ctx, stmt->for_stmt.initializer);
+    forget_writes(ctx, stmt);
+    switch (stmt->type) {
+        case STMT_WHILE: {
+            lower_expression(ctx, &stmt->while_stmt.condition, 0);
+            RangeEnv *exit = range_env_copy(ctx->env);
+            refine_locals(ctx, stmt->while_stmt.condition, 1);
+            lower_statement(ctx, stmt->while_stmt.body);
+            take_ranges(ctx, exit);
+            break;
+        }
+        case STMT_FOR: {
+            lower_expression(ctx, &stmt->for_stmt.condition, 0);
+            RangeEnv *exit = range_env_copy(ctx->env);
+            refine_locals(ctx, stmt->for_stmt.condition, 1);
+            lower_statement(ctx, stmt->for_stmt.body);
+            // The body may have moved the counter past the condition's bound
+            take_ranges(ctx, range_env_copy(exit));
+            lower_increment(ctx, &stmt->for_stmt.increment);
+            lower_expression(ctx, &stmt->for_stmt.increment, 0);
+            take_ranges(ctx, exit);
+            break;
+        }
+        default: {
+            lower_expression(ctx, &stmt->for_in.iterable, 0);
+            RangeEnv *exit = range_env_copy(ctx->env);
+            if (!statement_writes_variable(stmt->for_in.body, stmt->for_in.var.name)) {
+                set_local_range(ctx, stmt->for_in.var.name, iteration_range(ctx, stmt->for_in.iterable));
+            }
+            lower_statement(ctx, stmt->for_in.body);
+            lower_statement(ctx, stmt->for_in.else_branch);
+            take_ranges(ctx, exit);
+            break;
+        }
+    }
+}
+
+void lower_statement(IntContext *ctx, Statement *stmt) {
+    if (!stmt) return;
+
+    switch (stmt->type) {
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                lower_statement(ctx, stmt->block.statements[i]);
+            }
+            break;
+
+        case STMT_EXPR:
+            lower_increment(ctx, &stmt->expr);
+            lower_expression(ctx, &stmt->expr, 0);
+            track_expression_statement(ctx, stmt->expr);
+            break;
+
+        case STMT_VAR_DECL: {
+            Variable *var = &stmt->var_decl.var;
+            lower_expression(ctx, &stmt->var_decl.initializer, 0);
+            Interval value = interval_full();
+            if (stmt->var_decl.initializer) {
+                value = int_range(ctx, stmt->var_decl.initializer);
+                visit_expression(stmt->var_decl.initializer, forget_write, ctx);
+            } else if (!var->is_initialized && !var->is_array && var->type == TYPE_INT) {
+                value = interval_const(0); // Declared without a value: starts at 0
+            }
+            set_local_range(ctx, var->name, value);
+            forget_globals(ctx);
+            break;
+        }
+
+        case STMT_IF: {
+            lower_expression(ctx, &stmt->if_stmt.condition, 0);
+            visit_expression(stmt->if_stmt.condition, forget_write, ctx);
+            RangeEnv *outer = ctx->env;
+            RangeEnv *else_env = range_env_copy(outer);
+            ctx->env = range_env_copy(outer);
+            refine_locals(ctx, stmt->if_stmt.condition, 1);
+            lower_statement(ctx, stmt->if_stmt.then_branch);
+            RangeEnv *then_env = ctx->env;
+            ctx->env = else_env;
+            refine_locals(ctx, stmt->if_stmt.condition, 0);
+            lower_statement(ctx, stmt->if_stmt.else_branch);
+            else_env = ctx->env;
+            range_env_free(outer);
+
+            int then_returns = statement_always_returns(stmt->if_stmt.then_branch);
+            int else_returns = statement_always_returns(stmt->if_stmt.else_branch);
+            if (then_returns && !else_returns) {
+                ctx->env = else_env;
+                range_env_free(then_env);
+            } else {
+                if (!else_returns || then_returns) range_env_join(then_env, else_env);
+                ctx->env = then_env;
+                range_env_free(else_env);
+            }
+            break;
+        }
+
+        case STMT_WHILE:
+        case STMT_FOR:
+        case STMT_FOR_IN:
+            lower_loop(ctx, stmt);
+            break;
+
+        case STMT_RETURN:
+            lower_expression(ctx, &stmt->return_value, 0);
+            break;
+
+        case STMT_PRINT:
+            for (int i = 0; i < stmt->print.arg_count; i++) {
+                // %u, %x, %X and %o print the argument masked to 32 bits, which wraps it anyway
+                char conversion = format_conversion(stmt->print.format, i);
+                lower_expression(ctx, &stmt->print.args[i], conversion && strchr("uxXo", conversion));
+            }
+            forget_globals(ctx);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Give every int operation its exact C meaning
+void lower_integer_semantics(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        Function *func = prog->functions[i];
+        IntContext ctx = { prog, func, range_env_create(), optimizer_options.enabled };
+        for (int j = 0; j < func->param_count; j++) {
+            if (func->params[j].type == TYPE_INT) range_env_set(ctx.env, func->params[j].name, interval_int());
+        }
+        lower_statement(&ctx, func->body);
+        range_env_free(ctx.env);
+    }
+    if (prog->init_block) {
+        IntContext ctx = { prog, NULL, range_env_create(), 0 };
+        lower_statement(&ctx, prog->init_block);
+        range_env_free(ctx.env);
+    }
+}
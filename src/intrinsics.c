@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// C library calls mapped to the fastest Python equivalent. Calls to these
+// functions would fail in the generated code, so they are lowered even with
+// -O0, unless the program defines a function of the same name.
+//     sin(x)         ->  math.sin(x)       (import math is added by codegen)
+//     sqrt(x)        ->  _c_sqrt(x)        (NaN or inf outside the domain, as in C)
+//     pow(x, 3)      ->  (x ** 3)          (math.pow unless x is a float and 3 an int)
+//     fabs(x)        ->  abs(x)
+//     strlen("ab")   ->  len("ab")         (s.index('') for a char array)
+//     strcmp(a, b)   ->  ((a > b) - (a < b))
+//     toupper(c)     ->  str.upper(c)      (characters are one-character strings)
+//     s[n] = 0       ->  s[n] = ''         (the terminator is '', as in zeroed char arrays)
+// Each entry gives the form for arguments of arg_type and a fallback for any
+// other argument; a call with neither is left alone with a warning.
+
+typedef enum {
+    FORM_CALL,     // python(args)
+    FORM_POWER,    // a ** b
+    FORM_LENGTH,   // len(s)
+    FORM_COMPARE,  // (a > b) - (a < b)
+} IntrinsicForm;
+
+typedef struct {
+    const char *name;       // C function
+    const char *header;
+    int arity;
+    IntrinsicForm form;
+    VariableType arg_type;  // What the first argument must be for the form; TYPE_VOID = anything
+    const char *python;     // Function called by FORM_CALL
+    const char *fallback;   // Function called when the argument has another type, or NULL
+    VariableType result;    // TYPE_VOID when it is the type of the first argument
+} Intrinsic;
+
+static const Intrinsic intrinsics[] = {
+    // stdlib.h
+    { "abs",     "stdlib.h", 1, FORM_CALL,    TYPE_VOID,   "abs",         NULL,         TYPE_VOID },
+    { "labs",    "stdlib.h", 1, FORM_CALL,    TYPE_VOID,   "abs",         NULL,         TYPE_VOID },
+    { "llabs",   "stdlib.h", 1, FORM_CALL,    TYPE_VOID,   "abs",         NULL,         TYPE_VOID },
+
+    // math.h
+    { "fabs",    "math.h",   1, FORM_CALL,    TYPE_FLOAT,  "abs",         "math.fabs",  TYPE_FLOAT },
+    { "pow",     "math.h",   2, FORM_POWER,   TYPE_FLOAT,  NULL,          "math.pow",   TYPE_FLOAT },
+    { "sqrt",    "math.h",   1, FORM_CALL,    TYPE_VOID,   "_c_sqrt",     NULL,         TYPE_FLOAT },
+    { "exp",     "math.h",   1, FORM_CALL,    TYPE_VOID,   "_c_exp",      NULL,         TYPE_FLOAT },
+    { "log",     "math.h",   1, FORM_CALL,    TYPE_VOID,   "_c_log",      NULL,         TYPE_FLOAT },
+    { "log2",    "math.h",   1, FORM_CALL,    TYPE_VOID,   "_c_log2",     NULL,         TYPE_FLOAT },
+    { "log10",   "math.h",   1, FORM_CALL,    TYPE_VOID,   "_c_log10",    NULL,         TYPE_FLOAT },
+    { "sin",     "math.h",   1, FORM_CALL,    TYPE_VOID,   "math.sin",    NULL,         TYPE_FLOAT },
+    { "cos",     "math.h",   1, FORM_CALL,    TYPE_VOID,   "math.cos",    NULL,         TYPE_FLOAT },
+    { "tan",     "math.h",   1, FORM_CALL,    TYPE_VOID,   "math.tan",    NULL,         TYPE_FLOAT },
+    { "asin",    "math.h",   1, FORM_CALL,    TYPE_VOID,   "_c_asin",     NULL,         TYPE_FLOAT },
+    { "acos",    "math.h",   1, FORM_CALL,    TYPE_VOID,   "_c_acos",     NULL,         TYPE_FLOAT },
+    { "atan",    "math.h",   1, FORM_CALL,    TYPE_VOID,   "math.atan",   NULL,         TYPE_FLOAT },
+    { "atan2",   "math.h",   2, FORM_CALL,    TYPE_VOID,   "math.atan2",  NULL,         TYPE_FLOAT },
+    { "sinh",    "math.h",   1, FORM_CALL,    TYPE_VOID,   "math.sinh",   NULL,         TYPE_FLOAT },
+    { "cosh",    "math.h",   1, FORM_CALL,    TYPE_VOID,   "math.cosh",   NULL,         TYPE_FLOAT },
+    { "tanh",    "math.h",   1, FORM_CALL,    TYPE_VOID,   "math.tanh",   NULL,         TYPE_FLOAT },
+    { "hypot",   "math.h",   2, FORM_CALL,    TYPE_VOID,   "math.hypot",  NULL,         TYPE_FLOAT },
+    { "fmod",    "math.h",   2, FORM_CALL,    TYPE_VOID,   "math.fmod",   NULL,         TYPE_FLOAT },
+    { "floor",   "math.h",   1, FORM_CALL,    TYPE_VOID,   "math.floor",  NULL,         TYPE_FLOAT },
+    { "ceil",    "math.h",   1, FORM_CALL,    TYPE_VOID,   "math.ceil",   NULL,         TYPE_FLOAT },
+    { "trunc",   "math.h",   1, FORM_CALL,    TYPE_VOID,   "math.trunc",  NULL,         TYPE_FLOAT },
+
+    // string.h
+    { "strlen",  "string.h", 1, FORM_LENGTH,  TYPE_VOID,   "len",         NULL,         TYPE_INT },
+    { "strcmp",  "string.h", 2, FORM_COMPARE, TYPE_VOID,   NULL,          NULL,         TYPE_INT },
+
+    // ctype.h
+    { "toupper", "ctype.h",  1, FORM_CALL,    TYPE_CHAR,   "str.upper",   NULL,         TYPE_CHAR },
+    { "tolower", "ctype.h",  1, FORM_CALL,    TYPE_CHAR,   "str.lower",   NULL,         TYPE_CHAR },
+    { "isdigit", "ctype.h",  1, FORM_CALL,    TYPE_CHAR,   "str.isdigit", NULL,         TYPE_INT },
+    { "isalpha", "ctype.h",  1, FORM_CALL,    TYPE_CHAR,   "str.isalpha", NULL,         TYPE_INT },
+    { "isalnum", "ctype.h",  1, FORM_CALL,    TYPE_CHAR,   "str.isalnum", NULL,         TYPE_INT },
+    { "isspace", "ctype.h",  1, FORM_CALL,    TYPE_CHAR,   "str.isspace", NULL,         TYPE_INT },
+    { "isupper", "ctype.h",  1, FORM_CALL,    TYPE_CHAR,   "str.isupper", NULL,         TYPE_INT },
+    { "islower", "ctype.h",  1, FORM_CALL,    TYPE_CHAR,   "str.islower", NULL,         TYPE_INT },
+};
+
+#define INTRINSIC_COUNT (sizeof(intrinsics) / sizeof(intrinsics[0]))
+
+typedef struct {
+    Program *prog;
+    Function *func;
+} IntrinsicContext;
+
+const Intrinsic *find_intrinsic(const char *name) {
+    for (size_t i = 0; i < INTRINSIC_COUNT; i++) {
+        if (strcmp(intrinsics[i].name, name) == 0) return &intrinsics[i];
+    }
+    return NULL;
+}
+
+// The entry a generated Python call came from, or NULL
+const Intrinsic *find_python_intrinsic(const char *name) {
+    for (size_t i = 0; i < INTRINSIC_COUNT; i++) {
+        if ((intrinsics[i].python && strcmp(intrinsics[i].python, name) == 0) ||
+            (intrinsics[i].fallback && strcmp(intrinsics[i].fallback, name) == 0)) {
+            return &intrinsics[i];
+        }
+    }
+    return NULL;
+}
+
+// Check if a Python function comes from the intrinsic table (they have no side effects)
+int is_intrinsic(const char *name) {
+    return find_python_intrinsic(name) != NULL;
+}
+
+// C type of a call the intrinsic table produced, or TYPE_VOID when unknown
+VariableType intrinsic_result_type(const char *name, VariableType arg_type) {
+    const Intrinsic *intrinsic = find_python_intrinsic(name);
+    if (!intrinsic) return TYPE_VOID;
+    return intrinsic->result == TYPE_VOID ? arg_type : intrinsic->result;
+}
+
+int is_string_literal(Expression *expr) {
+    return expr->type == EXPR_LITERAL && expr->literal.lit_type == TYPE_STRING;
+}
+
+Expression *make_string_literal(const char *value) {
+    Expression *expr = create_expression();
+    expr->type = EXPR_LITERAL;
+    expr->literal.lit_type = TYPE_STRING;
+    expr->literal.string_val = strdup(value);
+    return expr;
+}
+
+// The char array a string argument names, or NULL
+Variable *lookup_char_array(IntrinsicContext *ctx, Expression *expr) {
+    if (expr->type != EXPR_VARIABLE) return NULL;
+    Variable *var = lookup_variable(ctx->prog, ctx->func, expr->var_name);
+    return var && var->is_array && !var->struct_name && var->type == TYPE_CHAR ? var : NULL;
+}
+
+// Length of a C string: len() of a literal, or the position of the first
+// zero character ('') of a char array
+Expression *string_length(IntrinsicContext *ctx, Expression *arg) {
+    if (is_string_literal(arg)) return make_call("len", &arg, 1);
+    if (!lookup_char_array(ctx, arg)) return NULL;
+    char index[256];
+    snprintf(index, sizeof(index), "%s.index", arg->var_name);
+    Expression *terminator = make_string_literal("");
+    return make_call(index, &terminator, 1);
+}
+
+// A C string as a Python str: a literal, or a char array up to its terminator
+Expression *string_value(IntrinsicContext *ctx, Expression *arg) {
+    if (is_string_literal(arg)) return clone_expression(arg);
+    Expression *length = string_length(ctx, arg);
+    if (!length) return NULL;
+    Expression *chars = make_slice(arg->var_name, NULL, length);
+    return make_call("''.join", &chars, 1);
+}
+
+// The Python expression for an intrinsic call, or NULL if the arguments do not fit
+Expression *lower_intrinsic(IntrinsicContext *ctx, const Intrinsic *intrinsic, Expression *call) {
+    Expression **args = call->call.args;
+    int preferred = intrinsic->arg_type == TYPE_VOID ||
+                    expression_type(ctx->prog, ctx->func, args[0]) == intrinsic->arg_type;
+    switch (intrinsic->form) {
+        case FORM_CALL:
+            if (preferred) return make_call(intrinsic->python, args, call->call.arg_count);
+            break;
+        case FORM_POWER:
+            // A float raised to an int is always real, like C; math.pow handles the rest
+            if (preferred && expression_type(ctx->prog, ctx->func, args[1]) == TYPE_INT) {
+                return make_binary(OP_POW, args[0], args[1]);
+            }
+            break;
+        case FORM_LENGTH:
+            return string_length(ctx, args[0]);
+        case FORM_COMPARE: {
+            Expression *a = string_value(ctx, args[0]);
+            Expression *b = string_value(ctx, args[1]);
+            if (!a || !b) return NULL;
+            return make_binary(OP_SUB, make_binary(OP_GT, a, b),
+                               make_binary(OP_LT, clone_expression(a), clone_expression(b)));
+        }
+    }
+    return intrinsic->fallback ? make_call(intrinsic->fallback, args, call->call.arg_count) : NULL;
+}
+
+void lower_intrinsic_call(Expression *expr, void *ctx) {
+    IntrinsicContext *intrinsics_ctx = ctx;
+    if (expr->type != EXPR_CALL || find_function(intrinsics_ctx->prog, expr->call.func_name)) return;
+    const Intrinsic *intrinsic = find_intrinsic(expr->call.func_name);
+    if (!intrinsic || expr->call.arg_count != intrinsic->arity) return;
+
+    Expression *lowered = lower_intrinsic(intrinsics_ctx, intrinsic, expr);
+    if (lowered) {
+        *expr = *lowered;
+    } else {
+        fprintf(stderr, "Warning: %s call (%s) has no Python equivalent for these arguments\n",
+                intrinsic->name, intrinsic->header);
+    }
+}
+
+int is_char_expression(IntrinsicContext *ctx, Expression *expr) {
+    return expression_type(ctx->prog, ctx->func, expr) == TYPE_CHAR;
+}
+
+int is_int_zero(Expression *expr) {
+    return expr->type == EXPR_LITERAL && expr->literal.lit_type == TYPE_INT && expr->literal.int_val == 0;
+}
+
+// The character '\0', emitted as ''
+void make_char_zero(Expression *expr) {
+    expr->literal.lit_type = TYPE_CHAR;
+    expr->literal.char_val = '\0';
+}
+
+// A 0 stored into or compared with a char is the terminator character
+void lower_char_zero(Expression *expr, void *ctx) {
+    if (expr->type != EXPR_BINARY) return;
+    BinaryOpType op = expr->binary.op;
+    if (op != OP_ASSIGN && op != OP_EQ && op != OP_NEQ) return;
+    if (is_int_zero(expr->binary.right) && is_char_expression(ctx, expr->binary.left)) {
+        make_char_zero(expr->binary.right);
+    } else if (op != OP_ASSIGN && is_int_zero(expr->binary.left) && is_char_expression(ctx, expr->binary.right)) {
+        make_char_zero(expr->binary.left);
+    }
+}
+
+void lower_char_zero_declaration(Statement *stmt, void *ctx) {
+    (void)ctx;
+    if (stmt->type != STMT_VAR_DECL || stmt->var_decl.var.type != TYPE_CHAR || stmt->var_decl.var.is_array) return;
+    if (stmt->var_decl.initializer && is_int_zero(stmt->var_decl.initializer)) {
+        make_char_zero(stmt->var_decl.initializer);
+    }
+}
+
+// Replace C library calls with their Python equivalents
+void lower_intrinsic_calls(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        IntrinsicContext ctx = { prog, prog->functions[i] };
+        visit_statement_expressions(prog->functions[i]->body, lower_char_zero, &ctx);
+        visit_statements(prog->functions[i]->body, lower_char_zero_declaration, &ctx);
+        visit_statement_expressions(prog->functions[i]->body, lower_intrinsic_call, &ctx);
+    }
+}
@@ -7,13 +7,16 @@
 // Helper function to check if a string is a C keyword
 int is_keyword(const char *str)
 {
+    // keywords[i] lexes as token_types[i]; keep the two tables in the same order
     static const char *keywords[] = {
         "int", "float", "char", "void", "if", "else", "while", "for", "do",
-        "return", "break", "continue", "printf", "scanf", "struct", "asm"};  // Added "asm"
+        "return", "break", "continue", "printf", "scanf", "struct", "asm", "extern", "static",
+        "switch", "case", "default"};
     static const TokenType token_types[] = {
         TOKEN_INT, TOKEN_FLOAT, TOKEN_CHAR, TOKEN_VOID, TOKEN_IF, TOKEN_ELSE, TOKEN_WHILE, 
         TOKEN_FOR, TOKEN_DO, TOKEN_RETURN, TOKEN_BREAK, TOKEN_CONTINUE, TOKEN_PRINTF, 
-        TOKEN_SCANF, TOKEN_STRUCT, TOKEN_ASM};  // Added TOKEN_ASM
+        TOKEN_SCANF, TOKEN_STRUCT, TOKEN_ASM, TOKEN_EXTERN, TOKEN_STATIC,
+        TOKEN_SWITCH, TOKEN_CASE, TOKEN_DEFAULT};
     static const int keyword_count = sizeof(keywords) / sizeof(keywords[0]);
 
     for (int i = 0; i < keyword_count; i++)
@@ -100,6 +103,22 @@ Token *lexer(const char *input, int *token_count)
             continue;
         }
 
+        // Skip preprocessor lines; declarations from #include come from linking
+        // the other translation units instead
+        if (input[pos] == '#')
+        {
+            if (strncmp(&input[pos + 1], "include", 7) != 0)
+            {
+                fprintf(stderr, "Warning: preprocessor directive ignored at line %d\n", line);
+            }
+            while (input[pos] != '\0' && input[pos] != '\n')
+            {
+                pos++;
+                column++;
+            }
+            continue;
+        }
+
         // Resize token array if needed
         if (*token_count >= capacity - 1)
         {
@@ -119,12 +138,22 @@ Token *lexer(const char *input, int *token_count)
             pos += 3; // Skip "asm"
             column += 3;
 
-            // Skip whitespace
+            // Skip whitespace and an optional volatile qualifier
             while (isspace(input[pos]) && input[pos] != '\n')
             {
                 pos++;
                 column++;
             }
+            if (strncmp(&input[pos], "volatile", 8) == 0 && !isalnum(input[pos + 8]))
+            {
+                pos += 8;
+                column += 8;
+                while (isspace(input[pos]) && input[pos] != '\n')
+                {
+                    pos++;
+                    column++;
+                }
+            }
 
             // Expect '('
             if (input[pos] != '(')
@@ -351,6 +380,13 @@ Token *lexer(const char *input, int *token_count)
                 pos += 2;
                 column += 2;
             }
+            else if (input[pos + 1] == '=')
+            {
+                tokens[*token_count].type = TOKEN_PLUS_ASSIGN;
+                tokens[*token_count].value = strdup("+=");
+                pos += 2;
+                column += 2;
+            }
             else
             {
                 tokens[*token_count].type = TOKEN_PLUS;
@@ -368,6 +404,13 @@ Token *lexer(const char *input, int *token_count)
                 pos += 2;
                 column += 2;
             }
+            else if (input[pos + 1] == '=')
+            {
+                tokens[*token_count].type = TOKEN_MINUS_ASSIGN;
+                tokens[*token_count].value = strdup("-=");
+                pos += 2;
+                column += 2;
+            }
             else
             {
                 tokens[*token_count].type = TOKEN_MINUS;
@@ -378,24 +421,54 @@ Token *lexer(const char *input, int *token_count)
             break;
 
         case '*':
-            tokens[*token_count].type = TOKEN_MULTIPLY;
-            tokens[*token_count].value = strdup("*");
-            pos++;
-            column++;
+            if (input[pos + 1] == '=')
+            {
+                tokens[*token_count].type = TOKEN_MULTIPLY_ASSIGN;
+                tokens[*token_count].value = strdup("*=");
+                pos += 2;
+                column += 2;
+            }
+            else
+            {
+                tokens[*token_count].type = TOKEN_MULTIPLY;
+                tokens[*token_count].value = strdup("*");
+                pos++;
+                column++;
+            }
             break;
 
         case '/':
-            tokens[*token_count].type = TOKEN_DIVIDE;
-            tokens[*token_count].value = strdup("/");
-            pos++;
-            column++;
+            if (input[pos + 1] == '=')
+            {
+                tokens[*token_count].type = TOKEN_DIVIDE_ASSIGN;
+                tokens[*token_count].value = strdup("/=");
+                pos += 2;
+                column += 2;
+            }
+            else
+            {
+                tokens[*token_count].type = TOKEN_DIVIDE;
+                tokens[*token_count].value = strdup("/");
+                pos++;
+                column++;
+            }
             break;
 
         case '%':
-            tokens[*token_count].type = TOKEN_MOD;
-            tokens[*token_count].value = strdup("%");
-            pos++;
-            column++;
+            if (input[pos + 1] == '=')
+            {
+                tokens[*token_count].type = TOKEN_MOD_ASSIGN;
+                tokens[*token_count].value = strdup("%=");
+                pos += 2;
+                column += 2;
+            }
+            else
+            {
+                tokens[*token_count].type = TOKEN_MOD;
+                tokens[*token_count].value = strdup("%");
+                pos++;
+                column++;
+            }
             break;
 
         case '=':
@@ -440,6 +513,13 @@ Token *lexer(const char *input, int *token_count)
                 pos += 2;
                 column += 2;
             }
+            else if (input[pos + 1] == '<' && input[pos + 2] == '=')
+            {
+                tokens[*token_count].type = TOKEN_SHIFT_LEFT_ASSIGN;
+                tokens[*token_count].value = strdup("<<=");
+                pos += 3;
+                column += 3;
+            }
             else if (input[pos + 1] == '<')
             {
                 tokens[*token_count].type = TOKEN_SHIFT_LEFT;
@@ -464,6 +544,13 @@ Token *lexer(const char *input, int *token_count)
                 pos += 2;
                 column += 2;
             }
+            else if (input[pos + 1] == '>' && input[pos + 2] == '=')
+            {
+                tokens[*token_count].type = TOKEN_SHIFT_RIGHT_ASSIGN;
+                tokens[*token_count].value = strdup(">>=");
+                pos += 3;
+                column += 3;
+            }
             else if (input[pos + 1] == '>')
             {
                 tokens[*token_count].type = TOKEN_SHIFT_RIGHT;
@@ -488,6 +575,13 @@ Token *lexer(const char *input, int *token_count)
                 pos += 2;
                 column += 2;
             }
+            else if (input[pos + 1] == '=')
+            {
+                tokens[*token_count].type = TOKEN_BIT_AND_ASSIGN;
+                tokens[*token_count].value = strdup("&=");
+                pos += 2;
+                column += 2;
+            }
             else
             {
                 tokens[*token_count].type = TOKEN_BIT_AND;
@@ -505,6 +599,13 @@ Token *lexer(const char *input, int *token_count)
                 pos += 2;
                 column += 2;
             }
+            else if (input[pos + 1] == '=')
+            {
+                tokens[*token_count].type = TOKEN_BIT_OR_ASSIGN;
+                tokens[*token_count].value = strdup("|=");
+                pos += 2;
+                column += 2;
+            }
             else
             {
                 tokens[*token_count].type = TOKEN_BIT_OR;
@@ -577,13 +678,30 @@ Token *lexer(const char *input, int *token_count)
             column++;
             break;
 
-        case '^':
-            tokens[*token_count].type = TOKEN_BIT_XOR;
-            tokens[*token_count].value = strdup("^");
+        case ':':
+            tokens[*token_count].type = TOKEN_COLON;
+            tokens[*token_count].value = strdup(":");
             pos++;
             column++;
             break;
 
+        case '^':
+            if (input[pos + 1] == '=')
+            {
+                tokens[*token_count].type = TOKEN_BIT_XOR_ASSIGN;
+                tokens[*token_count].value = strdup("^=");
+                pos += 2;
+                column += 2;
+            }
+            else
+            {
+                tokens[*token_count].type = TOKEN_BIT_XOR;
+                tokens[*token_count].value = strdup("^");
+                pos++;
+                column++;
+            }
+            break;
+
         case '~':
             tokens[*token_count].type = TOKEN_BIT_NOT;
             tokens[*token_count].value = strdup("~");
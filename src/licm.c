@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Loop-invariant code motion. Pure expressions whose operands no iteration
+// can change are computed once into a temporary before the loop:
+//     while (i < n * 2) { s = s + p.x * k; i++; }
+// becomes
+//     _inv0 = n * 2; _inv1 = p.x * k
+//     while i < _inv0: s = s + _inv1; i += 1
+// A hoisted expression runs even when the loop runs zero times, so only
+// expressions that cannot raise are taken from the body. Expressions that may
+// raise (division, indexing, calls to functions that may fail or loop) are
+// hoisted only from the part of the loop condition that is evaluated before
+// the first iteration anyway.
+// Temporaries hoisted out of an inner loop move further out when they are
+// invariant in the enclosing loop as well. Loops that a --profile-use run
+// never entered are left as they are.
+
+#define TEMP_PREFIX "_inv"
+
+typedef struct {
+    Program *prog;
+    Function *func;
+    int temp_count;     // Temporaries created so far in this function
+} HoistContext;
+
+typedef struct {
+    HoistContext *ctx;
+    Statement *loop;     // Everything that runs on each iteration
+    Statement *hoisted;  // Temporary declarations placed before the loop
+} LoopHoist;
+
+int is_hoisted_temp(Statement *stmt) {
+    return stmt->type == STMT_VAR_DECL && strncmp(stmt->var_decl.var.name, TEMP_PREFIX, strlen(TEMP_PREFIX)) == 0;
+}
+
+// Only operations are worth a temporary; names and constants are already cheap
+int is_hoist_candidate(Expression *expr) {
+    switch (expr->type) {
+        case EXPR_BINARY:
+            return expr->binary.op != OP_ASSIGN;
+        case EXPR_UNARY:
+            return expr->unary.op == OP_NOT || expr->unary.op == OP_BIT_NOT ||
+                   (expr->unary.op == OP_NEGATE && expr->unary.expr->type != EXPR_LITERAL);
+        case EXPR_CALL:
+        case EXPR_MEMBER_ACCESS:
+        case EXPR_ARRAY_ACCESS:
+        case EXPR_SLICE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Name of the temporary holding expr, creating it if needed
+const char *hoist_into_temp(LoopHoist *hoist, Expression *expr, VariableType type) {
+    Statement *hoisted = hoist->hoisted;
+    for (int i = 0; i < hoisted->block.stmt_count; i++) {
+        Statement *decl = hoisted->block.statements[i];
+        if (expressions_equal(decl->var_decl.initializer, expr)) return decl->var_decl.var.name;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), TEMP_PREFIX "%d", hoist->ctx->temp_count++);
+    Statement *decl = create_statement();
+    decl->type = STMT_VAR_DECL;
+    decl->var_decl.var.name = strdup(name);
+    decl->var_decl.var.type = type;
+    decl->var_decl.var.is_initialized = 1;
+    decl->var_decl.initializer = clone_expression(expr);
+    block_append(hoisted, decl);
+    return decl->var_decl.var.name;
+}
+
+// Replace maximal invariant subexpressions with temporaries.
+// evaluated_first is set when the expression runs before the first iteration.
+void hoist_expression(LoopHoist *hoist, Expression **slot, int evaluated_first) {
+    Expression *expr = *slot;
+    if (!expr || expr->type == EXPR_GENERATOR || expr->type == EXPR_ASM) return;
+
+    Program *prog = hoist->ctx->prog;
+    if (is_hoist_candidate(expr) && !expression_has_side_effects(prog, expr) &&
+        (evaluated_first || !expression_may_trap(prog, expr)) &&
+        expression_is_invariant(prog, expr, hoist->loop)) {
+        VariableType type = expression_type(prog, hoist->ctx->func, expr);
+        if (type == TYPE_INT || type == TYPE_FLOAT) {
+            *slot = make_variable(hoist_into_temp(hoist, expr, type));
+            return;
+        }
+    }
+
+    switch (expr->type) {
+        case EXPR_BINARY:
+            if (expr->binary.op == OP_ASSIGN) {
+                // The target itself stays; only its index can move
+                if (expr->binary.left->type == EXPR_ARRAY_ACCESS) {
+                    hoist_expression(hoist, &expr->binary.left->array_access.index, evaluated_first);
+                }
+                hoist_expression(hoist, &expr->binary.right, evaluated_first);
+            } else {
+                hoist_expression(hoist, &expr->binary.left, evaluated_first);
+                // The right operand of && and || may not run at all
+                int short_circuit = expr->binary.op == OP_AND || expr->binary.op == OP_OR;
+                hoist_expression(hoist, &expr->binary.right, evaluated_first && !short_circuit);
+            }
+            break;
+        case EXPR_UNARY:
+            if (!written_target(expr)) hoist_expression(hoist, &expr->unary.expr, evaluated_first);
+            break;
+        case EXPR_CALL:
+            for (int i = 0; i < expr->call.arg_count; i++) {
+                hoist_expression(hoist, &expr->call.args[i], evaluated_first);
+            }
+            break;
+        case EXPR_ARRAY_ACCESS:
+            hoist_expression(hoist, &expr->array_access.index, evaluated_first);
+            break;
+        case EXPR_SLICE:
+            hoist_expression(hoist, &expr->slice.start, evaluated_first);
+            hoist_expression(hoist, &expr->slice.stop, evaluated_first);
+            break;
+        default:
+            break;
+    }
+}
+
+// Hoist from the statements of a loop body; nested loops were handled already
+void hoist_statement(LoopHoist *hoist, Statement *stmt) {
+    if (!stmt) return;
+
+    switch (stmt->type) {
+        case STMT_EXPR:
+            hoist_expression(hoist, &stmt->expr, 0);
+            break;
+        case STMT_VAR_DECL:
+            if (!is_hoisted_temp(stmt)) hoist_expression(hoist, &stmt->var_decl.initializer, 0);
+            break;
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                hoist_statement(hoist, stmt->block.statements[i]);
+            }
+            break;
+        case STMT_IF:
+            hoist_expression(hoist, &stmt->if_stmt.condition, 0);
+            hoist_statement(hoist, stmt->if_stmt.then_branch);
+            hoist_statement(hoist, stmt->if_stmt.else_branch);
+            break;
+        case STMT_RETURN:
+            hoist_expression(hoist, &stmt->return_value, 0);
+            break;
+        case STMT_PRINT:
+            for (int i = 0; i < stmt->print.arg_count; i++) {
+                hoist_expression(hoist, &stmt->print.args[i], 0);
+            }
+            break;
+        case STMT_FOR_IN:
+            hoist_expression(hoist, &stmt->for_in.iterable, 0);
+            break;
+        default:
+            break;
+    }
+}
+
+// Inline nested blocks into the body so hoisted declarations sit at the top level
+void flatten_block(Statement *block) {
+    Statement *flat = make_block();
+    for (int i = 0; i < block->block.stmt_count; i++) {
+        Statement *stmt = block->block.statements[i];
+        if (stmt->type == STMT_BLOCK) {
+            flatten_block(stmt);
+            for (int j = 0; j < stmt->block.stmt_count; j++) {
+                block_append(flat, stmt->block.statements[j]);
+            }
+        } else {
+            block_append(flat, stmt);
+        }
+    }
+    free(block->block.statements);
+    block->block.statements = flat->block.statements;
+    block->block.stmt_count = flat->block.stmt_count;
+    free(flat);
+}
+
+// Move temporaries of inner loops out of this loop when their value cannot change
+void hoist_inner_temps(LoopHoist *hoist, Statement *body) {
+    int kept = 0;
+    for (int i = 0; i < body->block.stmt_count; i++) {
+        Statement *stmt = body->block.statements[i];
+        Expression *init = is_hoisted_temp(stmt) ? stmt->var_decl.initializer : NULL;
+        if (init && !expression_may_trap(hoist->ctx->prog, init) && expression_is_invariant(hoist->ctx->prog, init, hoist->loop)) {
+            block_append(hoist->hoisted, stmt);
+            continue;
+        }
+        body->block.statements[kept++] = stmt;
+    }
+    body->block.stmt_count = kept;
+}
+
+Statement **loop_body_slot(Statement *loop) {
+    switch (loop->type) {
+        case STMT_WHILE: return &loop->while_stmt.body;
+        case STMT_FOR: return &loop->for_stmt.body;
+        default: return &loop->for_in.body;
+    }
+}
+
+Statement *hoist_loop_statement(Statement *stmt, void *ctx) {
+    if (stmt->type != STMT_WHILE && stmt->type != STMT_FOR && stmt->type != STMT_FOR_IN) return stmt;
+    if (loop_is_cold(stmt)) return stmt;  // Per --profile-use the body never runs
+
+    LoopHoist hoist = { ctx, stmt, make_block() };
+    Statement **body = loop_body_slot(stmt);
+    if (!*body || (*body)->type != STMT_BLOCK) {
+        Statement *block = make_block();
+        if (*body) block_append(block, *body);
+        *body = block;
+    }
+    flatten_block(*body);
+    hoist_inner_temps(&hoist, *body);
+
+    // The condition runs before the first iteration; the increment only after one
+    if (stmt->type == STMT_WHILE) {
+        hoist_expression(&hoist, &stmt->while_stmt.condition, 1);
+    } else if (stmt->type == STMT_FOR) {
+        hoist_expression(&hoist, &stmt->for_stmt.condition, 1);
+        hoist_expression(&hoist, &stmt->for_stmt.increment, 0);
+    }
+    hoist_statement(&hoist, *body);
+
+    if (hoist.hoisted->block.stmt_count == 0) {
+        free(hoist.hoisted->block.statements);
+        free(hoist.hoisted);
+        return stmt;
+    }
+    block_append(hoist.hoisted, stmt);
+    return hoist.hoisted;
+}
+
+// Hoist loop invariants in every function
+void hoist_loop_invariants(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        HoistContext ctx = { prog, prog->functions[i], 0 };
+        prog->functions[i]->body = transform_statements(prog->functions[i]->body, hoist_loop_statement, &ctx);
+    }
+}
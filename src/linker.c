@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "../include/linker.h"
+#include "../include/optimizer.h"
+
+// Whole-program linking. Each input file is parsed into its own Program, and
+// the units are merged into one so that every pass (specialization,
+// compile-time evaluation, tree shaking, ...) sees across files, like a C
+// linker resolving symbols between object files:
+//  - a function, or an initialized global, defined in two units is an error
+//  - uninitialized and extern globals of the same name are one variable
+//    (common symbols); conflicting types are an error
+//  - a static function or global whose name another unit also uses is
+//    renamed within its unit (helper in util.c becomes util_helper)
+//  - structs are shared by name, and the first definition is kept
+// Prototypes are dropped by the parser; calls resolve by name here.
+
+typedef struct {
+    const char *from;
+    const char *to;
+    int rename_variables;  // The name is not shadowed by a local
+} SymbolRename;
+
+void rename_symbol_use(Expression *expr, void *ctx) {
+    SymbolRename *rename = ctx;
+    char **name = NULL;
+    switch (expr->type) {
+        case EXPR_CALL: name = &expr->call.func_name; break;
+        case EXPR_VARIABLE: if (rename->rename_variables) name = &expr->var_name; break;
+        case EXPR_ARRAY_ACCESS: if (rename->rename_variables) name = &expr->array_access.array_name; break;
+        case EXPR_SLICE: if (rename->rename_variables) name = &expr->slice.array_name; break;
+        default: break;
+    }
+    if (name && strcmp(*name, rename->from) == 0) {
+        free(*name);
+        *name = strdup(rename->to);
+    }
+}
+
+// Rename a function or global and every use of it in one unit
+void rename_unit_symbol(Program *unit, const char *from, const char *to) {
+    for (int i = 0; i < unit->function_count; i++) {
+        Function *func = unit->functions[i];
+        SymbolRename rename = { from, to, !is_local_name(func, from) };
+        visit_statement_expressions(func->body, rename_symbol_use, &rename);
+    }
+    for (int i = 0; i < unit->function_count; i++) {
+        if (strcmp(unit->functions[i]->name, from) == 0) {
+            free(unit->functions[i]->name);
+            unit->functions[i]->name = strdup(to);
+        }
+    }
+    for (int i = 0; i < unit->global_var_count; i++) {
+        if (strcmp(unit->global_vars[i].name, from) == 0) {
+            free(unit->global_vars[i].name);
+            unit->global_vars[i].name = strdup(to);
+        }
+    }
+}
+
+// Check if a unit defines or declares a function or global
+int unit_has_symbol(Program *unit, const char *name) {
+    if (find_function(unit, name) || is_global_name(unit, name)) return 1;
+    for (int i = 0; i < unit->extern_count; i++) {
+        if (strcmp(unit->extern_vars[i].name, name) == 0) return 1;
+    }
+    return 0;
+}
+
+// The file name as an identifier prefix: src/util.c -> util
+void unit_prefix(const char *file, char *prefix, size_t size) {
+    const char *base = strrchr(file, '/');
+    base = base ? base + 1 : file;
+    size_t length = 0;
+    for (const char *c = base; *c && *c != '.' && length + 1 < size; c++) {
+        prefix[length++] = isalnum((unsigned char)*c) ? *c : '_';
+    }
+    prefix[length] = '\0';
+}
+
+// Give static symbols that clash with another unit's names a unit prefix
+void rename_static_symbols(Program **units, const char **files, int count) {
+    // Find every clash before renaming, so both sides of one are renamed
+    int **clashes = malloc((count + 1) * sizeof(int*));
+    for (int u = 0; u < count; u++) {
+        clashes[u] = calloc(units[u]->static_count + 1, sizeof(int));
+        for (int s = 0; s < units[u]->static_count; s++) {
+            for (int v = 0; v < count; v++) {
+                if (v != u && unit_has_symbol(units[v], units[u]->static_names[s])) clashes[u][s] = 1;
+            }
+        }
+    }
+
+    for (int u = 0; u < count; u++) {
+        for (int s = 0; s < units[u]->static_count; s++) {
+            const char *name = units[u]->static_names[s];
+            if (!clashes[u][s]) continue;
+
+            char prefix[128];
+            char renamed[256];
+            unit_prefix(files[u], prefix, sizeof(prefix));
+            snprintf(renamed, sizeof(renamed), "%s_%s", prefix, name);
+            int taken = 1;
+            while (taken) {
+                taken = 0;
+                for (int v = 0; v < count; v++) {
+                    if (unit_has_symbol(units[v], renamed)) taken = 1;
+                }
+                if (taken) strncat(renamed, "_", sizeof(renamed) - strlen(renamed) - 1);
+            }
+            rename_unit_symbol(units[u], name, renamed);
+        }
+        free(clashes[u]);
+    }
+    free(clashes);
+}
+
+int same_variable_type(Variable *a, Variable *b) {
+    if (a->type != b->type || a->is_array != b->is_array) return 0;
+    if (a->is_array && a->array_size != b->array_size) return 0;
+    if (!a->struct_name || !b->struct_name) return !a->struct_name && !b->struct_name;
+    return strcmp(a->struct_name, b->struct_name) == 0;
+}
+
+// Add a global to the linked program, merging it with an earlier one of the same name
+int link_global(Program *prog, const char **origins, Variable *var, const char *file) {
+    for (int i = 0; i < prog->global_var_count; i++) {
+        Variable *existing = &prog->global_vars[i];
+        if (strcmp(existing->name, var->name) != 0) continue;
+        if (!same_variable_type(existing, var)) {
+            fprintf(stderr, "Error: conflicting types for global '%s' (%s and %s)\n", var->name, origins[i], file);
+            return 0;
+        }
+        if (existing->is_initialized && var->is_initialized) {
+            fprintf(stderr, "Error: multiple definition of global '%s' (%s and %s)\n", var->name, origins[i], file);
+            return 0;
+        }
+        if (var->is_initialized) {
+            *existing = *var;
+            origins[i] = file;
+        }
+        return 1;
+    }
+    prog->global_vars = realloc(prog->global_vars, (prog->global_var_count + 1) * sizeof(Variable));
+    origins[prog->global_var_count] = file;
+    prog->global_vars[prog->global_var_count++] = *var;
+    return 1;
+}
+
+int same_struct(Struct *a, Struct *b) {
+    if (a->field_count != b->field_count) return 0;
+    for (int i = 0; i < a->field_count; i++) {
+        if (strcmp(a->fields[i].name, b->fields[i].name) != 0 || !same_variable_type(&a->fields[i], &b->fields[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+Program *link_programs(Program **units, const char **files, int count) {
+    rename_static_symbols(units, files, count);
+
+    int global_total = 0;
+    int function_total = 0;
+    for (int u = 0; u < count; u++) {
+        global_total += units[u]->global_var_count + units[u]->extern_count;
+        function_total += units[u]->function_count;
+    }
+    const char **global_origins = malloc((global_total + 1) * sizeof(char*));
+    const char **function_origins = malloc((function_total + 1) * sizeof(char*));
+
+    Program *prog = calloc(1, sizeof(Program));
+    int ok = 1;
+    for (int u = 0; u < count && ok; u++) {
+        Program *unit = units[u];
+        for (int i = 0; i < unit->struct_count; i++) {
+            Struct *existing = NULL;
+            for (int j = 0; j < prog->struct_count; j++) {
+                if (strcmp(prog->structs[j].name, unit->structs[i].name) == 0) existing = &prog->structs[j];
+            }
+            if (existing) {
+                if (!same_struct(existing, &unit->structs[i])) {
+                    fprintf(stderr, "Warning: struct %s is defined differently in %s; using the first definition\n",
+                            existing->name, files[u]);
+                }
+                continue;
+            }
+            prog->structs = realloc(prog->structs, (prog->struct_count + 1) * sizeof(Struct));
+            prog->structs[prog->struct_count++] = unit->structs[i];
+        }
+
+        for (int i = 0; i < unit->function_count && ok; i++) {
+            Function *func = unit->functions[i];
+            for (int j = 0; j < prog->function_count; j++) {
+                if (strcmp(prog->functions[j]->name, func->name) == 0) {
+                    fprintf(stderr, "Error: multiple definition of function '%s' (%s and %s)\n",
+                            func->name, function_origins[j], files[u]);
+                    ok = 0;
+                }
+            }
+            if (!ok) break;
+            prog->functions = realloc(prog->functions, (prog->function_count + 1) * sizeof(Function*));
+            function_origins[prog->function_count] = files[u];
+            func->source_file = files[u];
+            prog->functions[prog->function_count++] = func;
+        }
+
+        for (int i = 0; i < unit->global_var_count && ok; i++) {
+            ok = link_global(prog, global_origins, &unit->global_vars[i], files[u]);
+        }
+    }
+
+    // An extern global takes the definition from another unit; C would fail
+    // to link without one, but the zero-initialized variable C programmers
+    // usually meant is defined instead
+    for (int u = 0; u < count && ok; u++) {
+        for (int i = 0; i < units[u]->extern_count && ok; i++) {
+            Variable *var = &units[u]->extern_vars[i];
+            if (!is_global_name(prog, var->name)) {
+                fprintf(stderr, "Warning: extern global '%s' (%s) is never defined; it starts at zero\n",
+                        var->name, files[u]);
+                var->is_initialized = 0;
+            }
+            ok = link_global(prog, global_origins, var, files[u]);
+        }
+    }
+
+    free(global_origins);
+    free(function_origins);
+    for (int u = 0; u < count; u++) {
+        free(units[u]->functions);
+        free(units[u]->global_vars);
+        free(units[u]->structs);
+        for (int i = 0; i < units[u]->static_count; i++) {
+            free(units[u]->static_names[i]);
+        }
+        free(units[u]->static_names);
+        free(units[u]->extern_vars);
+        free(units[u]);
+    }
+    if (!ok) return NULL;
+    program = prog;
+    return prog;
+}
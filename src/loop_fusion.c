@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Loop fusion. Back-to-back loops over the same iteration space
+//     for (i = 0; i < n; i++) a[i] = i * 2;
+//     for (i = 0; i < n; i++) b[i] = a[i] + 1;
+// become one loop, so the per-iteration overhead is paid once:
+//     for (i = 0; i < n; i++) { a[i] = i * 2; b[i] = a[i] + 1; }
+// The same applies to i = a; while (i < b) { ...; i++; } pairs. Loops are
+// fused when they have the same start, condition and increment, neither body
+// can leave the loop early or change the bounds, and every array one body
+// writes and the other touches is only indexed by the loop variable, so each
+// iteration still sees the elements the original order produced. A second
+// loop that declares its own counter (for (int j = 0; ...)) is renamed to the
+// first loop's variable.
+
+typedef struct {
+    Program *prog;
+    Function *func;  // NULL for the module-level init block
+} FusionContext;
+
+// One loop in normalized form
+typedef struct {
+    Statement *init;      // Initializer (for) or the statement before the loop (while)
+    const char *var;      // Loop variable
+    Expression *start;
+    Expression *cond;
+    Expression *incr;
+    Statement *body;      // Body without the increment of a while loop
+    int declared;         // The for initializer declares the variable
+} FusionLoop;
+
+typedef struct {
+    const char *name;
+    Expression *index;    // NULL for a scalar or a whole-array use
+    int is_write;
+} Access;
+
+typedef struct {
+    Program *prog;
+    Function *func;
+    Access *accesses;
+    int count;
+    int writes_global;
+    int calls_functions;  // Calls program functions, which may read globals
+} AccessSet;
+
+// Read the variable and start value out of i = a or int i = a
+int match_loop_start(Statement *init, const char **var, Expression **start, int *declared) {
+    if (!init) return 0;
+    if (init->type == STMT_VAR_DECL) {
+        Variable *decl = &init->var_decl.var;
+        if (decl->is_array || decl->struct_name || decl->type != TYPE_INT || !init->var_decl.initializer) return 0;
+        *var = decl->name;
+        *start = init->var_decl.initializer;
+        *declared = 1;
+        return 1;
+    }
+    if (init->type != STMT_EXPR || init->expr->type != EXPR_BINARY || init->expr->binary.op != OP_ASSIGN ||
+        init->expr->binary.left->type != EXPR_VARIABLE) {
+        return 0;
+    }
+    *var = init->expr->binary.left->var_name;
+    *start = init->expr->binary.right;
+    *declared = 0;
+    return 1;
+}
+
+// Check for a break, continue or return that leaves this loop (or the function)
+int has_loop_exit(Statement *stmt, int nested) {
+    if (!stmt) return 0;
+    switch (stmt->type) {
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return !nested;
+        case STMT_RETURN:
+            return 1;
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                if (has_loop_exit(stmt->block.statements[i], nested)) return 1;
+            }
+            return 0;
+        case STMT_IF:
+            return has_loop_exit(stmt->if_stmt.then_branch, nested) || has_loop_exit(stmt->if_stmt.else_branch, nested);
+        case STMT_WHILE:
+            return has_loop_exit(stmt->while_stmt.body, 1);
+        case STMT_FOR:
+            return has_loop_exit(stmt->for_stmt.body, 1);
+        case STMT_FOR_IN:
+            return has_loop_exit(stmt->for_in.body, 1) || has_loop_exit(stmt->for_in.else_branch, nested);
+        default:
+            return 0;
+    }
+}
+
+// The loop at block position i; a while loop also takes the statement before it
+int match_fusion_loop(Statement *block, int i, FusionLoop *loop) {
+    Statement *stmt = block->block.statements[i];
+    if (stmt->type == STMT_FOR) {
+        loop->init = stmt->for_stmt.initializer;
+        loop->cond = stmt->for_stmt.condition;
+        loop->incr = stmt->for_stmt.increment;
+        loop->body = stmt->for_stmt.body;
+    } else if (stmt->type == STMT_WHILE && i > 0 && stmt->while_stmt.body->type == STMT_BLOCK) {
+        Statement *body = stmt->while_stmt.body;
+        if (body->block.stmt_count == 0) return 0;
+        Statement *last = body->block.statements[body->block.stmt_count - 1];
+        if (last->type != STMT_EXPR) return 0;
+        loop->init = block->block.statements[i - 1];
+        loop->cond = stmt->while_stmt.condition;
+        loop->incr = last->expr;
+        loop->body = make_block();
+        for (int j = 0; j < body->block.stmt_count - 1; j++) {
+            block_append(loop->body, body->block.statements[j]);
+        }
+    } else {
+        return 0;
+    }
+
+    if (!loop->cond || !loop->incr || !loop->body) return 0;
+    if (!match_loop_start(loop->init, &loop->var, &loop->start, &loop->declared)) return 0;
+    if (stmt->type == STMT_WHILE && loop->declared) return 0;
+    // The increment has to be the only write, and only of the loop variable
+    Expression *target = written_target(loop->incr);
+    if (!target || target->type != EXPR_VARIABLE || strcmp(target->var_name, loop->var) != 0) return 0;
+    if (statement_writes_variable(loop->body, loop->var)) return 0;
+    return !has_loop_exit(loop->body, 0);
+}
+
+void rename_variable(Expression *expr, void *ctx) {
+    const char **names = ctx;
+    if (expr->type == EXPR_VARIABLE && strcmp(expr->var_name, names[0]) == 0) {
+        expr->var_name = strdup(names[1]);
+    }
+}
+
+typedef struct {
+    const char *name;
+    int found;
+} DeclScan;
+
+void find_decl(Statement *stmt, void *ctx) {
+    DeclScan *scan = ctx;
+    if ((stmt->type == STMT_VAR_DECL && strcmp(stmt->var_decl.var.name, scan->name) == 0) ||
+        (stmt->type == STMT_FOR_IN && strcmp(stmt->for_in.var.name, scan->name) == 0)) {
+        scan->found = 1;
+    }
+}
+
+int statement_declares(Statement *stmt, const char *name) {
+    DeclScan scan = { name, 0 };
+    visit_statements(stmt, find_decl, &scan);
+    return scan.found;
+}
+
+int statement_mentions(Statement *stmt, const char *name) {
+    return count_variable_reads(stmt, name) > 0 || statement_writes_variable(stmt, name) ||
+           statement_declares(stmt, name);
+}
+
+// Give the second loop the first loop's variable when it declares its own
+int unify_loop_variables(FusionLoop *first, FusionLoop *second) {
+    if (strcmp(first->var, second->var) == 0) return 1;
+    if (!second->declared || second->init->type != STMT_VAR_DECL) return 0;
+    if (statement_mentions(second->body, first->var) || statement_mentions(first->body, second->var)) return 0;
+    if (statement_declares(second->body, second->var)) return 0;
+
+    // Renamed copies, so the loop is untouched if it cannot be fused after all
+    const char *names[2] = { second->var, first->var };
+    second->body = clone_statement(second->body);
+    second->cond = clone_expression(second->cond);
+    second->incr = clone_expression(second->incr);
+    visit_statement_expressions(second->body, rename_variable, names);
+    visit_expression(second->cond, rename_variable, names);
+    visit_expression(second->incr, rename_variable, names);
+    second->var = first->var;
+    return 1;
+}
+
+void add_access(AccessSet *set, const char *name, Expression *index, int is_write) {
+    set->accesses = realloc(set->accesses, (set->count + 1) * sizeof(Access));
+    set->accesses[set->count].name = name;
+    set->accesses[set->count].index = index;
+    set->accesses[set->count].is_write = is_write;
+    set->count++;
+    if (is_write && is_global_name(set->prog, name) && !(set->func && is_local_name(set->func, name))) {
+        set->writes_global = 1;
+    }
+}
+
+void collect_access(Expression *expr, void *ctx) {
+    AccessSet *set = ctx;
+    Expression *target = written_target(expr);
+    if (target) {
+        const char *name = base_variable_name(target);
+        if (name) add_access(set, name, target->type == EXPR_ARRAY_ACCESS ? target->array_access.index : NULL, 1);
+    }
+    switch (expr->type) {
+        case EXPR_VARIABLE:
+            add_access(set, expr->var_name, NULL, 0);
+            break;
+        case EXPR_ARRAY_ACCESS:
+            add_access(set, expr->array_access.array_name, expr->array_access.index, 0);
+            break;
+        case EXPR_SLICE:
+            add_access(set, expr->slice.array_name, NULL, 0);
+            break;
+        case EXPR_CALL:
+            if (find_function(set->prog, expr->call.func_name)) set->calls_functions = 1;
+            break;
+        default:
+            break;
+    }
+}
+
+void collect_decl(Statement *stmt, void *ctx) {
+    AccessSet *set = ctx;
+    if (stmt->type == STMT_VAR_DECL) add_access(set, stmt->var_decl.var.name, NULL, 1);
+    if (stmt->type == STMT_FOR_IN) add_access(set, stmt->for_in.var.name, NULL, 1);
+}
+
+void collect_accesses(FusionContext *ctx, Statement *body, AccessSet *set) {
+    AccessSet empty = { ctx->prog, ctx->func, NULL, 0, 0, 0 };
+    *set = empty;
+    visit_statement_expressions(body, collect_access, set);
+    visit_statements(body, collect_decl, set);
+}
+
+// Every use of name in set is an element access at exactly the loop variable
+int only_same_iteration(AccessSet *set, const char *name, const char *var) {
+    for (int i = 0; i < set->count; i++) {
+        Access *access = &set->accesses[i];
+        if (strcmp(access->name, name) != 0) continue;
+        if (!access->index || access->index->type != EXPR_VARIABLE || strcmp(access->index->var_name, var) != 0) return 0;
+    }
+    return 1;
+}
+
+int uses_name(AccessSet *set, const char *name) {
+    for (int i = 0; i < set->count; i++) {
+        if (strcmp(set->accesses[i].name, name) == 0) return 1;
+    }
+    return 0;
+}
+
+// A temporary declared at the top of the body before any other use of it
+int declares_private(Statement *body, const char *name) {
+    if (body->type != STMT_BLOCK) return 0;
+    for (int i = 0; i < body->block.stmt_count; i++) {
+        Statement *stmt = body->block.statements[i];
+        if (stmt->type == STMT_VAR_DECL && strcmp(stmt->var_decl.var.name, name) == 0) {
+            return !stmt->var_decl.initializer || !expression_mentions(stmt->var_decl.initializer, name);
+        }
+        if (statement_mentions(stmt, name)) return 0;
+    }
+    return 0;
+}
+
+// Check that nothing a body writes is used by the other body in a different iteration
+int writes_are_independent(FusionLoop *loop, AccessSet *writer, FusionLoop *other_loop, AccessSet *other) {
+    const char *var = loop->var;
+    for (int i = 0; i < writer->count; i++) {
+        Access *access = &writer->accesses[i];
+        if (!access->is_write || !uses_name(other, access->name)) continue;
+        // Each iteration of both loops starts the temporary afresh
+        if (declares_private(loop->body, access->name) && declares_private(other_loop->body, access->name)) continue;
+        if (!only_same_iteration(writer, access->name, var) || !only_same_iteration(other, access->name, var)) return 0;
+    }
+    // Program functions called by one body may read what the other writes
+    if (writer->writes_global && other->calls_functions) return 0;
+    return 1;
+}
+
+int bodies_are_independent(FusionContext *ctx, FusionLoop *first, FusionLoop *second) {
+    AccessSet a, b;
+    collect_accesses(ctx, first->body, &a);
+    collect_accesses(ctx, second->body, &b);
+    int independent = writes_are_independent(first, &a, second, &b) && writes_are_independent(second, &b, first, &a);
+    free(a.accesses);
+    free(b.accesses);
+    return independent;
+}
+
+// Both loops run the same iterations and fusing them keeps every dependence
+int can_fuse(FusionContext *ctx, FusionLoop *first, FusionLoop *second) {
+    if (!unify_loop_variables(first, second)) return 0;
+    if (!expressions_equal(first->start, second->start) || !expressions_equal(first->cond, second->cond) ||
+        !expressions_equal(first->incr, second->incr)) {
+        return 0;
+    }
+
+    if (first->cond->type != EXPR_BINARY) return 0;
+
+    Statement *both = make_block();
+    block_append(both, first->body);
+    block_append(both, second->body);
+    int ok = !expression_has_side_effects(ctx->prog, first->start) &&
+             !expression_has_side_effects(ctx->prog, first->cond) &&
+             !statement_has_impure_calls(ctx->prog, both) &&
+             !(statement_has_print(first->body) && statement_has_print(second->body)) &&
+             expression_is_invariant(ctx->prog, first->start, both) &&
+             bodies_are_independent(ctx, first, second);
+    // The condition may only change through the loop variable
+    Expression *sides[2] = { first->cond->binary.left, first->cond->binary.right };
+    for (int i = 0; ok && i < 2; i++) {
+        if (sides[i]->type == EXPR_VARIABLE && strcmp(sides[i]->var_name, first->var) == 0) continue;
+        ok = expression_is_invariant(ctx->prog, sides[i], both) && !expression_mentions(sides[i], first->var);
+    }
+    free(both->block.statements);
+    free(both);
+    return ok;
+}
+
+void append_body(Statement *block, Statement *body) {
+    if (body->type != STMT_BLOCK) {
+        block_append(block, body);
+        return;
+    }
+    for (int i = 0; i < body->block.stmt_count; i++) {
+        block_append(block, body->block.statements[i]);
+    }
+}
+
+void remove_statements(Statement *block, int at, int count) {
+    memmove(&block->block.statements[at], &block->block.statements[at + count],
+            (block->block.stmt_count - at - count) * sizeof(Statement*));
+    block->block.stmt_count -= count;
+}
+
+// Fuse adjacent loops in a block, chaining as long as the next loop matches
+void fuse_block(FusionContext *ctx, Statement *block) {
+    for (int i = 0; i < block->block.stmt_count; i++) {
+        FusionLoop first;
+        if (!match_fusion_loop(block, i, &first)) continue;
+        Statement *loop = block->block.statements[i];
+        int next = i + (loop->type == STMT_WHILE ? 2 : 1);
+
+        FusionLoop second;
+        while (next < block->block.stmt_count && block->block.statements[next]->type == loop->type &&
+               match_fusion_loop(block, next, &second) && can_fuse(ctx, &first, &second)) {
+            Statement *fused = make_block();
+            append_body(fused, first.body);
+            append_body(fused, second.body);
+            first.body = fused;
+            if (loop->type == STMT_FOR) {
+                loop->for_stmt.body = fused;
+                remove_statements(block, next, 1);
+            } else {
+                Statement *body = make_block();
+                append_body(body, fused);
+                block_append(body, make_expression_statement(first.incr));
+                loop->while_stmt.body = body;
+                remove_statements(block, next - 1, 2);
+            }
+        }
+    }
+}
+
+Statement *fuse_loop_statement(Statement *stmt, void *ctx) {
+    if (stmt->type == STMT_BLOCK) fuse_block(ctx, stmt);
+    return stmt;
+}
+
+// Fuse adjacent counted loops in every function
+void fuse_loops(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        FusionContext ctx = { prog, prog->functions[i] };
+        prog->functions[i]->body = transform_statements(prog->functions[i]->body, fuse_loop_statement, &ctx);
+    }
+}
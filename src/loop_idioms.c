@@ -0,0 +1,554 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "../include/optimizer.h"
+
+// Loop idiom recognition. Runs on the for-in loops produced by
+// lower_range_loops and replaces whole loops with builtins that run in C:
+//     for v in it: acc = acc + e          ->  acc = acc + sum(e for v in it)
+//     for v in it: if c: acc = acc + e    ->  acc = acc + sum(e for v in it if c)
+//     for v in it: acc = acc * e          ->  acc = acc * math.prod(e for v in it)
+//     for v in it: if e < acc: acc = e    ->  acc = min(acc, min(e for v in it))
+//     for v in it: if c: return r         ->  if any(c for v in it): return r
+//     for v in range(a, b): if A[v] == k: return v
+//                                         ->  if k in A[a:b]: return A.index(k, a, b)
+// A sum over range(a, b) of a polynomial of degree <= 2 in v becomes its
+// closed form. Only int accumulators are reduced, and sum() and math.prod()
+// are typed as int, so lower_integer_semantics wraps the reduced value like
+// any other int arithmetic. Sums and products are exact modulo 2^32, so one
+// wrap of the result gives what the wrapping C loop computes.
+
+typedef struct {
+    Program *prog;
+    Function *func;
+} IdiomContext;
+
+// Strip blocks that hold a single statement; NULL if there is not exactly one
+Statement *single_statement(Statement *stmt) {
+    while (stmt && stmt->type == STMT_BLOCK) {
+        if (stmt->block.stmt_count != 1) return NULL;
+        stmt = stmt->block.statements[0];
+    }
+    return stmt;
+}
+
+int int_literal_value(Expression *expr, long long *value) {
+    if (!expr || expr->type != EXPR_LITERAL || expr->literal.lit_type != TYPE_INT) return 0;
+    *value = expr->literal.int_val;
+    return 1;
+}
+
+Expression *make_long_literal(long long value) {
+    if (value < INT_MIN || value > INT_MAX) return NULL;
+    return make_int_literal((int)value);
+}
+
+// Split an expression into base + constant (base is NULL for a literal)
+Expression *split_offset(Expression *expr, long long *offset) {
+    long long value;
+    if (int_literal_value(expr, &value)) {
+        *offset = value;
+        return NULL;
+    }
+    if (expr->type == EXPR_BINARY && (expr->binary.op == OP_ADD || expr->binary.op == OP_SUB) &&
+        int_literal_value(expr->binary.right, &value)) {
+        Expression *base = split_offset(expr->binary.left, offset);
+        *offset += expr->binary.op == OP_ADD ? value : -value;
+        return base;
+    }
+    if (expr->type == EXPR_BINARY && expr->binary.op == OP_ADD && int_literal_value(expr->binary.left, &value)) {
+        Expression *base = split_offset(expr->binary.right, offset);
+        *offset += value;
+        return base;
+    }
+    *offset = 0;
+    return expr;
+}
+
+Expression *join_offset(Expression *base, long long offset) {
+    if (!base) return make_long_literal(offset);
+    if (offset == 0) return base;
+    if (offset > 0) return make_binary(OP_ADD, base, make_long_literal(offset));
+    return make_binary(OP_SUB, base, make_long_literal(-offset));
+}
+
+// Arithmetic on expressions that folds constants; NULL stands for zero
+Expression *fold_add(Expression *a, Expression *b) {
+    long long x, y;
+    if (!a) return b;
+    if (!b) return a;
+    Expression *base_a = split_offset(a, &x);
+    Expression *base_b = split_offset(b, &y);
+    if ((!base_a || !base_b) && make_long_literal(x + y)) return join_offset(base_a ? base_a : base_b, x + y);
+    return make_binary(OP_ADD, a, b);
+}
+
+Expression *fold_negate(Expression *a) {
+    long long x;
+    if (!a) return NULL;
+    if (int_literal_value(a, &x) && make_long_literal(-x)) return make_long_literal(-x);
+    Expression *expr = create_expression();
+    expr->type = EXPR_UNARY;
+    expr->unary.op = OP_NEGATE;
+    expr->unary.expr = a;
+    return expr;
+}
+
+Expression *fold_sub(Expression *a, Expression *b) {
+    long long x, y;
+    if (!b) return a;
+    if (!a) return fold_negate(b);
+    Expression *base_a = split_offset(a, &x);
+    Expression *base_b = split_offset(b, &y);
+    if (!make_long_literal(x - y)) return make_binary(OP_SUB, a, b);
+    if (!base_b) return join_offset(base_a, x - y);
+    if (base_a && expressions_equal(base_a, base_b)) return make_long_literal(x - y);
+    return make_binary(OP_SUB, a, b);
+}
+
+Expression *fold_mul(Expression *a, Expression *b) {
+    long long x, y;
+    if (!a || !b) return NULL;
+    if (int_literal_value(a, &x) && x == 1) return b;
+    if (int_literal_value(b, &y) && y == 1) return a;
+    if (int_literal_value(a, &x) && int_literal_value(b, &y)) {
+        if (x == 0 || y == 0) return NULL;
+        if (llabs(x) <= INT_MAX && llabs(y) <= INT_MAX && make_long_literal(x * y)) {
+            return make_long_literal(x * y);
+        }
+    }
+    return make_binary(OP_MUL, a, b);
+}
+
+// Exact division: the dividend is always a multiple of the divisor
+Expression *fold_exact_div(Expression *a, int divisor) {
+    long long x;
+    if (!a) return NULL;
+    if (int_literal_value(a, &x)) return make_long_literal(x / divisor);
+    return make_binary(OP_FLOOR_DIV, a, make_int_literal(divisor));
+}
+
+// Coefficients of c0 + c1*v + c2*v*v; NULL coefficients are zero
+typedef struct {
+    Expression *coef[3];
+} Polynomial;
+
+int polynomial_of(Expression *expr, const char *var, Polynomial *poly) {
+    poly->coef[0] = poly->coef[1] = poly->coef[2] = NULL;
+    if (!expression_mentions(expr, var)) {
+        poly->coef[0] = clone_expression(expr);
+        return 1;
+    }
+    if (expr->type == EXPR_VARIABLE) {
+        poly->coef[1] = make_int_literal(1);
+        return 1;
+    }
+    if (expr->type == EXPR_UNARY && expr->unary.op == OP_NEGATE) {
+        if (!polynomial_of(expr->unary.expr, var, poly)) return 0;
+        for (int i = 0; i < 3; i++) poly->coef[i] = fold_negate(poly->coef[i]);
+        return 1;
+    }
+    if (expr->type != EXPR_BINARY) return 0;
+
+    Polynomial left, right;
+    if (!polynomial_of(expr->binary.left, var, &left) || !polynomial_of(expr->binary.right, var, &right)) {
+        return 0;
+    }
+    switch (expr->binary.op) {
+        case OP_ADD:
+            for (int i = 0; i < 3; i++) poly->coef[i] = fold_add(left.coef[i], right.coef[i]);
+            return 1;
+        case OP_SUB:
+            for (int i = 0; i < 3; i++) poly->coef[i] = fold_sub(left.coef[i], right.coef[i]);
+            return 1;
+        case OP_MUL:
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    if (!left.coef[i] || !right.coef[j]) continue;
+                    if (i + j > 2) return 0;
+                    poly->coef[i + j] = fold_add(poly->coef[i + j],
+                                                 fold_mul(clone_expression(left.coef[i]),
+                                                          clone_expression(right.coef[j])));
+                }
+            }
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Sum of v*v for v in range(0, x): (x - 1) * x * (2x - 1) / 6
+Expression *sum_of_squares_below(Expression *x) {
+    Expression *twice = fold_mul(make_int_literal(2), clone_expression(x));
+    Expression *product = fold_mul(fold_mul(fold_sub(clone_expression(x), make_int_literal(1)),
+                                            clone_expression(x)),
+                                   fold_sub(twice, make_int_literal(1)));
+    return fold_exact_div(product, 6);
+}
+
+// Closed form of sum(poly(v) for v in range(a, b)), assuming a <= b
+Expression *closed_form_sum(Polynomial *poly, Expression *a, Expression *b) {
+    Expression *count = fold_sub(clone_expression(b), clone_expression(a));
+    Expression *total = fold_mul(poly->coef[0], count);
+
+    if (poly->coef[1]) {
+        // (a + b - 1) * (b - a) / 2
+        Expression *pairs = fold_mul(fold_sub(fold_add(clone_expression(a), clone_expression(b)), make_int_literal(1)),
+                                     fold_sub(clone_expression(b), clone_expression(a)));
+        total = fold_add(total, fold_mul(poly->coef[1], fold_exact_div(pairs, 2)));
+    }
+    if (poly->coef[2]) {
+        Expression *squares = fold_sub(sum_of_squares_below(b), sum_of_squares_below(a));
+        total = fold_add(total, fold_mul(poly->coef[2], squares));
+    }
+    return total ? total : make_int_literal(0);
+}
+
+// Condition under which an iterable yields at least one item.
+// Returns NULL with *known set to 1 or 0 when the answer is known statically.
+Expression *nonempty_condition(IdiomContext *ctx, Expression *iterable, int *known) {
+    long long start = 0, stop, step = 1;
+    *known = -1;
+
+    if (iterable->type == EXPR_VARIABLE) {
+        int size = array_size_of(ctx->prog, ctx->func, iterable->var_name);
+        if (size > 0) {
+            *known = 1;
+            return NULL;
+        }
+        Expression *args[1] = { make_variable(iterable->var_name) };
+        return make_binary(OP_GT, make_call("len", args, 1), make_int_literal(0));
+    }
+
+    Expression *lo, *hi;
+    if (iterable->type == EXPR_SLICE) {
+        lo = iterable->slice.start;
+        hi = iterable->slice.stop;
+        // Slice starts are never negative, so max(n, 0) > lo is just n > lo
+        if (hi->type == EXPR_CALL && strcmp(hi->call.func_name, "max") == 0 && hi->call.arg_count == 2) {
+            hi = hi->call.args[0];
+        }
+    } else if (iterable->type == EXPR_CALL && strcmp(iterable->call.func_name, "range") == 0) {
+        lo = iterable->call.args[0];
+        hi = iterable->call.args[1];
+        if (iterable->call.arg_count > 2 && !int_literal_value(iterable->call.args[2], &step)) return NULL;
+    } else {
+        return NULL;
+    }
+
+    if ((!lo || int_literal_value(lo, &start)) && int_literal_value(hi, &stop)) {
+        *known = step > 0 ? stop > start : stop < start;
+        return NULL;
+    }
+    // hi > lo, with constant offsets moved to the right (n + 1 > 1 becomes n > 0)
+    long long hi_offset, lo_offset = 0;
+    Expression *hi_base = split_offset(hi, &hi_offset);
+    Expression *lo_base = lo ? split_offset(lo, &lo_offset) : NULL;
+    BinaryOpType op = step > 0 ? OP_GT : OP_LT;
+    if (hi_base && !lo_base && make_long_literal(lo_offset - hi_offset)) {
+        return make_binary(op, clone_expression(hi_base), make_long_literal(lo_offset - hi_offset));
+    }
+    Expression *first = lo ? clone_expression(lo) : make_int_literal(0);
+    return make_binary(op, clone_expression(hi), first);
+}
+
+// Guard a statement with the non-emptiness of the loop's iterable
+Statement *guard_nonempty(IdiomContext *ctx, Expression *iterable, Statement *stmt) {
+    int known;
+    Expression *cond = nonempty_condition(ctx, iterable, &known);
+    if (known == 1) return stmt;
+    if (known == 0) return make_block();
+    if (!cond) return NULL;
+
+    Statement *guard = create_statement();
+    guard->type = STMT_IF;
+    guard->if_stmt.condition = cond;
+    guard->if_stmt.then_branch = stmt;
+    guard->if_stmt.else_branch = NULL;
+    return guard;
+}
+
+// Build (element for var in iterable if condition); a bare loop variable
+// over an unfiltered iterable is just the iterable
+Expression *make_generator(Expression *element, Variable *var, Expression *iterable, Expression *condition) {
+    if (!condition && element->type == EXPR_VARIABLE && strcmp(element->var_name, var->name) == 0) {
+        return clone_expression(iterable);
+    }
+    Expression *expr = create_expression();
+    expr->type = EXPR_GENERATOR;
+    expr->generator.element = clone_expression(element);
+    expr->generator.var = *var;
+    expr->generator.var.name = strdup(var->name);
+    expr->generator.var.struct_name = var->struct_name ? strdup(var->struct_name) : NULL;
+    expr->generator.iterable = clone_expression(iterable);
+    expr->generator.condition = clone_expression(condition);
+    return expr;
+}
+
+Expression *make_unary_call(const char *name, Expression *arg) {
+    Expression *args[1] = { arg };
+    return make_call(name, args, 1);
+}
+
+Statement *make_assignment(const char *name, Expression *value) {
+    return make_expression_statement(make_binary(OP_ASSIGN, make_variable(name), value));
+}
+
+// The accumulator must be a scalar int local so the rewrite stays in the function's scope
+int is_int_accumulator(IdiomContext *ctx, const char *name, const char *loop_var) {
+    Variable *var = lookup_local(ctx->func, name);
+    return var && var->type == TYPE_INT && !var->is_array && !var->struct_name && strcmp(name, loop_var) != 0;
+}
+
+// Check if a call is one of the reductions this pass emits (only over ints)
+int is_int_reduction(const char *name) {
+    return strcmp(name, "sum") == 0 || strcmp(name, "math.prod") == 0;
+}
+
+// Operand of an idiom: evaluated once per item, so it must have no side effects
+int is_idiom_operand(IdiomContext *ctx, Expression *expr, const char *acc) {
+    return !expression_has_side_effects(ctx->prog, expr) && !(acc && expression_mentions(expr, acc)) &&
+           expression_is_integer(ctx->prog, ctx->func, expr);
+}
+
+// Match acc = acc + e, acc = e + acc, acc = acc - e, acc = acc * e, acc = e * acc, acc++ and ++acc
+int match_accumulate(Expression *expr, const char **acc, BinaryOpType *op, Expression **value) {
+    if (expr->type == EXPR_UNARY && (expr->unary.op == OP_POST_INC || expr->unary.op == OP_PRE_INC) &&
+        expr->unary.expr->type == EXPR_VARIABLE) {
+        *acc = expr->unary.expr->var_name;
+        *op = OP_ADD;
+        *value = make_int_literal(1);
+        return 1;
+    }
+    if (expr->type != EXPR_BINARY || expr->binary.op != OP_ASSIGN ||
+        expr->binary.left->type != EXPR_VARIABLE || expr->binary.right->type != EXPR_BINARY) {
+        return 0;
+    }
+
+    const char *name = expr->binary.left->var_name;
+    Expression *update = expr->binary.right;
+    *op = update->binary.op;
+    if (*op != OP_ADD && *op != OP_SUB && *op != OP_MUL) return 0;
+
+    Expression *left = update->binary.left;
+    Expression *right = update->binary.right;
+    if (left->type == EXPR_VARIABLE && strcmp(left->var_name, name) == 0) {
+        *value = right;
+    } else if (*op != OP_SUB && right->type == EXPR_VARIABLE && strcmp(right->var_name, name) == 0) {
+        *value = left;
+    } else {
+        return 0;
+    }
+    *acc = name;
+    return 1;
+}
+
+// acc = acc + e / acc = acc * e over the loop, optionally filtered by a condition
+Statement *accumulate_idiom(IdiomContext *ctx, Statement *loop, Expression *filter, Statement *update) {
+    const char *var = loop->for_in.var.name;
+    Expression *iterable = loop->for_in.iterable;
+    const char *acc;
+    BinaryOpType op;
+    Expression *value;
+
+    if (!update || update->type != STMT_EXPR || !match_accumulate(update->expr, &acc, &op, &value)) return NULL;
+    if (!is_int_accumulator(ctx, acc, var) || !is_idiom_operand(ctx, value, acc)) return NULL;
+    if (filter && (expression_has_side_effects(ctx->prog, filter) || expression_mentions(filter, acc))) return NULL;
+
+    Polynomial poly;
+    if (!filter && op != OP_MUL && iterable->type == EXPR_CALL && strcmp(iterable->call.func_name, "range") == 0 &&
+        iterable->call.arg_count == 2 && polynomial_of(value, var, &poly)) {
+        Statement *closed = make_assignment(acc, make_binary(op, make_variable(acc),
+                                            closed_form_sum(&poly, iterable->call.args[0], iterable->call.args[1])));
+        return guard_nonempty(ctx, iterable, closed);
+    }
+
+    Expression *combined = make_unary_call(op == OP_MUL ? "math.prod" : "sum", make_generator(value, &loop->for_in.var, iterable, filter));
+    return make_assignment(acc, make_binary(op, make_variable(acc), combined));
+}
+
+// if (e < acc) acc = e; and friends become min/max
+Statement *extremum_idiom(IdiomContext *ctx, Statement *loop, Statement *body) {
+    const char *var = loop->for_in.var.name;
+    if (body->type != STMT_IF || body->if_stmt.else_branch) return NULL;
+
+    Statement *assign = single_statement(body->if_stmt.then_branch);
+    if (!assign || assign->type != STMT_EXPR || assign->expr->type != EXPR_BINARY ||
+        assign->expr->binary.op != OP_ASSIGN || assign->expr->binary.left->type != EXPR_VARIABLE) {
+        return NULL;
+    }
+    const char *acc = assign->expr->binary.left->var_name;
+    Expression *value = assign->expr->binary.right;
+
+    Expression *cond = body->if_stmt.condition;
+    if (cond->type != EXPR_BINARY) return NULL;
+    BinaryOpType op = cond->binary.op;
+    if (op != OP_LT && op != OP_LTE && op != OP_GT && op != OP_GTE) return NULL;
+    if (cond->binary.right->type == EXPR_VARIABLE && strcmp(cond->binary.right->var_name, acc) == 0 &&
+        expressions_equal(cond->binary.left, value)) {
+        // e < acc
+    } else if (cond->binary.left->type == EXPR_VARIABLE && strcmp(cond->binary.left->var_name, acc) == 0 &&
+               expressions_equal(cond->binary.right, value)) {
+        op = mirror_comparison(op);
+    } else {
+        return NULL;
+    }
+    if (!is_int_accumulator(ctx, acc, var) || !is_idiom_operand(ctx, value, acc)) return NULL;
+
+    // Ties do not matter for integers, so < and <= both select the minimum
+    const char *name = op == OP_LT || op == OP_LTE ? "min" : "max";
+    Expression *args[2] = { make_variable(acc),
+                            make_unary_call(name, make_generator(value, &loop->for_in.var, loop->for_in.iterable, NULL)) };
+    return guard_nonempty(ctx, loop->for_in.iterable, make_assignment(acc, make_call(name, args, 2)));
+}
+
+// Statements run once when the search succeeds: return r, or assignments followed by break
+int match_search_exit(Statement *then_branch, const char *var, Statement **action) {
+    Statement *single = single_statement(then_branch);
+    if (single && single->type == STMT_RETURN) {
+        *action = single;
+        return 1;
+    }
+    if (!then_branch || then_branch->type != STMT_BLOCK || then_branch->block.stmt_count < 2) return 0;
+
+    int count = then_branch->block.stmt_count;
+    if (then_branch->block.statements[count - 1]->type != STMT_BREAK) return 0;
+    Statement *block = make_block();
+    for (int i = 0; i < count - 1; i++) {
+        Statement *stmt = then_branch->block.statements[i];
+        if (stmt->type != STMT_EXPR || stmt->expr->type != EXPR_BINARY || stmt->expr->binary.op != OP_ASSIGN ||
+            stmt->expr->binary.left->type != EXPR_VARIABLE ||
+            strcmp(stmt->expr->binary.left->var_name, var) == 0) {
+            return 0;
+        }
+        block_append(block, stmt);
+    }
+    *action = block;
+    return 1;
+}
+
+// Replace the loop variable in the exit action with its value at the match
+typedef struct {
+    const char *var;
+    Expression *value;
+} VariableRewrite;
+
+void replace_variable(Expression *expr, void *ctx) {
+    VariableRewrite *rewrite = ctx;
+    if (expr->type == EXPR_VARIABLE && strcmp(expr->var_name, rewrite->var) == 0) {
+        *expr = *clone_expression(rewrite->value);
+    }
+}
+
+// for v in range(a, b): if A[v] == k: (exit using v)  ->  if k in A[a:b]: (exit using A.index(k, a, b))
+Statement *index_idiom(IdiomContext *ctx, Statement *loop, Expression *cond, Statement *action) {
+    const char *var = loop->for_in.var.name;
+    Expression *iterable = loop->for_in.iterable;
+    if (iterable->type != EXPR_CALL || strcmp(iterable->call.func_name, "range") != 0 ||
+        iterable->call.arg_count != 2) {
+        return NULL;
+    }
+    if (cond->type != EXPR_BINARY || cond->binary.op != OP_EQ) return NULL;
+
+    Expression *access = cond->binary.left;
+    Expression *key = cond->binary.right;
+    if (access->type != EXPR_ARRAY_ACCESS) {
+        access = cond->binary.right;
+        key = cond->binary.left;
+    }
+    if (access->type != EXPR_ARRAY_ACCESS || access->array_access.index->type != EXPR_VARIABLE ||
+        strcmp(access->array_access.index->var_name, var) != 0) {
+        return NULL;
+    }
+    const char *array = access->array_access.array_name;
+    int size = array_size_of(ctx->prog, ctx->func, array);
+    if (size < 0 || expression_mentions(key, var) || expression_has_side_effects(ctx->prog, key)) return NULL;
+
+    long long start, stop = -1;
+    Expression *lo = iterable->call.args[0];
+    Expression *hi = iterable->call.args[1];
+    if (!int_literal_value(lo, &start) || start < 0) return NULL;
+    int_literal_value(hi, &stop);
+    Expression *end = slice_stop(hi);
+    if (!end) return NULL;
+
+    char method[512];
+    snprintf(method, sizeof(method), "%s.index", array);
+    Expression *haystack;
+    Expression *index;
+    if (start == 0 && size > 0 && stop == size) {
+        haystack = make_variable(array);
+        index = make_unary_call(method, clone_expression(key));
+    } else {
+        haystack = create_expression();
+        haystack->type = EXPR_SLICE;
+        haystack->slice.array_name = strdup(array);
+        haystack->slice.start = start == 0 ? NULL : clone_expression(lo);
+        haystack->slice.stop = end;
+        Expression *args[3] = { clone_expression(key), clone_expression(lo), clone_expression(end) };
+        index = make_call(method, args, 3);
+    }
+
+    VariableRewrite rewrite = { var, index };
+    visit_statement_expressions(action, replace_variable, &rewrite);
+
+    Statement *stmt = create_statement();
+    stmt->type = STMT_IF;
+    stmt->if_stmt.condition = make_binary(OP_IN, clone_expression(key), haystack);
+    stmt->if_stmt.then_branch = action;
+    stmt->if_stmt.else_branch = NULL;
+    return stmt;
+}
+
+// Early-exit search: if (c) { return r; } or if (c) { x = k; break; }
+Statement *search_idiom(IdiomContext *ctx, Statement *loop, Statement *body) {
+    const char *var = loop->for_in.var.name;
+    if (body->type != STMT_IF || body->if_stmt.else_branch) return NULL;
+
+    Expression *cond = body->if_stmt.condition;
+    Statement *action;
+    if (expression_has_side_effects(ctx->prog, cond)) return NULL;
+    if (!match_search_exit(body->if_stmt.then_branch, var, &action)) return NULL;
+
+    // The exit action runs after the loop, where the loop variable no longer exists
+    if (count_variable_reads(action, var) > 0 || statement_writes_variable(action, var)) {
+        return index_idiom(ctx, loop, cond, action);
+    }
+
+    Statement *stmt = create_statement();
+    stmt->type = STMT_IF;
+    stmt->if_stmt.condition = make_unary_call("any", make_generator(cond, &loop->for_in.var, loop->for_in.iterable, NULL));
+    stmt->if_stmt.then_branch = action;
+    stmt->if_stmt.else_branch = NULL;
+    return stmt;
+}
+
+Statement *recognize_loop_statement(Statement *stmt, void *ctx) {
+    IdiomContext *idioms = ctx;
+    if (stmt->type != STMT_FOR_IN || stmt->for_in.else_branch) return stmt;
+
+    Statement *body = single_statement(stmt->for_in.body);
+    if (!body) return stmt;
+
+    Statement *replacement = NULL;
+    if (body->type == STMT_EXPR) {
+        replacement = accumulate_idiom(idioms, stmt, NULL, body);
+    } else if (body->type == STMT_IF && !body->if_stmt.else_branch) {
+        replacement = extremum_idiom(idioms, stmt, body);
+        if (!replacement) {
+            replacement = accumulate_idiom(idioms, stmt, body->if_stmt.condition,
+                                           single_statement(body->if_stmt.then_branch));
+        }
+        if (!replacement) replacement = search_idiom(idioms, stmt, body);
+    }
+    return replacement ? replacement : stmt;
+}
+
+// Replace reduction and search loops in every function
+void recognize_loop_idioms(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        IdiomContext ctx = { prog, prog->functions[i] };
+        prog->functions[i]->body = transform_statements(prog->functions[i]->body, recognize_loop_statement, &ctx);
+    }
+}
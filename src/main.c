@@ -3,7 +3,9 @@
 #include <string.h>
 #include "../include/lexer.h"
 #include "../include/parser.h"
+#include "../include/linker.h"
 #include "../include/codegen.h"
+#include "../include/optimizer.h"
 
 // Read entire file into a string
 char *read_file(const char *filename) {
@@ -37,24 +39,84 @@ char *read_file(const char *filename) {
     return buffer;
 }
 
+// Add the local headers a file includes (#include "x.h", relative to the file)
+// as translation units of their own, for their structs, externs and prototypes
+void add_included_headers(const char *file, const char *input, const char ***files, int *count) {
+    for (const char *line = input; line; line = strchr(line, '\n')) {
+        while (*line == '\n' || *line == ' ' || *line == '\t') line++;
+        if (strncmp(line, "#include", 8) != 0) continue;
+        const char *open = strchr(line, '"');
+        const char *end = strchr(line, '\n');
+        if (!open || (end && open > end)) continue;  // <stdio.h> and friends
+        const char *close = strchr(open + 1, '"');
+        if (!close) continue;
+
+        const char *slash = strrchr(file, '/');
+        int dir_length = slash ? (int)(slash - file + 1) : 0;
+        char *header = malloc(dir_length + (close - open) + 1);
+        sprintf(header, "%.*s%.*s", dir_length, file, (int)(close - open - 1), open + 1);
+        int known = 0;
+        for (int i = 0; i < *count; i++) {
+            if (strcmp((*files)[i], header) == 0) known = 1;
+        }
+        if (known) {
+            free(header);
+            continue;
+        }
+        *files = realloc(*files, (*count + 1) * sizeof(char*));
+        (*files)[(*count)++] = header;
+    }
+}
+
 int main(int argc, char *argv[]) {
-    const char *input_file = NULL;
+    // Every input file is a translation unit of one program
+    const char **input_files = malloc(argc * sizeof(char*));
+    int input_count = 0;
     const char *output_file = "output.py";
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
             output_file = argv[++i];
-        } else if (input_file == NULL) {
-            input_file = argv[i];
+        } else if (strcmp(argv[i], "-O0") == 0) {
+            optimizer_options.enabled = 0;
+        } else if (strcmp(argv[i], "--memo-cache-size") == 0 && i + 1 < argc) {
+            // -1 keeps the cache unbounded, 0 turns memoization off
+            optimizer_options.memo_cache_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tabulate-max-size") == 0 && i + 1 < argc) {
+            // 0 turns bottom-up tabulation off
+            optimizer_options.tabulate_max_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--eval-budget") == 0 && i + 1 < argc) {
+            // 0 turns compile-time evaluation off
+            optimizer_options.eval_step_budget = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-clones") == 0 && i + 1 < argc) {
+            // 0 turns function specialization off
+            optimizer_options.max_clones = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--unswitch-growth") == 0 && i + 1 < argc) {
+            // 0 turns loop unswitching off
+            optimizer_options.unswitch_growth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            // Functions, globals and structs kept besides what main reaches
+            optimizer_options.exports = argv[++i];
+        } else if (strcmp(argv[i], "--profile-generate") == 0 && i + 1 < argc) {
+            // The generated program counts calls and loop iterations into this file
+            optimizer_options.profile_generate = argv[++i];
+        } else if (strcmp(argv[i], "--profile-use") == 0 && i + 1 < argc) {
+            // Counts from a --profile-generate run steer the optimizer to the hot paths
+            optimizer_options.profile_use = argv[++i];
+        } else if (strcmp(argv[i], "--cost-report") == 0) {
+            // Rank functions and loop nests of the output by estimated cost
+            optimizer_options.cost_report = 1;
+        } else if (argv[i][0] != '-') {
+            input_files[input_count++] = argv[i];
         } else {
             fprintf(stderr, "Error: Unexpected argument '%s'\n", argv[i]);
             return 1;
         }
     }
     
-    if (input_file == NULL) {
-        printf("Usage: %s <input_file.c> [-o output_file.py]\n", argv[0]);
+    if (input_count == 0) {
+        printf("Usage: %s <input_file.c> [more_input.c ...] [-o output_file.py] [-O0] [--memo-cache-size N] [--tabulate-max-size N] [--eval-budget N] [--max-clones N] [--unswitch-growth N] [--export name,...] [--profile-generate file] [--profile-use file] [--cost-report]\n", argv[0]);
         printf("Using built-in example code...\n");
         
         // Use a built-in example if no input file is provided
@@ -88,6 +150,9 @@ int main(int argc, char *argv[]) {
         // Parse tokens
         Program *program = parse(tokens, token_count);
         
+        // Optimize the AST
+        optimize_program(program);
+        
         // Generate Python code
         generate_code(program, output_file);
         
@@ -101,30 +166,65 @@ int main(int argc, char *argv[]) {
         return 0;
     }
     
-    // Read input file
-    char *input = read_file(input_file);
-    if (!input) {
+    int file_count = input_count;
+    char **inputs = NULL;
+    Token **unit_tokens = NULL;
+    int *token_counts = NULL;
+    Program **units = NULL;
+    for (int u = 0; u < file_count; u++) {
+        inputs = realloc(inputs, (u + 1) * sizeof(char*));
+        unit_tokens = realloc(unit_tokens, (u + 1) * sizeof(Token*));
+        token_counts = realloc(token_counts, (u + 1) * sizeof(int));
+        units = realloc(units, (u + 1) * sizeof(Program*));
+
+        // Read input file
+        inputs[u] = read_file(input_files[u]);
+        if (!inputs[u]) {
+            return 1;
+        }
+
+        printf("Processing file: %s\n", input_files[u]);
+        add_included_headers(input_files[u], inputs[u], &input_files, &file_count);
+
+        // Tokenize and parse each translation unit
+        token_counts[u] = 0;
+        unit_tokens[u] = lexer(inputs[u], &token_counts[u]);
+        units[u] = parse(unit_tokens[u], token_counts[u]);
+    }
+
+    // Resolve symbols across the units so the optimizer sees the whole program
+    Program *program = link_programs(units, input_files, file_count);
+    if (!program) {
         return 1;
     }
     
-    printf("Processing file: %s\n", input_file);
-    
-    // Tokenize input
-    int token_count = 0;
-    Token *tokens = lexer(input, &token_count);
-    
-    // Parse tokens
-    Program *program = parse(tokens, token_count);
+    // Optimize the AST
+    if (optimize_program(program) != 0) {
+        return 1;
+    }
+    if (optimizer_options.cost_report) {
+        report_costs(program, stdout);
+    }
     
     // Generate Python code
     generate_code(program, output_file);
     
     // Cleanup
-    free(input);
-    for (int i = 0; i < token_count; i++) {
-        free(tokens[i].value);
+    for (int u = 0; u < file_count; u++) {
+        free(inputs[u]);
+        for (int i = 0; i < token_counts[u]; i++) {
+            free(unit_tokens[u][i].value);
+        }
+        free(unit_tokens[u]);
+    }
+    free(inputs);
+    free(unit_tokens);
+    free(token_counts);
+    free(units);
+    for (int u = input_count; u < file_count; u++) {
+        free((char *)input_files[u]);
     }
-    free(tokens);
+    free(input_files);
     free_program(program);
     
     return 0;
@@ -0,0 +1,893 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Default settings; main.c overrides them from the command line
+OptimizerOptions optimizer_options = {
+    1,    // enabled
+    -1,   // memo_cache_size (unbounded)
+    4096, // tabulate_max_size
+    1000000, // eval_step_budget
+    4,    // max_clones
+    NULL, // exports
+    NULL, // profile_generate
+    NULL, // profile_use
+    64,   // unswitch_growth
+    0,    // cost_report
+};
+
+// Look up a function definition by name
+Function *find_function(Program *prog, const char *name) {
+    for (int i = 0; i < prog->function_count; i++) {
+        if (strcmp(prog->functions[i]->name, name) == 0) {
+            return prog->functions[i];
+        }
+    }
+    return NULL;
+}
+
+// Python builtins the optimizer itself emits; they have no side effects
+int is_pure_builtin(const char *name) {
+    static const char *builtins[] = { "range", "list", "len", "sum", "min", "max", "any", "math.prod" };
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+        if (strcmp(name, builtins[i]) == 0) return 1;
+    }
+    // Read-only list methods (a.index)
+    if (is_intrinsic(name) || is_bit_builtin(name) || strcmp(name, "''.join") == 0) return 1;
+    const char *method = strrchr(name, '.');
+    return method && strcmp(method, ".index") == 0;
+}
+
+// Check if a call has no side effects: a pure program function or a pure builtin
+int call_is_pure(Program *prog, const char *name) {
+    Function *callee = find_function(prog, name);
+    if (callee) return callee->is_pure;
+    return is_pure_builtin(name);
+}
+
+// Check if a name refers to a global variable
+int is_global_name(Program *prog, const char *name) {
+    for (int i = 0; i < prog->global_var_count; i++) {
+        if (strcmp(prog->global_vars[i].name, name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+typedef struct {
+    const char *name;
+    int found;
+} LocalSearch;
+
+void find_local_decl(Statement *stmt, void *ctx) {
+    LocalSearch *search = ctx;
+    if (stmt->type == STMT_VAR_DECL && strcmp(stmt->var_decl.var.name, search->name) == 0) {
+        search->found = 1;
+    }
+    if (stmt->type == STMT_FOR_IN && strcmp(stmt->for_in.var.name, search->name) == 0) {
+        search->found = 1;
+    }
+}
+
+// Check if a name is a parameter or is declared anywhere in the function body.
+// Python scopes locals to the whole function, so block nesting does not matter.
+int is_local_name(Function *func, const char *name) {
+    for (int i = 0; i < func->param_count; i++) {
+        if (strcmp(func->params[i].name, name) == 0) {
+            return 1;
+        }
+    }
+    LocalSearch search = { name, 0 };
+    visit_statements(func->body, find_local_decl, &search);
+    return search.found;
+}
+
+// Create an integer literal
+Expression *make_int_literal(int value) {
+    Expression *expr = create_expression();
+    expr->type = EXPR_LITERAL;
+    expr->literal.lit_type = TYPE_INT;
+    expr->literal.int_val = value;
+    return expr;
+}
+
+// Create a variable reference
+Expression *make_variable(const char *name) {
+    Expression *expr = create_expression();
+    expr->type = EXPR_VARIABLE;
+    expr->var_name = strdup(name);
+    return expr;
+}
+
+// Create a binary expression (OP_ASSIGN included)
+Expression *make_binary(BinaryOpType op, Expression *left, Expression *right) {
+    Expression *expr = create_expression();
+    expr->type = EXPR_BINARY;
+    expr->binary.op = op;
+    expr->binary.left = left;
+    expr->binary.right = right;
+    return expr;
+}
+
+// Create a function call with a copy of the argument array
+Expression *make_call(const char *name, Expression **args, int arg_count) {
+    Expression *expr = create_expression();
+    expr->type = EXPR_CALL;
+    expr->call.func_name = strdup(name);
+    expr->call.args = malloc((arg_count + 1) * sizeof(Expression*));
+    for (int i = 0; i < arg_count; i++) {
+        expr->call.args[i] = args[i];
+    }
+    expr->call.arg_count = arg_count;
+    return expr;
+}
+
+// Build a list display [elements...]
+Expression *make_list(Expression **elements, int count) {
+    Expression *expr = create_expression();
+    expr->type = EXPR_LIST;
+    expr->list.elements = malloc((count + 1) * sizeof(Expression*));
+    for (int i = 0; i < count; i++) {
+        expr->list.elements[i] = elements[i];
+    }
+    expr->list.count = count;
+    return expr;
+}
+
+// Build array[start:stop]; a NULL start is an open start
+Expression *make_slice(const char *array, Expression *start, Expression *stop) {
+    Expression *expr = create_expression();
+    expr->type = EXPR_SLICE;
+    expr->slice.array_name = strdup(array);
+    expr->slice.start = start;
+    expr->slice.stop = stop;
+    return expr;
+}
+
+// Add a constant to an expression, folding literals
+Expression *offset_expression(Expression *expr, int offset) {
+    if (offset == 0) return clone_expression(expr);
+    if (expr->type == EXPR_LITERAL && expr->literal.lit_type == TYPE_INT) {
+        return make_int_literal(expr->literal.int_val + offset);
+    }
+    // (e + c) + offset and (e - c) + offset fold into a single constant
+    if (expr->type == EXPR_BINARY && (expr->binary.op == OP_ADD || expr->binary.op == OP_SUB) &&
+        expr->binary.right->type == EXPR_LITERAL && expr->binary.right->literal.lit_type == TYPE_INT) {
+        int constant = expr->binary.right->literal.int_val;
+        return offset_expression(expr->binary.left, (expr->binary.op == OP_ADD ? constant : -constant) + offset);
+    }
+    if (offset > 0) return make_binary(OP_ADD, clone_expression(expr), make_int_literal(offset));
+    return make_binary(OP_SUB, clone_expression(expr), make_int_literal(-offset));
+}
+
+// Wrap an expression in an expression statement
+Statement *make_expression_statement(Expression *expr) {
+    Statement *stmt = create_statement();
+    stmt->type = STMT_EXPR;
+    stmt->expr = expr;
+    return stmt;
+}
+
+// Create an empty block
+Statement *make_block() {
+    Statement *stmt = create_statement();
+    stmt->type = STMT_BLOCK;
+    stmt->block.statements = malloc(sizeof(Statement*));
+    stmt->block.stmt_count = 0;
+    return stmt;
+}
+
+// Append a statement to a block
+void block_append(Statement *block, Statement *stmt) {
+    block->block.statements = realloc(block->block.statements,
+                                      (block->block.stmt_count + 1) * sizeof(Statement*));
+    block->block.statements[block->block.stmt_count++] = stmt;
+}
+
+// Check if control never falls off the end of a statement
+int statement_always_returns(Statement *stmt) {
+    if (!stmt) return 0;
+
+    switch (stmt->type) {
+        case STMT_RETURN:
+            return 1;
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                if (statement_always_returns(stmt->block.statements[i])) {
+                    return 1;
+                }
+            }
+            return 0;
+        case STMT_IF:
+            return stmt->if_stmt.else_branch &&
+                   statement_always_returns(stmt->if_stmt.then_branch) &&
+                   statement_always_returns(stmt->if_stmt.else_branch);
+        default:
+            return 0;
+    }
+}
+
+// Visit an expression and all of its subexpressions
+void visit_expression(Expression *expr, ExpressionVisitor visit, void *ctx) {
+    if (!expr) return;
+
+    visit(expr, ctx);
+    switch (expr->type) {
+        case EXPR_BINARY:
+            visit_expression(expr->binary.left, visit, ctx);
+            visit_expression(expr->binary.right, visit, ctx);
+            break;
+        case EXPR_UNARY:
+            visit_expression(expr->unary.expr, visit, ctx);
+            break;
+        case EXPR_CALL:
+            for (int i = 0; i < expr->call.arg_count; i++) {
+                visit_expression(expr->call.args[i], visit, ctx);
+            }
+            break;
+        case EXPR_ARRAY_ACCESS:
+            visit_expression(expr->array_access.index, visit, ctx);
+            break;
+        case EXPR_MEMBER_ACCESS:
+            visit_expression(expr->member_access.struct_expr, visit, ctx);
+            break;
+        case EXPR_SLICE:
+            visit_expression(expr->slice.start, visit, ctx);
+            visit_expression(expr->slice.stop, visit, ctx);
+            break;
+        case EXPR_GENERATOR:
+            visit_expression(expr->generator.iterable, visit, ctx);
+            visit_expression(expr->generator.element, visit, ctx);
+            visit_expression(expr->generator.condition, visit, ctx);
+            break;
+        case EXPR_LIST:
+            for (int i = 0; i < expr->list.count; i++) {
+                visit_expression(expr->list.elements[i], visit, ctx);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+typedef struct {
+    ExpressionVisitor visit;
+    void *ctx;
+} ExpressionWalk;
+
+void visit_own_expressions(Statement *stmt, void *ctx) {
+    ExpressionWalk *walk = ctx;
+    switch (stmt->type) {
+        case STMT_EXPR:
+            visit_expression(stmt->expr, walk->visit, walk->ctx);
+            break;
+        case STMT_VAR_DECL:
+            visit_expression(stmt->var_decl.initializer, walk->visit, walk->ctx);
+            break;
+        case STMT_IF:
+            visit_expression(stmt->if_stmt.condition, walk->visit, walk->ctx);
+            break;
+        case STMT_WHILE:
+            visit_expression(stmt->while_stmt.condition, walk->visit, walk->ctx);
+            break;
+        case STMT_FOR:
+            visit_expression(stmt->for_stmt.condition, walk->visit, walk->ctx);
+            visit_expression(stmt->for_stmt.increment, walk->visit, walk->ctx);
+            break;
+        case STMT_RETURN:
+            visit_expression(stmt->return_value, walk->visit, walk->ctx);
+            break;
+        case STMT_PRINT:
+            for (int i = 0; i < stmt->print.arg_count; i++) {
+                visit_expression(stmt->print.args[i], walk->visit, walk->ctx);
+            }
+            break;
+        case STMT_FOR_IN:
+            visit_expression(stmt->for_in.iterable, walk->visit, walk->ctx);
+            break;
+        default:
+            break;
+    }
+}
+
+// Visit every expression reachable from a statement, including nested statements
+void visit_statement_expressions(Statement *stmt, ExpressionVisitor visit, void *ctx) {
+    ExpressionWalk walk = { visit, ctx };
+    visit_statements(stmt, visit_own_expressions, &walk);
+}
+
+// Visit a statement and all of its nested statements
+void visit_statements(Statement *stmt, StatementVisitor visit, void *ctx) {
+    if (!stmt) return;
+
+    visit(stmt, ctx);
+    switch (stmt->type) {
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                visit_statements(stmt->block.statements[i], visit, ctx);
+            }
+            break;
+        case STMT_IF:
+            visit_statements(stmt->if_stmt.then_branch, visit, ctx);
+            visit_statements(stmt->if_stmt.else_branch, visit, ctx);
+            break;
+        case STMT_WHILE:
+            visit_statements(stmt->while_stmt.body, visit, ctx);
+            break;
+        case STMT_FOR:
+            visit_statements(stmt->for_stmt.initializer, visit, ctx);
+            visit_statements(stmt->for_stmt.body, visit, ctx);
+            break;
+        case STMT_FOR_IN:
+            visit_statements(stmt->for_in.body, visit, ctx);
+            visit_statements(stmt->for_in.else_branch, visit, ctx);
+            break;
+        default:
+            break;
+    }
+}
+
+// Rebuild a statement tree bottom-up: children are transformed first, then
+// transform is called on the statement itself and its result replaces it
+Statement *transform_statements(Statement *stmt, StatementTransform transform, void *ctx) {
+    if (!stmt) return NULL;
+
+    switch (stmt->type) {
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                stmt->block.statements[i] = transform_statements(stmt->block.statements[i], transform, ctx);
+            }
+            break;
+        case STMT_IF:
+            stmt->if_stmt.then_branch = transform_statements(stmt->if_stmt.then_branch, transform, ctx);
+            stmt->if_stmt.else_branch = transform_statements(stmt->if_stmt.else_branch, transform, ctx);
+            break;
+        case STMT_WHILE:
+            stmt->while_stmt.body = transform_statements(stmt->while_stmt.body, transform, ctx);
+            break;
+        case STMT_FOR:
+            stmt->for_stmt.body = transform_statements(stmt->for_stmt.body, transform, ctx);
+            break;
+        case STMT_FOR_IN:
+            stmt->for_in.body = transform_statements(stmt->for_in.body, transform, ctx);
+            stmt->for_in.else_branch = transform_statements(stmt->for_in.else_branch, transform, ctx);
+            break;
+        default:
+            break;
+    }
+    // A replacement keeps the source line and, for a loop, the profile count
+    int line = stmt->line;
+    long long profile_count = stmt->profile_count;
+    int was_loop = stmt->type == STMT_WHILE || stmt->type == STMT_FOR || stmt->type == STMT_FOR_IN;
+    Statement *result = transform(stmt, ctx);
+    if (result && result != stmt) {
+        if (result->line == 0) result->line = line;
+        int is_loop = result->type == STMT_WHILE || result->type == STMT_FOR || result->type == STMT_FOR_IN;
+        if (was_loop && is_loop && result->profile_count < 0) result->profile_count = profile_count;
+    }
+    return result;
+}
+
+typedef struct {
+    const char *name;
+    int found;
+} MentionScan;
+
+void find_mention(Expression *expr, void *ctx) {
+    MentionScan *scan = ctx;
+    if (expr->type == EXPR_VARIABLE && strcmp(expr->var_name, scan->name) == 0) scan->found = 1;
+}
+
+// Check if an expression mentions a variable
+int expression_mentions(Expression *expr, const char *name) {
+    MentionScan scan = { name, 0 };
+    visit_expression(expr, find_mention, &scan);
+    return scan.found;
+}
+
+// Check if two expressions are structurally identical
+int expressions_equal(Expression *a, Expression *b) {
+    if (!a || !b) return a == b;
+    if (a->type != b->type) return 0;
+
+    switch (a->type) {
+        case EXPR_VARIABLE:
+            return strcmp(a->var_name, b->var_name) == 0;
+        case EXPR_LITERAL:
+            if (a->literal.lit_type != b->literal.lit_type) return 0;
+            switch (a->literal.lit_type) {
+                case TYPE_INT: return a->literal.int_val == b->literal.int_val;
+                case TYPE_FLOAT: return a->literal.float_val == b->literal.float_val;
+                case TYPE_CHAR: return a->literal.char_val == b->literal.char_val;
+                case TYPE_STRING: return strcmp(a->literal.string_val, b->literal.string_val) == 0;
+                default: return 0;
+            }
+        case EXPR_BINARY:
+            return a->binary.op == b->binary.op && expressions_equal(a->binary.left, b->binary.left) &&
+                   expressions_equal(a->binary.right, b->binary.right);
+        case EXPR_UNARY:
+            return a->unary.op == b->unary.op && expressions_equal(a->unary.expr, b->unary.expr);
+        case EXPR_CALL:
+            if (strcmp(a->call.func_name, b->call.func_name) != 0 || a->call.arg_count != b->call.arg_count) {
+                return 0;
+            }
+            for (int i = 0; i < a->call.arg_count; i++) {
+                if (!expressions_equal(a->call.args[i], b->call.args[i])) return 0;
+            }
+            return 1;
+        case EXPR_ARRAY_ACCESS:
+            return strcmp(a->array_access.array_name, b->array_access.array_name) == 0 &&
+                   expressions_equal(a->array_access.index, b->array_access.index);
+        case EXPR_MEMBER_ACCESS:
+            return strcmp(a->member_access.member_name, b->member_access.member_name) == 0 &&
+                   expressions_equal(a->member_access.struct_expr, b->member_access.struct_expr);
+        case EXPR_SLICE:
+            return strcmp(a->slice.array_name, b->slice.array_name) == 0 &&
+                   expressions_equal(a->slice.start, b->slice.start) &&
+                   expressions_equal(a->slice.stop, b->slice.stop);
+        case EXPR_LIST:
+            if (a->list.count != b->list.count) return 0;
+            for (int i = 0; i < a->list.count; i++) {
+                if (!expressions_equal(a->list.elements[i], b->list.elements[i])) return 0;
+            }
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Return the target of an assignment or increment/decrement, or NULL
+Expression *written_target(Expression *expr) {
+    if (expr->type == EXPR_BINARY && expr->binary.op == OP_ASSIGN) {
+        return expr->binary.left;
+    }
+    if (expr->type == EXPR_UNARY &&
+        (expr->unary.op == OP_PRE_INC || expr->unary.op == OP_PRE_DEC ||
+         expr->unary.op == OP_POST_INC || expr->unary.op == OP_POST_DEC)) {
+        return expr->unary.expr;
+    }
+    return NULL;
+}
+
+// Name of the variable that an lvalue ultimately refers to (a for a[i], p for p.x)
+const char *base_variable_name(Expression *target) {
+    switch (target->type) {
+        case EXPR_VARIABLE: return target->var_name;
+        case EXPR_ARRAY_ACCESS: return target->array_access.array_name;
+        case EXPR_SLICE: return target->slice.array_name;
+        case EXPR_MEMBER_ACCESS: return base_variable_name(target->member_access.struct_expr);
+        default: return NULL;
+    }
+}
+
+typedef struct {
+    const char *name;
+    Program *prog;
+    int count;
+} NameScan;
+
+void find_variable_write(Expression *expr, void *ctx) {
+    NameScan *scan = ctx;
+    Expression *target = written_target(expr);
+    if (!target) return;
+    const char *base = base_variable_name(target);
+    if (base && strcmp(base, scan->name) == 0) scan->count++;
+}
+
+void find_statement_write(Statement *stmt, void *ctx) {
+    NameScan *scan = ctx;
+    if (stmt->type == STMT_VAR_DECL && strcmp(stmt->var_decl.var.name, scan->name) == 0) scan->count++;
+    if (stmt->type == STMT_FOR_IN && strcmp(stmt->for_in.var.name, scan->name) == 0) scan->count++;
+}
+
+// Check if a statement assigns, declares or iterates over a variable (or an element/member of it)
+int statement_writes_variable(Statement *stmt, const char *name) {
+    NameScan scan = { name, NULL, 0 };
+    visit_statements(stmt, find_statement_write, &scan);
+    visit_statement_expressions(stmt, find_variable_write, &scan);
+    return scan.count > 0;
+}
+
+void count_read(Expression *expr, void *ctx) {
+    NameScan *scan = ctx;
+    if (expr->type == EXPR_VARIABLE && strcmp(expr->var_name, scan->name) == 0) scan->count++;
+    if (expr->type == EXPR_BINARY && expr->binary.op == OP_ASSIGN &&
+        expr->binary.left->type == EXPR_VARIABLE && strcmp(expr->binary.left->var_name, scan->name) == 0) {
+        scan->count--; // A plain assignment target is not a read
+    }
+}
+
+// Count the places where a statement reads a scalar variable
+int count_variable_reads(Statement *stmt, const char *name) {
+    NameScan scan = { name, NULL, 0 };
+    visit_statement_expressions(stmt, count_read, &scan);
+    return scan.count;
+}
+
+void find_impure_call(Expression *expr, void *ctx) {
+    NameScan *scan = ctx;
+    if (expr->type == EXPR_ASM) scan->count++;
+    if (expr->type != EXPR_CALL) return;
+    if (!call_is_pure(scan->prog, expr->call.func_name)) scan->count++;
+}
+
+void find_print(Statement *stmt, void *ctx) {
+    NameScan *scan = ctx;
+    if (stmt->type == STMT_PRINT) scan->count++;
+}
+
+// Check if a statement calls anything that may have side effects (or runs asm)
+int statement_has_impure_calls(Program *prog, Statement *stmt) {
+    NameScan scan = { NULL, prog, 0 };
+    visit_statement_expressions(stmt, find_impure_call, &scan);
+    return scan.count > 0;
+}
+
+void find_side_effect(Expression *expr, void *ctx) {
+    NameScan *scan = ctx;
+    if (written_target(expr)) scan->count++;
+    find_impure_call(expr, ctx);
+}
+
+// Check if evaluating an expression can change program state
+int expression_has_side_effects(Program *prog, Expression *expr) {
+    NameScan scan = { NULL, prog, 0 };
+    visit_expression(expr, find_side_effect, &scan);
+    return scan.count > 0;
+}
+
+void find_element_write(Expression *expr, void *ctx) {
+    NameScan *scan = ctx;
+    Expression *target = written_target(expr);
+    if (target && target->type == EXPR_ARRAY_ACCESS) scan->count++;
+}
+
+typedef struct {
+    Program *prog;
+    Statement *body;
+    int body_has_calls;
+    int body_writes_elements;
+    int invariant;
+} InvariantScan;
+
+void check_invariant(Expression *expr, void *ctx) {
+    InvariantScan *scan = ctx;
+    const char *name = NULL;
+
+    switch (expr->type) {
+        case EXPR_VARIABLE:
+            name = expr->var_name;
+            break;
+        case EXPR_ARRAY_ACCESS:
+        case EXPR_SLICE:
+            // Array parameters may alias each other or a global, so any element write counts
+            if (scan->body_writes_elements) scan->invariant = 0;
+            name = expr->type == EXPR_SLICE ? expr->slice.array_name : expr->array_access.array_name;
+            break;
+        case EXPR_CALL:
+            if (!call_is_pure(scan->prog, expr->call.func_name)) scan->invariant = 0;
+            return;
+        case EXPR_ASM:
+            scan->invariant = 0;
+            return;
+        default:
+            if (written_target(expr)) scan->invariant = 0;
+            return;
+    }
+
+    // Impure calls in the body may write any global, but not a local or parameter
+    // (a local that shadows a global is treated as the global, which is safe)
+    if (statement_writes_variable(scan->body, name) || (scan->body_has_calls && is_global_name(scan->prog, name))) {
+        scan->invariant = 0;
+    }
+}
+
+// Check if an expression has the same value on every iteration of a loop body
+int expression_is_invariant(Program *prog, Expression *expr, Statement *body) {
+    NameScan writes = { NULL, prog, 0 };
+    visit_statement_expressions(body, find_element_write, &writes);
+    InvariantScan scan = { prog, body, statement_has_impure_calls(prog, body), writes.count > 0, 1 };
+    visit_expression(expr, check_invariant, &scan);
+    return scan.invariant;
+}
+
+// Check if a statement contains a printf
+int statement_has_print(Statement *stmt) {
+    NameScan scan = { NULL, NULL, 0 };
+    visit_statements(stmt, find_print, &scan);
+    return scan.count > 0;
+}
+
+typedef struct {
+    const char *name;
+    Variable *var;
+} DeclSearch;
+
+void find_variable_decl(Statement *stmt, void *ctx) {
+    DeclSearch *search = ctx;
+    if (!search->var && stmt->type == STMT_VAR_DECL && strcmp(stmt->var_decl.var.name, search->name) == 0) {
+        search->var = &stmt->var_decl.var;
+    }
+    if (!search->var && stmt->type == STMT_FOR_IN && strcmp(stmt->for_in.var.name, search->name) == 0) {
+        search->var = &stmt->for_in.var;
+    }
+}
+
+// Generator variables are scoped to their generator, but are named after the loop variable they replace
+void find_generator_variable(Expression *expr, void *ctx) {
+    DeclSearch *search = ctx;
+    if (!search->var && expr->type == EXPR_GENERATOR && strcmp(expr->generator.var.name, search->name) == 0) {
+        search->var = &expr->generator.var;
+    }
+}
+
+// Find the parameter or local declaration for a name, or NULL
+Variable *lookup_local(Function *func, const char *name) {
+    if (!func) return NULL;
+
+    for (int i = 0; i < func->param_count; i++) {
+        if (strcmp(func->params[i].name, name) == 0) {
+            return &func->params[i];
+        }
+    }
+    DeclSearch search = { name, NULL };
+    visit_statements(func->body, find_variable_decl, &search);
+    if (!search.var) visit_statement_expressions(func->body, find_generator_variable, &search);
+    return search.var;
+}
+
+// Run all enabled passes over the program; returns nonzero if it cannot be translated
+int optimize_program(Program *prog) {
+    // switch, memcpy and friends, C library calls and inline asm have no Python equivalent, so they are lowered even at -O0
+    lower_switch_statements(prog);
+    if (lower_memory_calls(prog) > 0) return 1;
+    lower_intrinsic_calls(prog);
+    lower_inline_asm(prog);
+    // Both profile modes number functions and loops here, so counts from an
+    // instrumented run line up with the sites they describe. The instrumented
+    // build is left unoptimized: compile-time evaluation or fusion would leave
+    // nothing of the source program to count.
+    if (optimizer_options.profile_generate) {
+        instrument_program(prog);
+        lower_integer_semantics(prog);
+        return 0;
+    }
+    if (optimizer_options.profile_use) {
+        apply_profile(prog, optimizer_options.profile_use);
+    }
+    if (optimizer_options.enabled) {
+        freeze_constant_tables(prog);
+        scalarize_struct_locals(prog);
+        specialize_functions(prog);
+        analyze_purity(prog);
+        evaluate_constant_calls(prog);
+        tabulate_functions(prog);
+        fuse_loops(prog);
+        unswitch_loops(prog);
+        lower_range_loops(prog);
+        collapse_array_fills(prog);
+        lower_copy_loops(prog);
+        reduce_induction_variables(prog);
+        recognize_bit_idioms(prog);
+        recognize_loop_idioms(prog);
+        cache_member_accesses(prog);
+        hoist_loop_invariants(prog);
+        eliminate_common_subexpressions(prog);
+        shake_unused_definitions(prog);
+    }
+    // Needed for correct output even at -O0, where every operation gets its fix-up
+    lower_integer_semantics(prog);
+    if (optimizer_options.enabled) {
+        bind_global_names(prog);
+    }
+    return 0;
+}
+
+// Find the local, parameter or global a name refers to, or NULL
+Variable *lookup_variable(Program *prog, Function *func, const char *name) {
+    Variable *var = lookup_local(func, name);
+    if (var) return var;
+    for (int i = 0; i < prog->global_var_count; i++) {
+        if (strcmp(prog->global_vars[i].name, name) == 0) {
+            return &prog->global_vars[i];
+        }
+    }
+    return NULL;
+}
+
+// Find the declaration of a struct field, or NULL
+Variable *lookup_field(Program *prog, const char *struct_name, const char *field) {
+    for (int i = 0; i < prog->struct_count; i++) {
+        if (strcmp(prog->structs[i].name, struct_name) != 0) continue;
+        for (int j = 0; j < prog->structs[i].field_count; j++) {
+            if (strcmp(prog->structs[i].fields[j].name, field) == 0) {
+                return &prog->structs[i].fields[j];
+            }
+        }
+    }
+    return NULL;
+}
+
+// Find the declaration behind a member access chain such as p.x, or NULL
+Variable *lookup_member(Program *prog, Function *func, Expression *expr) {
+    Variable *base = NULL;
+    if (expr->member_access.struct_expr->type == EXPR_VARIABLE) {
+        base = lookup_variable(prog, func, expr->member_access.struct_expr->var_name);
+    } else if (expr->member_access.struct_expr->type == EXPR_MEMBER_ACCESS) {
+        base = lookup_member(prog, func, expr->member_access.struct_expr);
+    }
+    if (!base || !base->struct_name) return NULL;
+    return lookup_field(prog, base->struct_name, expr->member_access.member_name);
+}
+
+// Check if an expression always produces a Python int
+int expression_is_integer(Program *prog, Function *func, Expression *expr) {
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            return expr->literal.lit_type == TYPE_INT;
+
+        case EXPR_VARIABLE: {
+            Variable *var = lookup_variable(prog, func, expr->var_name);
+            return var && var->type == TYPE_INT && !var->is_array && !var->struct_name;
+        }
+
+        case EXPR_ARRAY_ACCESS: {
+            Variable *var = lookup_variable(prog, func, expr->array_access.array_name);
+            return var && var->type == TYPE_INT && var->is_array;
+        }
+
+        case EXPR_MEMBER_ACCESS: {
+            Variable *field = lookup_member(prog, func, expr);
+            return field && field->type == TYPE_INT && !field->is_array;
+        }
+
+        case EXPR_CALL: {
+            Function *callee = find_function(prog, expr->call.func_name);
+            if (!callee) return expression_type(prog, func, expr) == TYPE_INT;
+            return callee->return_type == TYPE_INT;
+        }
+
+        case EXPR_UNARY:
+            switch (expr->unary.op) {
+                case OP_NOT: return 1;
+                case OP_NEGATE: case OP_BIT_NOT: return expression_is_integer(prog, func, expr->unary.expr);
+                default: return 0;
+            }
+
+        case EXPR_BINARY:
+            switch (expr->binary.op) {
+                case OP_EQ: case OP_NEQ: case OP_LT: case OP_GT: case OP_LTE: case OP_GTE: case OP_IN:
+                    return 1;
+                case OP_ASSIGN: case OP_AND: case OP_OR:
+                    return 0;
+                default:
+                    return expression_is_integer(prog, func, expr->binary.left) &&
+                           expression_is_integer(prog, func, expr->binary.right);
+            }
+
+        default:
+            return 0;
+    }
+}
+
+// Static type of an expression's value, or TYPE_VOID when it is unknown
+VariableType expression_type(Program *prog, Function *func, Expression *expr) {
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            return expr->literal.lit_type;
+
+        case EXPR_VARIABLE: {
+            Variable *var = lookup_variable(prog, func, expr->var_name);
+            return var && !var->is_array && !var->struct_name ? var->type : TYPE_VOID;
+        }
+
+        case EXPR_ARRAY_ACCESS: {
+            Variable *var = lookup_variable(prog, func, expr->array_access.array_name);
+            return var && var->is_array && !var->struct_name ? var->type : TYPE_VOID;
+        }
+
+        case EXPR_MEMBER_ACCESS: {
+            Variable *field = lookup_member(prog, func, expr);
+            return field && !field->is_array && !field->struct_name ? field->type : TYPE_VOID;
+        }
+
+        case EXPR_CALL: {
+            Function *callee = find_function(prog, expr->call.func_name);
+            if (!callee) {
+                if (is_bit_builtin(expr->call.func_name) || is_int_reduction(expr->call.func_name)) return TYPE_INT;
+                VariableType arg = expr->call.arg_count > 0 ? expression_type(prog, func, expr->call.args[0]) : TYPE_VOID;
+                return intrinsic_result_type(expr->call.func_name, arg);
+            }
+            return callee->return_type;
+        }
+
+        case EXPR_UNARY:
+            if (expr->unary.op == OP_NOT) return TYPE_INT;
+            return expression_type(prog, func, expr->unary.expr);
+
+        case EXPR_BINARY: {
+            switch (expr->binary.op) {
+                case OP_EQ: case OP_NEQ: case OP_LT: case OP_GT: case OP_LTE: case OP_GTE:
+                case OP_AND: case OP_OR: case OP_IN:
+                    return TYPE_INT;
+                case OP_ASSIGN:
+                    return expression_type(prog, func, expr->binary.left);
+                default:
+                    break;
+            }
+            VariableType left = expression_type(prog, func, expr->binary.left);
+            VariableType right = expression_type(prog, func, expr->binary.right);
+            if (left == TYPE_FLOAT && (right == TYPE_FLOAT || right == TYPE_INT)) return TYPE_FLOAT;
+            if (right == TYPE_FLOAT && left == TYPE_INT) return TYPE_FLOAT;
+            if (left == TYPE_INT && right == TYPE_INT) return TYPE_INT;
+            return TYPE_VOID;
+        }
+
+        default:
+            return TYPE_VOID;
+    }
+}
+
+void find_trap(Expression *expr, void *ctx) {
+    NameScan *scan = ctx;
+    switch (expr->type) {
+        case EXPR_ARRAY_ACCESS:
+        case EXPR_ASM:
+        case EXPR_GENERATOR:
+            scan->count++; // Index errors, or code we cannot reason about
+            break;
+        case EXPR_CALL: {
+            Function *callee = scan->prog ? find_function(scan->prog, expr->call.func_name) : NULL;
+            if (callee ? function_may_trap(scan->prog, callee) : strcmp(expr->call.func_name, "len") != 0) {
+                scan->count++;
+            }
+            break;
+        }
+        case EXPR_BINARY: {
+            Expression *right = expr->binary.right;
+            int literal = right->type == EXPR_LITERAL && right->literal.lit_type == TYPE_INT;
+            switch (expr->binary.op) {
+                case OP_DIV: case OP_MOD: case OP_FLOOR_DIV: case OP_TRUNC_DIV: case OP_TRUNC_MOD:
+                    if (!literal || right->literal.int_val == 0) scan->count++;
+                    break;
+                case OP_SHIFT_LEFT: case OP_SHIFT_RIGHT:
+                    if (!literal || right->literal.int_val < 0) scan->count++;
+                    break;
+                case OP_POW:
+                    scan->count++; // 0.0 ** -1 and overflow raise
+                    break;
+                default:
+                    break;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void find_loop(Statement *stmt, void *ctx) {
+    NameScan *scan = ctx;
+    if (stmt->type == STMT_WHILE || stmt->type == STMT_FOR || stmt->type == STMT_FOR_IN) scan->count++;
+}
+
+// A call is safe to run speculatively when the callee is pure, has no loops
+// (so it always terminates), does not recurse and cannot raise itself
+int function_may_trap(Program *prog, Function *func) {
+    if (!func->is_pure || func->is_recursive) return 1;
+    NameScan scan = { NULL, prog, 0 };
+    visit_statements(func->body, find_loop, &scan);
+    visit_statement_expressions(func->body, find_trap, &scan);
+    return scan.count > 0;
+}
+
+// Check if evaluating an expression may raise in Python (division by zero,
+// bad index, negative shift, or a call that might fail), so that it must not
+// be evaluated earlier or more often than the program asks for
+int expression_may_trap(Program *prog, Expression *expr) {
+    NameScan scan = { NULL, prog, 0 };
+    visit_expression(expr, find_trap, &scan);
+    return scan.count > 0;
+}
@@ -7,6 +7,22 @@
 // Global variables
 Program *program = NULL;
 
+// The character a char literal token stands for ('a', or an escape such as '\\n' or '\\0')
+char char_literal_value(const char *text) {
+    if (text[0] != '\\') return text[0];
+    switch (text[1]) {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        case '0': return '\0';
+        case 'a': return '\a';
+        case 'b': return '\b';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        default: return text[1];  // \\, \' and \"
+    }
+}
+
 // Helper functions for memory allocation
 Expression *create_expression() {
     Expression *expr = malloc(sizeof(Expression));
@@ -25,6 +41,7 @@ Statement *create_statement() {
         exit(1);
     }
     memset(stmt, 0, sizeof(Statement));
+    stmt->profile_count = -1;
     return stmt;
 }
 
@@ -38,6 +55,15 @@ Function *create_function() {
     func->params = NULL;
     func->param_count = 0;
     func->body = NULL;
+    func->is_pure = 0;
+    func->is_recursive = 0;
+    func->memoize = 0;
+    func->default_names = NULL;
+    func->default_values = NULL;
+    func->default_count = 0;
+    func->profile_calls = -1;
+    func->line = 0;
+    func->source_file = NULL;
     return func;
 }
 
@@ -53,6 +79,147 @@ Struct *create_struct() {
     return s;
 }
 
+// Deep copy an expression
+Expression *clone_expression(Expression *expr) {
+    if (!expr) return NULL;
+
+    Expression *copy = create_expression();
+    *copy = *expr;
+    switch (expr->type) {
+        case EXPR_VARIABLE:
+            copy->var_name = strdup(expr->var_name);
+            break;
+        case EXPR_LITERAL:
+            if (expr->literal.lit_type == TYPE_STRING) {
+                copy->literal.string_val = strdup(expr->literal.string_val);
+            }
+            break;
+        case EXPR_BINARY:
+            copy->binary.left = clone_expression(expr->binary.left);
+            copy->binary.right = clone_expression(expr->binary.right);
+            break;
+        case EXPR_UNARY:
+            copy->unary.expr = clone_expression(expr->unary.expr);
+            break;
+        case EXPR_CALL:
+            copy->call.func_name = strdup(expr->call.func_name);
+            copy->call.args = malloc((expr->call.arg_count + 1) * sizeof(Expression*));
+            for (int i = 0; i < expr->call.arg_count; i++) {
+                copy->call.args[i] = clone_expression(expr->call.args[i]);
+            }
+            break;
+        case EXPR_ARRAY_ACCESS:
+            copy->array_access.array_name = strdup(expr->array_access.array_name);
+            copy->array_access.index = clone_expression(expr->array_access.index);
+            break;
+        case EXPR_MEMBER_ACCESS:
+            copy->member_access.struct_expr = clone_expression(expr->member_access.struct_expr);
+            copy->member_access.member_name = strdup(expr->member_access.member_name);
+            break;
+        case EXPR_ASM:
+            // Asm blocks are never rewritten, so sharing the operand strings is safe
+            break;
+        case EXPR_SLICE:
+            copy->slice.array_name = strdup(expr->slice.array_name);
+            copy->slice.start = clone_expression(expr->slice.start);
+            copy->slice.stop = clone_expression(expr->slice.stop);
+            break;
+        case EXPR_GENERATOR:
+            copy->generator.element = clone_expression(expr->generator.element);
+            copy->generator.var = expr->generator.var;
+            copy->generator.var.name = strdup(expr->generator.var.name);
+            if (expr->generator.var.struct_name) {
+                copy->generator.var.struct_name = strdup(expr->generator.var.struct_name);
+            }
+            copy->generator.iterable = clone_expression(expr->generator.iterable);
+            copy->generator.condition = clone_expression(expr->generator.condition);
+            break;
+        case EXPR_LIST:
+            copy->list.elements = malloc((expr->list.count + 1) * sizeof(Expression*));
+            for (int i = 0; i < expr->list.count; i++) {
+                copy->list.elements[i] = clone_expression(expr->list.elements[i]);
+            }
+            break;
+    }
+    return copy;
+}
+
+// Deep copy a statement
+Statement *clone_statement(Statement *stmt) {
+    if (!stmt) return NULL;
+
+    Statement *copy = create_statement();
+    *copy = *stmt;
+    switch (stmt->type) {
+        case STMT_EXPR:
+            copy->expr = clone_expression(stmt->expr);
+            break;
+        case STMT_VAR_DECL:
+            copy->var_decl.var.name = strdup(stmt->var_decl.var.name);
+            if (stmt->var_decl.var.struct_name) {
+                copy->var_decl.var.struct_name = strdup(stmt->var_decl.var.struct_name);
+            }
+            copy->var_decl.initializer = clone_expression(stmt->var_decl.initializer);
+            break;
+        case STMT_BLOCK:
+            copy->block.statements = malloc((stmt->block.stmt_count + 1) * sizeof(Statement*));
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                copy->block.statements[i] = clone_statement(stmt->block.statements[i]);
+            }
+            break;
+        case STMT_IF:
+            copy->if_stmt.condition = clone_expression(stmt->if_stmt.condition);
+            copy->if_stmt.then_branch = clone_statement(stmt->if_stmt.then_branch);
+            copy->if_stmt.else_branch = clone_statement(stmt->if_stmt.else_branch);
+            break;
+        case STMT_WHILE:
+            copy->while_stmt.condition = clone_expression(stmt->while_stmt.condition);
+            copy->while_stmt.body = clone_statement(stmt->while_stmt.body);
+            break;
+        case STMT_FOR:
+            copy->for_stmt.initializer = clone_statement(stmt->for_stmt.initializer);
+            copy->for_stmt.condition = clone_expression(stmt->for_stmt.condition);
+            copy->for_stmt.increment = clone_expression(stmt->for_stmt.increment);
+            copy->for_stmt.body = clone_statement(stmt->for_stmt.body);
+            break;
+        case STMT_RETURN:
+            copy->return_value = clone_expression(stmt->return_value);
+            break;
+        case STMT_PRINT:
+            copy->print.format = strdup(stmt->print.format);
+            copy->print.args = malloc((stmt->print.arg_count + 1) * sizeof(Expression*));
+            for (int i = 0; i < stmt->print.arg_count; i++) {
+                copy->print.args[i] = clone_expression(stmt->print.args[i]);
+            }
+            break;
+        case STMT_FOR_IN:
+            copy->for_in.var.name = strdup(stmt->for_in.var.name);
+            if (stmt->for_in.var.struct_name) {
+                copy->for_in.var.struct_name = strdup(stmt->for_in.var.struct_name);
+            }
+            copy->for_in.iterable = clone_expression(stmt->for_in.iterable);
+            copy->for_in.body = clone_statement(stmt->for_in.body);
+            copy->for_in.else_branch = clone_statement(stmt->for_in.else_branch);
+            break;
+        case STMT_SWITCH:
+            copy->switch_stmt.value = clone_expression(stmt->switch_stmt.value);
+            copy->switch_stmt.cases = malloc((stmt->switch_stmt.case_count + 1) * sizeof(SwitchCase));
+            for (int i = 0; i < stmt->switch_stmt.case_count; i++) {
+                SwitchCase *group = &copy->switch_stmt.cases[i];
+                *group = stmt->switch_stmt.cases[i];
+                group->labels = malloc((group->label_count + 1) * sizeof(Expression*));
+                for (int j = 0; j < group->label_count; j++) {
+                    group->labels[j] = clone_expression(stmt->switch_stmt.cases[i].labels[j]);
+                }
+                group->body = clone_statement(stmt->switch_stmt.cases[i].body);
+            }
+            break;
+        default:
+            break;
+    }
+    return copy;
+}
+
 // Parser state
 typedef struct {
     Token *tokens;
@@ -169,6 +336,24 @@ void synchronize(Parser *parser) {
     }
 }
 
+// Join the contents of the string literals in an asm section ("a\n\t" "b" -> a\n\tb);
+// escapes are kept as written
+char *unquote_asm_strings(const char *text) {
+    char *result = malloc(strlen(text) + 1);
+    int length = 0;
+    int in_string = 0;
+    for (const char *c = text; *c; c++) {
+        if (*c == '"') {
+            in_string = !in_string;
+        } else if (in_string) {
+            result[length++] = *c;
+            if (*c == '\\' && c[1]) result[length++] = *++c;
+        }
+    }
+    result[length] = '\0';
+    return result;
+}
+
 // Parse inline assembly block
 Expression *parse_asm(Parser *parser) {
     Expression *expr = create_expression();
@@ -186,7 +371,6 @@ Expression *parse_asm(Parser *parser) {
     if (!asm_str || strlen(asm_str) == 0) {
         fprintf(stderr, "Parse error at line %d, column %d: Empty asm block\n",
                 asm_token.line, asm_token.column);
-        consume(parser, TOKEN_SEMICOLON, "Expected ';' after asm block");
         return expr;
     }
 
@@ -242,13 +426,9 @@ Expression *parse_asm(Parser *parser) {
         clobber_str = strndup(section_start, ptr - section_start);
     }
 
-    // Trim instructions
+    // Instructions are the contents of the string literals, concatenated
     if (instructions) {
-        char *trimmed = instructions;
-        while (isspace(*trimmed)) trimmed++;
-        char *end = trimmed + strlen(trimmed) - 1;
-        while (end > trimmed && isspace(*end)) *end-- = '\0';
-        expr->asm_block.instructions = strdup(trimmed);
+        expr->asm_block.instructions = unquote_asm_strings(instructions);
         free(instructions);
     }
 
@@ -280,7 +460,12 @@ Expression *parse_asm(Parser *parser) {
                 char *var_end = var + strlen(var) - 1;
                 while (var_end > var && isspace(*var_end)) *var_end-- = '\0';
             }
-            expr->asm_block.outputs[expr->asm_block.output_count].constraint = constraint ? strdup(constraint) : NULL;
+            if (!constraint) {
+                // Blank section, e.g. the empty outputs of asm("nop" : : : "memory")
+                token = strtok(NULL, ",");
+                continue;
+            }
+            expr->asm_block.outputs[expr->asm_block.output_count].constraint = constraint ? unquote_asm_strings(constraint) : NULL;
             expr->asm_block.outputs[expr->asm_block.output_count].variable = var ? strdup(var) : NULL;
             expr->asm_block.output_count++;
             token = strtok(NULL, ",");
@@ -315,7 +500,11 @@ Expression *parse_asm(Parser *parser) {
                 char *var_end = var + strlen(var) - 1;
                 while (var_end > var && isspace(*var_end)) *var_end-- = '\0';
             }
-            expr->asm_block.inputs[expr->asm_block.input_count].constraint = constraint ? strdup(constraint) : NULL;
+            if (!constraint) {
+                token = strtok(NULL, ",");
+                continue;
+            }
+            expr->asm_block.inputs[expr->asm_block.input_count].constraint = constraint ? unquote_asm_strings(constraint) : NULL;
             expr->asm_block.inputs[expr->asm_block.input_count].variable = var ? strdup(var) : NULL;
             expr->asm_block.input_count++;
             token = strtok(NULL, ",");
@@ -337,13 +526,12 @@ Expression *parse_asm(Parser *parser) {
             while (isspace(*token)) token++;
             char *end = token + strlen(token) - 1;
             while (end > token && isspace(*end)) *end-- = '\0';
-            expr->asm_block.clobbers[expr->asm_block.clobber_count++] = strdup(token);
+            if (*token) expr->asm_block.clobbers[expr->asm_block.clobber_count++] = strdup(token);
             token = strtok(NULL, ",");
         }
         free(clobber_str);
     }
 
-    consume(parser, TOKEN_SEMICOLON, "Expected ';' after asm block");
     return expr;
 }
 
@@ -370,7 +558,7 @@ Expression *parse_primary(Parser *parser) {
     if (match(parser, TOKEN_CHAR_LITERAL)) {
         expr->type = EXPR_LITERAL;
         expr->literal.lit_type = TYPE_CHAR;
-        expr->literal.char_val = previous(parser).value[0];
+        expr->literal.char_val = char_literal_value(previous(parser).value);
         return expr;
     }
     
@@ -383,6 +571,22 @@ Expression *parse_primary(Parser *parser) {
     
     if (match(parser, TOKEN_ID)) {
         char *name = strdup(previous(parser).value);
+
+        // sizeof(type) is known here; sizeof(variable) stays a call for the optimizer to resolve
+        if (strcmp(name, "sizeof") == 0 && check(parser, TOKEN_LPAREN) &&
+            (parser->tokens[parser->current + 1].type == TOKEN_INT ||
+             parser->tokens[parser->current + 1].type == TOKEN_FLOAT ||
+             parser->tokens[parser->current + 1].type == TOKEN_CHAR)) {
+            advance(parser);
+            advance(parser);
+            TokenType type = previous(parser).type;
+            consume(parser, TOKEN_RPAREN, "Expected ')' after sizeof type");
+            expr->type = EXPR_LITERAL;
+            expr->literal.lit_type = TYPE_INT;
+            expr->literal.int_val = type == TOKEN_CHAR ? 1 : 4;
+            free(name);
+            return expr;
+        }
         
         // Check if it's a function call
         if (match(parser, TOKEN_LPAREN)) {
@@ -638,9 +842,47 @@ Expression *parse_or(Parser *parser) {
     return expr;
 }
 
+// Map a compound assignment token (+=, -=, ...) to its binary operator; -1 if not one
+int compound_assignment_op(TokenType type) {
+    switch (type) {
+        case TOKEN_PLUS_ASSIGN: return OP_ADD;
+        case TOKEN_MINUS_ASSIGN: return OP_SUB;
+        case TOKEN_MULTIPLY_ASSIGN: return OP_MUL;
+        case TOKEN_DIVIDE_ASSIGN: return OP_DIV;
+        case TOKEN_MOD_ASSIGN: return OP_MOD;
+        case TOKEN_BIT_AND_ASSIGN: return OP_BIT_AND;
+        case TOKEN_BIT_OR_ASSIGN: return OP_BIT_OR;
+        case TOKEN_BIT_XOR_ASSIGN: return OP_BIT_XOR;
+        case TOKEN_SHIFT_LEFT_ASSIGN: return OP_SHIFT_LEFT;
+        case TOKEN_SHIFT_RIGHT_ASSIGN: return OP_SHIFT_RIGHT;
+        default: return -1;
+    }
+}
+
 // Parse assignment expressions
 Expression *parse_assignment(Parser *parser) {
     Expression *expr = parse_or(parser);
+    int compound_op = compound_assignment_op(peek(parser).type);
+    if (compound_op >= 0) {
+        // a op= b is parsed as a = a op b
+        advance(parser);
+        if (expr->type != EXPR_VARIABLE && expr->type != EXPR_ARRAY_ACCESS && 
+            expr->type != EXPR_MEMBER_ACCESS) {
+            fprintf(stderr, "Parse error at line %d, column %d: Invalid assignment target\n", 
+                    peek(parser).line, peek(parser).column);
+        }
+        Expression *operation = create_expression();
+        operation->type = EXPR_BINARY;
+        operation->binary.op = (BinaryOpType)compound_op;
+        operation->binary.left = clone_expression(expr);
+        operation->binary.right = parse_assignment(parser);
+        Expression *binary = create_expression();
+        binary->type = EXPR_BINARY;
+        binary->binary.op = OP_ASSIGN;
+        binary->binary.left = expr;
+        binary->binary.right = operation;
+        return binary;
+    }
     if (match(parser, TOKEN_EQUALS)) {
         Expression *binary = create_expression();
         binary->type = EXPR_BINARY;
@@ -663,6 +905,66 @@ Expression *parse_expression(Parser *parser) {
 }
 
 // Parse variable declaration
+// Zero of an element type, as the generated Python fills arrays
+Expression *zero_element(VariableType type) {
+    Expression *expr = create_expression();
+    expr->type = EXPR_LITERAL;
+    expr->literal.lit_type = type == TYPE_CHAR ? TYPE_STRING : type;
+    if (type == TYPE_CHAR) expr->literal.string_val = strdup("");
+    return expr;
+}
+
+// Parse {a, b, c} for an array. Negated numbers are folded into literals,
+// missing elements are zero, and an array declared with [] gets one slot
+// per element.
+Expression *parse_array_initializer(Parser *parser, Variable *var) {
+    Token start = peek(parser);
+    consume(parser, TOKEN_LBRACE, "Expected '{' before array initializer");
+    Expression *list = create_expression();
+    list->type = EXPR_LIST;
+    list->list.elements = NULL;
+    list->list.count = 0;
+    int count = 0;
+    while (!check(parser, TOKEN_RBRACE) && !is_at_end(parser)) {
+        Expression *element = parse_expression(parser);
+        if (element->type == EXPR_UNARY && element->unary.op == OP_NEGATE &&
+            element->unary.expr->type == EXPR_LITERAL) {
+            Expression *literal = element->unary.expr;
+            if (literal->literal.lit_type == TYPE_INT) literal->literal.int_val = -literal->literal.int_val;
+            if (literal->literal.lit_type == TYPE_FLOAT) literal->literal.float_val = -literal->literal.float_val;
+            if (literal->literal.lit_type == TYPE_INT || literal->literal.lit_type == TYPE_FLOAT) {
+                free(element);
+                element = literal;
+            }
+        }
+        list->list.elements = realloc(list->list.elements, (count + 1) * sizeof(Expression*));
+        list->list.elements[count++] = element;
+        if (!match(parser, TOKEN_COMMA)) break;
+    }
+    consume(parser, TOKEN_RBRACE, "Expected '}' after array initializer");
+
+    if (var->array_size < 0) var->array_size = count;
+    if (count > var->array_size) {
+        fprintf(stderr, "Warning: line %d: excess elements in the initializer of %s are ignored\n",
+                start.line, var->name);
+        count = var->array_size;
+    }
+    list->list.elements = realloc(list->list.elements, (var->array_size + 1) * sizeof(Expression*));
+    while (count < var->array_size) {
+        list->list.elements[count++] = zero_element(var->type);
+    }
+    list->list.count = count;
+    return list;
+}
+
+// An initializer list made of literals only
+int literal_elements(Expression *list) {
+    for (int i = 0; i < list->list.count; i++) {
+        if (list->list.elements[i]->type != EXPR_LITERAL) return 0;
+    }
+    return 1;
+}
+
 Statement *parse_var_declaration(Parser *parser, VariableType type, char *struct_name) {
     Statement *stmt = create_statement();
     stmt->type = STMT_VAR_DECL;
@@ -673,24 +975,33 @@ Statement *parse_var_declaration(Parser *parser, VariableType type, char *struct
     stmt->var_decl.var.is_array = 0;
     stmt->var_decl.var.struct_name = struct_name ? strdup(struct_name) : NULL;
     
+    Token size_token = peek(parser);
     if (match(parser, TOKEN_LBRACKET)) {
         stmt->var_decl.var.is_array = 1;
+        size_token = peek(parser);
         if (match(parser, TOKEN_NUMBER)) {
             stmt->var_decl.var.array_size = atoi(previous(parser).value);
         } else {
-            fprintf(stderr, "Parse error at line %d, column %d: Expected array size\n", 
-                    peek(parser).line, peek(parser).column);
-            stmt->var_decl.var.array_size = 0;
+            stmt->var_decl.var.array_size = -1; // int t[] = {...} takes its size from the initializer
         }
         consume(parser, TOKEN_RBRACKET, "Expected ']' after array size");
     }
     
     if (match(parser, TOKEN_EQUALS)) {
         stmt->var_decl.var.is_initialized = 1;
-        stmt->var_decl.initializer = parse_expression(parser);
+        if (stmt->var_decl.var.is_array && check(parser, TOKEN_LBRACE)) {
+            stmt->var_decl.initializer = parse_array_initializer(parser, &stmt->var_decl.var);
+        } else {
+            stmt->var_decl.initializer = parse_expression(parser);
+        }
     } else {
         stmt->var_decl.initializer = NULL;
     }
+    if (stmt->var_decl.var.is_array && stmt->var_decl.var.array_size < 0) {
+        fprintf(stderr, "Parse error at line %d, column %d: Expected array size\n", 
+                size_token.line, size_token.column);
+        stmt->var_decl.var.array_size = 0;
+    }
     
     consume(parser, TOKEN_SEMICOLON, "Expected ';' after variable declaration");
     return stmt;
@@ -826,6 +1137,58 @@ Statement *parse_for_statement(Parser *parser) {
     return stmt;
 }
 
+// Parse switch statement. Consecutive labels form one case group; a
+// group's statements run on into the next group unless they break.
+Statement *parse_switch_statement(Parser *parser) {
+    Statement *stmt = create_statement();
+    stmt->type = STMT_SWITCH;
+    consume(parser, TOKEN_LPAREN, "Expected '(' after 'switch'");
+    stmt->switch_stmt.value = parse_expression(parser);
+    consume(parser, TOKEN_RPAREN, "Expected ')' after switch value");
+    consume(parser, TOKEN_LBRACE, "Expected '{' before switch cases");
+    stmt->switch_stmt.cases = NULL;
+    stmt->switch_stmt.case_count = 0;
+
+    SwitchCase *group = NULL;
+    while (!check(parser, TOKEN_RBRACE) && !is_at_end(parser)) {
+        if (match(parser, TOKEN_CASE) || match(parser, TOKEN_DEFAULT)) {
+            int is_default = previous(parser).type == TOKEN_DEFAULT;
+            if (!group || group->body->block.stmt_count > 0) {
+                int count = stmt->switch_stmt.case_count++;
+                stmt->switch_stmt.cases = realloc(stmt->switch_stmt.cases, (count + 1) * sizeof(SwitchCase));
+                group = &stmt->switch_stmt.cases[count];
+                memset(group, 0, sizeof(SwitchCase));
+                group->body = create_statement();
+                group->body->type = STMT_BLOCK;
+            }
+            if (is_default) {
+                group->is_default = 1;
+                consume(parser, TOKEN_COLON, "Expected ':' after 'default'");
+            } else {
+                group->labels = realloc(group->labels, (group->label_count + 1) * sizeof(Expression*));
+                group->labels[group->label_count++] = parse_expression(parser);
+                consume(parser, TOKEN_COLON, "Expected ':' after case value");
+            }
+            continue;
+        }
+        Token start = peek(parser);
+        Statement *next_stmt = parse_statement(parser);
+        if (!group) {
+            fprintf(stderr, "Parse error at line %d, column %d: Statement before the first case label\n",
+                    start.line, start.column);
+            continue;
+        }
+        if (next_stmt) {
+            Statement *body = group->body;
+            body->block.statements = realloc(body->block.statements, (body->block.stmt_count + 1) * sizeof(Statement*));
+            body->block.statements[body->block.stmt_count++] = next_stmt;
+        }
+    }
+
+    consume(parser, TOKEN_RBRACE, "Expected '}' after switch cases");
+    return stmt;
+}
+
 // Parse return statement
 Statement *parse_return_statement(Parser *parser) {
     Statement *stmt = create_statement();
@@ -908,6 +1271,7 @@ Struct *parse_struct(Parser *parser) {
 // Parse function declaration
 Function *parse_function(Parser *parser) {
     Function *func = create_function();
+    func->line = peek(parser).line;
     if (match(parser, TOKEN_INT) || match(parser, TOKEN_FLOAT) || 
         match(parser, TOKEN_CHAR) || match(parser, TOKEN_VOID)) {
         func->return_type = token_to_var_type(previous(parser).type, parser);
@@ -931,6 +1295,7 @@ Function *parse_function(Parser *parser) {
                 capacity *= 2;
                 func->params = realloc(func->params, capacity * sizeof(Variable));
             }
+            func->params[func->param_count].struct_name = NULL;
             if (match(parser, TOKEN_INT) || match(parser, TOKEN_FLOAT) || 
                 match(parser, TOKEN_CHAR) || match(parser, TOKEN_VOID)) {
                 func->params[func->param_count].type = token_to_var_type(previous(parser).type, parser);
@@ -944,20 +1309,36 @@ Function *parse_function(Parser *parser) {
                 func->params[func->param_count].type = TYPE_INT;
             }
             
-            consume(parser, TOKEN_ID, "Expected parameter name");
-            func->params[func->param_count].name = strdup(previous(parser).value);
+            // f(void) has no parameters, and prototypes may leave names out
+            if (func->param_count == 0 && func->params[0].type == TYPE_VOID &&
+                !func->params[0].struct_name && check(parser, TOKEN_RPAREN)) {
+                break;
+            }
+            if (!check(parser, TOKEN_ID) && (check(parser, TOKEN_COMMA) || check(parser, TOKEN_RPAREN))) {
+                char name[32];
+                snprintf(name, sizeof(name), "_arg%d", func->param_count);
+                func->params[func->param_count].name = strdup(name);
+            } else {
+                consume(parser, TOKEN_ID, "Expected parameter name");
+                func->params[func->param_count].name = strdup(previous(parser).value);
+            }
             func->params[func->param_count].is_array = 0;
             func->param_count++;
         } while (match(parser, TOKEN_COMMA));
     }
     
     consume(parser, TOKEN_RPAREN, "Expected ')' after parameters");
+    // A prototype declares a function defined later or in another translation unit
+    if (match(parser, TOKEN_SEMICOLON)) {
+        func->body = NULL;
+        return func;
+    }
     func->body = parse_block(parser);
     return func;
 }
 
 // Parse statement
-Statement *parse_statement(Parser *parser) {
+Statement *parse_statement_kind(Parser *parser) {
     if (match(parser, TOKEN_IF)) {
         return parse_if_statement(parser);
     }
@@ -967,6 +1348,9 @@ Statement *parse_statement(Parser *parser) {
     if (match(parser, TOKEN_FOR)) {
         return parse_for_statement(parser);
     }
+    if (match(parser, TOKEN_SWITCH)) {
+        return parse_switch_statement(parser);
+    }
     if (match(parser, TOKEN_RETURN)) {
         return parse_return_statement(parser);
     }
@@ -996,6 +1380,45 @@ Statement *parse_statement(Parser *parser) {
     return parse_expression_statement(parser);
 }
 
+// Parse a statement and record the source line it starts on
+Statement *parse_statement(Parser *parser) {
+    int line = peek(parser).line;
+    Statement *stmt = parse_statement_kind(parser);
+    if (stmt && stmt->line == 0) stmt->line = line;
+    return stmt;
+}
+
+// Store a global's literal initializer (optionally negated) in var->value
+int global_initial_value(Variable *var, Expression *init) {
+    int negate = 0;
+    if (init->type == EXPR_UNARY && init->unary.op == OP_NEGATE) {
+        negate = 1;
+        init = init->unary.expr;
+    }
+    if (init->type != EXPR_LITERAL || var->is_array) return 0;
+    switch (init->literal.lit_type) {
+        case TYPE_INT:
+            if (var->type == TYPE_FLOAT) {
+                var->value.float_val = negate ? -init->literal.int_val : init->literal.int_val;
+            } else if (var->type == TYPE_INT) {
+                var->value.int_val = negate ? -init->literal.int_val : init->literal.int_val;
+            } else {
+                return 0;
+            }
+            return 1;
+        case TYPE_FLOAT:
+            if (var->type != TYPE_FLOAT) return 0;
+            var->value.float_val = negate ? -init->literal.float_val : init->literal.float_val;
+            return 1;
+        case TYPE_CHAR:
+            if (var->type != TYPE_CHAR || negate) return 0;
+            var->value.char_val = init->literal.char_val;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
 // Main parsing function
 Program *parse(Token *tokens, int token_count) {
     Parser parser = { tokens, token_count, 0 };
@@ -1006,6 +1429,13 @@ Program *parse(Token *tokens, int token_count) {
     program->global_var_count = 0;
     program->structs = malloc(10 * sizeof(Struct));
     program->struct_count = 0;
+    program->init_block = NULL;
+    program->static_names = NULL;
+    program->static_count = 0;
+    program->extern_vars = NULL;
+    program->extern_count = 0;
+    program->profile_sites = NULL;
+    program->profile_site_count = 0;
     
     int func_capacity = 10;
     int var_capacity = 10;
@@ -1021,24 +1451,51 @@ Program *parse(Token *tokens, int token_count) {
             continue;
         }
         
+        // Storage class: static symbols are private to this translation unit,
+        // extern globals are defined in another one
+        int is_static = match(&parser, TOKEN_STATIC);
+        int is_extern = !is_static && match(&parser, TOKEN_EXTERN);
         if (match(&parser, TOKEN_INT) || match(&parser, TOKEN_FLOAT) || 
             match(&parser, TOKEN_CHAR) || match(&parser, TOKEN_VOID)) {
             TokenType type_token = previous(&parser).type;
+            if (check(&parser, TOKEN_ID) && is_static) {
+                program->static_names = realloc(program->static_names, (program->static_count + 1) * sizeof(char*));
+                program->static_names[program->static_count++] = strdup(peek(&parser).value);
+            }
             if (check(&parser, TOKEN_ID) && parser.tokens[parser.current + 1].type == TOKEN_LPAREN) {
+                parser.current--; // Backtrack to parse function
+                Function *func = parse_function(&parser);
+                if (!func->body) {
+                    // Calls are resolved by name when the units are linked
+                    free(func->params);
+                    free(func);
+                    continue;
+                }
                 if (program->function_count >= func_capacity) {
                     func_capacity *= 2;
                     program->functions = realloc(program->functions, func_capacity * sizeof(Function*));
                 }
-                parser.current--; // Backtrack to parse function
-                program->functions[program->function_count++] = parse_function(&parser);
+                program->functions[program->function_count++] = func;
+            } else if (is_extern) {
+                Statement *var_stmt = parse_var_declaration(&parser, token_to_var_type(type_token, &parser), NULL);
+                program->extern_vars = realloc(program->extern_vars, (program->extern_count + 1) * sizeof(Variable));
+                program->extern_vars[program->extern_count++] = var_stmt->var_decl.var;
+                free(var_stmt);
             } else {
                 if (program->global_var_count >= var_capacity) {
                     var_capacity *= 2;
                     program->global_vars = realloc(program->global_vars, var_capacity * sizeof(Variable));
                 }
-                parser.current--; // Backtrack to parse variable
                 Statement *var_stmt = parse_var_declaration(&parser, token_to_var_type(type_token, &parser), NULL);
-                program->global_vars[program->global_var_count] = var_stmt->var_decl.var;
+                Variable *global = &var_stmt->var_decl.var;
+                Expression *init = var_stmt->var_decl.initializer;
+                if (global->is_array && init && init->type == EXPR_LIST && literal_elements(init)) {
+                    global->elements = init;
+                } else if (init && !global_initial_value(global, init)) {
+                    fprintf(stderr, "Warning: initializer of global %s is not a literal; it starts at zero\n", global->name);
+                    global->is_initialized = 0;
+                }
+                program->global_vars[program->global_var_count] = *global;
                 program->global_var_count++;
                 free(var_stmt);
             }
@@ -1075,6 +1532,15 @@ void free_program(Program *prog) {
         }
     }
     free(prog->global_vars);
+    for (int i = 0; i < prog->static_count; i++) {
+        free(prog->static_names[i]);
+    }
+    free(prog->static_names);
+    free(prog->extern_vars);
+    for (int i = 0; i < prog->profile_site_count; i++) {
+        free(prog->profile_sites[i]);
+    }
+    free(prog->profile_sites);
     
     // Free functions (simplified, should free expressions and statements recursively)
     for (int i = 0; i < prog->function_count; i++) {
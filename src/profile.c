@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Profile-guided optimization. With --profile-generate FILE every function
+// counts its calls and every loop its iterations:
+//     def scale(x: int) -> int:
+//         _profile[3] = _profile[3] + 1
+// and the module writes the counts to FILE when it exits, one site per line:
+//     scale 1200
+//     scale:1 36000
+// A site is a function name, or a function name and the position of a loop
+// in it (1 for its first loop in source order). --profile-use FILE reads the
+// counts back onto Function.profile_calls and each loop's profile_count, and
+// the passes skip what the run never reached: no clones, tables or memo
+// caches for functions that were not called, no hoisting out of loops that
+// never ran. Sites that are missing from the file keep the default
+// heuristics. Both modes number the sites at the same point of the pipeline,
+// so the same sources give the same names.
+
+#define PROFILE_ARRAY "_profile"
+#define MAX_SITE 256
+
+typedef struct {
+    Program *prog;
+    Function *func;
+    int loop_index;
+} SiteWalk;
+
+int is_loop(Statement *stmt) {
+    return stmt->type == STMT_WHILE || stmt->type == STMT_FOR || stmt->type == STMT_FOR_IN;
+}
+
+// Register a counter and return the statement that bumps it: _profile[k] = _profile[k] + 1
+Statement *make_counter(Program *prog, const char *site) {
+    int index = prog->profile_site_count;
+    prog->profile_sites = realloc(prog->profile_sites, (index + 1) * sizeof(char*));
+    prog->profile_sites[prog->profile_site_count++] = strdup(site);
+
+    Expression *slot = create_expression();
+    slot->type = EXPR_ARRAY_ACCESS;
+    slot->array_access.array_name = strdup(PROFILE_ARRAY);
+    slot->array_access.index = make_int_literal(index);
+    Expression *sum = make_binary(OP_ADD, clone_expression(slot), make_int_literal(1));
+    return make_expression_statement(make_binary(OP_ASSIGN, slot, sum));
+}
+
+void prepend_counter(Statement **body, Statement *counter) {
+    Statement *block = make_block();
+    block_append(block, counter);
+    if (*body && (*body)->type == STMT_BLOCK) {
+        for (int i = 0; i < (*body)->block.stmt_count; i++) {
+            block_append(block, (*body)->block.statements[i]);
+        }
+        free((*body)->block.statements);
+        free(*body);
+    } else if (*body) {
+        block_append(block, *body);
+    }
+    *body = block;
+}
+
+void instrument_loop(Statement *stmt, void *ctx) {
+    SiteWalk *walk = ctx;
+    if (!is_loop(stmt)) return;
+    char site[MAX_SITE];
+    snprintf(site, sizeof(site), "%s:%d", walk->func->name, ++walk->loop_index);
+    prepend_counter(loop_body_slot(stmt), make_counter(walk->prog, site));
+}
+
+// Add a call counter to every function and an iteration counter to every loop
+void instrument_program(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        Function *func = prog->functions[i];
+        if (!func->body) continue;
+        SiteWalk walk = { prog, func, 0 };
+        Statement *counter = make_counter(prog, func->name);
+        visit_statements(func->body, instrument_loop, &walk);
+        prepend_counter(&func->body, counter);
+    }
+}
+
+typedef struct {
+    Function *func;
+    int loop_index;
+    int target;
+    long long count;
+    int found;
+} LoopSiteScan;
+
+void find_loop_site(Statement *stmt, void *ctx) {
+    LoopSiteScan *scan = ctx;
+    if (!is_loop(stmt) || ++scan->loop_index != scan->target) return;
+    stmt->profile_count = scan->count;
+    scan->found = 1;
+}
+
+// Attach one "site count" line to its function or loop
+int apply_site(Program *prog, const char *site, long long count) {
+    char name[MAX_SITE];
+    snprintf(name, sizeof(name), "%s", site);
+    char *colon = strchr(name, ':');
+    if (colon) *colon = '\0';
+    Function *func = find_function(prog, name);
+    if (!func) return 0;
+    if (!colon) {
+        func->profile_calls = count;
+        return 1;
+    }
+    LoopSiteScan scan = { func, 0, atoi(colon + 1), count, 0 };
+    visit_statements(func->body, find_loop_site, &scan);
+    return scan.found;
+}
+
+// Read the counts written by a --profile-generate build of the same sources
+void apply_profile(Program *prog, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Warning: cannot read profile '%s'; optimizing without it\n", path);
+        return;
+    }
+    char site[MAX_SITE];
+    long long count;
+    int mismatches = 0;
+    while (fscanf(fp, "%255s %lld", site, &count) == 2) {
+        if (!apply_site(prog, site, count)) mismatches++;
+    }
+    fclose(fp);
+    if (mismatches > 0) {
+        fprintf(stderr, "Warning: %d entries of profile '%s' do not match the program; was it made from other sources?\n",
+                mismatches, path);
+    }
+}
+
+// A function the profiled run never called
+int function_is_cold(Function *func) {
+    return func->profile_calls == 0;
+}
+
+// A loop whose body the profiled run never executed
+int loop_is_cold(Statement *loop) {
+    return loop->profile_count == 0;
+}
@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Interprocedural side-effect analysis. A function is pure when it has no
+// printf, no inline asm, writes no globals, mutates no array or struct, reads
+// no global that is written somewhere, and only calls pure functions.
+
+typedef struct {
+    Program *prog;
+    Function *func;
+    int *global_written;  // Indexed like prog->global_vars
+    int has_effects;
+} EffectScan;
+
+int global_index(Program *prog, const char *name) {
+    for (int i = 0; i < prog->global_var_count; i++) {
+        if (strcmp(prog->global_vars[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void mark_global_writes(Expression *expr, void *ctx) {
+    EffectScan *scan = ctx;
+    Expression *target = written_target(expr);
+    const char *base = target ? base_variable_name(target) : NULL;
+    if (!base || is_local_name(scan->func, base)) return;
+
+    // g = ..., g[i] = ... and g.x = ... all write the global g
+    int index = global_index(scan->prog, base);
+    if (index >= 0) {
+        scan->global_written[index] = 1;
+    }
+}
+
+void scan_expression_effects(Expression *expr, void *ctx) {
+    EffectScan *scan = ctx;
+
+    if (expr->type == EXPR_ASM) {
+        scan->has_effects = 1;
+        return;
+    }
+
+    // Reading a global is only safe if nothing ever writes it
+    const char *read = NULL;
+    if (expr->type == EXPR_VARIABLE) read = expr->var_name;
+    if (expr->type == EXPR_ARRAY_ACCESS) read = expr->array_access.array_name;
+    if (expr->type == EXPR_SLICE) read = expr->slice.array_name;
+    if (read && !is_local_name(scan->func, read)) {
+        int index = global_index(scan->prog, read);
+        if (index >= 0 && scan->global_written[index]) {
+            scan->has_effects = 1;
+        }
+    }
+
+    // Calls to functions outside the program are unknown, so treat them as impure
+    if (expr->type == EXPR_CALL && !find_function(scan->prog, expr->call.func_name) &&
+        !is_pure_builtin(expr->call.func_name)) {
+        scan->has_effects = 1;
+    }
+
+    Expression *target = written_target(expr);
+    if (!target) return;
+    if (target->type != EXPR_VARIABLE || !is_local_name(scan->func, target->var_name)) {
+        scan->has_effects = 1;
+    }
+}
+
+void scan_statement_effects(Statement *stmt, void *ctx) {
+    EffectScan *scan = ctx;
+    if (stmt->type == STMT_PRINT) {
+        scan->has_effects = 1;
+    }
+}
+
+typedef struct {
+    Program *prog;
+    int changed;
+    Function *caller;
+} CallScan;
+
+void demote_impure_callers(Expression *expr, void *ctx) {
+    CallScan *scan = ctx;
+    if (expr->type != EXPR_CALL || !scan->caller->is_pure) return;
+
+    if (!call_is_pure(scan->prog, expr->call.func_name)) {
+        scan->caller->is_pure = 0;
+        scan->changed = 1;
+    }
+}
+
+typedef struct {
+    Program *prog;
+    Function *target;
+    int *visited;  // Indexed like prog->functions
+    int found;
+} ReachScan;
+
+void follow_calls(Function *func, ReachScan *scan);
+
+void follow_call_expression(Expression *expr, void *ctx) {
+    ReachScan *scan = ctx;
+    if (expr->type != EXPR_CALL || scan->found) return;
+
+    for (int i = 0; i < scan->prog->function_count; i++) {
+        Function *callee = scan->prog->functions[i];
+        if (strcmp(callee->name, expr->call.func_name) != 0) continue;
+        if (callee == scan->target) {
+            scan->found = 1;
+        } else if (!scan->visited[i]) {
+            scan->visited[i] = 1;
+            follow_calls(callee, scan);
+        }
+        return;
+    }
+}
+
+void follow_calls(Function *func, ReachScan *scan) {
+    visit_statement_expressions(func->body, follow_call_expression, scan);
+}
+
+// Check if calls starting in one function can reach another (or itself)
+int function_reaches(Program *prog, Function *from, Function *target) {
+    ReachScan scan = { prog, target, calloc(prog->function_count + 1, sizeof(int)), 0 };
+    follow_calls(from, &scan);
+    free(scan.visited);
+    return scan.found;
+}
+
+typedef struct {
+    const char *name;
+    int writes;
+    int decls;
+    Expression *initializer;
+} ConstantScan;
+
+void count_local_writes(Expression *expr, void *ctx) {
+    ConstantScan *scan = ctx;
+    Expression *target = written_target(expr);
+    if (target && target->type == EXPR_VARIABLE && strcmp(target->var_name, scan->name) == 0) {
+        scan->writes++;
+    }
+}
+
+void find_constant_decl(Statement *stmt, void *ctx) {
+    ConstantScan *scan = ctx;
+    if (stmt->type == STMT_VAR_DECL && strcmp(stmt->var_decl.var.name, scan->name) == 0) {
+        scan->decls++;
+        scan->initializer = stmt->var_decl.initializer;
+    }
+}
+
+// Evaluate a literal, or a local that is initialized with a literal and never reassigned
+int constant_local_value(Function *func, Expression *expr, long long *value) {
+    if (expr->type == EXPR_LITERAL && expr->literal.lit_type == TYPE_INT) {
+        *value = expr->literal.int_val;
+        return 1;
+    }
+    if (expr->type == EXPR_LITERAL && expr->literal.lit_type == TYPE_CHAR) {
+        *value = expr->literal.char_val;
+        return 1;
+    }
+    if (expr->type != EXPR_VARIABLE) return 0;
+    for (int i = 0; i < func->param_count; i++) {
+        if (strcmp(func->params[i].name, expr->var_name) == 0) return 0;
+    }
+
+    ConstantScan scan = { expr->var_name, 0, 0, NULL };
+    visit_statements(func->body, find_constant_decl, &scan);
+    visit_statement_expressions(func->body, count_local_writes, &scan);
+    if (scan.decls != 1 || scan.writes != 0 || !scan.initializer) return 0;
+    if (scan.initializer->type != EXPR_LITERAL) return 0;
+    return constant_local_value(func, scan.initializer, value);
+}
+
+// Memoization needs hashable arguments and a result worth caching
+int can_memoize(Function *func) {
+    if (!func->is_pure || !func->is_recursive) return 0;
+    if (func->return_type == TYPE_VOID || func->param_count == 0) return 0;
+    // A profiled run that called it at most once has nothing to reuse
+    if (func->profile_calls >= 0 && func->profile_calls < 2) return 0;
+    for (int i = 0; i < func->param_count; i++) {
+        if (func->params[i].struct_name || func->params[i].is_array) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Compute is_pure, is_recursive and memoize for every function
+void analyze_purity(Program *prog) {
+    int *global_written = calloc(prog->global_var_count + 1, sizeof(int));
+
+    // Pass 1: which globals are written anywhere in the program
+    for (int i = 0; i < prog->function_count; i++) {
+        EffectScan scan = { prog, prog->functions[i], global_written, 0 };
+        visit_statement_expressions(prog->functions[i]->body, mark_global_writes, &scan);
+    }
+
+    // Pass 2: local effects of each function body
+    for (int i = 0; i < prog->function_count; i++) {
+        Function *func = prog->functions[i];
+        EffectScan scan = { prog, func, global_written, 0 };
+        visit_statements(func->body, scan_statement_effects, &scan);
+        visit_statement_expressions(func->body, scan_expression_effects, &scan);
+        func->is_pure = !scan.has_effects;
+    }
+
+    // Pass 3: propagate impurity from callees until nothing changes
+    CallScan calls = { prog, 1, NULL };
+    while (calls.changed) {
+        calls.changed = 0;
+        for (int i = 0; i < prog->function_count; i++) {
+            calls.caller = prog->functions[i];
+            visit_statement_expressions(calls.caller->body, demote_impure_callers, &calls);
+        }
+    }
+
+    for (int i = 0; i < prog->function_count; i++) {
+        Function *func = prog->functions[i];
+        func->is_recursive = function_reaches(prog, func, func);
+        func->memoize = optimizer_options.memo_cache_size != 0 && can_memoize(func);
+    }
+
+    free(global_written);
+}
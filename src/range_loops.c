@@ -0,0 +1,414 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Lowering of counted loops. A C loop of the form
+//     for (i = a; i < b; i += k) body
+// where body never writes i and b is loop-invariant becomes
+//     for i in range(a, b, k): body
+// which CPython runs far faster than the equivalent while loop. When the body
+// only reads a[i], the loop iterates over the elements of a directly. While
+// loops that are preceded by i = a and end with the increment (and contain no
+// continue) are handled the same way.
+
+typedef struct {
+    Program *prog;
+    Function *func;  // NULL for the module-level init block
+    Statement *scope; // Body the loops belong to
+} LoopContext;
+
+typedef struct {
+    char *var;          // Induction variable
+    Expression *start;  // First value
+    Expression *bound;  // Value compared against in the condition
+    BinaryOpType op;    // Comparison with the induction variable on the left
+    int step;           // Constant increment
+    int declared;       // The initializer declares the variable
+} CountedLoop;
+
+// Recognize i++, ++i, i--, --i, i = i + k, i = i - k and i = k + i
+int match_increment(Expression *expr, const char *var, int *step) {
+    if (!expr) return 0;
+
+    if (expr->type == EXPR_UNARY && expr->unary.expr->type == EXPR_VARIABLE &&
+        strcmp(expr->unary.expr->var_name, var) == 0) {
+        switch (expr->unary.op) {
+            case OP_PRE_INC: case OP_POST_INC: *step = 1; return 1;
+            case OP_PRE_DEC: case OP_POST_DEC: *step = -1; return 1;
+            default: return 0;
+        }
+    }
+
+    if (expr->type != EXPR_BINARY || expr->binary.op != OP_ASSIGN) return 0;
+    Expression *target = expr->binary.left;
+    Expression *value = expr->binary.right;
+    if (target->type != EXPR_VARIABLE || strcmp(target->var_name, var) != 0) return 0;
+    if (value->type != EXPR_BINARY || (value->binary.op != OP_ADD && value->binary.op != OP_SUB)) return 0;
+
+    Expression *left = value->binary.left;
+    Expression *right = value->binary.right;
+    if (value->binary.op == OP_ADD && left->type == EXPR_LITERAL) {
+        Expression *swap = left;
+        left = right;
+        right = swap;
+    }
+    if (left->type != EXPR_VARIABLE || strcmp(left->var_name, var) != 0) return 0;
+    if (right->type != EXPR_LITERAL || right->literal.lit_type != TYPE_INT) return 0;
+    *step = value->binary.op == OP_ADD ? right->literal.int_val : -right->literal.int_val;
+    return *step != 0;
+}
+
+// Match the initializer, condition and increment of a counted loop
+int match_counted_loop(LoopContext *ctx, Statement *init, Expression *cond, Expression *incr,
+                       Statement *body, CountedLoop *loop) {
+    if (!init || !cond || !incr) return 0;
+
+    if (init->type == STMT_VAR_DECL) {
+        Variable *var = &init->var_decl.var;
+        if (var->is_array || var->struct_name || var->type != TYPE_INT || !init->var_decl.initializer) return 0;
+        loop->var = var->name;
+        loop->start = init->var_decl.initializer;
+        loop->declared = 1;
+    } else if (init->type == STMT_EXPR && init->expr->type == EXPR_BINARY &&
+               init->expr->binary.op == OP_ASSIGN && init->expr->binary.left->type == EXPR_VARIABLE) {
+        // Globals would become locals of the function once used as a Python loop variable
+        Variable *var = lookup_local(ctx->func, init->expr->binary.left->var_name);
+        if (ctx->func && (!var || var->is_array || var->struct_name || var->type != TYPE_INT)) return 0;
+        loop->var = init->expr->binary.left->var_name;
+        loop->start = init->expr->binary.right;
+        loop->declared = 0;
+    } else {
+        return 0;
+    }
+    if (expression_has_side_effects(ctx->prog, loop->start)) return 0;
+    if (!expression_is_integer(ctx->prog, ctx->func, loop->start)) return 0;
+
+    if (cond->type != EXPR_BINARY) return 0;
+    loop->op = cond->binary.op;
+    if (loop->op != OP_LT && loop->op != OP_LTE && loop->op != OP_GT && loop->op != OP_GTE) return 0;
+    if (cond->binary.left->type == EXPR_VARIABLE && strcmp(cond->binary.left->var_name, loop->var) == 0) {
+        loop->bound = cond->binary.right;
+    } else if (cond->binary.right->type == EXPR_VARIABLE &&
+               strcmp(cond->binary.right->var_name, loop->var) == 0) {
+        loop->bound = cond->binary.left;
+        loop->op = mirror_comparison(loop->op);
+    } else {
+        return 0;
+    }
+
+    if (!match_increment(incr, loop->var, &loop->step)) return 0;
+    if ((loop->op == OP_LT || loop->op == OP_LTE) && loop->step <= 0) return 0;
+    if ((loop->op == OP_GT || loop->op == OP_GTE) && loop->step >= 0) return 0;
+
+    // range() evaluates its arguments once, so the bound must not change
+    if (statement_writes_variable(body, loop->var)) return 0;
+    if (expression_mentions(loop->bound, loop->var)) return 0;
+    if (!expression_is_invariant(ctx->prog, loop->bound, body)) return 0;
+    if (!expression_is_integer(ctx->prog, ctx->func, loop->bound)) return 0;
+    return 1;
+}
+
+// Build range(start, stop[, step]) for a counted loop
+Expression *range_call(CountedLoop *loop) {
+    Expression *args[3];
+    int count = 2;
+    args[0] = clone_expression(loop->start);
+    switch (loop->op) {
+        case OP_LTE: args[1] = offset_expression(loop->bound, 1); break;
+        case OP_GTE: args[1] = offset_expression(loop->bound, -1); break;
+        default: args[1] = clone_expression(loop->bound); break;
+    }
+    if (loop->step != 1) {
+        args[count++] = make_int_literal(loop->step);
+    }
+    return make_call("range", args, count);
+}
+
+typedef struct {
+    const char *var;
+    const char *array;
+    int accesses;
+    int other;
+} ElementScan;
+
+void find_element_reads(Expression *expr, void *ctx) {
+    ElementScan *scan = ctx;
+    if (expr->type == EXPR_ARRAY_ACCESS && expr->array_access.index->type == EXPR_VARIABLE &&
+        strcmp(expr->array_access.index->var_name, scan->var) == 0) {
+        if (!scan->array) scan->array = expr->array_access.array_name;
+        if (strcmp(scan->array, expr->array_access.array_name) == 0) {
+            scan->accesses++;
+        } else {
+            scan->other++;
+        }
+    }
+}
+
+typedef struct {
+    const char *var;
+    const char *array;
+    const char *element;
+} ElementRewrite;
+
+void replace_element_reads(Expression *expr, void *ctx) {
+    ElementRewrite *rewrite = ctx;
+    if (expr->type == EXPR_ARRAY_ACCESS && strcmp(expr->array_access.array_name, rewrite->array) == 0 &&
+        expr->array_access.index->type == EXPR_VARIABLE &&
+        strcmp(expr->array_access.index->var_name, rewrite->var) == 0) {
+        expr->type = EXPR_VARIABLE;
+        expr->var_name = strdup(rewrite->element);
+    }
+}
+
+// Find the declared size of an array visible in the function, or -1
+int array_size_of(Program *prog, Function *func, const char *name) {
+    Variable *var = lookup_local(func, name);
+    if (!var) {
+        for (int i = 0; i < prog->global_var_count; i++) {
+            if (strcmp(prog->global_vars[i].name, name) == 0) var = &prog->global_vars[i];
+        }
+    }
+    return var && var->is_array ? var->array_size : -1;
+}
+
+// Slice end for a loop bound: negative ends count from the back in Python,
+// so clamp them at 0 (an empty slice, like the empty loop). NULL if the bound
+// is a negative constant.
+Expression *slice_stop(Expression *stop) {
+    if (stop->type == EXPR_LITERAL && stop->literal.lit_type == TYPE_INT) {
+        return stop->literal.int_val >= 0 ? clone_expression(stop) : NULL;
+    }
+    Expression *args[2] = { clone_expression(stop), make_int_literal(0) };
+    return make_call("max", args, 2);
+}
+
+// Try to turn for (i = lo; i < hi; i++) ... a[i] ... into for a_i in a[lo:hi]
+Statement *element_loop(LoopContext *ctx, CountedLoop *loop, Statement *body) {
+    if (loop->step != 1 || (loop->op != OP_LT && loop->op != OP_LTE)) return NULL;
+    if (loop->start->type != EXPR_LITERAL || loop->start->literal.lit_type != TYPE_INT ||
+        loop->start->literal.int_val < 0) {
+        return NULL;
+    }
+
+    ElementScan scan = { loop->var, NULL, 0, 0 };
+    visit_statement_expressions(body, find_element_reads, &scan);
+    if (!scan.array || scan.other > 0 || scan.accesses != count_variable_reads(body, loop->var)) return NULL;
+    if (statement_writes_variable(body, scan.array) || statement_has_impure_calls(ctx->prog, body)) return NULL;
+
+    Expression *range = range_call(loop);
+    Expression *stop = range->call.args[1];
+    Expression *end = slice_stop(stop);
+    if (!end) return NULL;
+    int size = array_size_of(ctx->prog, ctx->func, scan.array);
+    Expression *iterable;
+    if (loop->start->literal.int_val == 0 && stop->type == EXPR_LITERAL &&
+        stop->literal.lit_type == TYPE_INT && stop->literal.int_val == size) {
+        iterable = make_variable(scan.array);
+    } else {
+        iterable = create_expression();
+        iterable->type = EXPR_SLICE;
+        iterable->slice.array_name = strdup(scan.array);
+        iterable->slice.start = loop->start->literal.int_val == 0 ? NULL : clone_expression(loop->start);
+        iterable->slice.stop = end;
+    }
+
+    char element[512];
+    snprintf(element, sizeof(element), "_%s_%s", scan.array, loop->var);
+    ElementRewrite rewrite = { loop->var, scan.array, element };
+    visit_statement_expressions(body, replace_element_reads, &rewrite);
+
+    // The element variable has the array's element type
+    Variable *array = lookup_variable(ctx->prog, ctx->func, scan.array);
+    Statement *stmt = create_statement();
+    stmt->type = STMT_FOR_IN;
+    stmt->for_in.var.name = strdup(element);
+    stmt->for_in.var.type = array ? array->type : TYPE_INT;
+    stmt->for_in.var.struct_name = array && array->struct_name ? strdup(array->struct_name) : NULL;
+    stmt->for_in.iterable = iterable;
+    stmt->for_in.body = body;
+    return stmt;
+}
+
+typedef struct {
+    Statement *target;
+    Statement *block;
+    int index;
+} BlockSearch;
+
+void find_enclosing_block(Statement *stmt, void *ctx) {
+    BlockSearch *search = ctx;
+    if (stmt->type != STMT_BLOCK || search->block) return;
+    for (int i = 0; i < stmt->block.stmt_count; i++) {
+        if (stmt->block.statements[i] == search->target) {
+            search->block = stmt;
+            search->index = i;
+        }
+    }
+}
+
+// Check if a statement gives var a new value before anything reads it
+int overwrites_variable(Statement *stmt, const char *var) {
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            return strcmp(stmt->var_decl.var.name, var) == 0;
+        case STMT_EXPR: {
+            Expression *expr = stmt->expr;
+            return expr->type == EXPR_BINARY && expr->binary.op == OP_ASSIGN &&
+                   expr->binary.left->type == EXPR_VARIABLE && strcmp(expr->binary.left->var_name, var) == 0 &&
+                   !expression_mentions(expr->binary.right, var);
+        }
+        case STMT_FOR:
+            return stmt->for_stmt.initializer && overwrites_variable(stmt->for_stmt.initializer, var);
+        case STMT_FOR_IN:
+            // Lowered without an exit value, so nothing reads var after it
+            return strcmp(stmt->for_in.var.name, var) == 0 && !stmt->for_in.else_branch;
+        case STMT_BLOCK:
+            return stmt->block.stmt_count > 0 && overwrites_variable(stmt->block.statements[0], var);
+        default:
+            return 0;
+    }
+}
+
+// Check if the value var has after a loop may be read: the statements that
+// follow the loop in its block either read var or run to the end of a block
+// other than the function body (and so may loop back or fall through)
+int read_after_loop(Statement *scope, Statement *loop, const char *var) {
+    BlockSearch search = { loop, NULL, 0 };
+    visit_statements(scope, find_enclosing_block, &search);
+    if (!search.block) return 1;
+    for (int i = search.index + 1; i < search.block->block.stmt_count; i++) {
+        Statement *stmt = search.block->block.statements[i];
+        if (overwrites_variable(stmt, var)) return 0;
+        if (count_variable_reads(stmt, var) > 0 || statement_writes_variable(stmt, var)) return 1;
+    }
+    return search.block != scope;
+}
+
+// Lower a matched counted loop; the loop statement must still be in the function body
+Statement *lower_counted_loop(LoopContext *ctx, Statement *original, CountedLoop *loop, Statement *body) {
+    // C leaves i at its exit value; only reproduce that if someone reads i afterwards
+    int needs_exit_value = !loop->declared &&
+        count_variable_reads(ctx->scope, loop->var) > count_variable_reads(original, loop->var) &&
+        read_after_loop(ctx->scope, original, loop->var);
+
+    if (!needs_exit_value) {
+        Statement *elements = element_loop(ctx, loop, body);
+        if (elements) {
+            elements->line = original->line;
+            elements->profile_count = original->profile_count;
+            return elements;
+        }
+    }
+
+    Statement *stmt = create_statement();
+    stmt->type = STMT_FOR_IN;
+    stmt->line = original->line;
+    stmt->profile_count = original->profile_count;
+    stmt->for_in.var.name = strdup(loop->var);
+    stmt->for_in.var.type = TYPE_INT;
+    stmt->for_in.iterable = range_call(loop);
+    stmt->for_in.body = body;
+    if (!needs_exit_value) return stmt;
+
+    // i = a - k; for i in range(...): ... else: i += k
+    // leaves a when the loop never runs, last + k on normal exit, and the current value on break
+    stmt->for_in.else_branch = make_expression_statement(
+        make_binary(OP_ASSIGN, make_variable(loop->var),
+                    make_binary(OP_ADD, make_variable(loop->var), make_int_literal(loop->step))));
+    Statement *block = make_block();
+    block_append(block, make_expression_statement(
+        make_binary(OP_ASSIGN, make_variable(loop->var), offset_expression(loop->start, -loop->step))));
+    block_append(block, stmt);
+    return block;
+}
+
+// Check for a continue that belongs to this loop (not to a nested one)
+int has_own_continue(Statement *stmt) {
+    if (!stmt) return 0;
+    switch (stmt->type) {
+        case STMT_CONTINUE:
+            return 1;
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                if (has_own_continue(stmt->block.statements[i])) return 1;
+            }
+            return 0;
+        case STMT_IF:
+            return has_own_continue(stmt->if_stmt.then_branch) || has_own_continue(stmt->if_stmt.else_branch);
+        default:
+            return 0;
+    }
+}
+
+// Rewrite i = a; while (i < b) { ...; i++; } inside a block
+void lower_counted_whiles(LoopContext *ctx, Statement *block) {
+    for (int i = 1; i < block->block.stmt_count; i++) {
+        Statement *init = block->block.statements[i - 1];
+        Statement *loop = block->block.statements[i];
+        if (loop->type != STMT_WHILE || loop->while_stmt.body->type != STMT_BLOCK) continue;
+
+        Statement *body = loop->while_stmt.body;
+        if (body->block.stmt_count == 0 || has_own_continue(body)) continue;
+        Statement *last = body->block.statements[body->block.stmt_count - 1];
+        if (last->type != STMT_EXPR) continue;
+
+        // Express the initializer as an assignment so the declaration stays in place
+        Statement *assign = NULL;
+        if (init->type == STMT_VAR_DECL && init->var_decl.initializer && !init->var_decl.var.is_array) {
+            assign = make_expression_statement(make_binary(OP_ASSIGN, make_variable(init->var_decl.var.name),
+                                                           init->var_decl.initializer));
+        } else if (init->type == STMT_EXPR) {
+            assign = init;
+        } else {
+            continue;
+        }
+
+        Statement *rest = make_block();
+        for (int j = 0; j < body->block.stmt_count - 1; j++) {
+            block_append(rest, body->block.statements[j]);
+        }
+
+        CountedLoop counted;
+        if (!match_counted_loop(ctx, assign, loop->while_stmt.condition, last->expr, rest, &counted)) {
+            free(rest->block.statements);
+            free(rest);
+            continue;
+        }
+
+        block->block.statements[i] = lower_counted_loop(ctx, loop, &counted, rest);
+        if (init->type == STMT_VAR_DECL) {
+            init->var_decl.initializer = NULL;
+            init->var_decl.var.is_initialized = 0;
+        } else {
+            block->block.statements[i - 1] = make_block();
+        }
+    }
+}
+
+Statement *lower_loop_statement(Statement *stmt, void *ctx) {
+    LoopContext *loops = ctx;
+
+    if (stmt->type == STMT_BLOCK) {
+        lower_counted_whiles(loops, stmt);
+        return stmt;
+    }
+    if (stmt->type != STMT_FOR) return stmt;
+
+    CountedLoop counted;
+    if (!match_counted_loop(loops, stmt->for_stmt.initializer, stmt->for_stmt.condition,
+                            stmt->for_stmt.increment, stmt->for_stmt.body, &counted)) {
+        return stmt;
+    }
+    return lower_counted_loop(loops, stmt, &counted, stmt->for_stmt.body);
+}
+
+// Lower counted loops in every function and in the module-level init block
+void lower_range_loops(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        LoopContext ctx = { prog, prog->functions[i], prog->functions[i]->body };
+        prog->functions[i]->body = transform_statements(prog->functions[i]->body, lower_loop_statement, &ctx);
+    }
+    LoopContext module = { prog, NULL, prog->init_block };
+    prog->init_block = transform_statements(prog->init_block, lower_loop_statement, &module);
+}
@@ -0,0 +1,387 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Interval arithmetic over C integer expressions. Bounds saturate at
+// +/-RANGE_LIMIT, which stands for "unknown" in that direction.
+#define RANGE_LIMIT (1LL << 62)
+
+Interval interval_full() {
+    Interval range = { -RANGE_LIMIT, RANGE_LIMIT };
+    return range;
+}
+
+Interval interval_const(long long value) {
+    Interval range = { value, value };
+    return range;
+}
+
+int interval_is_empty(Interval range) {
+    return range.lo > range.hi;
+}
+
+int interval_is_bounded(Interval range) {
+    return range.lo > -RANGE_LIMIT && range.hi < RANGE_LIMIT;
+}
+
+Interval interval_hull(Interval a, Interval b) {
+    if (interval_is_empty(a)) return b;
+    if (interval_is_empty(b)) return a;
+    Interval range = { a.lo < b.lo ? a.lo : b.lo, a.hi > b.hi ? a.hi : b.hi };
+    return range;
+}
+
+long long clamp_bound(long long value) {
+    if (value < -RANGE_LIMIT) return -RANGE_LIMIT;
+    if (value > RANGE_LIMIT) return RANGE_LIMIT;
+    return value;
+}
+
+// Add two lower (upper = 0) or upper (upper = 1) bounds; unknown bounds stay
+// unknown, and an unknown bound in either direction makes the sum unknown in
+// the direction being bounded
+long long add_bounds(long long a, long long b, int upper) {
+    int a_high = a >= RANGE_LIMIT, b_high = b >= RANGE_LIMIT;
+    int a_low = a <= -RANGE_LIMIT, b_low = b <= -RANGE_LIMIT;
+    if ((a_high || b_high) && (a_low || b_low)) return upper ? RANGE_LIMIT : -RANGE_LIMIT;
+    if (a_high || b_high) return RANGE_LIMIT;
+    if (a_low || b_low) return -RANGE_LIMIT;
+    return clamp_bound(a + b);
+}
+
+long long subtract_bounds(long long a, long long b, int upper) {
+    return add_bounds(a, -clamp_bound(b), upper);
+}
+
+// Multiply two bounds; unknown bounds stay unknown
+long long multiply_bounds(long long a, long long b) {
+    if (a == 0 || b == 0) return 0;
+    if (a <= -RANGE_LIMIT || a >= RANGE_LIMIT || b <= -RANGE_LIMIT || b >= RANGE_LIMIT ||
+        llabs(a) > RANGE_LIMIT / llabs(b)) {
+        return (a < 0) != (b < 0) ? -RANGE_LIMIT : RANGE_LIMIT;
+    }
+    return a * b;
+}
+
+// &, | and ^ of two values in the int range stay in the int range
+Interval interval_bitwise_int(Interval a, Interval b) {
+    Interval range = { -2147483647LL - 1, 2147483647LL };
+    if (a.lo >= range.lo && a.hi <= range.hi && b.lo >= range.lo && b.hi <= range.hi) return range;
+    return interval_full();
+}
+
+Interval interval_from_corners(long long a, long long b, long long c, long long d) {
+    Interval range = { a, a };
+    long long corners[3] = { b, c, d };
+    for (int i = 0; i < 3; i++) {
+        if (corners[i] < range.lo) range.lo = corners[i];
+        if (corners[i] > range.hi) range.hi = corners[i];
+    }
+    return range;
+}
+
+RangeEnv *range_env_create() {
+    RangeEnv *env = malloc(sizeof(RangeEnv));
+    env->names = NULL;
+    env->ranges = NULL;
+    env->count = 0;
+    return env;
+}
+
+RangeEnv *range_env_copy(RangeEnv *env) {
+    RangeEnv *copy = range_env_create();
+    for (int i = 0; i < env->count; i++) {
+        range_env_set(copy, env->names[i], env->ranges[i]);
+    }
+    return copy;
+}
+
+void range_env_free(RangeEnv *env) {
+    for (int i = 0; i < env->count; i++) {
+        free(env->names[i]);
+    }
+    free(env->names);
+    free(env->ranges);
+    free(env);
+}
+
+void range_env_set(RangeEnv *env, const char *name, Interval range) {
+    for (int i = 0; i < env->count; i++) {
+        if (strcmp(env->names[i], name) == 0) {
+            env->ranges[i] = range;
+            return;
+        }
+    }
+    env->names = realloc(env->names, (env->count + 1) * sizeof(char*));
+    env->ranges = realloc(env->ranges, (env->count + 1) * sizeof(Interval));
+    env->names[env->count] = strdup(name);
+    env->ranges[env->count] = range;
+    env->count++;
+}
+
+// Unknown variables get the full range
+Interval range_env_get(RangeEnv *env, const char *name) {
+    for (int i = 0; i < env->count; i++) {
+        if (strcmp(env->names[i], name) == 0) {
+            return env->ranges[i];
+        }
+    }
+    return interval_full();
+}
+
+// Merge the ranges of two control-flow paths into env
+void range_env_join(RangeEnv *env, RangeEnv *other) {
+    for (int i = 0; i < env->count; i++) {
+        env->ranges[i] = interval_hull(env->ranges[i], range_env_get(other, env->names[i]));
+    }
+    for (int i = 0; i < other->count; i++) {
+        int known = 0;
+        for (int j = 0; j < env->count; j++) {
+            if (strcmp(env->names[j], other->names[i]) == 0) {
+                known = 1;
+                break;
+            }
+        }
+        if (!known) {
+            range_env_set(env, other->names[i], interval_full());
+        }
+    }
+}
+
+// Truncating division of intervals when the divisor excludes zero
+Interval interval_divide(Interval a, Interval b) {
+    if (b.lo <= 0 && b.hi >= 0) return interval_full();
+    if (!interval_is_bounded(a) || !interval_is_bounded(b)) return interval_full();
+    return interval_from_corners(a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi);
+}
+
+// C remainder: |result| < |divisor| and the sign follows the dividend
+Interval interval_remainder(Interval a, Interval b) {
+    if (b.lo <= 0 && b.hi >= 0) return interval_full();
+    long long max_abs = llabs(b.lo) > llabs(b.hi) ? llabs(b.lo) : llabs(b.hi);
+    Interval range = { -(max_abs - 1), max_abs - 1 };
+    if (a.lo >= 0) {
+        range.lo = 0;
+        if (a.hi < range.hi) range.hi = a.hi;
+    } else if (a.hi <= 0) {
+        range.hi = 0;
+        if (a.lo > range.lo) range.lo = a.lo;
+    }
+    return range;
+}
+
+// Compute a range that contains every value the expression can take
+Interval interval_of_expression(Expression *expr, RangeEnv *env) {
+    if (!expr) return interval_full();
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            if (expr->literal.lit_type == TYPE_INT) return interval_const(expr->literal.int_val);
+            if (expr->literal.lit_type == TYPE_CHAR) return interval_const(expr->literal.char_val);
+            return interval_full();
+
+        case EXPR_VARIABLE:
+            return range_env_get(env, expr->var_name);
+
+        case EXPR_UNARY: {
+            Interval inner = interval_of_expression(expr->unary.expr, env);
+            switch (expr->unary.op) {
+                case OP_NEGATE: {
+                    Interval range = { clamp_bound(-inner.hi), clamp_bound(-inner.lo) };
+                    return range;
+                }
+                case OP_NOT: {
+                    Interval range = { 0, 1 };
+                    return range;
+                }
+                case OP_BIT_NOT: {
+                    Interval range = { clamp_bound(-inner.hi - 1), clamp_bound(-inner.lo - 1) };
+                    return range;
+                }
+                case OP_WRAP_INT: {
+                    Interval range = { -2147483647LL - 1, 2147483647LL };
+                    if (inner.lo >= range.lo && inner.hi <= range.hi) return inner;
+                    return range;
+                }
+                default:
+                    return interval_full();
+            }
+        }
+
+        case EXPR_BINARY: {
+            if (expr->binary.op == OP_ASSIGN) {
+                return interval_of_expression(expr->binary.right, env);
+            }
+            Interval a = interval_of_expression(expr->binary.left, env);
+            Interval b = interval_of_expression(expr->binary.right, env);
+            switch (expr->binary.op) {
+                case OP_ADD: {
+                    Interval range = { add_bounds(a.lo, b.lo, 0), add_bounds(a.hi, b.hi, 1) };
+                    return range;
+                }
+                case OP_SUB: {
+                    Interval range = { subtract_bounds(a.lo, b.hi, 0), subtract_bounds(a.hi, b.lo, 1) };
+                    return range;
+                }
+                case OP_MUL:
+                    return interval_from_corners(multiply_bounds(a.lo, b.lo), multiply_bounds(a.lo, b.hi),
+                                                 multiply_bounds(a.hi, b.lo), multiply_bounds(a.hi, b.hi));
+                case OP_DIV: case OP_TRUNC_DIV:
+                    return interval_divide(a, b);
+                case OP_FLOOR_DIV: {
+                    // Rounding down reaches at most one below the truncated quotient
+                    Interval range = interval_divide(a, b);
+                    if (interval_is_bounded(range)) range.lo--;
+                    return range;
+                }
+                case OP_MOD: case OP_TRUNC_MOD:
+                    return interval_remainder(a, b);
+                case OP_SHIFT_LEFT:
+                    if (b.lo >= 0 && b.hi < 32) {
+                        return interval_from_corners(multiply_bounds(a.lo, 1LL << b.lo), multiply_bounds(a.lo, 1LL << b.hi),
+                                                     multiply_bounds(a.hi, 1LL << b.lo), multiply_bounds(a.hi, 1LL << b.hi));
+                    }
+                    return interval_full();
+                case OP_SHIFT_RIGHT:
+                    if (b.lo >= 0 && b.hi < 63) {
+                        return interval_from_corners(a.lo >> b.lo, a.lo >> b.hi, a.hi >> b.lo, a.hi >> b.hi);
+                    }
+                    return interval_full();
+                case OP_BIT_OR: case OP_BIT_XOR:
+                    if (a.lo >= 0 && b.lo >= 0 && interval_is_bounded(a) && interval_is_bounded(b)) {
+                        // No bit above the highest bit of either operand can be set
+                        long long limit = 1;
+                        while (limit <= a.hi || limit <= b.hi) limit <<= 1;
+                        Interval range = { 0, limit - 1 };
+                        return range;
+                    }
+                    if (expr->binary.op == OP_BIT_OR && (a.hi < 0 || b.hi < 0)) {
+                        // Setting bits of a negative value keeps it negative and never lowers it
+                        Interval range = { a.hi < 0 ? a.lo : b.lo, -1 };
+                        if (a.hi < 0 && b.hi < 0 && b.lo > a.lo) range.lo = b.lo;
+                        return range;
+                    }
+                    return interval_bitwise_int(a, b);
+                case OP_EQ: case OP_NEQ: case OP_LT: case OP_GT:
+                case OP_LTE: case OP_GTE: case OP_AND: case OP_OR: {
+                    Interval range = { 0, 1 };
+                    return range;
+                }
+                case OP_BIT_AND:
+                    if (a.lo >= 0 && b.lo >= 0) {
+                        Interval range = { 0, a.hi < b.hi ? a.hi : b.hi };
+                        return range;
+                    }
+                    if (a.lo >= 0 || b.lo >= 0) {
+                        Interval range = { 0, a.lo >= 0 ? a.hi : b.hi };
+                        return range;
+                    }
+                    return interval_bitwise_int(a, b);
+                default:
+                    return interval_full();
+            }
+        }
+
+        case EXPR_CALL:
+            // Bit counts of a 32-bit int
+            if (strcmp(expr->call.func_name, "int.bit_count") == 0 || strcmp(expr->call.func_name, "int.bit_length") == 0) {
+                Interval range = { 0, 32 };
+                return range;
+            }
+            if (strcmp(expr->call.func_name, "reverse_bits") == 0 && expr->call.arg_count == 2 &&
+                expr->call.args[1]->type == EXPR_LITERAL && expr->call.args[1]->literal.int_val < 32) {
+                Interval range = { 0, (1LL << expr->call.args[1]->literal.int_val) - 1 };
+                return range;
+            }
+            return interval_full();
+
+        default:
+            return interval_full();
+    }
+}
+
+// Flip a comparison so that the variable is on the left (c < x becomes x > c)
+BinaryOpType mirror_comparison(BinaryOpType op) {
+    switch (op) {
+        case OP_LT: return OP_GT;
+        case OP_GT: return OP_LT;
+        case OP_LTE: return OP_GTE;
+        case OP_GTE: return OP_LTE;
+        default: return op;
+    }
+}
+
+// Negate a comparison (!(x < c) is x >= c)
+BinaryOpType negate_comparison(BinaryOpType op) {
+    switch (op) {
+        case OP_LT: return OP_GTE;
+        case OP_GT: return OP_LTE;
+        case OP_LTE: return OP_GT;
+        case OP_GTE: return OP_LT;
+        case OP_EQ: return OP_NEQ;
+        case OP_NEQ: return OP_EQ;
+        default: return op;
+    }
+}
+
+// Narrow the ranges in env to the paths where cond evaluates to truth
+void refine_by_condition(Expression *cond, int truth, RangeEnv *env) {
+    if (!cond) return;
+
+    if (cond->type == EXPR_UNARY && cond->unary.op == OP_NOT) {
+        refine_by_condition(cond->unary.expr, !truth, env);
+        return;
+    }
+    if (cond->type != EXPR_BINARY) return;
+
+    BinaryOpType op = cond->binary.op;
+    if ((op == OP_AND && truth) || (op == OP_OR && !truth)) {
+        refine_by_condition(cond->binary.left, truth, env);
+        refine_by_condition(cond->binary.right, truth, env);
+        return;
+    }
+    if (op != OP_EQ && op != OP_NEQ && op != OP_LT && op != OP_GT && op != OP_LTE && op != OP_GTE) {
+        return;
+    }
+
+    Expression *var = cond->binary.left;
+    Expression *bound = cond->binary.right;
+    if (var->type != EXPR_VARIABLE) {
+        var = cond->binary.right;
+        bound = cond->binary.left;
+        op = mirror_comparison(op);
+    }
+    if (var->type != EXPR_VARIABLE) return;
+    if (!truth) op = negate_comparison(op);
+
+    Interval limit = interval_of_expression(bound, env);
+    Interval range = range_env_get(env, var->var_name);
+    switch (op) {
+        case OP_LT:
+            if (limit.hi - 1 < range.hi) range.hi = limit.hi - 1;
+            break;
+        case OP_LTE:
+            if (limit.hi < range.hi) range.hi = limit.hi;
+            break;
+        case OP_GT:
+            if (limit.lo + 1 > range.lo) range.lo = limit.lo + 1;
+            break;
+        case OP_GTE:
+            if (limit.lo > range.lo) range.lo = limit.lo;
+            break;
+        case OP_EQ:
+            if (limit.lo > range.lo) range.lo = limit.lo;
+            if (limit.hi < range.hi) range.hi = limit.hi;
+            break;
+        case OP_NEQ:
+            if (limit.lo == limit.hi) {
+                if (range.lo == limit.lo) range.lo++;
+                if (range.hi == limit.lo) range.hi--;
+            }
+            break;
+        default:
+            break;
+    }
+    range_env_set(env, var->var_name, range);
+}
@@ -0,0 +1,324 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Scalar replacement of structs. A struct local that never escapes (it is
+// only ever used as p.field: never passed to a call, returned, assigned or
+// printed as a whole) is split into one Python local per field, so
+//     struct Point p; p.x = 1; p.y = p.x + 2;
+// becomes
+//     _p_x: int = 0; _p_y: int = 0; _p_x = 1; _p_y = _p_x + 2
+// and every attribute lookup turns into a local variable access.
+//
+// Structs that do escape still get their member accesses cached around
+// loops: the fields a loop touches are loaded into locals before it and the
+// ones it writes are stored back after it.
+
+// Name of the local standing for s.field
+char *field_local_name(const char *var, const char *field) {
+    char name[512];
+    snprintf(name, sizeof(name), "_%s_%s", var, field);
+    return strdup(name);
+}
+
+int is_member_of(Expression *expr, const char *var) {
+    return expr->type == EXPR_MEMBER_ACCESS && expr->member_access.struct_expr->type == EXPR_VARIABLE &&
+           strcmp(expr->member_access.struct_expr->var_name, var) == 0;
+}
+
+typedef struct {
+    Program *prog;
+    const char *var;
+    const char *struct_name;
+    int mentions;      // Every appearance of the variable
+    int member_uses;   // Appearances as the base of a member access
+    int bad_fields;    // Unknown, array or struct-typed fields
+    int *used;         // Indexed like the struct's fields
+} StructUseScan;
+
+Struct *find_struct(Program *prog, const char *name) {
+    for (int i = 0; i < prog->struct_count; i++) {
+        if (strcmp(prog->structs[i].name, name) == 0) return &prog->structs[i];
+    }
+    return NULL;
+}
+
+void scan_struct_use(Expression *expr, void *ctx) {
+    StructUseScan *scan = ctx;
+    if (expr->type == EXPR_VARIABLE && strcmp(expr->var_name, scan->var) == 0) scan->mentions++;
+    if (expr->type == EXPR_ASM) scan->mentions++; // Operands may name the struct
+    if (!is_member_of(expr, scan->var)) return;
+
+    scan->member_uses++;
+    Struct *s = find_struct(scan->prog, scan->struct_name);
+    for (int i = 0; s && i < s->field_count; i++) {
+        if (strcmp(s->fields[i].name, expr->member_access.member_name) == 0) {
+            if (s->fields[i].is_array || s->fields[i].struct_name) scan->bad_fields++;
+            scan->used[i] = 1;
+            return;
+        }
+    }
+    scan->bad_fields++;
+}
+
+typedef struct {
+    const char *var;
+} FieldRewrite;
+
+// Turn s.field into the field's local
+void replace_member_reads(Expression *expr, void *ctx) {
+    FieldRewrite *rewrite = ctx;
+    if (!is_member_of(expr, rewrite->var)) return;
+    char *name = field_local_name(rewrite->var, expr->member_access.member_name);
+    expr->type = EXPR_VARIABLE;
+    expr->var_name = name;
+}
+
+typedef struct {
+    const char *name;
+    int count;
+    Statement *decl;
+} StructDeclScan;
+
+void find_struct_decl(Statement *stmt, void *ctx) {
+    StructDeclScan *scan = ctx;
+    if (stmt->type == STMT_VAR_DECL && strcmp(stmt->var_decl.var.name, scan->name) == 0) {
+        scan->count++;
+        scan->decl = stmt;
+    }
+    if (stmt->type == STMT_FOR_IN && strcmp(stmt->for_in.var.name, scan->name) == 0) scan->count++;
+}
+
+// Split one struct local into per-field locals if it never escapes
+void scalarize_declaration(Program *prog, Function *func, Statement *decl) {
+    Variable *var = &decl->var_decl.var;
+    Struct *s = find_struct(prog, var->struct_name);
+    if (!s || var->is_array || decl->var_decl.initializer || lookup_local(func, var->name) != var) return;
+
+    // One declaration only, so the name means the same struct everywhere in the function
+    StructDeclScan decls = { var->name, 0, NULL };
+    visit_statements(func->body, find_struct_decl, &decls);
+    if (decls.count != 1) return;
+
+    StructUseScan scan = { prog, var->name, s->name, 0, 0, 0, calloc(s->field_count + 1, sizeof(int)) };
+    visit_statement_expressions(func->body, scan_struct_use, &scan);
+    if (scan.mentions != scan.member_uses || scan.bad_fields > 0) {
+        free(scan.used);
+        return;
+    }
+
+    FieldRewrite rewrite = { var->name };
+    visit_statement_expressions(func->body, replace_member_reads, &rewrite);
+
+    // The declaration becomes one zero-initialized local per used field
+    char *name = var->name;
+    decl->type = STMT_BLOCK;
+    decl->block.statements = malloc(sizeof(Statement*));
+    decl->block.stmt_count = 0;
+    for (int i = 0; i < s->field_count; i++) {
+        if (!scan.used[i]) continue;
+        Statement *field = create_statement();
+        field->type = STMT_VAR_DECL;
+        field->var_decl.var.name = field_local_name(name, s->fields[i].name);
+        field->var_decl.var.type = s->fields[i].type;
+        field->var_decl.initializer = NULL;
+        block_append(decl, field);
+    }
+    free(scan.used);
+}
+
+typedef struct {
+    Statement **decls;
+    int count;
+} StructDeclList;
+
+void collect_struct_decls(Statement *stmt, void *ctx) {
+    StructDeclList *list = ctx;
+    if (stmt->type != STMT_VAR_DECL || !stmt->var_decl.var.struct_name) return;
+    list->decls = realloc(list->decls, (list->count + 1) * sizeof(Statement*));
+    list->decls[list->count++] = stmt;
+}
+
+// Split every non-escaping struct local into scalars
+void scalarize_struct_locals(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        Function *func = prog->functions[i];
+        StructDeclList list = { NULL, 0 };
+        visit_statements(func->body, collect_struct_decls, &list);
+        for (int j = 0; j < list.count; j++) {
+            scalarize_declaration(prog, func, list.decls[j]);
+        }
+        free(list.decls);
+    }
+}
+
+typedef struct {
+    Program *prog;
+    Function *func;
+} CacheContext;
+
+typedef struct {
+    Program *prog;
+    Function *func;
+    const char *var;
+    const char *struct_name;
+    int aliased;        // Another struct of the same type is used in the loop
+    int whole_writes;   // The struct itself is assigned or declared
+} CacheScan;
+
+void scan_cache_conflicts(Expression *expr, void *ctx) {
+    CacheScan *scan = ctx;
+    if (expr->type == EXPR_VARIABLE && strcmp(expr->var_name, scan->var) != 0) {
+        Variable *other = lookup_variable(scan->prog, scan->func, expr->var_name);
+        if (other && other->struct_name && strcmp(other->struct_name, scan->struct_name) == 0) scan->aliased = 1;
+    }
+    Expression *target = written_target(expr);
+    if (target && target->type == EXPR_VARIABLE && strcmp(target->var_name, scan->var) == 0) scan->whole_writes++;
+}
+
+void find_return(Statement *stmt, void *ctx) {
+    int *found = ctx;
+    if (stmt->type == STMT_RETURN) *found = 1;
+}
+
+typedef struct {
+    const char *var;
+    const char *field;
+    int found;
+} FieldWriteScan;
+
+void find_field_write(Expression *expr, void *ctx) {
+    FieldWriteScan *scan = ctx;
+    Expression *target = written_target(expr);
+    if (target && is_member_of(target, scan->var) &&
+        strcmp(target->member_access.member_name, scan->field) == 0) {
+        scan->found = 1;
+    }
+}
+
+// Drop x = x left behind when an inner loop's cache is cached again by an outer loop
+Statement *drop_self_assignment(Statement *stmt, void *ctx) {
+    (void)ctx;
+    Expression *value = NULL;
+    const char *target = NULL;
+    if (stmt->type == STMT_VAR_DECL) {
+        target = stmt->var_decl.var.name;
+        value = stmt->var_decl.initializer;
+    } else if (stmt->type == STMT_EXPR && stmt->expr->type == EXPR_BINARY && stmt->expr->binary.op == OP_ASSIGN &&
+               stmt->expr->binary.left->type == EXPR_VARIABLE) {
+        target = stmt->expr->binary.left->var_name;
+        value = stmt->expr->binary.right;
+    }
+    if (value && value->type == EXPR_VARIABLE && strcmp(value->var_name, target) == 0 && target[0] == '_') {
+        return make_block();
+    }
+    return stmt;
+}
+
+// Cache the fields of var that a loop uses; returns the replacement for the loop
+Statement *cache_struct_in_loop(CacheContext *ctx, Statement *loop, Statement *wrapped, const char *var) {
+    // Globals could be read by the pure functions the loop calls
+    Variable *decl = lookup_local(ctx->func, var);
+    if (!decl || !decl->struct_name || decl->is_array) return wrapped;
+    StructDeclScan decls = { var, 0, NULL };
+    visit_statements(loop, find_struct_decl, &decls);
+    if (decls.count > 0) return wrapped;
+    Struct *s = find_struct(ctx->prog, decl->struct_name);
+    if (!s) return wrapped;
+
+    StructUseScan uses = { ctx->prog, var, s->name, 0, 0, 0, calloc(s->field_count + 1, sizeof(int)) };
+    visit_statement_expressions(loop, scan_struct_use, &uses);
+    CacheScan conflicts = { ctx->prog, ctx->func, var, s->name, 0, 0 };
+    visit_statement_expressions(loop, scan_cache_conflicts, &conflicts);
+    if (uses.mentions != uses.member_uses || uses.bad_fields > 0 || conflicts.aliased || conflicts.whole_writes) {
+        free(uses.used);
+        return wrapped;
+    }
+
+    int has_return = 0;
+    visit_statements(loop, find_return, &has_return);
+
+    Statement *before = make_block();
+    Statement *after = make_block();
+    for (int i = 0; i < s->field_count; i++) {
+        if (!uses.used[i]) continue;
+        FieldWriteScan writes = { var, s->fields[i].name, 0 };
+        visit_statement_expressions(loop, find_field_write, &writes);
+        // A return inside the loop would skip the store after it
+        if (writes.found && has_return) {
+            free(uses.used);
+            return wrapped;
+        }
+
+        Expression *member = create_expression();
+        member->type = EXPR_MEMBER_ACCESS;
+        member->member_access.struct_expr = make_variable(var);
+        member->member_access.member_name = strdup(s->fields[i].name);
+
+        Statement *load = create_statement();
+        load->type = STMT_VAR_DECL;
+        load->var_decl.var.name = field_local_name(var, s->fields[i].name);
+        load->var_decl.var.type = s->fields[i].type;
+        load->var_decl.var.is_initialized = 1;
+        load->var_decl.initializer = member;
+        block_append(before, load);
+
+        if (writes.found) {
+            block_append(after, make_expression_statement(
+                make_binary(OP_ASSIGN, clone_expression(member), make_variable(load->var_decl.var.name))));
+        }
+    }
+    free(uses.used);
+    if (before->block.stmt_count == 0) return wrapped;
+
+    FieldRewrite rewrite = { var };
+    visit_statement_expressions(wrapped, replace_member_reads, &rewrite);
+    transform_statements(loop, drop_self_assignment, NULL);
+
+    block_append(before, wrapped);
+    for (int i = 0; i < after->block.stmt_count; i++) {
+        block_append(before, after->block.statements[i]);
+    }
+    return before;
+}
+
+typedef struct {
+    const char **names;
+    int count;
+} StructNameList;
+
+void collect_member_bases(Expression *expr, void *ctx) {
+    StructNameList *list = ctx;
+    if (expr->type != EXPR_MEMBER_ACCESS || expr->member_access.struct_expr->type != EXPR_VARIABLE) return;
+    const char *name = expr->member_access.struct_expr->var_name;
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->names[i], name) == 0) return;
+    }
+    list->names = realloc(list->names, (list->count + 1) * sizeof(char*));
+    list->names[list->count++] = name;
+}
+
+Statement *cache_loop_statement(Statement *stmt, void *ctx) {
+    CacheContext *cache = ctx;
+    if (stmt->type != STMT_WHILE && stmt->type != STMT_FOR && stmt->type != STMT_FOR_IN) return stmt;
+    // Impure calls could read or write the struct behind our back
+    if (statement_has_impure_calls(cache->prog, stmt)) return stmt;
+
+    StructNameList list = { NULL, 0 };
+    visit_statement_expressions(stmt, collect_member_bases, &list);
+    Statement *result = stmt;
+    for (int i = 0; i < list.count; i++) {
+        result = cache_struct_in_loop(cache, stmt, result, list.names[i]);
+    }
+    free(list.names);
+    return result;
+}
+
+// Cache member accesses of escaping structs around loops
+void cache_member_accesses(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        CacheContext ctx = { prog, prog->functions[i] };
+        prog->functions[i]->body = transform_statements(prog->functions[i]->body, cache_loop_statement, &ctx);
+    }
+}
@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Block copies as slice assignments, which CPython runs as a single C loop.
+//     memcpy(dst, src + 2, n * sizeof(int))   ->  dst[0:n] = src[2:2 + n]
+//     memset(buf, 0, sizeof(buf))             ->  buf[0:16] = [0] * 16
+// memmove is the same as memcpy: the right-hand slice is a copy, so
+// overlapping ranges behave like memmove. sizeof(variable) is resolved here
+// (the parser already folds sizeof(type)); these calls have no Python
+// equivalent, so they are lowered even with -O0.
+// With optimizations on, counted loops that copy or fill a range,
+//     for (i = a; i < b; i++) dst[i + k] = src[i + m];
+//     for (i = a; i < b; i++) dst[i] = v;
+// become dst[a + k:b + k] = src[a + m:b + m] and dst[a:b] = [v] * (b - a).
+// A loop copying within one array is only a slice assignment when it reads
+// each element before the loop overwrites it (a shift toward the copy
+// direction), which is exactly the case where it matches memmove.
+
+typedef struct {
+    Program *prog;
+    Function *func;  // NULL for the module-level init block
+    int failures;    // memcpy, memmove and memset calls left untranslated
+} SliceContext;
+
+int element_size(Variable *array) {
+    return array->type == TYPE_CHAR ? 1 : 4;
+}
+
+// Replace sizeof(variable) with its size in bytes
+void resolve_sizeof(Expression *expr, void *ctx) {
+    SliceContext *slices = ctx;
+    if (expr->type != EXPR_CALL || strcmp(expr->call.func_name, "sizeof") != 0 || expr->call.arg_count != 1 ||
+        expr->call.args[0]->type != EXPR_VARIABLE) {
+        return;
+    }
+    Variable *var = lookup_variable(slices->prog, slices->func, expr->call.args[0]->var_name);
+    if (!var || var->struct_name) {
+        fprintf(stderr, "Warning: cannot determine sizeof(%s)\n", expr->call.args[0]->var_name);
+        return;
+    }
+    expr->type = EXPR_LITERAL;
+    expr->literal.lit_type = TYPE_INT;
+    expr->literal.int_val = element_size(var) * (var->is_array ? var->array_size : 1);
+}
+
+int int_literal(Expression *expr, long long *value) {
+    if (!expr || expr->type != EXPR_LITERAL || expr->literal.lit_type != TYPE_INT) return 0;
+    *value = expr->literal.int_val;
+    return 1;
+}
+
+// base + offset, folding literals; a NULL offset is zero
+Expression *add_offset(Expression *base, Expression *offset) {
+    long long value;
+    if (!offset) return clone_expression(base);
+    if (int_literal(offset, &value)) return offset_expression(base, (int)value);
+    if (int_literal(base, &value)) return offset_expression(offset, (int)value);
+    return make_binary(OP_ADD, clone_expression(base), clone_expression(offset));
+}
+
+// The array a name refers to, or NULL
+Variable *lookup_array(SliceContext *ctx, Expression *expr) {
+    if (expr->type != EXPR_VARIABLE) return NULL;
+    Variable *array = lookup_variable(ctx->prog, ctx->func, expr->var_name);
+    return array && array->is_array && !array->struct_name ? array : NULL;
+}
+
+// The array a pointer argument points into: a, a + k or k + a
+Variable *match_array_pointer(SliceContext *ctx, Expression *arg, const char **name, Expression **offset) {
+    Expression *base = arg;
+    *offset = NULL;
+    if (arg->type == EXPR_BINARY && arg->binary.op == OP_ADD) {
+        int left_is_array = lookup_array(ctx, arg->binary.left) != NULL;
+        base = left_is_array ? arg->binary.left : arg->binary.right;
+        *offset = left_is_array ? arg->binary.right : arg->binary.left;
+    }
+    Variable *array = lookup_array(ctx, base);
+    if (array) *name = base->var_name;
+    return array;
+}
+
+// Number of elements in a byte count: n * sizeof(T), sizeof(a) or a constant
+Expression *element_count(Expression *bytes, int size) {
+    long long value;
+    if (size == 1) return clone_expression(bytes);
+    if (int_literal(bytes, &value)) return value % size == 0 ? make_int_literal((int)(value / size)) : NULL;
+    if (bytes->type == EXPR_BINARY && bytes->binary.op == OP_MUL) {
+        if (int_literal(bytes->binary.right, &value) && value == size) return clone_expression(bytes->binary.left);
+        if (int_literal(bytes->binary.left, &value) && value == size) return clone_expression(bytes->binary.right);
+    }
+    return NULL;
+}
+
+// The element memset stores: each byte set to value
+Expression *memset_element(SliceContext *ctx, Variable *array, Expression *value) {
+    long long byte;
+    if (value->type == EXPR_LITERAL && value->literal.lit_type == TYPE_CHAR) {
+        byte = (unsigned char)value->literal.char_val;
+    } else if (value->type == EXPR_UNARY && value->unary.op == OP_NEGATE && int_literal(value->unary.expr, &byte)) {
+        byte = -byte;  // memset(a, -1, ...) sets every byte to 0xFF
+    } else if (!int_literal(value, &byte)) {
+        if (expression_has_side_effects(ctx->prog, value)) return NULL;
+        VariableType type = expression_type(ctx->prog, ctx->func, value);
+        // A char computed at run time is already the string a char element holds
+        if (array->type == TYPE_CHAR && type == TYPE_CHAR) return clone_expression(value);
+        // An int computed at run time: (v & 0xFF) * 0x01010101, wrapped by the integer lowering
+        if (array->type != TYPE_INT || type != TYPE_INT) return NULL;
+        return make_binary(OP_MUL, make_binary(OP_BIT_AND, clone_expression(value), make_int_literal(0xFF)),
+                           make_int_literal(0x01010101));
+    }
+    byte &= 0xFF;
+    if (array->type == TYPE_INT) return make_int_literal((int)(unsigned int)(byte * 0x01010101u));
+    if (array->type != TYPE_FLOAT && array->type != TYPE_CHAR) return NULL;
+    if (array->type == TYPE_FLOAT && byte != 0) return NULL;
+
+    Expression *element = create_expression();
+    element->type = EXPR_LITERAL;
+    element->literal.lit_type = array->type;
+    if (array->type == TYPE_FLOAT) {
+        element->literal.float_val = 0.0;
+    } else {
+        // Characters are Python strings; a zero byte is the terminator ''
+        element->literal.char_val = (char)byte;
+    }
+    return element;
+}
+
+// dst[offset:offset + count] = values
+Expression *slice_assignment(const char *name, Expression *offset, Expression *count, Expression *values) {
+    Expression *start = offset ? clone_expression(offset) : NULL;
+    Expression *stop = offset ? add_offset(offset, count) : clone_expression(count);
+    return make_binary(OP_ASSIGN, make_slice(name, start, stop), values);
+}
+
+// [element] * count
+Expression *repeated_list(Expression *element, Expression *count) {
+    return make_binary(OP_MUL, make_list(&element, 1), count);
+}
+
+// Lower memcpy, memmove and memset; NULL if the call cannot be expressed as a slice
+Expression *lower_memory_call(SliceContext *ctx, Expression *call) {
+    const char *name = call->call.func_name;
+    int is_copy = strcmp(name, "memcpy") == 0 || strcmp(name, "memmove") == 0;
+    if (call->call.arg_count != 3) return NULL;
+
+    const char *dst_name, *src_name;
+    Expression *dst_offset, *src_offset;
+    Variable *dst = match_array_pointer(ctx, call->call.args[0], &dst_name, &dst_offset);
+    if (!dst) return NULL;
+    Expression *count = element_count(call->call.args[2], element_size(dst));
+    if (!count) return NULL;
+
+    if (is_copy) {
+        Variable *src = match_array_pointer(ctx, call->call.args[1], &src_name, &src_offset);
+        if (!src || src->type != dst->type) return NULL;
+        Expression *source = make_slice(src_name, src_offset ? clone_expression(src_offset) : NULL,
+                                        src_offset ? add_offset(src_offset, count) : clone_expression(count));
+        return slice_assignment(dst_name, dst_offset, count, source);
+    }
+    Expression *element = memset_element(ctx, dst, call->call.args[1]);
+    if (!element) return NULL;
+    return slice_assignment(dst_name, dst_offset, count, repeated_list(element, clone_expression(count)));
+}
+
+void lower_memory_statement(Statement *stmt, void *ctx) {
+    SliceContext *slices = ctx;
+    if (stmt->type != STMT_EXPR || stmt->expr->type != EXPR_CALL) return;
+    const char *name = stmt->expr->call.func_name;
+    if (strcmp(name, "memcpy") != 0 && strcmp(name, "memmove") != 0 && strcmp(name, "memset") != 0) return;
+
+    Expression *lowered = lower_memory_call(slices, stmt->expr);
+    if (lowered) {
+        stmt->expr = lowered;
+    } else {
+        // Python has no such function, so emitting the call would only fail at run time
+        fprintf(stderr, "Error: line %d: %s call could not be translated to a slice assignment\n", stmt->line, name);
+        slices->failures++;
+    }
+}
+
+// Turn memcpy/memmove/memset calls into slice assignments; returns the number of calls left untranslated
+int lower_memory_calls(Program *prog) {
+    int failures = 0;
+    for (int i = 0; i < prog->function_count; i++) {
+        SliceContext ctx = { prog, prog->functions[i], 0 };
+        visit_statement_expressions(prog->functions[i]->body, resolve_sizeof, &ctx);
+        visit_statements(prog->functions[i]->body, lower_memory_statement, &ctx);
+        failures += ctx.failures;
+    }
+    return failures;
+}
+
+// Match var, var + e, e + var or var - e, where e does not involve var
+int match_index_offset(Expression *index, const char *var, Expression **offset) {
+    *offset = NULL;
+    if (index->type == EXPR_VARIABLE) return strcmp(index->var_name, var) == 0;
+    if (index->type != EXPR_BINARY || (index->binary.op != OP_ADD && index->binary.op != OP_SUB)) return 0;
+
+    Expression *left = index->binary.left;
+    Expression *right = index->binary.right;
+    if (left->type == EXPR_VARIABLE && strcmp(left->var_name, var) == 0 && !expression_mentions(right, var)) {
+        long long value;
+        if (index->binary.op == OP_ADD) *offset = right;
+        else if (int_literal(right, &value)) *offset = make_int_literal((int)-value);
+        else return 0;
+        return 1;
+    }
+    if (index->binary.op == OP_ADD && right->type == EXPR_VARIABLE && strcmp(right->var_name, var) == 0 &&
+        !expression_mentions(left, var)) {
+        *offset = left;
+        return 1;
+    }
+    return 0;
+}
+
+// A copy within one array matches memmove only if every element is read before it is overwritten
+int copy_order_is_safe(Expression *dst_offset, Expression *src_offset, int step) {
+    long long dst = 0, src = 0;
+    if ((dst_offset && !int_literal(dst_offset, &dst)) || (src_offset && !int_literal(src_offset, &src))) return 0;
+    return step > 0 ? dst <= src : dst >= src;
+}
+
+// Rewrite for i in range(a, b[, -1]): dst[i + k] = src[i + m] (or = v) as one slice assignment
+Statement *lower_copy_loop(Statement *stmt, void *ctx) {
+    SliceContext *slices = ctx;
+    if (stmt->type != STMT_FOR_IN || stmt->for_in.else_branch) return stmt;
+    Expression *range = stmt->for_in.iterable;
+    if (range->type != EXPR_CALL || strcmp(range->call.func_name, "range") != 0 || range->call.arg_count < 2) {
+        return stmt;
+    }
+    long long step = 1;
+    if (range->call.arg_count == 3 && (!int_literal(range->call.args[2], &step) || step != -1)) return stmt;
+
+    Statement *store = single_statement(stmt->for_in.body);
+    if (!store || store->type != STMT_EXPR || store->expr->type != EXPR_BINARY || store->expr->binary.op != OP_ASSIGN ||
+        store->expr->binary.left->type != EXPR_ARRAY_ACCESS) {
+        return stmt;
+    }
+    const char *var = stmt->for_in.var.name;
+    Expression *target = store->expr->binary.left;
+    Expression *value = store->expr->binary.right;
+    const char *dst_name = target->array_access.array_name;
+    Variable *dst = lookup_variable(slices->prog, slices->func, dst_name);
+    Expression *dst_offset;
+    if (!dst || !dst->is_array || dst->struct_name) return stmt;
+    if (!match_index_offset(target->array_access.index, var, &dst_offset)) return stmt;
+    if (dst_offset && (expression_uses_array(dst_offset, dst_name) || expression_has_side_effects(slices->prog, dst_offset))) {
+        return stmt;
+    }
+
+    // Iterations cover first..last in order, so the slice is [low:high)
+    Expression *low = step > 0 ? range->call.args[0] : offset_expression(range->call.args[1], 1);
+    Expression *high = step > 0 ? range->call.args[1] : offset_expression(range->call.args[0], 1);
+    Expression *start = add_offset(low, dst_offset);
+    if (start->type == EXPR_LITERAL && start->literal.int_val < 0) return stmt;
+    Expression *stop = slice_stop(add_offset(high, dst_offset));
+    if (!stop) return stmt;
+
+    Expression *values;
+    if (value->type == EXPR_ARRAY_ACCESS) {
+        const char *src_name = value->array_access.array_name;
+        Variable *src = lookup_variable(slices->prog, slices->func, src_name);
+        Expression *src_offset;
+        if (!src || !src->is_array || src->struct_name || src->type != dst->type) return stmt;
+        if (!match_index_offset(value->array_access.index, var, &src_offset)) return stmt;
+        if (src_offset && (expression_uses_array(src_offset, dst_name) || expression_has_side_effects(slices->prog, src_offset))) {
+            return stmt;
+        }
+        if (strcmp(src_name, dst_name) == 0 && !copy_order_is_safe(dst_offset, src_offset, (int)step)) return stmt;
+        values = make_slice(src_name, add_offset(low, src_offset), slice_stop(add_offset(high, src_offset)));
+        if (!values->slice.stop) return stmt;
+    } else {
+        // A fill: the value is the same on every iteration
+        if (expression_mentions(value, var) || expression_uses_array(value, dst_name) ||
+            expression_has_side_effects(slices->prog, value) || expression_may_trap(slices->prog, value)) {
+            return stmt;
+        }
+        long long first, last;
+        Expression *count = int_literal(low, &first) && int_literal(high, &last) ?
+            make_int_literal((int)(last - first)) : make_binary(OP_SUB, clone_expression(high), clone_expression(low));
+        values = repeated_list(clone_expression(value), count);
+    }
+    return make_expression_statement(make_binary(OP_ASSIGN, make_slice(dst_name, start, stop), values));
+}
+
+// Turn element-wise copy, shift and fill loops into slice assignments
+void lower_copy_loops(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        SliceContext ctx = { prog, prog->functions[i], 0 };
+        prog->functions[i]->body = transform_statements(prog->functions[i]->body, lower_copy_loop, &ctx);
+    }
+}
@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Function specialization. A helper called with a constant mode or stride
+//     int scale(int x, int mode) { if (mode == 1) return x * 2; return x + 1; }
+//     ... scale(v, 1) ...
+// gets a clone with the constant substituted, folded and its dead branches
+// removed, and the call site is redirected to it:
+//     def scale_mode_1(x: int) -> int: return x * 2
+//     ... scale_mode_1(v) ...
+// One clone is made per distinct pattern of constant arguments, at most
+// --max-clones per function, and only when substituting removes a branch.
+// With --profile-use, calls in or to functions that never ran are skipped.
+// Calls whose arguments are all constant are left to compile-time evaluation.
+
+#define MAX_NAME 256
+
+typedef struct {
+    Function *original;
+    char *suffix;        // Fixed parameters and their values, e.g. "_mode_1"
+    Function *clone;     // NULL when specializing did not pay off
+} Specialization;
+
+typedef struct {
+    Program *prog;
+    Specialization *specs;
+    int spec_count;
+    Function **worklist;  // Functions whose call sites still have to be scanned
+    int work_count;
+} SpecializeContext;
+
+typedef struct {
+    const char *name;
+    int value;
+} ParameterValue;
+
+// Replace every read of a parameter with its constant value
+void substitute_parameter(Expression *expr, void *ctx) {
+    ParameterValue *param = ctx;
+    if (expr->type == EXPR_VARIABLE && strcmp(expr->var_name, param->name) == 0) {
+        expr->type = EXPR_LITERAL;
+        expr->literal.lit_type = TYPE_INT;
+        expr->literal.int_val = param->value;
+    }
+}
+
+// Fold constant subexpressions bottom-up
+void fold_expression(Program *prog, Expression **slot) {
+    Expression *expr = *slot;
+    if (!expr) return;
+
+    switch (expr->type) {
+        case EXPR_BINARY:
+            fold_expression(prog, &expr->binary.left);
+            fold_expression(prog, &expr->binary.right);
+            break;
+        case EXPR_UNARY:
+            fold_expression(prog, &expr->unary.expr);
+            break;
+        case EXPR_CALL:
+            for (int i = 0; i < expr->call.arg_count; i++) {
+                fold_expression(prog, &expr->call.args[i]);
+            }
+            break;
+        case EXPR_ARRAY_ACCESS:
+            fold_expression(prog, &expr->array_access.index);
+            return;
+        default:
+            return;
+    }
+
+    long long value;
+    if (evaluate_constant(prog, expr, &value)) *slot = make_int_literal((int)value);
+}
+
+void fold_statement(Statement *stmt, void *ctx) {
+    Program *prog = ctx;
+    switch (stmt->type) {
+        case STMT_EXPR:
+            fold_expression(prog, &stmt->expr);
+            break;
+        case STMT_VAR_DECL:
+            fold_expression(prog, &stmt->var_decl.initializer);
+            break;
+        case STMT_IF:
+            fold_expression(prog, &stmt->if_stmt.condition);
+            break;
+        case STMT_WHILE:
+            fold_expression(prog, &stmt->while_stmt.condition);
+            break;
+        case STMT_FOR:
+            fold_expression(prog, &stmt->for_stmt.condition);
+            fold_expression(prog, &stmt->for_stmt.increment);
+            break;
+        case STMT_RETURN:
+            fold_expression(prog, &stmt->return_value);
+            break;
+        case STMT_PRINT:
+            for (int i = 0; i < stmt->print.arg_count; i++) {
+                fold_expression(prog, &stmt->print.args[i]);
+            }
+            break;
+        case STMT_FOR_IN:
+            fold_expression(prog, &stmt->for_in.iterable);
+            break;
+        default:
+            break;
+    }
+}
+
+int literal_truth(Expression *expr, int *truth) {
+    if (!expr || expr->type != EXPR_LITERAL || expr->literal.lit_type != TYPE_INT) return 0;
+    *truth = expr->literal.int_val != 0;
+    return 1;
+}
+
+// Drop if-branches and loops whose condition is a known constant, and
+// statements after a return that a removed branch left behind
+Statement *remove_dead_branch(Statement *stmt, void *ctx) {
+    int *removed = ctx;
+    int truth;
+    switch (stmt->type) {
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count - 1; i++) {
+                if (statement_always_returns(stmt->block.statements[i])) {
+                    stmt->block.stmt_count = i + 1;
+                    break;
+                }
+            }
+            return stmt;
+        case STMT_IF:
+            if (!literal_truth(stmt->if_stmt.condition, &truth)) return stmt;
+            (*removed)++;
+            if (truth) return stmt->if_stmt.then_branch;
+            return stmt->if_stmt.else_branch ? stmt->if_stmt.else_branch : make_block();
+        case STMT_WHILE:
+            if (!literal_truth(stmt->while_stmt.condition, &truth) || truth) return stmt;
+            (*removed)++;
+            return make_block();
+        case STMT_FOR:
+            if (!literal_truth(stmt->for_stmt.condition, &truth) || truth) return stmt;
+            (*removed)++;
+            return stmt->for_stmt.initializer ? stmt->for_stmt.initializer : make_block();
+        default:
+            return stmt;
+    }
+}
+
+// Fold constants and remove dead branches; returns the number of branches removed
+int simplify_statement(Program *prog, Statement **stmt) {
+    int removed = 0;
+    visit_statements(*stmt, fold_statement, prog);
+    *stmt = transform_statements(*stmt, remove_dead_branch, &removed);
+    return removed;
+}
+
+typedef struct {
+    const char *name;
+    int found;
+} ShadowScan;
+
+void find_shadowing_decl(Statement *stmt, void *ctx) {
+    ShadowScan *scan = ctx;
+    if ((stmt->type == STMT_VAR_DECL && strcmp(stmt->var_decl.var.name, scan->name) == 0) ||
+        (stmt->type == STMT_FOR_IN && strcmp(stmt->for_in.var.name, scan->name) == 0)) {
+        scan->found = 1;
+    }
+}
+
+// A parameter can be fixed when the body only reads it
+int can_specialize_parameter(Function *func, int index) {
+    Variable *param = &func->params[index];
+    if (param->type != TYPE_INT || param->is_array || param->struct_name) return 0;
+    if (statement_writes_variable(func->body, param->name)) return 0;
+    // A local of the same name would shadow it in part of the body
+    ShadowScan scan = { param->name, 0 };
+    visit_statements(func->body, find_shadowing_decl, &scan);
+    return !scan.found;
+}
+
+// Clone func with the fixed parameters substituted; NULL if nothing simplifies
+Function *build_clone(Program *prog, Function *func, long long *values, int *fixed, const char *suffix) {
+    Function *clone = create_function();
+    clone->return_type = func->return_type;
+    clone->line = func->line;
+    clone->source_file = func->source_file;
+    clone->params = malloc((func->param_count + 1) * sizeof(Variable));
+    clone->body = clone_statement(func->body);
+    for (int i = 0; i < func->param_count; i++) {
+        if (!fixed[i]) {
+            clone->params[clone->param_count] = func->params[i];
+            clone->params[clone->param_count++].name = strdup(func->params[i].name);
+            continue;
+        }
+        ParameterValue param = { func->params[i].name, (int)values[i] };
+        visit_statement_expressions(clone->body, substitute_parameter, &param);
+    }
+    if (simplify_statement(prog, &clone->body) == 0) {
+        for (int i = 0; i < clone->param_count; i++) {
+            free(clone->params[i].name);
+        }
+        free(clone->params);
+        free(clone);
+        return NULL;
+    }
+
+    char name[MAX_NAME];
+    snprintf(name, sizeof(name), "%s%s", func->name, suffix);
+    while (find_function(prog, name)) {
+        strncat(name, "_", sizeof(name) - strlen(name) - 1);
+    }
+    clone->name = strdup(name);
+    return clone;
+}
+
+// Place a clone after the function it was made from and its earlier clones
+void insert_clone(Program *prog, Function *original, Function *clone, int earlier_clones) {
+    prog->functions = realloc(prog->functions, (prog->function_count + 1) * sizeof(Function*));
+    int position = 0;
+    while (prog->functions[position] != original) position++;
+    position += 1 + earlier_clones;
+    memmove(&prog->functions[position + 1], &prog->functions[position],
+            (prog->function_count - position) * sizeof(Function*));
+    prog->functions[position] = clone;
+    prog->function_count++;
+}
+
+int clone_count(SpecializeContext *ctx, Function *original) {
+    int count = 0;
+    for (int i = 0; i < ctx->spec_count; i++) {
+        if (ctx->specs[i].original == original && ctx->specs[i].clone) count++;
+    }
+    return count;
+}
+
+// The clone for a pattern of constant arguments, creating it if allowed
+Function *find_or_make_clone(SpecializeContext *ctx, Function *func, long long *values, int *fixed) {
+    char suffix[MAX_NAME] = "";
+    for (int i = 0; i < func->param_count; i++) {
+        if (!fixed[i]) continue;
+        size_t used = strlen(suffix);
+        snprintf(suffix + used, sizeof(suffix) - used, "_%s_%s%lld", func->params[i].name,
+                 values[i] < 0 ? "m" : "", values[i] < 0 ? -values[i] : values[i]);
+    }
+    for (int i = 0; i < ctx->spec_count; i++) {
+        if (ctx->specs[i].original == func && strcmp(ctx->specs[i].suffix, suffix) == 0) return ctx->specs[i].clone;
+    }
+    int earlier_clones = clone_count(ctx, func);
+    if (earlier_clones >= optimizer_options.max_clones) return NULL;
+
+    Function *clone = build_clone(ctx->prog, func, values, fixed, suffix);
+    ctx->specs = realloc(ctx->specs, (ctx->spec_count + 1) * sizeof(Specialization));
+    ctx->specs[ctx->spec_count].original = func;
+    ctx->specs[ctx->spec_count].suffix = strdup(suffix);
+    ctx->specs[ctx->spec_count].clone = clone;
+    ctx->spec_count++;
+    if (clone) {
+        insert_clone(ctx->prog, func, clone, earlier_clones);
+        ctx->worklist = realloc(ctx->worklist, (ctx->work_count + 1) * sizeof(Function*));
+        ctx->worklist[ctx->work_count++] = clone;
+    }
+    return clone;
+}
+
+typedef struct {
+    SpecializeContext *spec;
+    Function *caller;
+} CallSiteScan;
+
+// Redirect a call with some (but not all) constant arguments to a clone
+void specialize_call(Expression *expr, void *ctx) {
+    CallSiteScan *scan = ctx;
+    if (expr->type != EXPR_CALL) return;
+    Function *callee = find_function(scan->spec->prog, expr->call.func_name);
+    if (!callee || callee->param_count != expr->call.arg_count || callee->param_count < 2) return;
+    // Clones of code the profiled run never reached only take up --max-clones slots
+    if (function_is_cold(callee) || function_is_cold(scan->caller)) return;
+
+    int count = callee->param_count;
+    long long *values = calloc(count, sizeof(long long));
+    int *fixed = calloc(count, sizeof(int));
+    int fixed_count = 0;
+    for (int i = 0; i < count; i++) {
+        if (can_specialize_parameter(callee, i) && constant_argument(scan->caller, expr->call.args[i], &values[i])) {
+            fixed[i] = 1;
+            fixed_count++;
+        }
+    }
+
+    Function *clone = fixed_count > 0 && fixed_count < count ? find_or_make_clone(scan->spec, callee, values, fixed) : NULL;
+    if (clone) {
+        int kept = 0;
+        for (int i = 0; i < count; i++) {
+            if (!fixed[i]) expr->call.args[kept++] = expr->call.args[i];
+        }
+        expr->call.arg_count = kept;
+        expr->call.func_name = strdup(clone->name);
+    }
+    free(values);
+    free(fixed);
+}
+
+// Clone functions for the constant arguments they are called with
+void specialize_functions(Program *prog) {
+    if (optimizer_options.max_clones <= 0) return;
+
+    SpecializeContext ctx = { prog, NULL, 0, NULL, 0 };
+    ctx.worklist = malloc((prog->function_count + 1) * sizeof(Function*));
+    for (int i = 0; i < prog->function_count; i++) {
+        ctx.worklist[ctx.work_count++] = prog->functions[i];
+    }
+    // Clones are scanned too, so constants passed on through recursion are specialized as well
+    for (int i = 0; i < ctx.work_count; i++) {
+        CallSiteScan scan = { &ctx, ctx.worklist[i] };
+        visit_statement_expressions(ctx.worklist[i]->body, specialize_call, &scan);
+    }
+
+    for (int i = 0; i < ctx.spec_count; i++) {
+        free(ctx.specs[i].suffix);
+    }
+    free(ctx.specs);
+    free(ctx.worklist);
+}
@@ -0,0 +1,449 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "../include/optimizer.h"
+
+// Lowering of switch statements. Python has no statement that dispatches on
+// a value in constant time (match compares its literal patterns one by one),
+// so each switch becomes the cheapest of three shapes:
+//   - an if/elif chain, for small or sparse switches and at -O0;
+//   - a binary decision tree over the sorted case values, when it needs
+//     fewer comparisons per dispatch than the chain:
+//         if state < 4:
+//             if state < 2: ...
+//   - a lookup table, when every case only stores a constant into the same
+//     variable: state = _step_switch0[state - 1] after one range check.
+// Each case runs the statements of the cases it falls into up to the first
+// break. A break that is not a case's last statement (inside an if) leaves a
+// one-shot while True: loop around the dispatch, and a continue of an
+// enclosing loop then goes through a flag, since it would otherwise continue
+// that wrapper.
+
+#define SWITCH_PREFIX "_sw"
+#define SWITCH_TABLE_MIN 4  // Fewer labels dispatch as fast through a chain or tree
+#define SWITCH_GROWTH 64    // Statements a decision tree may add by copying case bodies
+
+typedef struct {
+    Program *prog;
+    Function *func;
+    int temp_count;
+    int table_count;
+} SwitchContext;
+
+// Consecutive case values that select the same group
+typedef struct {
+    long long lo;
+    long long hi;
+    int group;
+} LabelRange;
+
+typedef struct {
+    Expression *value;      // The switch value, or the temporary holding it
+    VariableType type;      // TYPE_INT or TYPE_CHAR labels
+    LabelRange *ranges;     // Sorted by value
+    int range_count;
+    int label_count;
+    Statement **entries;    // Statements each group runs, fall-through included
+    int default_index;      // Group with the default label, or -1
+    double cost;            // Comparisons summed over every label (decision tree)
+} SwitchDispatch;
+
+Statement *make_if_statement(Expression *condition, Statement *then_branch, Statement *else_branch) {
+    Statement *stmt = create_statement();
+    stmt->type = STMT_IF;
+    stmt->if_stmt.condition = condition;
+    stmt->if_stmt.then_branch = then_branch;
+    stmt->if_stmt.else_branch = else_branch;
+    return stmt;
+}
+
+// Append a group's statements up to its first top-level break, flattening
+// braced case bodies; returns 1 once control cannot reach the next group
+int append_case_statements(Statement *block, Statement *stmt) {
+    if (!stmt) return 0;
+    if (stmt->type == STMT_BLOCK) {
+        for (int i = 0; i < stmt->block.stmt_count; i++) {
+            if (append_case_statements(block, stmt->block.statements[i])) return 1;
+        }
+        return 0;
+    }
+    if (stmt->type == STMT_BREAK) return 1;
+    block_append(block, clone_statement(stmt));
+    return stmt->type == STMT_RETURN || stmt->type == STMT_CONTINUE;
+}
+
+// What runs when a group is selected: its statements and those it falls into
+Statement *case_entry(Statement *sw, int index) {
+    Statement *entry = make_block();
+    for (int i = index; i < sw->switch_stmt.case_count; i++) {
+        if (append_case_statements(entry, sw->switch_stmt.cases[i].body)) break;
+    }
+    return entry;
+}
+
+// A break or continue that would apply to the switch rather than to a loop inside it
+int contains_switch_jump(Statement *stmt, StatementType type) {
+    if (!stmt) return 0;
+    switch (stmt->type) {
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return stmt->type == type;
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                if (contains_switch_jump(stmt->block.statements[i], type)) return 1;
+            }
+            return 0;
+        case STMT_IF:
+            return contains_switch_jump(stmt->if_stmt.then_branch, type) ||
+                   contains_switch_jump(stmt->if_stmt.else_branch, type);
+        default:
+            return 0;
+    }
+}
+
+// continue becomes flag = 1; break out of the one-shot loop
+Statement *replace_switch_continue(Statement *stmt, const char *flag) {
+    if (!stmt) return NULL;
+    switch (stmt->type) {
+        case STMT_CONTINUE: {
+            Statement *block = make_block();
+            block_append(block, make_expression_statement(
+                make_binary(OP_ASSIGN, make_variable(flag), make_int_literal(1))));
+            Statement *exit = create_statement();
+            exit->type = STMT_BREAK;
+            block_append(block, exit);
+            return block;
+        }
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                stmt->block.statements[i] = replace_switch_continue(stmt->block.statements[i], flag);
+            }
+            return stmt;
+        case STMT_IF:
+            stmt->if_stmt.then_branch = replace_switch_continue(stmt->if_stmt.then_branch, flag);
+            stmt->if_stmt.else_branch = replace_switch_continue(stmt->if_stmt.else_branch, flag);
+            return stmt;
+        default:
+            return stmt;
+    }
+}
+
+// The constant of a case label: an int or char literal, possibly negated
+int label_constant(Expression *label, VariableType *type, long long *value) {
+    int negate = 0;
+    if (label->type == EXPR_UNARY && label->unary.op == OP_NEGATE) {
+        negate = 1;
+        label = label->unary.expr;
+    }
+    if (label->type != EXPR_LITERAL) return 0;
+    if (label->literal.lit_type == TYPE_INT) {
+        *value = label->literal.int_val;
+    } else if (label->literal.lit_type == TYPE_CHAR && !negate) {
+        *value = (unsigned char)label->literal.char_val;
+    } else {
+        return 0;
+    }
+    *type = label->literal.lit_type;
+    if (negate) *value = -*value;
+    return 1;
+}
+
+Expression *make_label_literal(VariableType type, long long value) {
+    if (type == TYPE_INT) return make_int_literal((int)value);
+    Expression *expr = create_expression();
+    expr->type = EXPR_LITERAL;
+    expr->literal.lit_type = TYPE_CHAR;
+    expr->literal.char_val = (char)value;
+    return expr;
+}
+
+int compare_label_ranges(const void *a, const void *b) {
+    long long x = ((const LabelRange *)a)->lo;
+    long long y = ((const LabelRange *)b)->lo;
+    return (x > y) - (x < y);
+}
+
+// Sort the constant labels outside the default group and merge runs of
+// consecutive values into ranges; 0 when a label is not a constant
+int collect_label_ranges(Statement *sw, SwitchDispatch *dispatch) {
+    int capacity = 0;
+    for (int i = 0; i < sw->switch_stmt.case_count; i++) capacity += sw->switch_stmt.cases[i].label_count;
+    dispatch->ranges = malloc((capacity + 1) * sizeof(LabelRange));
+    dispatch->range_count = 0;
+    dispatch->label_count = 0;
+    for (int i = 0; i < sw->switch_stmt.case_count; i++) {
+        SwitchCase *group = &sw->switch_stmt.cases[i];
+        if (i == dispatch->default_index) continue;
+        for (int j = 0; j < group->label_count; j++) {
+            VariableType type;
+            long long value;
+            if (!label_constant(group->labels[j], &type, &value)) return 0;
+            if (dispatch->label_count > 0 && type != dispatch->type) return 0;
+            dispatch->type = type;
+            LabelRange range = { value, value, i };
+            dispatch->ranges[dispatch->label_count++] = range;
+        }
+    }
+    if (dispatch->label_count == 0) return 0;
+    qsort(dispatch->ranges, dispatch->label_count, sizeof(LabelRange), compare_label_ranges);
+    for (int i = 0; i < dispatch->label_count; i++) {
+        LabelRange *last = dispatch->range_count > 0 ? &dispatch->ranges[dispatch->range_count - 1] : NULL;
+        LabelRange range = dispatch->ranges[i];
+        if (last && range.lo == last->hi) return 0;  // Duplicate case value
+        if (last && range.lo == last->hi + 1 && range.group == last->group) {
+            last->hi = range.lo;
+        } else {
+            dispatch->ranges[dispatch->range_count++] = range;
+        }
+    }
+    return 1;
+}
+
+// if value == a or value == b: ... elif ...: ... else: default
+Statement *switch_chain(Statement *sw, SwitchDispatch *dispatch, double *cost) {
+    int default_index = dispatch->default_index;
+    Statement *chain = default_index >= 0 ? clone_statement(dispatch->entries[default_index]) : NULL;
+    int tests = 0;
+    *cost = 0;
+    for (int i = sw->switch_stmt.case_count - 1; i >= 0; i--) {
+        SwitchCase *group = &sw->switch_stmt.cases[i];
+        if (i == default_index || group->label_count == 0) continue;
+        // Without a default, a group that does nothing needs no test
+        if (default_index < 0 && dispatch->entries[i]->block.stmt_count == 0) continue;
+        Expression *cond = NULL;
+        for (int j = group->label_count - 1; j >= 0; j--) {
+            Expression *test = make_binary(OP_EQ, clone_expression(dispatch->value), clone_expression(group->labels[j]));
+            cond = cond ? make_binary(OP_OR, test, cond) : test;
+        }
+        chain = make_if_statement(cond, clone_statement(dispatch->entries[i]), chain);
+    }
+    // Every label is tested after all the labels of earlier groups
+    for (int i = 0; i < sw->switch_stmt.case_count; i++) {
+        if (i == default_index) continue;
+        for (int j = 0; j < sw->switch_stmt.cases[i].label_count; j++) {
+            *cost += ++tests;
+        }
+    }
+    return chain ? chain : make_block();
+}
+
+// Decision tree over ranges[first..last]; the value is known to lie in [known_lo, known_hi]
+Statement *switch_tree(SwitchDispatch *dispatch, int first, int last, long long known_lo, long long known_hi, int depth) {
+    if (first == last) {
+        LabelRange *range = &dispatch->ranges[first];
+        Expression *cond = NULL;
+        int tests = 0;
+        if (range->lo == range->hi && (known_lo < range->lo || known_hi > range->hi)) {
+            cond = make_binary(OP_EQ, clone_expression(dispatch->value), make_label_literal(dispatch->type, range->lo));
+            tests = 1;
+        } else {
+            if (known_lo < range->lo) {
+                cond = make_binary(OP_GTE, clone_expression(dispatch->value), make_label_literal(dispatch->type, range->lo));
+                tests++;
+            }
+            if (known_hi > range->hi) {
+                Expression *test = make_binary(OP_LTE, clone_expression(dispatch->value),
+                                               make_label_literal(dispatch->type, range->hi));
+                cond = cond ? make_binary(OP_AND, cond, test) : test;
+                tests++;
+            }
+        }
+        dispatch->cost += (double)(depth + tests) * (range->hi - range->lo + 1);
+        Statement *body = clone_statement(dispatch->entries[range->group]);
+        if (!cond) return body;
+        Statement *miss = dispatch->default_index >= 0 ? clone_statement(dispatch->entries[dispatch->default_index]) : NULL;
+        return make_if_statement(cond, body, miss);
+    }
+    int mid = (first + last + 1) / 2;
+    long long split = dispatch->ranges[mid].lo;
+    Expression *cond = make_binary(OP_LT, clone_expression(dispatch->value), make_label_literal(dispatch->type, split));
+    return make_if_statement(cond, switch_tree(dispatch, first, mid - 1, known_lo, split - 1, depth + 1),
+                             switch_tree(dispatch, mid, last, split, known_hi, depth + 1));
+}
+
+// The variable and constant of a group that only does var = constant
+int constant_store(Statement *entry, const char **var, long long *value) {
+    if (entry->block.stmt_count != 1) return 0;
+    Statement *stmt = entry->block.statements[0];
+    if (stmt->type != STMT_EXPR || stmt->expr->type != EXPR_BINARY || stmt->expr->binary.op != OP_ASSIGN) return 0;
+    Expression *target = stmt->expr->binary.left;
+    VariableType type;
+    if (target->type != EXPR_VARIABLE || !label_constant(stmt->expr->binary.right, &type, value)) return 0;
+    if (type != TYPE_INT || (*var && strcmp(*var, target->var_name) != 0)) return 0;
+    *var = target->var_name;
+    return 1;
+}
+
+// var = _f_switchN[value - lo] when every group stores a constant into var
+Statement *switch_table(SwitchContext *lowering, SwitchDispatch *dispatch) {
+    if (dispatch->type != TYPE_INT || dispatch->label_count < SWITCH_TABLE_MIN) return NULL;
+    long long lo = dispatch->ranges[0].lo;
+    long long hi = dispatch->ranges[dispatch->range_count - 1].hi;
+    long long span = hi - lo + 1;
+    if (span > 2LL * dispatch->label_count) return NULL;
+    // Values between the labels read the default's constant
+    if (dispatch->default_index < 0 && span != dispatch->label_count) return NULL;
+
+    const char *var = NULL;
+    long long fill = 0;
+    if (dispatch->default_index >= 0 && !constant_store(dispatch->entries[dispatch->default_index], &var, &fill)) return NULL;
+    long long *values = malloc(span * sizeof(long long));
+    for (long long i = 0; i < span; i++) values[i] = fill;
+    for (int i = 0; i < dispatch->range_count; i++) {
+        LabelRange *range = &dispatch->ranges[i];
+        long long value;
+        if (!constant_store(dispatch->entries[range->group], &var, &value)) {
+            free(values);
+            return NULL;
+        }
+        for (long long v = range->lo; v <= range->hi; v++) values[v - lo] = value;
+    }
+    Variable *target = lookup_variable(lowering->prog, lowering->func, var);
+    if (!target || target->is_array || target->struct_name || target->type != TYPE_INT) {
+        free(values);
+        return NULL;
+    }
+
+    char name[256];
+    snprintf(name, sizeof(name), "_%s_switch%d", lowering->func->name, lowering->table_count++);
+    add_global_table(lowering->prog, name, TYPE_INT, (int)span);
+    Expression **elements = malloc(span * sizeof(Expression*));
+    for (long long i = 0; i < span; i++) elements[i] = make_int_literal((int)values[i]);
+    if (!lowering->prog->init_block) {
+        lowering->prog->init_block = make_block();
+    }
+    // Filled in place: functions may have bound the list as a default argument
+    block_append(lowering->prog->init_block, make_expression_statement(
+        make_binary(OP_ASSIGN, make_slice(name, NULL, NULL), make_list(elements, (int)span))));
+    free(elements);
+    free(values);
+
+    Expression *in_range = make_binary(OP_AND,
+        make_binary(OP_GTE, clone_expression(dispatch->value), make_int_literal((int)lo)),
+        make_binary(OP_LTE, clone_expression(dispatch->value), make_int_literal((int)hi)));
+    Expression *slot = create_expression();
+    slot->type = EXPR_ARRAY_ACCESS;
+    slot->array_access.array_name = strdup(name);
+    slot->array_access.index = offset_expression(dispatch->value, (int)-lo);
+    Statement *store = make_expression_statement(make_binary(OP_ASSIGN, make_variable(var), slot));
+    Statement *miss = dispatch->default_index >= 0 ? clone_statement(dispatch->entries[dispatch->default_index]) : NULL;
+    return make_if_statement(in_range, store, miss);
+}
+
+void count_switch_statement(Statement *stmt, void *ctx) {
+    (void)stmt;
+    (*(int *)ctx)++;
+}
+
+int switch_size(Statement *stmt) {
+    int size = 0;
+    visit_statements(stmt, count_switch_statement, &size);
+    return size;
+}
+
+// A fresh temporary name in the current function
+void new_switch_name(SwitchContext *lowering, const char *suffix, char *name, size_t size) {
+    do {
+        snprintf(name, size, SWITCH_PREFIX "%d%s", lowering->temp_count++, suffix);
+    } while (lookup_variable(lowering->prog, lowering->func, name));
+}
+
+Statement *make_switch_temp(const char *name, VariableType type, Expression *initializer) {
+    Statement *decl = create_statement();
+    decl->type = STMT_VAR_DECL;
+    decl->var_decl.var.name = strdup(name);
+    decl->var_decl.var.type = type;
+    decl->var_decl.var.is_initialized = 1;
+    decl->var_decl.initializer = initializer;
+    return decl;
+}
+
+Statement *lower_switch_statement(Statement *stmt, void *ctx) {
+    SwitchContext *lowering = ctx;
+    if (stmt->type != STMT_SWITCH) return stmt;
+    int case_count = stmt->switch_stmt.case_count;
+    for (int i = 0; i < case_count; i++) {
+        stmt->switch_stmt.cases[i].body = transform_statements(stmt->switch_stmt.cases[i].body,
+                                                               lower_switch_statement, ctx);
+    }
+
+    Statement *result = make_block();
+    SwitchDispatch dispatch;
+    memset(&dispatch, 0, sizeof(dispatch));
+    dispatch.default_index = -1;
+    dispatch.type = TYPE_INT;
+    dispatch.value = stmt->switch_stmt.value;
+    dispatch.entries = malloc((case_count + 1) * sizeof(Statement*));
+    int breaks = 0;
+    int continues = 0;
+    for (int i = 0; i < case_count; i++) {
+        if (stmt->switch_stmt.cases[i].is_default) dispatch.default_index = i;
+        dispatch.entries[i] = case_entry(stmt, i);
+        breaks |= contains_switch_jump(dispatch.entries[i], STMT_BREAK);
+        continues |= contains_switch_jump(dispatch.entries[i], STMT_CONTINUE);
+    }
+    int constant_labels = collect_label_ranges(stmt, &dispatch);
+
+    // The value is evaluated once, before any case runs
+    char temp[64];
+    if (dispatch.value->type != EXPR_VARIABLE) {
+        new_switch_name(lowering, "", temp, sizeof(temp));
+        block_append(result, make_switch_temp(temp, dispatch.type, dispatch.value));
+        dispatch.value = make_variable(temp);
+    }
+    char flag[64] = "";
+    if (breaks && continues) {
+        new_switch_name(lowering, "_continue", flag, sizeof(flag));
+        block_append(result, make_switch_temp(flag, TYPE_INT, make_int_literal(0)));
+        for (int i = 0; i < case_count; i++) {
+            dispatch.entries[i] = replace_switch_continue(dispatch.entries[i], flag);
+        }
+    }
+
+    double chain_cost;
+    Statement *selected = switch_chain(stmt, &dispatch, &chain_cost);
+    if (optimizer_options.enabled && constant_labels) {
+        Statement *table = breaks ? NULL : switch_table(lowering, &dispatch);
+        if (table) {
+            selected = table;
+        } else {
+            Statement *tree = switch_tree(&dispatch, 0, dispatch.range_count - 1, LLONG_MIN, LLONG_MAX, 0);
+            // Worth it when it saves at least one comparison per dispatch
+            if ((dispatch.cost + dispatch.label_count) <= chain_cost &&
+                switch_size(tree) <= switch_size(selected) + SWITCH_GROWTH) {
+                selected = tree;
+            }
+        }
+    }
+
+    if (breaks) {
+        // while True: <cases>; break
+        Statement *once = create_statement();
+        once->type = STMT_WHILE;
+        once->while_stmt.condition = make_int_literal(1);
+        once->while_stmt.body = make_block();
+        block_append(once->while_stmt.body, selected);
+        Statement *exit = create_statement();
+        exit->type = STMT_BREAK;
+        block_append(once->while_stmt.body, exit);
+        selected = once;
+    }
+    block_append(result, selected);
+    if (flag[0]) {
+        Statement *next = create_statement();
+        next->type = STMT_CONTINUE;
+        block_append(result, make_if_statement(make_variable(flag), next, NULL));
+    }
+    free(dispatch.entries);
+    free(dispatch.ranges);
+    return result->block.stmt_count == 1 ? result->block.statements[0] : result;
+}
+
+// Lower every switch in the program to if chains, decision trees or lookup tables
+void lower_switch_statements(Program *prog) {
+    for (int i = 0; i < prog->function_count; i++) {
+        SwitchContext ctx = { prog, prog->functions[i], 0, 0 };
+        prog->functions[i]->body = transform_statements(prog->functions[i]->body, lower_switch_statement, &ctx);
+    }
+}
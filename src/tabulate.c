@@ -0,0 +1,441 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Bottom-up tabulation. A pure function that only recurses into itself with
+// arguments of the form param - c (c >= 0) is evaluated once per point of its
+// parameter domain, in increasing order, into a preallocated list at import
+// time. The function itself then becomes a single list read.
+//
+// The domain comes from the constant arguments at outside call sites, widened
+// by interval analysis of the recursive call sites until it is closed. Bodies
+// with loops, array reads or variable divisors are skipped, since filling the
+// table visits points the original program might never reach. Exported
+// functions are skipped, since their callers are not all in the program.
+
+#define TABULATE_MAX_ROUNDS 64
+
+typedef struct {
+    Function *func;
+    int ok;
+} ShapeScan;
+
+// Check that a self-call argument is param, param - c or param + (-c); return c
+int decrement_of_argument(Expression *arg, const char *param, long long *decrement) {
+    if (arg->type == EXPR_VARIABLE && strcmp(arg->var_name, param) == 0) {
+        *decrement = 0;
+        return 1;
+    }
+    if (arg->type != EXPR_BINARY || (arg->binary.op != OP_SUB && arg->binary.op != OP_ADD)) return 0;
+    Expression *left = arg->binary.left;
+    Expression *right = arg->binary.right;
+    if (left->type != EXPR_VARIABLE || strcmp(left->var_name, param) != 0) return 0;
+    if (right->type != EXPR_LITERAL || right->literal.lit_type != TYPE_INT) return 0;
+    *decrement = arg->binary.op == OP_SUB ? right->literal.int_val : -right->literal.int_val;
+    return *decrement >= 0;
+}
+
+void check_tabulation_expression(Expression *expr, void *ctx) {
+    ShapeScan *scan = ctx;
+    Function *func = scan->func;
+
+    switch (expr->type) {
+        case EXPR_ARRAY_ACCESS:
+        case EXPR_MEMBER_ACCESS:
+            scan->ok = 0;
+            break;
+
+        case EXPR_BINARY:
+            // A divisor that is zero at an unreached point would raise during the fill
+            if ((expr->binary.op == OP_DIV || expr->binary.op == OP_MOD) &&
+                expr->binary.right->type != EXPR_LITERAL) {
+                scan->ok = 0;
+            }
+            if (expr->binary.op == OP_ASSIGN && expr->binary.left->type == EXPR_VARIABLE) {
+                for (int i = 0; i < func->param_count; i++) {
+                    if (strcmp(func->params[i].name, expr->binary.left->var_name) == 0) scan->ok = 0;
+                }
+            }
+            break;
+
+        case EXPR_UNARY:
+            if (expr->unary.op != OP_NEGATE && expr->unary.op != OP_NOT && expr->unary.op != OP_BIT_NOT &&
+                expr->unary.expr->type == EXPR_VARIABLE) {
+                for (int i = 0; i < func->param_count; i++) {
+                    if (strcmp(func->params[i].name, expr->unary.expr->var_name) == 0) scan->ok = 0;
+                }
+            }
+            break;
+
+        case EXPR_CALL: {
+            if (strcmp(expr->call.func_name, func->name) != 0 || expr->call.arg_count != func->param_count) {
+                scan->ok = 0;
+                break;
+            }
+            int decreasing = 0;
+            for (int i = 0; i < func->param_count; i++) {
+                long long decrement;
+                if (!decrement_of_argument(expr->call.args[i], func->params[i].name, &decrement)) {
+                    scan->ok = 0;
+                    return;
+                }
+                if (decrement > 0) decreasing = 1;
+            }
+            if (!decreasing) scan->ok = 0;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void check_tabulation_statement(Statement *stmt, void *ctx) {
+    ShapeScan *scan = ctx;
+    if (stmt->type == STMT_WHILE || stmt->type == STMT_FOR || stmt->type == STMT_FOR_IN) {
+        scan->ok = 0;
+    }
+}
+
+int is_tabulation_candidate(Function *func) {
+    if (!func->is_pure || !func->is_recursive) return 0;
+    if (func->return_type == TYPE_VOID || func->param_count == 0) return 0;
+    for (int i = 0; i < func->param_count; i++) {
+        Variable *param = &func->params[i];
+        if (param->struct_name || param->is_array) return 0;
+        if (param->type != TYPE_INT && param->type != TYPE_CHAR) return 0;
+    }
+
+    ShapeScan scan = { func, 1 };
+    visit_statements(func->body, check_tabulation_statement, &scan);
+    visit_statement_expressions(func->body, check_tabulation_expression, &scan);
+    return scan.ok;
+}
+
+typedef struct {
+    Program *prog;
+    Function *func;
+    Function *caller;
+    Interval *domain;
+    int calls;
+    int ok;
+} CallSiteScan;
+
+// Seed the domain from calls made outside the function; every one must be constant
+void collect_outside_calls(Expression *expr, void *ctx) {
+    CallSiteScan *scan = ctx;
+    if (expr->type != EXPR_CALL || strcmp(expr->call.func_name, scan->func->name) != 0) return;
+
+    if (expr->call.arg_count != scan->func->param_count) {
+        scan->ok = 0;
+        return;
+    }
+    scan->calls++;
+    for (int i = 0; i < expr->call.arg_count; i++) {
+        long long value;
+        if (!constant_local_value(scan->caller, expr->call.args[i], &value)) {
+            scan->ok = 0;
+            return;
+        }
+        scan->domain[i] = interval_hull(scan->domain[i], interval_const(value));
+    }
+}
+
+typedef struct {
+    Function *func;
+    Interval *domain;
+    RangeEnv *env;
+    int changed;
+} WidenScan;
+
+void widen_at_self_call(Expression *expr, void *ctx) {
+    WidenScan *scan = ctx;
+    if (expr->type != EXPR_CALL) return;
+
+    for (int i = 0; i < expr->call.arg_count; i++) {
+        Interval arg = interval_of_expression(expr->call.args[i], scan->env);
+        if (interval_is_empty(arg)) continue;
+        Interval widened = interval_hull(scan->domain[i], arg);
+        if (widened.lo != scan->domain[i].lo || widened.hi != scan->domain[i].hi) {
+            scan->domain[i] = widened;
+            scan->changed = 1;
+        }
+    }
+}
+
+void replace_env(RangeEnv *env, RangeEnv *source) {
+    RangeEnv *copy = range_env_copy(source);
+    for (int i = 0; i < env->count; i++) {
+        free(env->names[i]);
+    }
+    free(env->names);
+    free(env->ranges);
+    *env = *copy;
+    free(copy);
+}
+
+// Walk the body with path-sensitive ranges, widening the domain at each self-call
+void widen_domain(Statement *stmt, WidenScan *scan) {
+    if (!stmt) return;
+
+    switch (stmt->type) {
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->block.stmt_count; i++) {
+                widen_domain(stmt->block.statements[i], scan);
+                if (statement_always_returns(stmt->block.statements[i])) break;
+            }
+            break;
+
+        case STMT_IF: {
+            visit_expression(stmt->if_stmt.condition, widen_at_self_call, scan);
+            RangeEnv *outer = scan->env;
+            RangeEnv *then_env = range_env_copy(outer);
+            RangeEnv *else_env = range_env_copy(outer);
+            refine_by_condition(stmt->if_stmt.condition, 1, then_env);
+            refine_by_condition(stmt->if_stmt.condition, 0, else_env);
+
+            scan->env = then_env;
+            widen_domain(stmt->if_stmt.then_branch, scan);
+            scan->env = else_env;
+            widen_domain(stmt->if_stmt.else_branch, scan);
+            scan->env = outer;
+
+            int then_returns = statement_always_returns(stmt->if_stmt.then_branch);
+            int else_returns = statement_always_returns(stmt->if_stmt.else_branch);
+            if (then_returns && !else_returns) {
+                replace_env(outer, else_env);
+            } else if (else_returns && !then_returns) {
+                replace_env(outer, then_env);
+            } else {
+                range_env_join(then_env, else_env);
+                replace_env(outer, then_env);
+            }
+            range_env_free(then_env);
+            range_env_free(else_env);
+            break;
+        }
+
+        case STMT_VAR_DECL:
+            visit_expression(stmt->var_decl.initializer, widen_at_self_call, scan);
+            range_env_set(scan->env, stmt->var_decl.var.name,
+                          stmt->var_decl.initializer
+                              ? interval_of_expression(stmt->var_decl.initializer, scan->env)
+                              : interval_full());
+            break;
+
+        case STMT_EXPR:
+            visit_expression(stmt->expr, widen_at_self_call, scan);
+            if (stmt->expr->type == EXPR_BINARY && stmt->expr->binary.op == OP_ASSIGN &&
+                stmt->expr->binary.left->type == EXPR_VARIABLE) {
+                range_env_set(scan->env, stmt->expr->binary.left->var_name,
+                              interval_of_expression(stmt->expr->binary.right, scan->env));
+            } else if (stmt->expr->type == EXPR_UNARY && stmt->expr->unary.expr->type == EXPR_VARIABLE) {
+                range_env_set(scan->env, stmt->expr->unary.expr->var_name, interval_full());
+            }
+            break;
+
+        case STMT_RETURN:
+            visit_expression(stmt->return_value, widen_at_self_call, scan);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Build the flattened table index for a list of argument expressions
+Expression *table_index(Expression **args, Interval *domain, int count) {
+    Expression *index = NULL;
+    for (int i = 0; i < count; i++) {
+        Expression *term = args[i];
+        if (domain[i].lo != 0) {
+            term = make_binary(OP_SUB, term, make_int_literal((int)domain[i].lo));
+        }
+        if (!index) {
+            index = term;
+        } else {
+            int width = (int)(domain[i].hi - domain[i].lo + 1);
+            index = make_binary(OP_ADD, make_binary(OP_MUL, index, make_int_literal(width)), term);
+        }
+    }
+    return index;
+}
+
+typedef struct {
+    Function *func;
+    Interval *domain;
+    const char *table_name;
+} SelfCallRewrite;
+
+// Replace each self-call with a read of the table entry it would compute
+void rewrite_self_call(Expression *expr, void *ctx) {
+    SelfCallRewrite *rewrite = ctx;
+    if (expr->type != EXPR_CALL || strcmp(expr->call.func_name, rewrite->func->name) != 0) return;
+
+    Expression *index = table_index(expr->call.args, rewrite->domain, expr->call.arg_count);
+    free(expr->call.func_name);
+    free(expr->call.args);
+    expr->type = EXPR_ARRAY_ACCESS;
+    expr->array_access.array_name = strdup(rewrite->table_name);
+    expr->array_access.index = index;
+}
+
+void add_global_table(Program *prog, const char *name, VariableType type, int size) {
+    prog->global_vars = realloc(prog->global_vars, (prog->global_var_count + 1) * sizeof(Variable));
+    Variable *table = &prog->global_vars[prog->global_var_count++];
+    memset(table, 0, sizeof(Variable));
+    table->name = strdup(name);
+    table->type = type;
+    table->is_array = 1;
+    table->array_size = size;
+}
+
+void tabulate_function(Program *prog, Function *func, Interval *domain, int size) {
+    char table_name[256];
+    char body_name[256];
+    snprintf(table_name, sizeof(table_name), "_%s_table", func->name);
+    snprintf(body_name, sizeof(body_name), "_%s_body", func->name);
+
+    // _f_body: the original body with self-calls reading the table
+    Function *body = create_function();
+    body->name = strdup(body_name);
+    body->return_type = func->return_type;
+    body->line = func->line;
+    body->source_file = func->source_file;
+    body->param_count = func->param_count;
+    body->params = malloc(func->param_count * sizeof(Variable));
+    for (int i = 0; i < func->param_count; i++) {
+        body->params[i] = func->params[i];
+        body->params[i].name = strdup(func->params[i].name);
+    }
+    body->body = func->body;
+    body->is_pure = 1;
+    SelfCallRewrite rewrite = { func, domain, table_name };
+    visit_statement_expressions(body->body, rewrite_self_call, &rewrite);
+
+    // Emit _f_body right before f
+    prog->functions = realloc(prog->functions, (prog->function_count + 1) * sizeof(Function*));
+    int position = 0;
+    while (prog->functions[position] != func) position++;
+    memmove(&prog->functions[position + 1], &prog->functions[position],
+            (prog->function_count - position) * sizeof(Function*));
+    prog->functions[position] = body;
+    prog->function_count++;
+    add_global_table(prog, table_name, func->return_type, size);
+
+    // f: a single table read
+    Expression **params = malloc(func->param_count * sizeof(Expression*));
+    for (int i = 0; i < func->param_count; i++) {
+        params[i] = make_variable(func->params[i].name);
+    }
+    Expression *read = create_expression();
+    read->type = EXPR_ARRAY_ACCESS;
+    read->array_access.array_name = strdup(table_name);
+    read->array_access.index = table_index(params, domain, func->param_count);
+    Statement *ret = create_statement();
+    ret->type = STMT_RETURN;
+    ret->return_value = read;
+    func->body = make_block();
+    block_append(func->body, ret);
+    func->is_recursive = 0;
+    func->memoize = 0;
+
+    // Module-level fill: one loop per parameter, in increasing order
+    Expression **loop_vars = malloc(func->param_count * sizeof(Expression*));
+    for (int i = 0; i < func->param_count; i++) {
+        char loop_name[512];
+        snprintf(loop_name, sizeof(loop_name), "_%s_%s", func->name, func->params[i].name);
+        loop_vars[i] = make_variable(loop_name);
+    }
+    Expression **call_args = malloc(func->param_count * sizeof(Expression*));
+    Expression **index_args = malloc(func->param_count * sizeof(Expression*));
+    for (int i = 0; i < func->param_count; i++) {
+        call_args[i] = clone_expression(loop_vars[i]);
+        index_args[i] = clone_expression(loop_vars[i]);
+    }
+    Expression *slot = create_expression();
+    slot->type = EXPR_ARRAY_ACCESS;
+    slot->array_access.array_name = strdup(table_name);
+    slot->array_access.index = table_index(index_args, domain, func->param_count);
+    Statement *fill = make_expression_statement(
+        make_binary(OP_ASSIGN, slot, make_call(body_name, call_args, func->param_count)));
+
+    for (int i = func->param_count - 1; i >= 0; i--) {
+        Statement *loop = create_statement();
+        loop->type = STMT_FOR;
+        loop->for_stmt.initializer = make_expression_statement(
+            make_binary(OP_ASSIGN, clone_expression(loop_vars[i]), make_int_literal((int)domain[i].lo)));
+        loop->for_stmt.condition = make_binary(OP_LTE, clone_expression(loop_vars[i]),
+                                               make_int_literal((int)domain[i].hi));
+        loop->for_stmt.increment = make_binary(OP_ASSIGN, clone_expression(loop_vars[i]),
+                                               make_binary(OP_ADD, clone_expression(loop_vars[i]),
+                                                           make_int_literal(1)));
+        loop->for_stmt.body = make_block();
+        block_append(loop->for_stmt.body, fill);
+        fill = loop;
+    }
+    if (!prog->init_block) {
+        prog->init_block = make_block();
+    }
+    block_append(prog->init_block, fill);
+
+    free(params);
+    free(loop_vars);
+    free(call_args);
+    free(index_args);
+}
+
+// Find the closed parameter domain of a candidate; return its size or 0
+int tabulation_domain(Program *prog, Function *func, Interval *domain) {
+    Interval empty = { 1, 0 };
+    for (int i = 0; i < func->param_count; i++) {
+        domain[i] = empty;
+    }
+
+    CallSiteScan sites = { prog, func, NULL, domain, 0, 1 };
+    for (int i = 0; i < prog->function_count && sites.ok; i++) {
+        if (prog->functions[i] == func) continue;
+        sites.caller = prog->functions[i];
+        visit_statement_expressions(sites.caller->body, collect_outside_calls, &sites);
+    }
+    if (!sites.ok || sites.calls == 0) return 0;
+
+    for (int round = 0; round < TABULATE_MAX_ROUNDS; round++) {
+        WidenScan scan = { func, domain, range_env_create(), 0 };
+        for (int i = 0; i < func->param_count; i++) {
+            range_env_set(scan.env, func->params[i].name, domain[i]);
+        }
+        widen_domain(func->body, &scan);
+        range_env_free(scan.env);
+
+        long long size = 1;
+        for (int i = 0; i < func->param_count; i++) {
+            if (!interval_is_bounded(domain[i])) return 0;
+            size *= domain[i].hi - domain[i].lo + 1;
+            if (size > optimizer_options.tabulate_max_size) return 0;
+        }
+        if (!scan.changed) return (int)size;
+    }
+    return 0;
+}
+
+// Tabulate every eligible function whose table fits in tabulate_max_size
+void tabulate_functions(Program *prog) {
+    if (optimizer_options.tabulate_max_size <= 0) return;
+
+    for (int i = 0; i < prog->function_count; i++) {
+        Function *func = prog->functions[i];
+        if (!is_tabulation_candidate(func) || function_is_cold(func)) continue;
+        // The domain only covers in-program callers; exported functions have others
+        if (is_exported_name(func->name)) continue;
+
+        Interval *domain = malloc(func->param_count * sizeof(Interval));
+        int size = tabulation_domain(prog, func, domain);
+        if (size > 0) {
+            tabulate_function(prog, func, domain, size);
+            i++; // Skip past the _f_body inserted before f
+        }
+        free(domain);
+    }
+}
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Tree shaking. Only the functions, globals and structs reachable from main
+// (or from the names given with --export) are emitted. Reachability follows
+// calls, global reads and writes, and struct types of variables, parameters
+// and fields. Module-level statements (tabulation fills) are kept only when
+// they write a global that is still reachable.
+// A program with neither main nor an exported function is left alone.
+
+typedef struct {
+    Program *prog;
+    int *function_live;
+    int *global_live;
+    int *struct_live;
+    int changed;
+} Reachability;
+
+int index_of_function(Program *prog, const char *name) {
+    for (int i = 0; i < prog->function_count; i++) {
+        if (strcmp(prog->functions[i]->name, name) == 0) return i;
+    }
+    return -1;
+}
+
+int index_of_global(Program *prog, const char *name) {
+    for (int i = 0; i < prog->global_var_count; i++) {
+        if (strcmp(prog->global_vars[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+int index_of_struct(Program *prog, const char *name) {
+    for (int i = 0; i < prog->struct_count; i++) {
+        if (strcmp(prog->structs[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+void mark_live(int *live, int index, int *changed) {
+    if (index >= 0 && !live[index]) {
+        live[index] = 1;
+        *changed = 1;
+    }
+}
+
+void mark_struct(Reachability *reach, const char *name) {
+    if (name) mark_live(reach->struct_live, index_of_struct(reach->prog, name), &reach->changed);
+}
+
+void mark_global(Reachability *reach, const char *name) {
+    int index = index_of_global(reach->prog, name);
+    mark_live(reach->global_live, index, &reach->changed);
+    if (index >= 0) mark_struct(reach, reach->prog->global_vars[index].struct_name);
+}
+
+void mark_expression_uses(Expression *expr, void *ctx) {
+    Reachability *reach = ctx;
+    switch (expr->type) {
+        case EXPR_VARIABLE:
+            mark_global(reach, expr->var_name);
+            break;
+        case EXPR_ARRAY_ACCESS:
+            mark_global(reach, expr->array_access.array_name);
+            break;
+        case EXPR_SLICE:
+            mark_global(reach, expr->slice.array_name);
+            break;
+        case EXPR_CALL:
+            mark_live(reach->function_live, index_of_function(reach->prog, expr->call.func_name), &reach->changed);
+            break;
+        case EXPR_ASM:
+            for (int i = 0; i < expr->asm_block.output_count; i++) {
+                if (expr->asm_block.outputs[i].variable) mark_global(reach, expr->asm_block.outputs[i].variable);
+            }
+            for (int i = 0; i < expr->asm_block.input_count; i++) {
+                if (expr->asm_block.inputs[i].variable) mark_global(reach, expr->asm_block.inputs[i].variable);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void mark_statement_uses(Statement *stmt, void *ctx) {
+    Reachability *reach = ctx;
+    if (stmt->type == STMT_VAR_DECL) mark_struct(reach, stmt->var_decl.var.struct_name);
+}
+
+void mark_function_uses(Reachability *reach, Function *func) {
+    for (int i = 0; i < func->param_count; i++) {
+        mark_struct(reach, func->params[i].struct_name);
+    }
+    visit_statements(func->body, mark_statement_uses, reach);
+    visit_statement_expressions(func->body, mark_expression_uses, reach);
+}
+
+typedef struct {
+    Reachability *reach;
+    int writes_live;
+} InitScan;
+
+void find_live_write(Expression *expr, void *ctx) {
+    InitScan *scan = ctx;
+    Expression *target = written_target(expr);
+    const char *name = target ? base_variable_name(target) : NULL;
+    int index = name ? index_of_global(scan->reach->prog, name) : -1;
+    if (index >= 0 && scan->reach->global_live[index]) scan->writes_live = 1;
+}
+
+// A module-level statement matters only if it fills a global something still reads
+int init_statement_is_live(Reachability *reach, Statement *stmt) {
+    InitScan scan = { reach, 0 };
+    visit_statement_expressions(stmt, find_live_write, &scan);
+    return scan.writes_live;
+}
+
+// Whether --export names this function or global, so callers outside the
+// program may use it with any arguments
+int is_exported_name(const char *name) {
+    if (!optimizer_options.exports) return 0;
+
+    char *names = strdup(optimizer_options.exports);
+    int found = 0;
+    for (char *export = strtok(names, ","); export && !found; export = strtok(NULL, ",")) {
+        found = strcmp(export, name) == 0;
+    }
+    free(names);
+    return found;
+}
+
+// Mark main and the exported names as roots; returns 0 if there are none
+int mark_roots(Reachability *reach) {
+    int found = 0;
+    int main_index = index_of_function(reach->prog, "main");
+    if (main_index >= 0) {
+        reach->function_live[main_index] = 1;
+        found = 1;
+    }
+    if (!optimizer_options.exports) return found;
+
+    char *names = strdup(optimizer_options.exports);
+    for (char *name = strtok(names, ","); name; name = strtok(NULL, ",")) {
+        int function = index_of_function(reach->prog, name);
+        int global = index_of_global(reach->prog, name);
+        int type = index_of_struct(reach->prog, name);
+        if (function >= 0) {
+            reach->function_live[function] = 1;
+        } else if (global >= 0) {
+            reach->global_live[global] = 1;
+        } else if (type >= 0) {
+            reach->struct_live[type] = 1;
+        } else {
+            fprintf(stderr, "Warning: exported name '%s' is not defined\n", name);
+            continue;
+        }
+        found = 1;
+    }
+    free(names);
+    return found;
+}
+
+// Drop every function, global, struct and module-level statement main cannot reach
+void shake_unused_definitions(Program *prog) {
+    Reachability reach = { prog, calloc(prog->function_count + 1, sizeof(int)),
+                           calloc(prog->global_var_count + 1, sizeof(int)),
+                           calloc(prog->struct_count + 1, sizeof(int)), 1 };
+    if (!mark_roots(&reach)) {
+        free(reach.function_live);
+        free(reach.global_live);
+        free(reach.struct_live);
+        return;
+    }
+
+    int init_count = prog->init_block ? prog->init_block->block.stmt_count : 0;
+    int *init_live = calloc(init_count + 1, sizeof(int));
+    while (reach.changed) {
+        reach.changed = 0;
+        for (int i = 0; i < prog->function_count; i++) {
+            if (reach.function_live[i]) mark_function_uses(&reach, prog->functions[i]);
+        }
+        for (int i = 0; i < prog->global_var_count; i++) {
+            if (reach.global_live[i]) mark_struct(&reach, prog->global_vars[i].struct_name);
+        }
+        for (int i = 0; i < prog->struct_count; i++) {
+            for (int j = 0; reach.struct_live[i] && j < prog->structs[i].field_count; j++) {
+                mark_struct(&reach, prog->structs[i].fields[j].struct_name);
+            }
+        }
+        for (int i = 0; i < init_count; i++) {
+            Statement *stmt = prog->init_block->block.statements[i];
+            if (!init_live[i] && init_statement_is_live(&reach, stmt)) {
+                init_live[i] = 1;
+                reach.changed = 1;
+                visit_statements(stmt, mark_statement_uses, &reach);
+                visit_statement_expressions(stmt, mark_expression_uses, &reach);
+            }
+        }
+    }
+
+    int kept = 0;
+    for (int i = 0; i < prog->function_count; i++) {
+        if (reach.function_live[i]) prog->functions[kept++] = prog->functions[i];
+    }
+    prog->function_count = kept;
+    kept = 0;
+    for (int i = 0; i < prog->global_var_count; i++) {
+        if (reach.global_live[i]) prog->global_vars[kept++] = prog->global_vars[i];
+    }
+    prog->global_var_count = kept;
+    kept = 0;
+    for (int i = 0; i < prog->struct_count; i++) {
+        if (reach.struct_live[i]) prog->structs[kept++] = prog->structs[i];
+    }
+    prog->struct_count = kept;
+    kept = 0;
+    for (int i = 0; i < init_count; i++) {
+        if (init_live[i]) prog->init_block->block.statements[kept++] = prog->init_block->block.statements[i];
+    }
+    if (prog->init_block) prog->init_block->block.stmt_count = kept;
+
+    free(init_live);
+    free(reach.function_live);
+    free(reach.global_live);
+    free(reach.struct_live);
+}
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/optimizer.h"
+
+// Loop unswitching. An if whose condition no iteration can change is tested
+// once before the loop, and each branch gets its own copy of the loop:
+//     for (i = 0; i < n; i++) { if (mode) s += a[i]; else s -= a[i]; }
+// becomes
+//     if (mode) for (i = 0; i < n; i++) s += a[i];
+//     else      for (i = 0; i < n; i++) s -= a[i];
+// which also leaves simpler loops for the range, idiom and reduction passes.
+// The condition is evaluated even when the loop runs zero times or never
+// reaches the if, so it must be free of side effects and unable to raise.
+// Every copy adds the loop's size in statements, and a loop stops being
+// unswitched once the copies would exceed --unswitch-growth statements.
+// Loops that a --profile-use run never entered are left alone.
+
+typedef struct {
+    Program *prog;
+    Statement *loop;
+    Statement *found;   // First if on an invariant condition, in pre-order
+    int index;          // Its position among the loop's statements, in pre-order
+    int position;
+} InvariantIfSearch;
+
+void find_invariant_if(Statement *stmt, void *ctx) {
+    InvariantIfSearch *search = ctx;
+    int position = search->position++;
+    if (search->found || stmt->type != STMT_IF) return;
+    Expression *cond = stmt->if_stmt.condition;
+    if (cond->type == EXPR_LITERAL) return;  // Left to constant folding
+    if (expression_has_side_effects(search->prog, cond) || expression_may_trap(search->prog, cond)) return;
+    if (!expression_is_invariant(search->prog, cond, search->loop)) return;
+    search->found = stmt;
+    search->index = position;
+}
+
+typedef struct {
+    int target;
+    int position;
+    Statement *found;
+} PositionSearch;
+
+void find_position(Statement *stmt, void *ctx) {
+    PositionSearch *search = ctx;
+    if (search->position++ == search->target) search->found = stmt;
+}
+
+void count_statement(Statement *stmt, void *ctx) {
+    (void)stmt;
+    (*(int *)ctx)++;
+}
+
+typedef struct {
+    Statement *target;
+    Statement *replacement;
+} BranchReplace;
+
+Statement *replace_if(Statement *stmt, void *ctx) {
+    BranchReplace *replace = ctx;
+    return stmt == replace->target ? replace->replacement : stmt;
+}
+
+// Replace the if at a pre-order position of the loop with one of its branches
+void select_branch(Statement *loop, int index, int take_then) {
+    PositionSearch search = { index, 0, NULL };
+    visit_statements(loop, find_position, &search);
+    Statement *branch = take_then ? search.found->if_stmt.then_branch : search.found->if_stmt.else_branch;
+    BranchReplace replace = { search.found, branch ? branch : make_block() };
+    Statement **body = loop_body_slot(loop);
+    *body = transform_statements(*body, replace_if, &replace);
+}
+
+Statement *unswitch_loop(Program *prog, Statement *loop, int *budget) {
+    InvariantIfSearch search = { prog, loop, NULL, 0, 0 };
+    visit_statements(loop, find_invariant_if, &search);
+    if (!search.found) return loop;
+
+    int size = 0;
+    visit_statements(loop, count_statement, &size);
+    if (size > *budget) return loop;
+    *budget -= size;
+
+    Expression *cond = clone_expression(search.found->if_stmt.condition);
+    Statement *copy = clone_statement(loop);
+    select_branch(loop, search.index, 1);
+    select_branch(copy, search.index, 0);
+
+    Statement *stmt = create_statement();
+    stmt->type = STMT_IF;
+    stmt->line = search.found->line;
+    stmt->if_stmt.condition = cond;
+    // Further invariant ifs in either copy share what is left of the budget
+    stmt->if_stmt.then_branch = unswitch_loop(prog, loop, budget);
+    stmt->if_stmt.else_branch = unswitch_loop(prog, copy, budget);
+    return stmt;
+}
+
+Statement *unswitch_loop_statement(Statement *stmt, void *ctx) {
+    if (stmt->type != STMT_WHILE && stmt->type != STMT_FOR && stmt->type != STMT_FOR_IN) return stmt;
+    if (loop_is_cold(stmt)) return stmt;
+    int budget = optimizer_options.unswitch_growth;
+    return unswitch_loop(ctx, stmt, &budget);
+}
+
+// Unswitch loops on invariant conditions in every function
+void unswitch_loops(Program *prog) {
+    if (optimizer_options.unswitch_growth <= 0) return;
+    for (int i = 0; i < prog->function_count; i++) {
+        prog->functions[i]->body = transform_statements(prog->functions[i]->body, unswitch_loop_statement, prog);
+    }
+}
@@ -0,0 +1,16 @@
+// Whole-program test: compile with
+//     ./csnakecompiler test/multi/main.c test/multi/geometry.c test/multi/stats.c
+#include <stdio.h>
+#include "shapes.h"
+
+int main(void) {
+    struct Rect r;
+    r.width = 6;
+    r.height = -2;
+    printf("area: %d\n", area(r.width, r.height));
+    printf("perimeter: %d\n", perimeter(r.width, 7));
+    printf("sum of squares: %d\n", sum_of_squares(10));
+    printf("clamp: %d %d\n", clamp(3), clamp(42));
+    printf("calls: %d\n", calls);
+    return 0;
+}
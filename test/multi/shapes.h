@@ -0,0 +1,12 @@
+// Declarations shared by the translation units of the multi-file test
+struct Rect {
+    int width;
+    int height;
+};
+
+extern int calls;
+
+int area(int width, int height);
+int perimeter(int width, int height);
+int sum_of_squares(int n);
+int clamp(int value);
@@ -0,0 +1,21 @@
+#include "shapes.h"
+
+static int clamp_low(int value) {
+    if (value < 10) {
+        return 10;
+    }
+    return value;
+}
+
+int sum_of_squares(int n) {
+    int total = 0;
+    for (int i = 1; i <= n; i++) {
+        total += i * i;
+    }
+    calls++;
+    return total;
+}
+
+int clamp(int value) {
+    return clamp_low(value);
+}
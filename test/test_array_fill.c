@@ -0,0 +1,47 @@
+// Array-filling loops turned into comprehensions and list(range(...))
+int table[10];
+
+int cube(int x) {
+    return x * x * x;
+}
+
+int main() {
+    int squares[8];
+    int odds[6];
+    int cubes[5];
+    int i;
+    int n = 8;
+    int offset = 100;
+    int total = 0;
+
+    for (i = 0; i < n; i++) {
+        squares[i] = i * i + offset;
+    }
+    for (i = 0; i < 6; i++) {
+        odds[i] = 2 * i + 1;
+    }
+    for (i = 0; i < 5; i++) {
+        cubes[i] = cube(i - 2);
+    }
+    // Part of a global array
+    for (i = 2; i < 7; i++) {
+        table[i] = 10 - i;
+    }
+    // Each element depends on the previous one, so this stays a loop
+    for (i = 1; i < 10; i++) {
+        table[i] = table[i - 1] + i;
+    }
+
+    for (i = 0; i < 8; i++) {
+        total += squares[i];
+    }
+    for (i = 0; i < 6; i++) {
+        total += odds[i] * cubes[i % 5];
+    }
+    printf("total = %d\n", total);
+    for (i = 0; i < 10; i++) {
+        printf("%d ", table[i]);
+    }
+    printf("\n");
+    return 0;
+}
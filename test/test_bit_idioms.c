@@ -0,0 +1,87 @@
+// Bit-at-a-time loops replaced by int.bit_count, int.bit_length and a bit reversal table
+int popcount(int x) {
+    int count = 0;
+    while (x != 0) {
+        count += x & 1;
+        x >>= 1;
+    }
+    return count;
+}
+
+int sparse_popcount(int x) {
+    int count = 0;
+    while (x) {
+        x &= x - 1;
+        count++;
+    }
+    return count;
+}
+
+int bit_width(int x) {
+    int bits = 0;
+    while (x > 0) {
+        bits++;
+        x = x >> 1;
+    }
+    return bits;
+}
+
+int floor_log2(int x) {
+    int r = 0;
+    while (x > 1) {
+        x >>= 1;
+        r++;
+    }
+    return r;
+}
+
+int trailing_zeros(int x) {
+    int n = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        n++;
+    }
+    printf("odd part: %d\n", x);
+    return n;
+}
+
+int reverse_byte(int x) {
+    int i;
+    int r = 0;
+    for (i = 0; i < 8; i++) {
+        r = (r << 1) | (x & 1);
+        x >>= 1;
+    }
+    return r;
+}
+
+int reverse_word(int x) {
+    int i;
+    int r = 0;
+    for (i = 0; i < 32; i++) {
+        r = (r << 1) | (x & 1);
+        x >>= 1;
+    }
+    return r;
+}
+
+int main() {
+    int values[6];
+    int i;
+    int total = 0;
+    values[0] = 1;
+    values[1] = 12;
+    values[2] = 255;
+    values[3] = 1024;
+    values[4] = 99999;
+    values[5] = 2147483647;
+
+    for (i = 0; i < 6; i++) {
+        int v = values[i];
+        printf("%d: %d %d %d %d\n", v, popcount(v), sparse_popcount(v), bit_width(v), floor_log2(v));
+        total = total + reverse_byte(v) + trailing_zeros(v * 40);
+    }
+    printf("negative: %d %d %d\n", sparse_popcount(-1), sparse_popcount(-8), bit_width(-5));
+    printf("reversed: %d %d %d\n", total, reverse_word(1), reverse_word(6));
+    return 0;
+}
@@ -0,0 +1,42 @@
+// Pure calls with constant arguments evaluated at compile time
+int gcd(int a, int b) {
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+int collatz_steps(int n) {
+    int steps = 0;
+    while (n != 1) {
+        if (n % 2 == 0) {
+            n = n / 2;
+        } else {
+            n = 3 * n + 1;
+        }
+        steps++;
+    }
+    return steps;
+}
+
+int power(int base, int exp) {
+    if (exp == 0) {
+        return 1;
+    }
+    return base * power(base, exp - 1);
+}
+
+int main() {
+    int n = 27;
+    printf("gcd: %d\n", gcd(1071, 462));
+    printf("steps(%d) = %5d\n", n, collatz_steps(n));
+    printf("3^21 = %d, 3^25 = %d\n", power(3, 21), power(3, 25));
+    printf("hex %x, char %c, 100%%\n", power(2, 31) - 1, 65 + gcd(12, 8));
+    printf("%x %X %o %u %*x|\n", -power(2, 24), -n, -n, -n, 10, -n);
+    for (int i = -3; i <= 3; i++) {
+        printf("%d / 2 = %d, %d %% 2 = %d\n", i, i / 2, i, i % 2);
+    }
+    return 0;
+}
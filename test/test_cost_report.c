@@ -0,0 +1,62 @@
+// Constructs the cost report ranks and flags: a doubly nested counted loop,
+// while loops nested in a while loop, unmemoized recursion and a struct
+// field read on every iteration
+struct Point {
+    int x;
+    int y;
+};
+
+int grid_sum(int n, int m) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < m; j++) {
+            s = s + (i ^ j);
+        }
+    }
+    return s;
+}
+
+int collatz_steps(int n) {
+    int steps = 0;
+    int k = 1;
+    while (k < n) {
+        int v = k;
+        while (v != 1) {
+            if (v % 2 == 0) {
+                v = v / 2;
+            } else {
+                v = 3 * v + 1;
+            }
+            steps++;
+        }
+        k++;
+    }
+    return steps;
+}
+
+int walk(struct Point p, int n) {
+    int t = 0;
+    for (int i = 0; i < n; i++) {
+        t = t + p.x * i + p.y;
+    }
+    return t;
+}
+
+int paths(int r, int c) {
+    if (r == 0 || c == 0) {
+        return 1;
+    }
+    return paths(r - 1, c) + paths(r, c - 1);
+}
+
+int main() {
+    struct Point p;
+    p.x = 3;
+    p.y = 4;
+    int a = grid_sum(20, 30);
+    int b = collatz_steps(30);
+    int c = walk(p, 10);
+    int d = paths(6, 6);
+    printf("%d %d %d %d\n", a, b, c, d);
+    return 0;
+}
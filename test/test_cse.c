@@ -0,0 +1,52 @@
+// Repeated pure subexpressions computed once
+struct Point {
+    int x;
+    int y;
+};
+
+int table[8];
+
+int neighbours(int i) {
+    int left = table[i + 1] * 2;
+    int right = table[i + 1] - table[i];
+    return left + right;
+}
+
+int norm(int a, int b) {
+    struct Point p;
+    p.x = a;
+    p.y = b;
+    int sq = p.x * p.x + p.y * p.y;
+    if (p.x * p.x > p.y * p.y) {
+        return sq - p.x * p.x;
+    }
+    return sq;
+}
+
+int classify(int a, int b) {
+    int result = 0;
+    if (a * b > 10) {
+        result = 1;
+        if (a * b > 20) {
+            result = 2;
+        }
+    }
+    a = a + 1;
+    if (a * b > 10) {
+        result = result + 10;
+    }
+    return result;
+}
+
+int main() {
+    for (int i = 0; i < 8; i++) {
+        table[i] = i * i;
+    }
+    printf("%d\n", neighbours(3));
+    printf("%d\n", norm(3, 2));
+    printf("%d\n", norm(1, 5));
+    printf("%d\n", classify(3, 4));
+    printf("%d\n", classify(5, 5));
+    printf("%d\n", classify(1, 1));
+    return 0;
+}
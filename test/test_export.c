@@ -0,0 +1,14 @@
+// Compile with --export fib: main only calls fib(30), but importers may call
+// fib(40) or fib(-1), so fib must not become a read of a 0..30 table
+
+int fib(int n) {
+    if (n < 2) {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+int main() {
+    printf("fib(30) = %d\n", fib(30));
+    return 0;
+}
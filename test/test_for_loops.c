@@ -0,0 +1,82 @@
+// Counted loops lowered to range() and element iteration
+int data[8];
+
+int sum_range(int n) {
+    int total = 0;
+    for (int i = 1; i <= n; i++) {
+        total += i;
+    }
+    return total;
+}
+
+int sum_evens_down(int n) {
+    int total = 0;
+    for (int i = n; i >= 0; i -= 2) {
+        if (i % 4 == 0) {
+            continue;
+        }
+        total += i;
+    }
+    return total;
+}
+
+int first_at_least(int limit) {
+    int i;
+    for (i = 0; i < 8; i++) {
+        if (data[i] >= limit) {
+            break;
+        }
+    }
+    return i;
+}
+
+int sum_data() {
+    int total = 0;
+    for (int i = 0; i < 8; i++) {
+        total += data[i];
+    }
+    return total;
+}
+
+int count_pairs(int n) {
+    int pairs = 0;
+    int i = 0;
+    while (i < n) {
+        int j = i + 1;
+        while (j < n) {
+            pairs++;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    return pairs;
+}
+
+int calls = 0;
+
+void record(int k) {
+    calls = calls + k;
+}
+
+// The call may write globals, but not the local bound n
+int record_all(int n) {
+    for (int i = 0; i < n; i++) {
+        record(i);
+    }
+    return n;
+}
+
+int main() {
+    for (int i = 0; i < 8; i++) {
+        data[i] = i * 3;
+    }
+    printf("%d\n", sum_range(10));
+    printf("%d\n", sum_evens_down(11));
+    printf("%d\n", first_at_least(10));
+    printf("%d\n", first_at_least(100));
+    printf("%d\n", sum_data());
+    printf("%d\n", count_pairs(6));
+    printf("%d\n", record_all(7));
+    printf("%d\n", calls);
+    return 0;
+}
@@ -0,0 +1,57 @@
+// Globals: initializers, global declarations and promotion to locals in loops
+int counter;
+int limit = 5;
+float scale = 1.5;
+int table[8];
+
+void bump(int k) {
+    counter = counter + k;
+}
+
+// Reads limit and table and writes counter in its loop; nothing it calls touches them
+int total(int n) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        s = s + table[i % 8] * limit;
+        counter++;
+        if (s > 1000) {
+            return s;
+        }
+    }
+    return s;
+}
+
+// Calls bump, so counter stays global here
+int bumps(int n) {
+    for (int i = 0; i < n; i++) {
+        bump(i);
+        counter = counter * 2 % 1000;
+    }
+    return counter;
+}
+
+// math.sin and math.cos are bound as default arguments, so import math must stay
+// even though the body only calls the aliases
+float wave(int n) {
+    float w = 0.0;
+    for (int i = 0; i < n; i++) {
+        w = w + sin(i) * cos(i);
+    }
+    return w;
+}
+
+int main() {
+    for (int i = 0; i < 8; i++) {
+        table[i] = i;
+    }
+    bump(3);
+    int t = total(20);
+    printf("total: %d counter: %d\n", t, counter);
+    t = total(100);
+    printf("total: %d counter: %d\n", t, counter);
+    t = bumps(10);
+    printf("bumps: %d\n", t);
+    printf("scale: %.2f\n", scale * limit);
+    printf("wave: %.4f\n", wave(limit));
+    return 0;
+}
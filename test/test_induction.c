@@ -0,0 +1,60 @@
+// Flattened 2-D arrays indexed as a[i * n + j]: the inner loops count the
+// offset directly or iterate a row slice
+int a[48];
+int b[48];
+int c[48];
+
+int trace_sum(int rows, int cols) {
+    int s = 0;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            s = s + a[i * cols + j];
+        }
+    }
+    return s;
+}
+
+void add_matrices(int rows, int cols) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            c[i * cols + j] = a[i * cols + j] + b[i * cols + j];
+        }
+    }
+}
+
+int row_max(int row, int cols) {
+    int best = a[row * cols];
+    for (int j = 1; j < cols; j++) {
+        if (a[row * cols + j] > best) {
+            best = a[row * cols + j];
+        }
+    }
+    return best;
+}
+
+int weighted(int rows, int cols) {
+    int s = 0;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            s = s + a[i * cols + j] * b[j];
+        }
+    }
+    return s;
+}
+
+int main() {
+    for (int k = 0; k < 48; k++) {
+        a[k] = (k * 5) % 11 - 3;
+        b[k] = k % 7;
+    }
+    int t = trace_sum(6, 8);
+    add_matrices(6, 8);
+    int check = 0;
+    for (int k = 0; k < 48; k++) {
+        check = check + c[k] * (k + 1);
+    }
+    int m = row_max(2, 8);
+    int w = weighted(4, 12);
+    printf("%d %d %d %d\n", t, check, m, w);
+    return 0;
+}
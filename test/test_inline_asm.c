@@ -0,0 +1,43 @@
+// Inline assembly idioms translated to Python integer operations
+int main() {
+    int x = 305419896;
+    int n = 0;
+    int high = 0;
+    int low = 0;
+    int swapped = 0;
+    int y = 10;
+    int m = -1;
+
+    asm("popcnt %1, %0" : "=r"(n) : "r"(x));
+    printf("popcnt: %d\n", n);
+    asm("bsrl %1, %0" : "=r"(high) : "r"(x));
+    asm("bsfl %1, %0" : "=r"(low) : "r"(x));
+    printf("bsr: %d bsf: %d\n", high, low);
+
+    swapped = x;
+    asm("bswap %0" : "+r"(swapped));
+    printf("bswap: %d\n", swapped);
+
+    asm("roll $8, %0" : "+r"(x));
+    printf("rol: %d\n", x);
+    asm("rorl $12, %0" : "+r"(x));
+    printf("ror: %d\n", x);
+
+    asm("movl %1, %%eax\n\t"
+        "imull $3, %%eax\n\t"
+        "addl %%eax, %0"
+        : "+r"(y) : "r"(x) : "eax");
+    printf("mov/imul/add: %d\n", y);
+
+    asm("popcnt %1, %0" : "=r"(n) : "r"(m));
+    asm("shrl $28, %0" : "+r"(m));
+    printf("popcnt(-1): %d shr: %d\n", n, m);
+
+    // Both outputs are read before either is written
+    asm("xchgl %0, %1" : "+r"(m), "+r"(y));
+    printf("xchg: %d %d\n", m, y);
+
+    // Not translated: cpuid has no Python equivalent
+    asm volatile("cpuid" : : : "eax", "ebx", "ecx", "edx");
+    return 0;
+}
@@ -0,0 +1,71 @@
+// C integer semantics: 32-bit wraparound, truncating division and remainder
+int hash(int n) {
+    int h = 17;
+    for (int i = 0; i < n; i++) {
+        h = h * 31 + i;
+    }
+    return h;
+}
+
+int divide(int a, int b) {
+    return a / b;
+}
+
+int remainder(int a, int b) {
+    return a % b;
+}
+
+int digit_sum(int n) {
+    int total = 0;
+    if (n < 0) {
+        n = -n;
+    }
+    while (n > 0) {
+        total = total + n % 10;
+        n = n / 10;
+    }
+    return total;
+}
+
+int data[4];
+
+int average(int count) {
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        total += data[i];
+    }
+    return total / count;
+}
+
+// The loop becomes a product of every element, wrapped once
+int product_of(int count) {
+    int product = 1;
+    for (int i = 0; i < count; i++) {
+        product *= data[i] * 1000;
+    }
+    return product;
+}
+
+// Bitwise operations on ints never leave the int range
+int mix(int a, int b) {
+    return (a | b) ^ (a & -4) ^ (b | -16);
+}
+
+int main() {
+    data[0] = -7;
+    data[1] = -8;
+    data[2] = 3;
+    data[3] = -1;
+    printf("%d\n", hash(20));
+    printf("%d\n", divide(-7, 2));
+    printf("%d\n", divide(7, -2));
+    printf("%d\n", remainder(-7, 2));
+    printf("%d\n", remainder(7, -3));
+    printf("%d\n", digit_sum(-4096));
+    printf("%d\n", average(4));
+    printf("%d\n", product_of(4));
+    printf("%d %d\n", mix(-5, 12), mix(2147483647, -2147483647));
+    printf("%d\n", 2147483647 + 1);
+    printf("%d\n", (1 << 30) * 4);
+    return 0;
+}
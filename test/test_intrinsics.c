@@ -0,0 +1,55 @@
+// math.h, stdlib.h, string.h and ctype.h calls mapped to Python builtins and str methods
+
+char word[8];
+
+float distance(float x, float y) {
+    return sqrt(pow(x, 2) + pow(y, 2));
+}
+
+int count_digits(int n) {
+    int i;
+    int digits = 0;
+    for (i = 0; i < n; i++) {
+        if (isdigit(word[i])) {
+            digits++;
+        }
+    }
+    return digits;
+}
+
+int main() {
+    int i;
+    int n = -7;
+    float x = 3.0;
+    float y = -4.0;
+    float total = 0.0;
+
+    printf("distance: %f\n", distance(x, y));
+    printf("abs: %d %f %f\n", abs(n), fabs(y), fabs(n));
+    printf("pow: %f %f\n", pow(x, 3), pow(2, 0.5));
+    printf("rounding: %f %f %f\n", floor(y / 3), ceil(x / 2), fmod(x * 5, 4));
+    for (i = 1; i <= 10; i++) {
+        total = total + log(i) + exp(-i) + sin(i) * cos(i);
+    }
+    printf("series: %.4f %f\n", total, atan2(y, x));
+    // Outside the domain C returns NaN (never equal to itself) or inf instead of failing
+    printf("domain: %d %d %d %d %d\n", sqrt(y) != sqrt(y), log(y) != log(y), acos(x) != acos(x),
+           asin(-x) != asin(-x), log10(-x) != log10(-x));
+    printf("domain: %f %f %f %f\n", log(0.0), log2(x - x), exp(1000.0 * x), exp(-1000.0 * x));
+
+    word[0] = 'c';
+    word[1] = '4';
+    word[2] = 'p';
+    word[3] = '2';
+    printf("strlen: %d %d\n", strlen(word), strlen("hello"));
+    printf("digits: %d\n", count_digits(strlen(word)));
+    printf("strcmp: %d %d %d\n", strcmp(word, "c4p2"), strcmp("abc", "abd") < 0, strcmp(word, "c4") > 0);
+    printf("ctype: %c%c %d %d\n", toupper(word[0]), tolower('Q'), isalpha(word[2]) != 0, isspace(word[1]) != 0);
+
+    // Strings terminated explicitly, with 0 and with '\0'
+    word[2] = 0;
+    printf("terminated: %d %d %d\n", strlen(word), strcmp(word, "c4"), word[3] == '2');
+    word[1] = '\0';
+    printf("terminated: %d %d %d\n", strlen(word), strcmp(word, "c4") < 0, word[2] == 0);
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Loop-invariant expressions hoisted out of loops
+struct Point {
+    int x;
+    int y;
+};
+
+int scale(int v) {
+    return v * 3;
+}
+
+int weighted(int n, int k) {
+    struct Point p;
+    p.x = 4;
+    p.y = 5;
+    int total = 0;
+    int i = 0;
+    while (i < n * 2) {
+        total = total + (p.x + p.y) * k + i;
+        i++;
+    }
+    return total;
+}
+
+int grid(int rows, int cols) {
+    int acc = 0;
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            acc = acc + rows * cols - c + r;
+        }
+    }
+    return acc;
+}
+
+int safe_divide(int n, int d) {
+    int count = 0;
+    int i = 0;
+    while (i < n) {
+        if (d != 0) {
+            count = count + 100 / d;
+        }
+        i = i + 1;
+    }
+    return count;
+}
+
+int calls(int n, int m) {
+    int total = 0;
+    int i = 0;
+    while (i < scale(m)) {
+        total = total + i;
+        i = i + 1;
+    }
+    return total + n;
+}
+
+int root_below(int n, int k) {
+    int i = 0;
+    while (i * i < n * k && i < scale(n)) {
+        i++;
+    }
+    return i;
+}
+
+int main() {
+    printf("%d\n", weighted(5, 2));
+    printf("%d\n", grid(3, 4));
+    printf("%d\n", safe_divide(4, 0));
+    printf("%d\n", safe_divide(4, 7));
+    printf("%d\n", calls(1, 3));
+    printf("%d\n", root_below(10, 5));
+    return 0;
+}
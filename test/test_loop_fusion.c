@@ -0,0 +1,63 @@
+// Adjacent loops over the same range fused into one
+int a[8];
+int b[8];
+int c[8];
+
+int scale(int x) {
+    return x * 3;
+}
+
+int main() {
+    int i;
+    int n = 8;
+    int total = 0;
+    int shift = 2;
+
+    // Same counter, element-wise dependence through a[i]
+    for (i = 0; i < n; i++) {
+        a[i] = i * i;
+    }
+    for (i = 0; i < n; i++) {
+        b[i] = a[i] + shift;
+    }
+    for (i = 0; i < n; i++) {
+        int t = b[i] - a[i];
+        total += t;
+    }
+
+    // Second loop declares its own counter and a private temporary
+    for (int k = 0; k < n; k++) {
+        int t = scale(k);
+        c[k] = t;
+    }
+    for (int j = 0; j < n; j++) {
+        int t = c[j] + 1;
+        total += t;
+    }
+
+    // While loops with the same bounds
+    i = 1;
+    while (i < n) {
+        a[i] = a[i] + 1;
+        i++;
+    }
+    i = 1;
+    while (i < n) {
+        b[i] = b[i] * 2;
+        i++;
+    }
+
+    // Reads a neighbouring element, so it must stay separate
+    for (i = 0; i < n - 1; i++) {
+        c[i] = a[i] + b[i];
+    }
+    for (i = 0; i < n - 1; i++) {
+        a[i + 1] = c[i] + c[i + 1];
+    }
+
+    for (i = 0; i < n; i++) {
+        printf("%d %d %d\n", a[i], b[i], c[i]);
+    }
+    printf("total = %d, i = %d\n", total, i);
+    return 0;
+}
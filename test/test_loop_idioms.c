@@ -0,0 +1,117 @@
+// Reductions and searches replaced by Python builtins
+int values[10];
+
+int sum_squares(int n) {
+    int total = 0;
+    for (int i = 1; i <= n; i++) {
+        total += i * i + 2 * i - 3;
+    }
+    return total;
+}
+
+int count_multiples(int k) {
+    int count = 0;
+    for (int i = 0; i < 10; i++) {
+        if (values[i] % k == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int smallest() {
+    int best = values[0];
+    for (int i = 1; i < 10; i++) {
+        if (values[i] < best) {
+            best = values[i];
+        }
+    }
+    return best;
+}
+
+int largest_in(int lo, int hi) {
+    int best = -1;
+    for (int i = lo; i < hi; i++) {
+        if (best < values[i]) {
+            best = values[i];
+        }
+    }
+    return best;
+}
+
+int product_upto(int n) {
+    int product = 1;
+    for (int i = 1; i <= n; i++) {
+        product = product * i;
+    }
+    return product;
+}
+
+// Overflows int: the reduced sum wraps like the C loop
+int scaled_total(int scale) {
+    int total = 0;
+    for (int i = 0; i < 10; i++) {
+        total = total + values[i] * scale;
+    }
+    return total;
+}
+
+// C division and remainder truncate toward zero, also inside the reduction
+int quarter_total() {
+    int total = 0;
+    for (int i = 0; i < 10; i++) {
+        total += values[i] / 4;
+    }
+    return total;
+}
+
+int count_remainder(int r) {
+    int count = 0;
+    for (int i = 0; i < 10; i++) {
+        if (values[i] % 3 == r) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int position_of(int key) {
+    for (int i = 0; i < 10; i++) {
+        if (values[i] == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int has_negative(int n) {
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        if (values[i] < 0) {
+            found = 1;
+            break;
+        }
+    }
+    return found;
+}
+
+int main() {
+    for (int i = 0; i < 10; i++) {
+        values[i] = (i * 7) % 11 - 3;
+    }
+    printf("%d\n", sum_squares(10));
+    printf("%d\n", sum_squares(0));
+    printf("%d\n", count_multiples(2));
+    printf("%d\n", smallest());
+    printf("%d\n", largest_in(2, 6));
+    printf("%d\n", largest_in(6, 2));
+    printf("%d\n", product_upto(10));
+    printf("%d\n", product_upto(13));
+    printf("%d\n", scaled_total(1000000000));
+    printf("%d %d %d\n", quarter_total(), count_remainder(-1), count_remainder(2));
+    printf("%d\n", position_of(4));
+    printf("%d\n", position_of(100));
+    printf("%d\n", has_negative(3));
+    printf("%d\n", has_negative(1));
+    return 0;
+}
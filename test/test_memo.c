@@ -0,0 +1,35 @@
+// Pure recursive functions are memoized
+int fib(int n) {
+    if (n < 2) {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+int binomial(int n, int k) {
+    if (k == 0 || k == n) {
+        return 1;
+    }
+    return binomial(n - 1, k - 1) + binomial(n - 1, k);
+}
+
+// Reads a global array that main fills, so it must not be memoized
+int weights[10];
+
+int weighted(int n) {
+    if (n <= 0) {
+        return weights[0];
+    }
+    return weights[n % 10] + weighted(n - 1);
+}
+
+int main() {
+    printf("fib(30) = %d\n", fib(30));
+    printf("C(20, 10) = %d\n", binomial(20, 10));
+    printf("weighted(5) = %d\n", weighted(5));
+    for (int i = 0; i < 10; i++) {
+        weights[i] = i * 3;
+    }
+    printf("weighted(5) = %d\n", weighted(5));
+    return 0;
+}
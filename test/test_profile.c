@@ -0,0 +1,37 @@
+// A hot loop, a hot recursive helper and a path the run never takes.
+// With --profile-use only the paths that ran are specialized and tabulated.
+int fib(int n) {
+    if (n < 2) {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+int scale(int x, int mode) {
+    if (mode == 1) {
+        return x * 2;
+    }
+    return x + 1;
+}
+
+int rare(int x, int mode) {
+    if (mode == 2) {
+        return x * 3;
+    }
+    return x - 1;
+}
+
+int main() {
+    int total = 0;
+    for (int i = 0; i < 100; i++) {
+        total = total + scale(i, 1);
+    }
+    if (total < 0) {
+        for (int j = 0; j < 10; j++) {
+            total = total + rare(j, 2);
+        }
+    }
+    int f = fib(15);
+    printf("%d %d\n", total, f);
+    return 0;
+}
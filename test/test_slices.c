@@ -0,0 +1,57 @@
+// memcpy/memset/memmove calls and copy, shift and fill loops as slice assignments
+int src[10];
+int dst[10];
+char text[6];
+
+int main() {
+    int i;
+    int n = 10;
+    int pos = 3;
+    int total = 0;
+
+    for (i = 0; i < n; i++) {
+        src[i] = i * 7 % 11;
+    }
+
+    memcpy(dst, src, n * sizeof(int));
+    memset(dst + 6, 0, 4 * sizeof(int));
+    memmove(src + 1, src, 5 * sizeof(int));
+    memset(text, 'x', sizeof(text));
+    for (i = 0; i < 10; i++) {
+        total = total * 3 + dst[i] + src[i];
+    }
+    printf("after calls: %d %c\n", total, text[5]);
+    memset(src, -1, 2 * sizeof(int));
+    memset(src + 2, pos, sizeof(int));
+    printf("memset bytes: %d %d %d\n", src[0], src[1], src[2]);
+    memset(text, 0, sizeof(text));
+    memset(text, 'y', 3);
+    printf("cleared text: %d %c\n", strlen(text), text[2]);
+    memset(text + 3, text[0], 2);
+    memset(text + 1, '\0', 1);
+    printf("refilled text: %d %c %d\n", strlen(text), text[4], text[5] == 0);
+
+    // Copy loop with offsets, shift left and shift right in place
+    for (i = 0; i < 5; i++) {
+        dst[i + 5] = src[i];
+    }
+    for (i = pos; i < n - 1; i++) {
+        src[i] = src[i + 1];
+    }
+    for (i = n - 1; i > pos; i--) {
+        dst[i] = dst[i - 1];
+    }
+    // A forward shift right smears one element, so it must stay a loop
+    for (i = 1; i < 4; i++) {
+        src[i] = src[i - 1];
+    }
+    // Fill with a loop-invariant value
+    for (i = pos; i < n; i++) {
+        dst[i] = pos * 2;
+    }
+
+    for (i = 0; i < 10; i++) {
+        printf("%d %d\n", src[i], dst[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+// Helpers specialized for the constant mode and stride arguments they receive
+int data[16];
+
+int combine(int a, int b, int mode) {
+    if (mode == 0) {
+        return a + b;
+    } else if (mode == 1) {
+        return a * b;
+    }
+    return a - b;
+}
+
+int strided_sum(int count, int stride) {
+    int total = 0;
+    int i = 0;
+    if (stride <= 0) {
+        return 0;
+    }
+    while (i < count) {
+        total = total + data[i * stride];
+        i++;
+    }
+    return total;
+}
+
+int depth(int n, int verbose) {
+    if (n == 0) {
+        return 0;
+    }
+    if (verbose) {
+        printf("level %d\n", n);
+    }
+    return 1 + depth(n - 1, verbose);
+}
+
+int main() {
+    for (int i = 0; i < 16; i++) {
+        data[i] = i * 3 - 7;
+    }
+    int acc = 0;
+    for (int i = 0; i < 5; i++) {
+        acc = acc + combine(i, data[i], 0);
+        acc = acc + combine(acc, 3, 1);
+        acc = combine(acc, data[i + 1], 2);
+    }
+    printf("%d\n", acc);
+    printf("%d %d\n", strided_sum(data[3] + 3, 2), strided_sum(data[3] + 2, 3));
+    printf("%d\n", depth(data[4], 1));
+    printf("%d\n", depth(data[5], 0));
+    return 0;
+}
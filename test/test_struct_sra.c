@@ -0,0 +1,65 @@
+// Struct locals split into scalars; member accesses cached around loops
+struct Point {
+    int x;
+    int y;
+};
+
+struct Stats {
+    int count;
+    int total;
+    float scale;
+};
+
+int manhattan(int ax, int ay, int bx, int by) {
+    struct Point d;
+    d.x = ax - bx;
+    d.y = ay - by;
+    if (d.x < 0) {
+        d.x = -d.x;
+    }
+    if (d.y < 0) {
+        d.y = -d.y;
+    }
+    return d.x + d.y;
+}
+
+int walk(int steps) {
+    struct Point p;
+    int i;
+    p.x = 1;
+    p.y = 3;
+    for (i = 0; i < steps; i++) {
+        p.x = p.x + 2;
+        p.y = p.y + p.x;
+    }
+    return p.y - p.x;
+}
+
+int accumulate(struct Stats s, int n) {
+    int i = 0;
+    while (i < n) {
+        s.count = s.count + 1;
+        s.total = s.total + i * s.count;
+        i++;
+    }
+    return s.total;
+}
+
+int main() {
+    struct Stats s;
+    struct Point origin;
+    s.count = 3;
+    s.total = 10;
+    s.scale = 1.5;
+    printf("%d\n", manhattan(1, 7, 4, 2));
+    printf("%d\n", walk(10));
+    printf("%d\n", accumulate(s, 5));
+    origin.x = 0;
+    origin.y = 0;
+    int j;
+    for (j = 0; j < 4; j++) {
+        origin.x = origin.x + j;
+    }
+    printf("%d\n", origin.x);
+    return 0;
+}
@@ -0,0 +1,141 @@
+// switch statements: a dense state machine (decision tree), a constant
+// mapping (lookup table), a small sparse switch (if chain), fall-through,
+// grouped labels, char labels and breaks nested in ifs
+
+int next_state(int state, int input) {
+    switch (state) {
+        case 0:
+            if (input > 5) return 1;
+            return 2;
+        case 1:
+            if (input % 2 == 0) return 3;
+            return 4;
+        case 2:
+            return 5;
+        case 3:
+            return 6;
+        case 4:
+            return 7;
+        case 5:
+            return 0;
+        case 6:
+            return 8;
+        case 7:
+            return 8;
+        case 8:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+int days_in_month(int month) {
+    int days = 0;
+    switch (month) {
+        case 1: days = 31; break;
+        case 2: days = 28; break;
+        case 3: days = 31; break;
+        case 4: days = 30; break;
+        case 5: days = 31; break;
+        case 6: days = 30; break;
+        case 7: days = 31; break;
+        case 8: days = 31; break;
+        case 9: days = 30; break;
+        case 10: days = 31; break;
+        case 11: days = 30; break;
+        case 12: days = 31; break;
+        default: days = -1; break;
+    }
+    return days;
+}
+
+int weight(int code) {
+    int w = 0;
+    switch (code) {
+        case 100:
+            w = w + 1;
+        case 250:
+            w = w + 10;
+            break;
+        case 999:
+        case -7:
+            w = 500;
+            break;
+    }
+    return w;
+}
+
+int classify(char c) {
+    switch (c) {
+        case 'a': case 'e': case 'i': case 'o': case 'u':
+            return 1;
+        case ' ':
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+int bucket(int x) {
+    int r = 0;
+    switch (x) {
+        case 0: case 1: case 2: case 3:
+            r = 1;
+            break;
+        case 4: case 5: case 6: case 7:
+            r = 2;
+            if (x == 6) break;
+            r = r + 10;
+            break;
+        case 8: case 9: case 10: case 11: case 12: case 13: case 14: case 15:
+            r = 3;
+        default:
+            r = r + 100;
+    }
+    return r;
+}
+
+int skip_odd(int n) {
+    int total = 0;
+    for (int i = 0; i < n; i++) {
+        switch (i % 4) {
+            case 1:
+                if (i > 10) break;
+                continue;
+            case 3:
+                continue;
+            default:
+                total = total + i;
+        }
+        total = total + 1;
+    }
+    return total;
+}
+
+int main() {
+    int state = 0;
+    int trace = 0;
+    for (int i = 0; i < 40; i++) {
+        state = next_state(state, (i * 7) % 11);
+        trace = trace * 3 + state;
+        trace = trace % 100003;
+    }
+    printf("%d\n", trace);
+
+    int total = 0;
+    for (int m = 0; m <= 13; m++) {
+        total = total + days_in_month(m);
+    }
+    printf("%d\n", total);
+
+    printf("%d %d %d %d %d\n", weight(100), weight(250), weight(999), weight(-7), weight(3));
+    printf("%d %d %d\n", classify('e'), classify(' '), classify('z'));
+
+    int b = 0;
+    for (int x = -2; x < 18; x++) {
+        b = b + bucket(x) * (x + 3);
+    }
+    printf("%d\n", b);
+    printf("%d\n", skip_odd(30));
+    return 0;
+}
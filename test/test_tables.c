@@ -0,0 +1,63 @@
+// Brace-initialized arrays: tables nothing writes become module-level
+// tuple or bytes constants, tables that are written stay lists
+
+int crc_table[16] = {0, 498536548, 997073096, 651767980, 1994146192, 1802195444, 1303535960, 1342533948,
+                     -306674912, -267414716, -690576408, -882789492, -1687895376, -2032938284, -1609899400, -1111625188};
+int popcount4[] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+int history[8] = {5, 3};
+float weights[] = {0.25, 0.5, -0.75};
+char hex_digits[] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+
+int crc_nibbles(int value) {
+    int crc = 0;
+    for (int i = 0; i < 8; i++) {
+        int nibble = (value >> (i * 4)) & 15;
+        crc = crc_table[(crc ^ nibble) & 15] ^ (crc >> 4 & 268435455);
+    }
+    return crc;
+}
+
+int bits(int x) {
+    return popcount4[x & 15] + popcount4[(x >> 4) & 15];
+}
+
+int sum_popcounts() {
+    int s = 0;
+    for (int i = 0; i < 16; i++) {
+        s = s + popcount4[i];
+    }
+    return s;
+}
+
+void push(int value) {
+    for (int i = 7; i > 0; i--) {
+        history[i] = history[i - 1];
+    }
+    history[0] = value;
+}
+
+int decode(int op, int x) {
+    int costs[] = {1, 3, 3, 7, 2};
+    int scratch[3] = {1, 2, 3};
+    scratch[op % 3] = x;
+    return costs[op % 5] * x + scratch[0] + scratch[1] + scratch[2];
+}
+
+int main() {
+    printf("%d %d\n", crc_nibbles(123456789), crc_nibbles(42));
+    int total = 0;
+    for (int x = 0; x < 256; x = x + 7) {
+        total = total + bits(x);
+    }
+    printf("%d %d\n", total, sum_popcounts());
+    push(9);
+    push(4);
+    printf("%d %d %d %d\n", history[0], history[1], history[2], history[7]);
+    printf("%d %d\n", decode(3, 10), decode(7, -2));
+    float acc = 0.0;
+    for (int i = 0; i < 3; i++) {
+        acc = acc + weights[i] * (i + 1);
+    }
+    printf("%f %c%c\n", acc, hex_digits[11], hex_digits[4]);
+    return 0;
+}
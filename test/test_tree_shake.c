@@ -0,0 +1,47 @@
+// Only main and what it reaches should be emitted
+
+struct Pair {
+    int a;
+    int b;
+};
+
+struct Unused {
+    int x;
+};
+
+int totals[2];
+int scratch[4];
+
+int square(int x) {
+    return x * x;
+}
+
+int cube(int x) {
+    return x * x * x;
+}
+
+int unused_helper(int x) {
+    scratch[0] = x;
+    return cube(x) + 1;
+}
+
+void bump(int n) {
+    totals[0] = totals[0] + n;
+    totals[1] = totals[1] + 1;
+}
+
+int main() {
+    struct Pair last;
+    int i;
+    last.a = 0;
+    last.b = 0;
+    bump(square(3) + square(4));
+    for (i = 1; i <= 5; i++) {
+        last.a = last.b;
+        last.b = square(i) - i;
+        bump(last.b);
+    }
+    printf("total = %d over %d calls\n", totals[0], totals[1]);
+    printf("last two = %d %d\n", last.a, last.b);
+    return 0;
+}
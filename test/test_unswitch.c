@@ -0,0 +1,60 @@
+// Loops testing a flag that no iteration changes are split into one loop per branch
+int data[64];
+
+int signed_total(int n, int subtract) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        if (subtract) {
+            s = s - data[i];
+        } else {
+            s = s + data[i];
+        }
+    }
+    return s;
+}
+
+int clipped(int n, int clip, int limit) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        int v = data[i] * 3;
+        if (clip && v > limit) {
+            v = limit;
+        }
+        s = s + v;
+        i++;
+    }
+    return s;
+}
+
+int scaled(int n, int mode, int verbose) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        if (mode == 1) {
+            s = s + 2 * data[i];
+        } else if (mode == 2) {
+            s = s + data[i] * data[i];
+        } else {
+            s = s + 1;
+        }
+        if (verbose) {
+            printf("step %d %d\n", i, s);
+        }
+    }
+    return s;
+}
+
+int main() {
+    for (int i = 0; i < 64; i++) {
+        data[i] = (i * 7) % 13 - 4;
+    }
+    int a = signed_total(64, 0);
+    int b = signed_total(64, 1);
+    int c = clipped(64, 1, 20);
+    int d = clipped(64, 0, 20);
+    int e = scaled(64, 1, 0);
+    int f = scaled(64, 2, 0);
+    int g = scaled(4, 3, 1);
+    printf("%d %d %d %d %d %d %d\n", a, b, c, d, e, f, g);
+    return 0;
+}